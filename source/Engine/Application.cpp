@@ -45,25 +45,43 @@ public:
     static int         StartSceneNum;
 
     static bool        DevMenuActivated;
+
+    static bool        Headless;
 };
 #endif
 
 #include <Engine/Application.h>
 #include <Engine/Graphics.h>
 
+#include <Engine/Audio/AudioBenchmark.h>
+#include <Engine/Audio/AudioMixer.h>
 #include <Engine/Bytecode/ScriptManager.h>
 #include <Engine/Bytecode/ScriptEntity.h>
 #include <Engine/Bytecode/GarbageCollector.h>
+#include <Engine/Bytecode/RegisterTier.h>
+#include <Engine/Bytecode/VMBenchmark.h>
+#include <Engine/Bytecode/VMProfiler.h>
+#include <Engine/Bytecode/VMTierCheck.h>
 #include <Engine/Bytecode/SourceFileMap.h>
 #include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/FrameBenchmark.h>
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
 #include <Engine/Diagnostics/MemoryPools.h>
+#include <Engine/Diagnostics/PerformanceMeasure.h>
 #include <Engine/Filesystem/Directory.h>
+#include <Engine/ResourceTypes/ResourceLoader.h>
 #include <Engine/ResourceTypes/ResourceManager.h>
+#include <Engine/ResourceTypes/TextureCache.h>
+#include <Engine/Rendering/Software/SoftwareRenderer.h>
+#include <Engine/Rendering/TextureAtlas.h>
+#include <Engine/Rendering/Software/SpanBlitter.h>
+#include <Engine/Scene/ParallelUpdate.h>
 #include <Engine/Scene/SceneInfo.h>
+#include <Engine/Scene/SensorBenchmark.h>
 #include <Engine/TextFormats/XML/XMLParser.h>
 #include <Engine/TextFormats/XML/XMLNode.h>
+#include <Engine/Types/EntityBenchmark.h>
 #include <Engine/Utilities/StringUtils.h>
 
 #include <Engine/Media/MediaSource.h>
@@ -138,6 +156,8 @@ int         Application::StartSceneNum = 0;
 
 bool        Application::DevMenuActivated = false;
 
+bool        Application::Headless = false;
+
 char    StartingScene[256];
 
 bool    DevMenu = false;
@@ -198,6 +218,18 @@ PUBLIC STATIC void Application::Init(int argc, char* args[]) {
     SDL_SetHint(SDL_HINT_ANDROID_SEPARATE_MOUSE_AND_TOUCH, "1");
     #endif
 
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(args[i], "--headless"))
+            Application::Headless = true;
+    }
+
+    // SDL's dummy drivers never open anything on the system, so the
+    // window here is just a size and no sound is played.
+    if (Application::Headless) {
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+        SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_JOYSTICK | SDL_INIT_GAMECONTROLLER) < 0) {
         Log::Print(Log::LOG_INFO, "SDL_Init failed with error: %s", SDL_GetError());
     }
@@ -419,6 +451,32 @@ PUBLIC STATIC void Application::GetPerformanceSnapshot() {
             }
         }
 
+        // Renderer Performance Snapshot
+        Log::Print(Log::LOG_IMPORTANT, "Renderer Performance Snapshot:");
+        Log::Print(Log::LOG_INFO, "Draw Calls:      %8u\n"
+            "Sprite Batches:  %8u\n"
+            "Batched Sprites: %8u\n"
+            "Texture Binds:   %8u",
+            Graphics::PERF_Renderer.DrawCalls,
+            Graphics::PERF_Renderer.SpriteBatches,
+            Graphics::PERF_Renderer.BatchedSprites,
+            Graphics::PERF_Renderer.TextureBinds);
+
+        int atlasPages, atlasSheets;
+        double atlasUsage;
+        TextureAtlas::GetStats(&atlasPages, &atlasSheets, &atlasUsage);
+        if (atlasPages) {
+            // Each sheet switch on a page would otherwise have been a
+            // bind, and also a draw call when sprites are batched.
+            Uint32 switches = Graphics::PERF_Renderer.AtlasSheetSwitches;
+            Log::Print(Log::LOG_INFO, "Atlas Pages:     %8d (%d sheets, %.1f%% used)\n"
+                "Binds Saved:     %8u\n"
+                "Draws Saved:     %8u",
+                atlasPages, atlasSheets, atlasUsage * 100.0,
+                switches,
+                Graphics::SpriteBatching ? switches : 0);
+        }
+
         // Object Performance Snapshot
         double totalUpdateEarly = 0.0;
         double totalUpdate = 0.0;
@@ -450,6 +508,14 @@ PUBLIC STATIC void Application::GetPerformanceSnapshot() {
 
         Log::Print(Log::LOG_IMPORTANT, "Garbage Size:");
         Log::Print(Log::LOG_INFO, "%u", (Uint32)GarbageCollector::GarbageSize);
+
+        Log::Print(Log::LOG_IMPORTANT, "Garbage Collector (%s, %u cycles):", GarbageCollector::Incremental ? "incremental" : "stop-the-world", GarbageCollector::CycleCount);
+        Log::Print(Log::LOG_INFO, "Gray %.3f ms, Blacken %.3f ms, Free %.3f ms\n"
+            "           - Steps: %u (last %.3f ms, longest %.3f ms)\n"
+            "           - Freed %u objects out of %u",
+            GarbageCollector::GrayTime, GarbageCollector::BlackenTime, GarbageCollector::FreeTime,
+            GarbageCollector::StepCount, GarbageCollector::LastStepTime, GarbageCollector::LongestStepTime,
+            GarbageCollector::ObjectsFreed, GarbageCollector::ObjectsSwept);
     }
 }
 
@@ -497,6 +563,10 @@ PUBLIC STATIC void Application::UpdateWindowTitle() {
     if (Stepper) {
         ADD_TEXT("Frame Stepper ON");
     }
+
+    if (VMProfiler::Enabled) {
+        ADD_TEXT("Profiling");
+    }
 #undef ADD_TEXT
 
     if (paren)
@@ -513,10 +583,12 @@ PRIVATE STATIC void Application::Restart() {
 
     Scene::Dispose();
     SceneInfo::Dispose();
+    ResourceLoader::Clear();
     Graphics::SpriteSheetTextureMap->WithAll([](Uint32, Texture* tex) -> void {
         Graphics::DisposeTexture(tex);
     });
     Graphics::SpriteSheetTextureMap->Clear();
+    TextureAtlas::Dispose();
 
     ScriptManager::LoadAllClasses = false;
     ScriptEntity::DisableAutoAnimate = false;
@@ -574,6 +646,14 @@ PRIVATE STATIC void Application::LoadAudioSettings() {
 
 #undef GET_OR_SET_VOLUME
 
+    char resampling[16];
+    if (settings->GetString("audio", "resampling", resampling, sizeof resampling)) {
+        if (!strcmp(resampling, "cubic"))
+            AudioMixer::Interpolation = AudioMixer::INTERPOLATE_CUBIC;
+        else
+            AudioMixer::Interpolation = AudioMixer::INTERPOLATE_LINEAR;
+    }
+
     Application::SetMasterVolume(masterVolume);
     Application::SetMusicVolume(musicVolume);
     Application::SetSoundVolume(soundVolume);
@@ -620,6 +700,7 @@ PRIVATE STATIC void Application::LoadKeyBinds() {
     GET_KEY("devShowTileCol",        DevTileCol,       Key_F7);
     GET_KEY("devShowObjectRegions",  DevObjectRegions, Key_F8);
     GET_KEY("devQuit",               DevQuit,          Key_ESCAPE);
+    GET_KEY("devToggleProfiler",     DevProfiler,      Key_F11);
 
 #undef GET_KEY
 }
@@ -802,6 +883,12 @@ PRIVATE STATIC void Application::PollEvents() {
                         Application::UpdateWindowTitle();
                         break;
                     }
+                    // Start or stop the VM profiler (dev)
+                    else if (key == KeyBindsSDL[(int)KeyBind::DevProfiler]) {
+                        VMProfiler::Toggle();
+                        Application::UpdateWindowTitle();
+                        break;
+                    }
                 }
                 break;
             }
@@ -845,6 +932,9 @@ PRIVATE STATIC void Application::RunFrame(void* p) {
     Scene::AfterScene();
     MetricAfterSceneTime = Clock::GetTicks() - MetricAfterSceneTime;
 
+    // Finish off anything preloaded in the background
+    ResourceLoader::Update();
+
     if (DoNothing) goto DO_NOTHING;
 
     // Update
@@ -856,6 +946,7 @@ PRIVATE STATIC void Application::RunFrame(void* p) {
             // Poll for inputs
             MetricPollTime = Clock::GetTicks();
             InputManager::Poll();
+            FrameBenchmark::PollInput();
             MetricPollTime = Clock::GetTicks() - MetricPollTime;
 
             // Update scene
@@ -918,7 +1009,7 @@ PRIVATE STATIC void Application::RunFrame(void* p) {
         Graphics::SetBlendMode(BlendFactor_SRC_ALPHA, BlendFactor_INV_SRC_ALPHA, BlendFactor_SRC_ALPHA, BlendFactor_INV_SRC_ALPHA);
 
         float infoW = 400.0;
-        float infoH = 290.0;
+        float infoH = 310.0;
         float infoPadding = 20.0;
         Graphics::Save();
         Graphics::Translate(0.0, 0.0, 0.0);
@@ -1065,6 +1156,37 @@ PRIVATE STATIC void Application::RunFrame(void* p) {
                     DEBUG_DrawText(textBuffer, 0.0, 0.0);
                 Graphics::Restore();
 
+                listY += 20.0;
+
+                // Draw the tags using the most memory
+                if (Memory::IsCounting || Memory::IsTracking) {
+                    vector<MemoryTagStats> tagStats;
+                    Memory::GetTagStats(&tagStats);
+                    for (size_t i = 0; i < tagStats.size() && i < 5; i++) {
+                        MemoryTagStats& stats = tagStats[i];
+                        Graphics::Save();
+                        Graphics::Translate(infoPadding, listY, 0.0);
+                        Graphics::Scale(0.6, 0.6, 1.0);
+                            snprintf(textBuffer, 256, "%s: %.1f KB (Peak %.1f KB, %.0f allocs/s)",
+                                stats.Name ? stats.Name : "No name", stats.LiveBytes / 1000.0,
+                                stats.PeakBytes / 1000.0, stats.AllocationRate);
+                            DEBUG_DrawText(textBuffer, 0.0, 0.0);
+                        Graphics::Restore();
+
+                        listY += 20.0;
+                    }
+                }
+
+                const char* gcStates[] = { "Idle", "Marking", "Sweeping" };
+                Graphics::Save();
+                Graphics::Translate(infoPadding / 2.0, listY, 0.0);
+                Graphics::Scale(0.6, 0.6, 1.0);
+                    snprintf(textBuffer, 256, "GC: %s, Step %.3f ms (Max %.3f ms), Freed %u",
+                        gcStates[GarbageCollector::State], GarbageCollector::LastStepTime,
+                        GarbageCollector::LongestStepTime, GarbageCollector::ObjectsFreed);
+                    DEBUG_DrawText(textBuffer, 0.0, 0.0);
+                Graphics::Restore();
+
                 listY += 30.0;
 
                 float* listYPtr = &listY;
@@ -1093,6 +1215,17 @@ PRIVATE STATIC void Application::RunFrame(void* p) {
     MetricPresentTime = Clock::GetTicks() - MetricPresentTime;
 
     MetricFrameTime = Clock::GetTicks() - FrameTimeStart;
+
+    Perf_Application* perf = &PerformanceMeasure::PERF_Application;
+    perf->EventTime = MetricEventTime;
+    perf->AfterSceneTime = MetricAfterSceneTime;
+    perf->PollTime = MetricPollTime;
+    perf->UpdateTime = MetricUpdateTime;
+    perf->ClearTime = MetricClearTime;
+    perf->RenderTime = MetricRenderTime;
+    perf->FPSCounterTime = MetricFPSCounterTime;
+    perf->PresentTime = MetricPresentTime;
+    perf->FrameTime = MetricFrameTime;
 }
 PRIVATE STATIC void Application::DelayFrame() {
     // HACK: MacOS V-Sync timing gets disabled if window is not visible
@@ -1128,7 +1261,98 @@ PUBLIC STATIC void Application::Run(int argc, char* args[]) {
 
     Scene::Init();
 
-    if (argc > 1) {
+    bool runVMBenchmark = false;
+    bool runVMTierCheck = false;
+    bool runEntityBenchmark = false;
+    bool runSensorBenchmark = false;
+    bool runAudioBenchmark = false;
+    bool runFrameBenchmark = false;
+    bool bakeTextureCache = false;
+    bool packDataFile = false;
+    bool bakeTextureAtlas = false;
+    const char* packFilename = NULL;
+    int vmBenchmarkIterations = 0;
+    int entityBenchmarkCount = 0;
+    int sensorBenchmarkCount = 0;
+    int audioBenchmarkVoices = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(args[i], "--vm-benchmark")) {
+            runVMBenchmark = true;
+            if (i + 1 < argc)
+                StringUtils::ToNumber(&vmBenchmarkIterations, args[i + 1]);
+        }
+        else if (!strcmp(args[i], "--vm-tier-check")) {
+            runVMTierCheck = true;
+        }
+        else if (!strcmp(args[i], "--entity-benchmark")) {
+            runEntityBenchmark = true;
+            if (i + 1 < argc)
+                StringUtils::ToNumber(&entityBenchmarkCount, args[i + 1]);
+        }
+        else if (!strcmp(args[i], "--sensor-benchmark")) {
+            runSensorBenchmark = true;
+            if (i + 1 < argc)
+                StringUtils::ToNumber(&sensorBenchmarkCount, args[i + 1]);
+        }
+        else if (!strcmp(args[i], "--audio-benchmark")) {
+            runAudioBenchmark = true;
+            if (i + 1 < argc)
+                StringUtils::ToNumber(&audioBenchmarkVoices, args[i + 1]);
+        }
+        else if (!strcmp(args[i], "--benchmark")) {
+            runFrameBenchmark = true;
+            if (i + 1 < argc)
+                StringUtils::ToNumber(&FrameBenchmark::FrameCount, args[i + 1]);
+        }
+        else if (!strcmp(args[i], "--benchmark-output") && i + 1 < argc) {
+            StringUtils::Copy(FrameBenchmark::OutputFile, args[++i], sizeof FrameBenchmark::OutputFile);
+        }
+        else if (!strcmp(args[i], "--benchmark-input") && i + 1 < argc) {
+            StringUtils::Copy(FrameBenchmark::InputFile, args[++i], sizeof FrameBenchmark::InputFile);
+        }
+        else if (!strcmp(args[i], "--benchmark-hash")) {
+            FrameBenchmark::HashFrames = true;
+        }
+        else if (!strcmp(args[i], "--record-input") && i + 1 < argc) {
+            StringUtils::Copy(FrameBenchmark::RecordFile, args[++i], sizeof FrameBenchmark::RecordFile);
+        }
+        else if (!strcmp(args[i], "--bake-texture-cache")) {
+            bakeTextureCache = true;
+            if (i + 1 < argc && args[i + 1][0] != '-')
+                packFilename = args[++i];
+            else if (argc > 1 && !!StringUtils::StrCaseStr(args[1], ".hatch"))
+                packFilename = args[1];
+        }
+        else if (!strcmp(args[i], "--bake-atlas")) {
+            bakeTextureAtlas = true;
+            if (i + 1 < argc && args[i + 1][0] != '-')
+                packFilename = args[++i];
+        }
+        else if (!strcmp(args[i], "--pack")) {
+            packDataFile = true;
+            if (i + 1 < argc && args[i + 1][0] != '-')
+                packFilename = args[++i];
+        }
+    }
+
+    // Starts before the scene loads, so that it loads the same way
+    // on every run too.
+    if (runFrameBenchmark)
+        FrameBenchmark::Start();
+    FrameBenchmark::StartRecording();
+
+    if (packDataFile || bakeTextureAtlas || bakeTextureCache) {
+        // Packing goes first, since it starts the data file over
+        bool success = true;
+        if (packDataFile)
+            success = ResourceManager::PackDataFile(packFilename);
+        if (success && bakeTextureAtlas)
+            success = TextureAtlas::Bake(packFilename);
+        if (success && bakeTextureCache)
+            TextureCache::Bake(packFilename);
+        Running = false;
+    }
+    else if (argc > 1 && args[1][0] != '-') {
         char* pathStart = StringUtils::StrCaseStr(args[1], "/Resources/");
         if (pathStart == NULL)
             pathStart = StringUtils::StrCaseStr(args[1], "\\Resources\\");
@@ -1153,6 +1377,27 @@ PUBLIC STATIC void Application::Run(int argc, char* args[]) {
     Application::UpdateWindowTitle();
     Application::SetWindowSize(Application::WindowWidth, Application::WindowHeight);
 
+    if (runVMBenchmark) {
+        VMBenchmark::Run(vmBenchmarkIterations);
+        Running = false;
+    }
+    if (runVMTierCheck) {
+        VMTierCheck::Run();
+        Running = false;
+    }
+    if (runEntityBenchmark) {
+        EntityBenchmark::Run(entityBenchmarkCount);
+        Running = false;
+    }
+    if (runSensorBenchmark) {
+        SensorBenchmark::Run(sensorBenchmarkCount);
+        Running = false;
+    }
+    if (runAudioBenchmark) {
+        AudioBenchmark::Run(audioBenchmarkVoices);
+        Running = false;
+    }
+
     Graphics::Clear();
     Graphics::Present();
 
@@ -1169,7 +1414,13 @@ PUBLIC STATIC void Application::Run(int argc, char* args[]) {
                 BenchmarkTickStart = Clock::GetTicks();
 
             Application::RunFrame(NULL);
-            Application::DelayFrame();
+            if (FrameBenchmark::Active) {
+                // Frames run back to back, with no waiting in between.
+                if (!FrameBenchmark::EndFrame())
+                    Running = false;
+            }
+            else
+                Application::DelayFrame();
 
             BenchmarkFrameCount++;
             if (BenchmarkFrameCount == TargetFPS) {
@@ -1191,6 +1442,8 @@ PUBLIC STATIC void Application::Run(int argc, char* args[]) {
             }
         }
 
+        FrameBenchmark::Dispose();
+
         Scene::Dispose();
 
         if (DEBUG_fontSprite) {
@@ -1206,6 +1459,8 @@ PUBLIC STATIC void Application::Run(int argc, char* args[]) {
 }
 
 PUBLIC STATIC void Application::Cleanup() {
+    ParallelUpdate::Dispose();
+    ResourceLoader::Dispose();
     ResourceManager::Dispose();
     AudioManager::Dispose();
     InputManager::Dispose();
@@ -1472,8 +1727,35 @@ PUBLIC STATIC void Application::InitSettings(const char* filename) {
  #endif
     Application::Settings->GetInteger("dev", "logLevel", &logLevel);
     Application::Settings->GetBool("dev", "trackMemory", &Memory::IsTracking);
+    Application::Settings->GetBool("dev", "countMemory", &Memory::IsCounting);
     Log::SetLogLevel(logLevel);
 
+    Application::Settings->GetBool("dev", "incrementalGC", &GarbageCollector::Incremental);
+    Application::Settings->GetDecimal("dev", "gcStepTime", &GarbageCollector::MaxTimeAlotted);
+
+    char vmTier[16];
+    int vmTierMode = VM_TIER_AUTO;
+    int vmTierThreshold = (int)RegisterTier::HotCallCount;
+    if (Application::Settings->GetString("dev", "vmTier", vmTier, sizeof vmTier)) {
+        if (!strcmp(vmTier, "stack"))
+            vmTierMode = VM_TIER_STACK;
+        else if (!strcmp(vmTier, "register"))
+            vmTierMode = VM_TIER_REGISTER;
+    }
+    Application::Settings->GetInteger("dev", "vmTierThreshold", &vmTierThreshold);
+    if (vmTierThreshold >= 0)
+        RegisterTier::HotCallCount = (Uint32)vmTierThreshold;
+    RegisterTier::SetMode(vmTierMode);
+
+    Application::Settings->GetString("dev", "profilerOutput", VMProfiler::OutputFilename, sizeof(VMProfiler::OutputFilename));
+    Application::Settings->GetInteger("dev", "updateThreads", &ParallelUpdate::ThreadsRequested);
+    Application::Settings->GetInteger("dev", "softwareThreads", &SoftwareRenderer::ThreadsRequested);
+    Application::Settings->GetBool("dev", "softwareSIMD", &SpanBlitter::UseSIMD);
+    Application::Settings->GetBool("dev", "audioSIMD", &AudioMixer::UseSIMD);
+    Application::Settings->GetString("dev", "textureCache", TextureCache::CachePath, sizeof(TextureCache::CachePath));
+    Application::Settings->GetInteger("dev", "loaderThreads", &ResourceLoader::ThreadsRequested);
+    Application::Settings->GetDecimal("dev", "loaderUploadBudget", &ResourceLoader::UploadBudget);
+
     Application::Settings->GetBool("dev", "autoPerfSnapshots", &AutomaticPerformanceSnapshots);
     int apsFrameTimeThreshold = 20, apsMinInterval = 5;
     Application::Settings->GetInteger("dev", "apsMinFrameTime", &apsFrameTimeThreshold);
@@ -1483,6 +1765,9 @@ PUBLIC STATIC void Application::InitSettings(const char* filename) {
 
     Application::Settings->GetBool("display", "vsync", &Graphics::VsyncEnabled);
     Application::Settings->GetInteger("display", "multisample", &Graphics::MultisamplingEnabled);
+    Application::Settings->GetBool("display", "spriteBatching", &Graphics::SpriteBatching);
+    Application::Settings->GetBool("display", "textureAtlas", &TextureAtlas::Enabled);
+    Application::Settings->GetInteger("display", "textureAtlasSize", &TextureAtlas::PageSize);
     Application::Settings->GetInteger("display", "defaultMonitor", &Application::DefaultMonitor);
 }
 PUBLIC STATIC void Application::SaveSettings() {
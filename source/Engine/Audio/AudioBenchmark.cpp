@@ -0,0 +1,213 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+
+class AudioBenchmark {
+public:
+    static int DefaultVoices;
+};
+#endif
+
+#include <Engine/Audio/AudioBenchmark.h>
+
+#include <Engine/Audio/AudioChannel.h>
+#include <Engine/Audio/AudioManager.h>
+#include <Engine/Audio/AudioMixer.h>
+#include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/ResourceTypes/SoundFormats/SoundFormat.h>
+
+int AudioBenchmark::DefaultVoices = 64;
+
+// Seconds of audio mixed per pass
+#define BENCH_SECONDS 10
+// Length of the sound every voice loops, in frames
+#define BENCH_SOUND_FRAMES 22050
+
+static Uint32 BenchSeed;
+static Uint32 NextBenchRandom() {
+    BenchSeed = BenchSeed * 1103515245 + 12345;
+    return BenchSeed >> 16;
+}
+static float NextBenchFloat() {
+    return (float)NextBenchRandom() / 32768.0f;
+}
+
+// A few detuned harmonics and some noise, in the device's format.
+static Uint8* MakeSound() {
+    int channels = AudioManager::DeviceFormat.channels;
+    size_t samples = (size_t)BENCH_SOUND_FRAMES * channels;
+
+    float* source = (float*)Memory::Malloc(samples * sizeof(float));
+    Uint8* sound = (Uint8*)Memory::Malloc((size_t)BENCH_SOUND_FRAMES * AudioManager::BytesPerSample);
+    if (!source || !sound) {
+        Memory::Free(source);
+        Memory::Free(sound);
+        return NULL;
+    }
+
+    BenchSeed = 0x50D;
+    for (int i = 0; i < BENCH_SOUND_FRAMES; i++) {
+        double t = (double)i / BENCH_SOUND_FRAMES;
+        for (int c = 0; c < channels; c++) {
+            double v = 0.4 * sin(2.0 * M_PI * 220.0 * t * (1 + c))
+                + 0.2 * sin(2.0 * M_PI * 331.0 * t)
+                + 0.1 * sin(2.0 * M_PI * 1237.0 * t);
+            source[i * channels + c] = (float)v + (NextBenchFloat() - 0.5f) * 0.1f;
+        }
+    }
+    AudioMixer::WriteSamples(sound, source, AudioManager::DeviceFormat.format, samples);
+
+    Memory::Free(source);
+    return sound;
+}
+static AudioChannel* MakeVoice(Uint8* sound) {
+    SoundFormat* soundData = new SoundFormat;
+    soundData->InputFormat = AudioManager::DeviceFormat;
+    soundData->SampleSize = AudioManager::BytesPerSample;
+    soundData->TotalPossibleSamples = BENCH_SOUND_FRAMES;
+    soundData->Samples.resize(BENCH_SOUND_FRAMES);
+    for (int i = 0; i < BENCH_SOUND_FRAMES; i++)
+        soundData->Samples[i] = sound + (size_t)i * AudioManager::BytesPerSample;
+
+    AudioChannel* voice = new AudioChannel();
+    voice->Playback = new AudioPlayback(AudioManager::DeviceFormat,
+        AudioManager::DeviceFormat.samples * AUDIO_FIRST_LOAD_SAMPLE_BOOST,
+        AudioManager::BytesPerSample, AudioManager::BytesPerSample);
+    voice->Playback->SoundData = soundData;
+    voice->Playback->OwnsSoundData = true;
+    voice->Loop = true;
+    voice->LoopPoint = 0;
+    voice->Volume = 1.0f;
+    return voice;
+}
+// Puts every voice back at the same spot, so that each pass mixes the
+// same thing.
+static void ResetVoices(vector<AudioChannel*>& voices) {
+    BenchSeed = 0x5EED;
+    for (size_t i = 0; i < voices.size(); i++) {
+        voices[i]->Playback->Seek(NextBenchRandom() % BENCH_SOUND_FRAMES);
+        voices[i]->Pan = NextBenchFloat() * 2.0f - 1.0f;
+        voices[i]->Speed = 0x10000;
+    }
+}
+// Every voice glides to a new pitch each block, apart from every eighth
+// one, which plays as is the way most sound effects do.
+static void ChangePitches(vector<AudioChannel*>& voices) {
+    for (size_t i = 0; i < voices.size(); i++) {
+        if ((i & 7) == 7)
+            continue;
+
+        Uint32 speed = voices[i]->Speed + (NextBenchRandom() & 0x1FFF) - 0x1000;
+        if (speed < 0x8000)
+            speed = 0x8000;
+        else if (speed > 0x20000)
+            speed = 0x20000;
+        voices[i]->Speed = speed;
+    }
+}
+
+static double RunPass(vector<AudioChannel*>& voices, float* bus, Uint8* output, int blocks, Uint32* hash) {
+    int frames = AudioManager::DeviceFormat.samples;
+    size_t samples = (size_t)frames * AudioManager::DeviceFormat.channels;
+    size_t outputSize = (size_t)frames * AudioManager::BytesPerSample;
+    float volume = 4.0f / voices.size();
+
+    ResetVoices(voices);
+
+    double elapsed = 0.0;
+    for (int b = 0; b < blocks; b++) {
+        ChangePitches(voices);
+
+        double start = Clock::GetTicks();
+        memset(bus, 0, samples * sizeof(float));
+        for (size_t i = 0; i < voices.size(); i++)
+            AudioManager::AudioPlayMix(voices[i], bus, frames, volume);
+        AudioMixer::WriteSamples(output, bus, AudioManager::DeviceFormat.format, samples);
+        elapsed += Clock::GetTicks() - start;
+
+        for (size_t i = 0; i + 4 <= outputSize; i += 4) {
+            Uint32 word;
+            memcpy(&word, output + i, 4);
+            *hash = (*hash ^ word) * 0x01000193U;
+        }
+    }
+    return elapsed;
+}
+static void PrintBenchResult(const char* name, double elapsed, int voices, int blocks, Uint32 hash) {
+    double mixed = (double)blocks * AudioManager::DeviceFormat.samples;
+    double perFrame = elapsed * 1000000.0 / (mixed * voices);
+    double realtime = mixed * 1000.0 / AudioManager::DeviceFormat.freq / elapsed;
+    Log::Print(Log::LOG_INFO, "%-20s %9.3f ms  %7.2f ns/voice frame  %7.1fx realtime  (output %08X)", name, elapsed, perFrame, realtime, hash);
+}
+
+// Mixes a lot of looping voices at once, all of them panned and most of
+// them changing pitch every block, with each kind of interpolation, with
+// and without SIMD. The outputs should match.
+PUBLIC STATIC void AudioBenchmark::Run(int voiceCount) {
+    if (voiceCount <= 0)
+        voiceCount = DefaultVoices;
+
+    if (!AudioManager::DeviceFormat.channels || !AudioManager::DeviceFormat.samples) {
+        Log::Print(Log::LOG_ERROR, "Audio benchmark needs an audio device!");
+        return;
+    }
+
+    Uint8* sound = MakeSound();
+    int frames = AudioManager::DeviceFormat.samples;
+    float* bus = (float*)Memory::Malloc((size_t)frames * AudioManager::DeviceFormat.channels * sizeof(float));
+    Uint8* output = (Uint8*)Memory::Malloc((size_t)frames * AudioManager::BytesPerSample);
+    if (!sound || !bus || !output) {
+        Log::Print(Log::LOG_ERROR, "Audio benchmark could not allocate its buffers!");
+        Memory::Free(sound);
+        Memory::Free(bus);
+        Memory::Free(output);
+        return;
+    }
+
+    vector<AudioChannel*> voices;
+    for (int i = 0; i < voiceCount; i++)
+        voices.push_back(MakeVoice(sound));
+
+    int blocks = BENCH_SECONDS * AudioManager::DeviceFormat.freq / frames;
+
+    Log::Print(Log::LOG_IMPORTANT, "Audio Benchmark (%d voices, %d blocks of %d frames at %d Hz):",
+        voiceCount, blocks, frames, AudioManager::DeviceFormat.freq);
+
+    // Keeps the device from mixing while the mixer's settings get
+    // switched around.
+    if (AudioManager::AudioEnabled)
+        SDL_PauseAudioDevice(AudioManager::Device, 1);
+
+    bool useSIMD = AudioMixer::UseSIMD;
+    int interpolation = AudioMixer::Interpolation;
+
+    static const char* interpolationNames[] = { "Linear", "Cubic" };
+    for (int mode = AudioMixer::INTERPOLATE_LINEAR; mode <= AudioMixer::INTERPOLATE_CUBIC; mode++) {
+        for (int simd = 0; simd < 2; simd++) {
+            AudioMixer::Interpolation = mode;
+            AudioMixer::UseSIMD = simd != 0;
+            AudioMixer::Init();
+
+            char name[32];
+            snprintf(name, sizeof name, "%s (%s)", interpolationNames[mode], AudioMixer::Level);
+
+            Uint32 hash = 0x811C9DC5U;
+            double elapsed = RunPass(voices, bus, output, blocks, &hash);
+            PrintBenchResult(name, elapsed, voiceCount, blocks, hash);
+        }
+    }
+
+    AudioMixer::UseSIMD = useSIMD;
+    AudioMixer::Interpolation = interpolation;
+    AudioMixer::Init();
+
+    if (AudioManager::AudioEnabled)
+        SDL_PauseAudioDevice(AudioManager::Device, 0);
+
+    for (size_t i = 0; i < voices.size(); i++)
+        delete voices[i];
+    Memory::Free(sound);
+    Memory::Free(bus);
+    Memory::Free(output);
+}
@@ -20,6 +20,12 @@ struct AudioChannel {
     float          Pan = 0.0f;
     float          Volume = 0.0f;
     void*          Origin = nullptr;
+    // Which SetSound this channel is playing
+    Uint32         Serial = 0;
+    // Set to Serial once the sound plays to the end by itself
+    SDL_atomic_t   EndedSerial = { 0 };
+    // Where the sound data is, in samples, as of the last mix
+    SDL_atomic_t   Position = { 0 };
 
     ~AudioChannel() {
         delete Playback;
@@ -27,4 +33,14 @@ struct AudioChannel {
     }
 };
 
+// What the game thread knows about a sound channel. The audio thread
+// keeps its own AudioChannel for it, which only changes by command.
+struct AudioChannelState {
+    ISound*        Audio;
+    void*          Origin;
+    Uint32         Serial;
+    bool           Paused;
+    bool           Stopped;
+};
+
 #endif /* ENGINE_AUDIO_AUDIOCHANNEL_H */
@@ -0,0 +1,65 @@
+#ifndef ENGINE_AUDIO_AUDIOCOMMAND_H
+#define ENGINE_AUDIO_AUDIOCOMMAND_H
+
+#include <Engine/Includes/Standard.h>
+
+class ISound;
+class AudioPlayback;
+struct AudioChannel;
+
+enum {
+    AudioCommand_SetSound,
+    AudioCommand_PushMusic,
+    AudioCommand_RemoveMusic,
+    AudioCommand_ClearMusic,
+    AudioCommand_FadeOutMusic,
+    AudioCommand_AlterMusic,
+    AudioCommand_PauseMusic,
+    AudioCommand_ResumeMusic,
+    AudioCommand_ClearSounds,
+    AudioCommand_AlterChannel,
+    AudioCommand_PauseChannel,
+    AudioCommand_UnpauseChannel,
+    AudioCommand_StopChannel,
+    AudioCommand_PauseSound,
+    AudioCommand_UnpauseSound,
+    AudioCommand_StopSound,
+    AudioCommand_PauseAll,
+    AudioCommand_UnpauseAll,
+    AudioCommand_StopAll,
+    AudioCommand_StopOriginSound,
+    AudioCommand_StopAllOriginSounds,
+};
+
+// Something the game thread wants the audio thread to do to its
+// channels. Only the fields the command needs are set.
+struct AudioCommand {
+    Uint8          Type;
+    int            Channel;
+    ISound*        Sound;
+    void*          Origin;
+    AudioPlayback* Playback;
+    AudioChannel*  Music;
+    Uint32         Serial;
+    int            Sample;
+    bool           Loop;
+    Uint32         LoopPoint;
+    float          Pan;
+    Uint32         Speed;
+    float          Volume;
+    double         Seconds;
+};
+
+enum {
+    AudioRetired_Playback,
+    AudioRetired_Music,
+};
+
+// Something the audio thread is done with, handed back to the game
+// thread to reuse or free.
+struct AudioRetired {
+    Uint8 Type;
+    void* Object;
+};
+
+#endif /* ENGINE_AUDIO_AUDIOCOMMAND_H */
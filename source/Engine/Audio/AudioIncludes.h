@@ -3,6 +3,14 @@
 
 #define AUDIO_FIRST_LOAD_SAMPLE_BOOST 4
 
+// Voices are mixed this many frames at a time, which keeps their
+// windows small even when they're sped up a lot.
+#define MIX_CHUNK_FRAMES 512
+// Anything asked to play faster than this plays at this speed.
+#define MIX_MAX_SPEED (0x10000 * 32)
+// The most frames a voice's window can need for one chunk.
+#define MIX_WINDOW_FRAMES (MIX_CHUNK_FRAMES * 32 + 4)
+
 enum {
     MusicFade_None,
     MusicFade_Out,
@@ -3,6 +3,8 @@
 #include <Engine/Includes/StandardSDL2.h>
 #include <Engine/Application.h>
 #include <Engine/Audio/AudioChannel.h>
+#include <Engine/Audio/AudioCommand.h>
+#include <Engine/Audio/AudioRing.h>
 #include <Engine/ResourceTypes/ISound.h>
 
 class AudioManager {
@@ -12,22 +14,28 @@ public:
     static bool                 AudioEnabled;
 
     static Uint8                BytesPerSample;
-    static Uint8*               MixBuffer;
-    static size_t               MixBufferSize;
+    static float*               MixBus;
+    static size_t               MixBusFrames;
 
+    // What the game thread sees
     static deque<AudioChannel*> MusicStack;
-    static AudioChannel*        SoundArray;
+    static AudioChannelState*   SoundStates;
     static int                  SoundArrayLength;
 
+    // What the audio thread plays
+    static deque<AudioChannel*> MixMusicStack;
+    static AudioChannel*        SoundArray;
+
+    static AudioRing*           CommandQueue;
+    static AudioRing*           RetireQueue;
+
     static float                MasterVolume;
     static float                MusicVolume;
     static float                SoundVolume;
 
     static float                LowPassFilter;
 
-    static Uint8*               AudioQueue;
-    static size_t               AudioQueueSize;
-    static size_t               AudioQueueMaxSize;
+    static AudioRing*           AudioQueue;
 
     enum {
         REQUEST_EOF = 0,
@@ -38,8 +46,10 @@ public:
 #endif
 
 #include <Engine/Audio/AudioManager.h>
+#include <Engine/Audio/AudioMixer.h>
 #include <Engine/Audio/AudioPlayback.h>
 #include <Engine/ResourceTypes/SoundFormats/SoundFormat.h>
+#include <Engine/Diagnostics/Clock.h>
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
 
@@ -48,22 +58,56 @@ SDL_AudioSpec        AudioManager::DeviceFormat;
 bool                 AudioManager::AudioEnabled = false;
 
 Uint8                AudioManager::BytesPerSample;
-Uint8*               AudioManager::MixBuffer;
-size_t               AudioManager::MixBufferSize;
+float*               AudioManager::MixBus = NULL;
+size_t               AudioManager::MixBusFrames = 0;
 
 deque<AudioChannel*> AudioManager::MusicStack;
-AudioChannel*        AudioManager::SoundArray = NULL;
+AudioChannelState*   AudioManager::SoundStates = NULL;
 int                  AudioManager::SoundArrayLength = 512;
 
+deque<AudioChannel*> AudioManager::MixMusicStack;
+AudioChannel*        AudioManager::SoundArray = NULL;
+
+AudioRing*           AudioManager::CommandQueue = NULL;
+AudioRing*           AudioManager::RetireQueue = NULL;
+
 float                AudioManager::MasterVolume = 1.0f;
 float                AudioManager::MusicVolume = 1.0f;
 float                AudioManager::SoundVolume = 1.0f;
 
 float                AudioManager::LowPassFilter = 0.0f;
 
-Uint8*               AudioManager::AudioQueue = NULL;
-size_t               AudioManager::AudioQueueSize = 0;
-size_t               AudioManager::AudioQueueMaxSize = 0;
+AudioRing*           AudioManager::AudioQueue = NULL;
+
+// The game thread and the audio thread never wait on each other. What
+// the game does to channels is sent over as commands, which the audio
+// callback carries out before it mixes, and the game keeps its own idea
+// of what's playing to answer questions with. Playbacks and music
+// channels are made on the game thread and handed over in commands.
+// Once the audio thread is done with one, it's handed back through
+// RetireQueue to be reused or freed on the game thread. Streamed media
+// audio goes through AudioQueue.
+#define AUDIO_COMMAND_CAPACITY 1024
+// The game never has more than this many objects handed over at once,
+// so the audio thread always has room to hand them all back.
+#define AUDIO_RETIRE_CAPACITY 2048
+#define AUDIO_QUEUE_CAPACITY 0x8000
+
+static Uint32                 CommandsSent = 0;
+static SDL_atomic_t           CommandsDone;
+static int                    HandedOver = 0;
+static Uint32                 NextSerial = 0;
+static vector<AudioPlayback*> FreePlaybacks;
+
+static Uint8*                 StreamBuffer = NULL;
+static size_t                 StreamBufferSize = 0;
+
+static AudioCommand NewCommand(Uint8 type) {
+    AudioCommand command;
+    memset(&command, 0, sizeof command);
+    command.Type = type;
+    return command;
+}
 
 enum {
     FILTER_TYPE_LOW_PASS,
@@ -80,8 +124,6 @@ double mNormalizedFreq = 1.0 / 64.0; // Good for low pass
 int    mFilterType = FILTER_TYPE_LOW_PASS;
 // double mNormalizedFreq = 1.0 / 8.0;
 // int    mFilterType = FILTER_TYPE_HIGH_PASS;
-Sint16 mZx[2 * 2]; // 2 per channel
-Sint16 mZy[2 * 2]; // 2 per channel
 float  mZxF[2 * 2]; // 2 per channel
 float  mZyF[2 * 2]; // 2 per channel
 
@@ -91,11 +133,6 @@ PUBLIC STATIC void   AudioManager::CalculateCoeffs() {
     double beta = 0.5 * ( (1.0 - d) / (1.0 + d) );
     double gamma = (0.5 + beta) * cos(theta);
 
-    mZx[0] = 0;
-    mZx[1] = 0;
-    mZy[0] = 0;
-    mZy[1] = 0;
-
     mZxF[0] = 0;
     mZxF[1] = 0;
     mZyF[0] = 0;
@@ -114,27 +151,6 @@ PUBLIC STATIC void   AudioManager::CalculateCoeffs() {
     b1 = -2.0 * gamma;
     b2 = 2.0 * beta;
 }
-PUBLIC STATIC Sint16 AudioManager::ProcessSample(Sint16 inSample, int channel) {
-    Sint16 outSample;
-    int idx0 = 2 * channel;
-    int idx1 = idx0 + 1;
-
-    outSample = (Sint16)(
-        (a0 * inSample)  + (a1 * mZx[idx0]) +
-        (a2 * mZx[idx1]) - (b1 * mZy[idx0]) - (b2 * mZy[idx1]));
-
-    // if (outSample > 0x3FFF)
-    //     outSample = 0x3FFF;
-    // if (outSample < -0x3FFF)
-    //     outSample = -0x3FFF;
-
-    mZx[idx1] = mZx[idx0];
-    mZx[idx0] = inSample;
-    mZy[idx1] = mZy[idx0];
-    mZy[idx0] = outSample;
-
-    return (Sint16)(inSample * (1.0 - AudioManager::LowPassFilter) + outSample * mGain * AudioManager::LowPassFilter);
-}
 PUBLIC STATIC float  AudioManager::ProcessSampleFloat(float inSample, int channel) {
     float outSample;
     int idx0 = 2 * channel;
@@ -156,8 +172,16 @@ PUBLIC STATIC void   AudioManager::Init() {
     CalculateCoeffs();
 
     SoundArray = (AudioChannel*)Memory::Calloc(SoundArrayLength, sizeof(AudioChannel));
-    for (int i = 0; i < SoundArrayLength; i++)
+    SoundStates = (AudioChannelState*)Memory::Calloc(SoundArrayLength, sizeof(AudioChannelState));
+    for (int i = 0; i < SoundArrayLength; i++) {
         SoundArray[i].Paused = true;
+        SoundStates[i].Paused = true;
+    }
+
+    CommandQueue = new AudioRing(AUDIO_COMMAND_CAPACITY * sizeof(AudioCommand), "AudioManager::CommandQueue");
+    RetireQueue = new AudioRing(AUDIO_RETIRE_CAPACITY * sizeof(AudioRetired), "AudioManager::RetireQueue");
+    AudioQueue = new AudioRing(AUDIO_QUEUE_CAPACITY, "AudioManager::AudioQueue");
+    SDL_AtomicSet(&CommandsDone, 0);
 
     SDL_AudioSpec Want;
     memset(&Want, 0, sizeof(Want));
@@ -180,7 +204,6 @@ PUBLIC STATIC void   AudioManager::Init() {
     if (Application::Platform != Platforms::Android) {
         if (SDL_OpenAudio(&Want, &DeviceFormat) >= 0) {
             AudioEnabled = true;
-            SDL_PauseAudio(0);
             Device = 1;
         }
         else Log::Print(Log::LOG_ERROR, "Could not open audio device!");
@@ -188,7 +211,6 @@ PUBLIC STATIC void   AudioManager::Init() {
     else {
         if ((Device = SDL_OpenAudioDevice(NULL, 0, &Want, &DeviceFormat, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE))) {
             AudioEnabled = true;
-            SDL_PauseAudioDevice(Device, 0);
         }
         else Log::Print(Log::LOG_ERROR, "Could not open audio device!");
     }
@@ -204,15 +226,23 @@ PUBLIC STATIC void   AudioManager::Init() {
 
     BytesPerSample = ((DeviceFormat.format & 0xFF) >> 3) * DeviceFormat.channels;
 
-    if (DeviceFormat.channels == 2) {
-        MixBufferSize = DeviceFormat.samples;
-        MixBuffer = (Uint8*)Memory::Malloc(MixBufferSize * BytesPerSample);
-    }
+    AudioMixer::Init();
 
-    // AudioQueueMaxSize = DeviceFormat.samples * DeviceFormat.channels * (SDL_AUDIO_BITSIZE(DeviceFormat.format) >> 3);
-    AudioQueueMaxSize = 0x1000;
-    AudioQueueSize    = 0;
-    AudioQueue        = (Uint8*)Memory::Calloc(8, AudioQueueMaxSize);
+    // The callback is handed DeviceFormat.size bytes at a time, and mixes
+    // all of it in here without allocating anything
+    MixBusFrames = DeviceFormat.samples;
+    if (BytesPerSample && DeviceFormat.size / BytesPerSample > MixBusFrames)
+        MixBusFrames = DeviceFormat.size / BytesPerSample;
+    MixBus = (float*)Memory::TrackedMalloc("AudioManager::MixBus", MixBusFrames * DeviceFormat.channels * sizeof(float));
+    if (!MixBus)
+        MixBusFrames = 0;
+
+    StreamBufferSize = (size_t)DeviceFormat.samples * BytesPerSample;
+    StreamBuffer = (Uint8*)Memory::TrackedMalloc("AudioManager::StreamBuffer", StreamBufferSize);
+
+    // Everything the callback uses is ready now
+    if (AudioEnabled)
+        SDL_PauseAudioDevice(Device, 0);
 }
 
 PUBLIC STATIC void   AudioManager::ClampParams(float& pan, float& speed, float& volume) {
@@ -251,48 +281,63 @@ PUBLIC STATIC void   AudioManager::SetSound(int channel, ISound* music) {
     AudioManager::SetSound(channel, music, false, 0, 0.0f, 1.0f, 1.0f, nullptr);
 }
 PUBLIC STATIC void   AudioManager::SetSound(int channel, ISound* sound, bool loop, int loopPoint, float pan, float speed, float volume, void* origin) {
-    AudioManager::Lock();
-
-    AudioChannel* audio = &SoundArray[channel];
-    AudioPlayback* playback = audio->Playback;
+    AudioManager::ReclaimRetired();
+    if (!AudioManager::CanHandOver())
+        return;
 
     AudioManager::ClampParams(pan, speed, volume);
 
-    audio->Audio = sound;
-    audio->Stopped = false;
-    audio->Paused = false;
-    audio->Origin = origin;
-    audio->Loop = loop;
-    audio->LoopPoint = loopPoint;
-    audio->Fading = MusicFade_None;
-    audio->Pan = pan;
-    audio->Speed = (Uint32)(speed * 0x10000);
-    audio->Volume = volume;
-
+    // Playbacks the audio thread is done with get used again
     int requiredSamples = AudioManager::DeviceFormat.samples * AUDIO_FIRST_LOAD_SAMPLE_BOOST;
-    if (playback == nullptr) {
-        playback = new AudioPlayback(sound->Format, requiredSamples, sound->BytesPerSample, AudioManager::BytesPerSample);
-        audio->Playback = playback;
+    AudioPlayback* playback;
+    if (FreePlaybacks.size() > 0) {
+        playback = FreePlaybacks.back();
+        FreePlaybacks.pop_back();
+        playback->Change(sound->Format, requiredSamples, sound->BytesPerSample, AudioManager::BytesPerSample);
     }
     else {
-        playback->Change(sound->Format, requiredSamples, sound->BytesPerSample, AudioManager::BytesPerSample);
+        playback = new AudioPlayback(sound->Format, requiredSamples, sound->BytesPerSample, AudioManager::BytesPerSample);
     }
 
+    // This loads the whole sound if it hasn't been yet. Music streams from
+    // sound data of its own, so the audio thread isn't reading this.
     AudioManager::UpdateChannelPlayer(playback, sound);
 
     playback->Seek(0);
     if (playback->ConversionStream)
         SDL_AudioStreamClear(playback->ConversionStream);
 
-    AudioManager::Unlock();
+    if (++NextSerial == 0)
+        NextSerial = 1;
+
+    AudioChannelState* state = &SoundStates[channel];
+    AudioChannelState previous = *state;
+    state->Audio = sound;
+    state->Origin = origin;
+    state->Serial = NextSerial;
+    state->Paused = false;
+    state->Stopped = false;
+
+    AudioCommand command = NewCommand(AudioCommand_SetSound);
+    command.Channel = channel;
+    command.Sound = sound;
+    command.Origin = origin;
+    command.Playback = playback;
+    command.Serial = NextSerial;
+    command.Loop = loop;
+    command.LoopPoint = loopPoint;
+    command.Pan = pan;
+    command.Speed = (Uint32)(speed * 0x10000);
+    command.Volume = volume;
+    if (!AudioManager::SendCommand(&command))
+        *state = previous;
 }
 PUBLIC STATIC int    AudioManager::PlaySound(ISound* music) {
     return AudioManager::PlaySound(music, false, 0, 0.0f, 1.0f, 1.0f, nullptr);
 }
 PUBLIC STATIC int    AudioManager::PlaySound(ISound* music, bool loop, int loopPoint, float pan, float speed, float volume, void* origin) {
     for (int i = 0; i < SoundArrayLength; i++) {
-        AudioChannel* audio = &SoundArray[i];
-        if (!audio->Audio || audio->Stopped) {
+        if (!SoundStates[i].Audio || AudioManager::IsChannelStopped(i)) {
             AudioManager::SetSound(i, music, loop, loopPoint, pan, speed, volume, origin);
             return i;
         }
@@ -307,14 +352,9 @@ PUBLIC STATIC void   AudioManager::PushMusic(ISound* music, bool loop, Uint32 lp
 PUBLIC STATIC void   AudioManager::PushMusicAt(ISound* music, double at, bool loop, Uint32 lp, float pan, float speed, float volume, double fadeInAfterFinished) {
     if (music->LoadFailed) return;
 
-    AudioManager::Lock();
-
-    if (MusicStack.size() > 0 && fadeInAfterFinished > 0.0) {
-        AudioChannel* front = MusicStack.front();
-        front->Fading = MusicFade_In;
-        front->FadeTimer = 0.0f;
-        front->FadeTimerMax = fadeInAfterFinished;
-    }
+    AudioManager::ReclaimRetired();
+    if (!AudioManager::CanHandOver())
+        return;
 
     AudioManager::ClampParams(pan, speed, volume);
 
@@ -330,33 +370,43 @@ PUBLIC STATIC void   AudioManager::PushMusicAt(ISound* music, double at, bool lo
     newms->FadeTimer = 1.0;
     newms->FadeTimerMax = 1.0;
 
-    int start_sample = (int)std::ceil(at * music->Format.freq);
-
-    newms->Playback->Seek(start_sample);
-    if (newms->Playback->ConversionStream)
-        SDL_AudioStreamClear(newms->Playback->ConversionStream);
-
     if (loop)
         newms->Playback->LoopIndex = (Sint32)lp;
 
+    // The audio thread does the seeking, since the sound data might be
+    // getting played already.
+    int start_sample = (int)std::ceil(at * music->Format.freq);
+    SDL_AtomicSet(&newms->Position, start_sample);
+
     MusicStack.push_front(newms);
 
-    AudioManager::Unlock();
+    AudioCommand command = NewCommand(AudioCommand_PushMusic);
+    command.Music = newms;
+    command.Sample = start_sample;
+    command.Seconds = fadeInAfterFinished;
+    AudioManager::SendCommand(&command);
 }
 PUBLIC STATIC void   AudioManager::RemoveMusic(ISound* music) {
-    AudioManager::Lock();
-    for (size_t i = 0; i < MusicStack.size(); i++) {
-        if (MusicStack[i]->Audio == music) {
-            delete MusicStack[i];
+    AudioManager::ReclaimRetired();
+
+    AudioCommand command = NewCommand(AudioCommand_RemoveMusic);
+    command.Sound = music;
+    if (!AudioManager::SendCommand(&command))
+        return;
+
+    for (size_t i = 0; i < MusicStack.size(); ) {
+        if (MusicStack[i]->Audio == music)
             MusicStack.erase(MusicStack.begin() + i);
-        }
+        else
+            i++;
     }
-    AudioManager::Unlock();
 }
 PUBLIC STATIC bool   AudioManager::IsPlayingMusic() {
+    AudioManager::ReclaimRetired();
     return MusicStack.size() > 0;
 }
 PUBLIC STATIC bool   AudioManager::IsPlayingMusic(ISound* music) {
+    AudioManager::ReclaimRetired();
     for (size_t i = 0; i < MusicStack.size(); i++) {
         if (MusicStack[i]->Audio == music) {
             return true;
@@ -365,218 +415,444 @@ PUBLIC STATIC bool   AudioManager::IsPlayingMusic(ISound* music) {
     return false;
 }
 PUBLIC STATIC void   AudioManager::ClearMusic() {
-    AudioManager::Lock();
-    for (size_t i = 0; i < MusicStack.size(); i++) {
-        delete MusicStack[i];
-    }
+    AudioManager::ReclaimRetired();
     MusicStack.clear();
-    AudioManager::Unlock();
+
+    AudioCommand command = NewCommand(AudioCommand_ClearMusic);
+    AudioManager::ForceCommand(&command);
 }
 PUBLIC STATIC void   AudioManager::ClearSounds() {
-    AudioManager::Lock();
-    for (int i = 0; i < SoundArrayLength; i++) {
-        SoundArray[i].Stopped = true;
-        if (SoundArray[i].Playback) {
-            delete SoundArray[i].Playback;
-            SoundArray[i].Playback = NULL;
-        }
-    }
-    AudioManager::Unlock();
+    for (int i = 0; i < SoundArrayLength; i++)
+        SoundStates[i].Stopped = true;
+
+    AudioCommand command = NewCommand(AudioCommand_ClearSounds);
+    AudioManager::ForceCommand(&command);
 }
 PUBLIC STATIC void   AudioManager::FadeOutMusic(double seconds) {
-    AudioManager::Lock();
-    if (MusicStack.size() > 0) {
-        MusicStack[0]->Fading = MusicFade_Out;
-        MusicStack[0]->FadeTimer = seconds;
-        MusicStack[0]->FadeTimerMax = seconds;
-    }
-    AudioManager::Unlock();
+    AudioCommand command = NewCommand(AudioCommand_FadeOutMusic);
+    command.Seconds = seconds;
+    AudioManager::SendCommand(&command);
 }
 PUBLIC STATIC void   AudioManager::AlterMusic(float pan, float speed, float volume) {
-    AudioManager::Lock();
-    if (MusicStack.size() > 0) {
-        AudioManager::ClampParams(pan, speed, volume);
-        MusicStack[0]->Pan = pan;
-        MusicStack[0]->Speed = (Uint32)(speed * 0x10000);
-        MusicStack[0]->Volume = volume;
-    }
-    AudioManager::Unlock();
+    AudioManager::ClampParams(pan, speed, volume);
+
+    AudioCommand command = NewCommand(AudioCommand_AlterMusic);
+    command.Pan = pan;
+    command.Speed = (Uint32)(speed * 0x10000);
+    command.Volume = volume;
+    AudioManager::SendCommand(&command);
+}
+PUBLIC STATIC void   AudioManager::PauseMusic() {
+    AudioCommand command = NewCommand(AudioCommand_PauseMusic);
+    AudioManager::SendCommand(&command);
+}
+PUBLIC STATIC void   AudioManager::ResumeMusic() {
+    AudioCommand command = NewCommand(AudioCommand_ResumeMusic);
+    AudioManager::SendCommand(&command);
 }
 PUBLIC STATIC double AudioManager::GetMusicPosition(ISound* music) {
-    AudioManager::Lock();
-    double position = 0.0;
+    AudioManager::ReclaimRetired();
     for (size_t i = 0; i < MusicStack.size(); i++) {
-        if (MusicStack[i]->Audio == music) {
-            position = MusicStack[i]->Playback->SoundData->GetPosition();
-            break;
-        }
+        AudioChannel* audio = MusicStack[i];
+        if (audio->Audio == music)
+            return (double)SDL_AtomicGet(&audio->Position) / audio->Playback->SoundData->InputFormat.freq;
     }
-    AudioManager::Unlock();
-    return position;
+    return 0.0;
 }
 
-PUBLIC STATIC void   AudioManager::Lock() {
-    SDL_LockAudioDevice(Device);
-}
-PUBLIC STATIC void   AudioManager::Unlock() {
-    SDL_UnlockAudioDevice(Device);
+// Waits for the audio thread to get through every command sent so far,
+// so that sounds can be freed without it still playing them. This is
+// only meant for unloading.
+PUBLIC STATIC void   AudioManager::Sync() {
+    if (AudioEnabled) {
+        double start = Clock::GetTicks();
+        while ((Uint32)SDL_AtomicGet(&CommandsDone) != CommandsSent) {
+            // In case the device stopped asking for audio, the rest are
+            // run from here with the callback locked out
+            if (Clock::GetTicks() - start > 1000.0) {
+                Log::Print(Log::LOG_WARN, "Audio thread did not catch up with its commands!");
+                SDL_LockAudioDevice(Device);
+                AudioManager::RunCommands();
+                SDL_UnlockAudioDevice(Device);
+                break;
+            }
+            SDL_Delay(1);
+        }
+    }
+
+    // Spare playbacks are let go of too, rather than kept for reuse
+    AudioManager::ReclaimRetired();
+    for (size_t i = 0; i < FreePlaybacks.size(); i++)
+        delete FreePlaybacks[i];
+    FreePlaybacks.clear();
 }
 
 PUBLIC STATIC int    AudioManager::GetFreeChannel() {
-    AudioManager::Lock();
-    int channel = -1;
     for (int i = 0; i < SoundArrayLength; i++) {
-        if (SoundArray[i].Stopped) {
-            channel = i;
-            break;
-        }
+        if (AudioManager::IsChannelStopped(i))
+            return i;
     }
-    AudioManager::Unlock();
-    return channel;
+    return -1;
 }
 PUBLIC STATIC void   AudioManager::AlterChannel(int channel, float pan, float speed, float volume) {
-    AudioManager::Lock();
-    if (!SoundArray[channel].Stopped && !SoundArray[channel].Paused) {
-        AudioManager::ClampParams(pan, speed, volume);
-        SoundArray[channel].Pan = pan;
-        SoundArray[channel].Speed = (Uint32)(speed * 0x10000);
-        SoundArray[channel].Volume = volume;
-    }
-    AudioManager::Unlock();
+    AudioManager::ClampParams(pan, speed, volume);
+
+    AudioCommand command = NewCommand(AudioCommand_AlterChannel);
+    command.Channel = channel;
+    command.Pan = pan;
+    command.Speed = (Uint32)(speed * 0x10000);
+    command.Volume = volume;
+    AudioManager::SendCommand(&command);
 }
 PUBLIC STATIC bool   AudioManager::AudioIsPlaying(int channel) {
-    bool isPlaying = false;
-    AudioManager::Lock();
-    isPlaying = !SoundArray[channel].Stopped && !SoundArray[channel].Paused;
-    AudioManager::Unlock();
-    return isPlaying;
+    return !AudioManager::IsChannelStopped(channel) && !SoundStates[channel].Paused;
 }
 PUBLIC STATIC bool   AudioManager::AudioIsPlaying(ISound* audio) {
-    bool isPlaying = false;
-    AudioManager::Lock();
     for (int i = 0; i < SoundArrayLength; i++) {
-        AudioChannel* channel = &SoundArray[i];
-        if (!channel->Stopped && !channel->Paused && channel->Audio == audio)
-            isPlaying = true;
+        if (SoundStates[i].Audio == audio && AudioManager::AudioIsPlaying(i))
+            return true;
     }
-    AudioManager::Unlock();
-    return isPlaying;
+    return false;
 }
+// The game thread's view of a channel only changes once the command
+// that changes it has been sent.
 PUBLIC STATIC void   AudioManager::AudioUnpause(int channel) {
-    AudioManager::Lock();
-    SoundArray[channel].Paused = false;
-    AudioManager::Unlock();
+    if (AudioManager::SendChannelCommand(AudioCommand_UnpauseChannel, channel))
+        SoundStates[channel].Paused = false;
 }
 PUBLIC STATIC void   AudioManager::AudioUnpause(ISound* audio) {
-    AudioManager::Lock();
+    if (!AudioManager::SendSoundCommand(AudioCommand_UnpauseSound, audio, NULL))
+        return;
+
     for (int i = 0; i < SoundArrayLength; i++) {
-        if (SoundArray[i].Audio == audio)
-            SoundArray[i].Paused = false;
+        if (SoundStates[i].Audio == audio)
+            SoundStates[i].Paused = false;
     }
-    AudioManager::Unlock();
 }
 PUBLIC STATIC void   AudioManager::AudioPause(int channel) {
-    AudioManager::Lock();
-    SoundArray[channel].Paused = true;
-    AudioManager::Unlock();
+    if (AudioManager::SendChannelCommand(AudioCommand_PauseChannel, channel))
+        SoundStates[channel].Paused = true;
 }
 PUBLIC STATIC void   AudioManager::AudioPause(ISound* audio) {
-    AudioManager::Lock();
+    if (!AudioManager::SendSoundCommand(AudioCommand_PauseSound, audio, NULL))
+        return;
+
     for (int i = 0; i < SoundArrayLength; i++) {
-        if (SoundArray[i].Audio == audio)
-            SoundArray[i].Paused = true;
+        if (SoundStates[i].Audio == audio)
+            SoundStates[i].Paused = true;
     }
-    AudioManager::Unlock();
 }
 PUBLIC STATIC void   AudioManager::AudioStop(int channel) {
-    AudioManager::Lock();
-    SoundArray[channel].Stopped = true;
-    AudioManager::Unlock();
+    if (AudioManager::SendChannelCommand(AudioCommand_StopChannel, channel))
+        SoundStates[channel].Stopped = true;
 }
 PUBLIC STATIC void   AudioManager::AudioStop(ISound* audio) {
-    AudioManager::Lock();
+    if (!AudioManager::SendSoundCommand(AudioCommand_StopSound, audio, NULL))
+        return;
+
     for (int i = 0; i < SoundArrayLength; i++) {
-        if (SoundArray[i].Audio == audio)
-            SoundArray[i].Stopped = true;
+        if (SoundStates[i].Audio == audio)
+            SoundStates[i].Stopped = true;
     }
-    AudioManager::Unlock();
 }
 PUBLIC STATIC void   AudioManager::AudioUnpauseAll() {
-    AudioManager::Lock();
+    if (!AudioManager::SendChannelCommand(AudioCommand_UnpauseAll, 0))
+        return;
+
     for (int i = 0; i < SoundArrayLength; i++)
-        SoundArray[i].Paused = false;
-    AudioManager::Unlock();
+        SoundStates[i].Paused = false;
 }
 PUBLIC STATIC void   AudioManager::AudioPauseAll() {
-    AudioManager::Lock();
+    if (!AudioManager::SendChannelCommand(AudioCommand_PauseAll, 0))
+        return;
+
     for (int i = 0; i < SoundArrayLength; i++)
-        SoundArray[i].Paused = true;
-    AudioManager::Unlock();
+        SoundStates[i].Paused = true;
 }
 PUBLIC STATIC void   AudioManager::AudioStopAll() {
-    AudioManager::Lock();
+    if (!AudioManager::SendChannelCommand(AudioCommand_StopAll, 0))
+        return;
+
     for (int i = 0; i < SoundArrayLength; i++)
-        SoundArray[i].Stopped = true;
-    AudioManager::Unlock();
+        SoundStates[i].Stopped = true;
 }
 
 PUBLIC STATIC bool   AudioManager::IsOriginPlaying(void* origin, ISound* audio) {
-    bool isPlaying = false;
-    AudioManager::Lock();
     for (int i = 0; i < SoundArrayLength; i++) {
-        AudioChannel* channel = &SoundArray[i];
-        if (!channel->Stopped && !channel->Paused && channel->Audio == audio && channel->Origin == origin)
-            isPlaying = true;
+        if (SoundStates[i].Audio == audio && SoundStates[i].Origin == origin && AudioManager::AudioIsPlaying(i))
+            return true;
     }
-    AudioManager::Unlock();
-    return isPlaying;
+    return false;
 }
 PUBLIC STATIC void   AudioManager::StopOriginSound(void* origin, ISound* audio) {
-    AudioManager::Lock();
+    if (!AudioManager::SendSoundCommand(AudioCommand_StopOriginSound, audio, origin))
+        return;
+
     for (int i = 0; i < SoundArrayLength; i++) {
-        if (SoundArray[i].Audio == audio && SoundArray[i].Origin == origin)
-            SoundArray[i].Stopped = true;
+        if (SoundStates[i].Audio == audio && SoundStates[i].Origin == origin)
+            SoundStates[i].Stopped = true;
     }
-    AudioManager::Unlock();
 }
 PUBLIC STATIC void   AudioManager::StopAllOriginSounds(void* origin) {
-    AudioManager::Lock();
+    if (!AudioManager::SendSoundCommand(AudioCommand_StopAllOriginSounds, NULL, origin))
+        return;
+
     for (int i = 0; i < SoundArrayLength; i++) {
-        if (SoundArray[i].Origin == origin)
-            SoundArray[i].Stopped = true;
+        if (SoundStates[i].Origin == origin)
+            SoundStates[i].Stopped = true;
+    }
+}
+
+// Game thread side
+PRIVATE STATIC bool   AudioManager::IsChannelStopped(int channel) {
+    AudioChannelState* state = &SoundStates[channel];
+    if (state->Stopped)
+        return true;
+    return state->Serial && (Uint32)SDL_AtomicGet(&SoundArray[channel].EndedSerial) == state->Serial;
+}
+PRIVATE STATIC bool   AudioManager::CanHandOver() {
+    if (HandedOver < AUDIO_RETIRE_CAPACITY)
+        return true;
+
+    Log::Print(Log::LOG_ERROR, "Too many sounds handed over to the audio thread!");
+    return false;
+}
+// Returns false if the command was dropped, in which case whatever it
+// was handing over has been taken back.
+PRIVATE STATIC bool   AudioManager::SendCommand(AudioCommand* command) {
+    if (command->Playback || command->Music)
+        HandedOver++;
+
+    // Without a device, nothing's mixing, so it can be done right away.
+    if (!AudioEnabled) {
+        AudioManager::RunCommand(command);
+        return true;
+    }
+
+    if (!CommandQueue->Write(command, sizeof(AudioCommand))) {
+        Log::Print(Log::LOG_WARN, "Audio command queue is full!");
+
+        if (command->Playback) {
+            FreePlaybacks.push_back(command->Playback);
+            HandedOver--;
+        }
+        if (command->Music) {
+            for (size_t i = 0; i < MusicStack.size(); i++) {
+                if (MusicStack[i] == command->Music) {
+                    MusicStack.erase(MusicStack.begin() + i);
+                    break;
+                }
+            }
+            delete command->Music;
+            HandedOver--;
+        }
+        return false;
     }
-    AudioManager::Unlock();
+    CommandsSent++;
+    return true;
 }
+// For commands that can't be dropped, like the ones sent before sounds
+// are unloaded. If there's no room for one, the device is locked, which
+// keeps the callback out while everything queued up is run from here.
+PRIVATE STATIC void   AudioManager::ForceCommand(AudioCommand* command) {
+    if (command->Playback || command->Music)
+        HandedOver++;
+
+    if (!AudioEnabled) {
+        AudioManager::RunCommand(command);
+        return;
+    }
 
-PUBLIC STATIC void   AudioManager::MixAudioLR(Uint8* dest, Uint8* src, size_t len, float volumeL, float volumeR) {
-#define DEFINE_STREAM_PTR(type) type* src##type; type* dest##type
-#define PAN_STREAM_PTR(type) \
-    src##type = (type*)(src); \
-    dest##type = (type*)(dest); \
-    for (Uint32 o = 0; o < len; o++) { \
-        dest##type[0] = (type)(src##type[0] * volumeL); \
-        dest##type[1] = (type)(src##type[1] * volumeR); \
-        src##type += 2; \
-        dest##type += 2; \
+    if (CommandQueue->Write(command, sizeof(AudioCommand))) {
+        CommandsSent++;
+        return;
     }
 
-    DEFINE_STREAM_PTR(Uint8);
-    DEFINE_STREAM_PTR(Sint8);
-    DEFINE_STREAM_PTR(Uint16);
-    DEFINE_STREAM_PTR(Sint16);
-    DEFINE_STREAM_PTR(Sint32);
-    DEFINE_STREAM_PTR(float);
+    SDL_LockAudioDevice(Device);
+    AudioManager::RunCommands();
+    AudioManager::RunCommand(command);
+    SDL_UnlockAudioDevice(Device);
+}
+PRIVATE STATIC bool   AudioManager::SendChannelCommand(Uint8 type, int channel) {
+    AudioCommand command = NewCommand(type);
+    command.Channel = channel;
+    return AudioManager::SendCommand(&command);
+}
+PRIVATE STATIC bool   AudioManager::SendSoundCommand(Uint8 type, ISound* sound, void* origin) {
+    AudioCommand command = NewCommand(type);
+    command.Sound = sound;
+    command.Origin = origin;
+    return AudioManager::SendCommand(&command);
+}
+// Takes back whatever the audio thread is done with.
+PRIVATE STATIC void   AudioManager::ReclaimRetired() {
+    AudioRetired retired;
+    while (RetireQueue->Read(&retired, sizeof retired)) {
+        HandedOver--;
+        if (retired.Type == AudioRetired_Playback) {
+            FreePlaybacks.push_back((AudioPlayback*)retired.Object);
+            continue;
+        }
+
+        AudioChannel* music = (AudioChannel*)retired.Object;
+        for (size_t i = 0; i < MusicStack.size(); i++) {
+            if (MusicStack[i] == music) {
+                MusicStack.erase(MusicStack.begin() + i);
+                break;
+            }
+        }
+        delete music;
+    }
+}
+
+// Audio thread side
+PRIVATE STATIC void   AudioManager::Retire(Uint8 type, void* object) {
+    AudioRetired retired;
+    retired.Type = type;
+    retired.Object = object;
+    // This never fails, since the game thread never hands over more
+    // than there's room for.
+    RetireQueue->Write(&retired, sizeof retired);
+}
+PRIVATE STATIC void   AudioManager::RunCommands() {
+    AudioCommand command;
+    int count = 0;
+    while (CommandQueue->Read(&command, sizeof command)) {
+        AudioManager::RunCommand(&command);
+        count++;
+    }
+    if (count)
+        SDL_AtomicAdd(&CommandsDone, count);
+}
+PRIVATE STATIC void   AudioManager::RunCommand(AudioCommand* command) {
+    AudioChannel* audio;
+    switch (command->Type) {
+        case AudioCommand_SetSound:
+            audio = &SoundArray[command->Channel];
+            if (audio->Playback)
+                AudioManager::Retire(AudioRetired_Playback, audio->Playback);
+
+            audio->Audio = command->Sound;
+            audio->Playback = command->Playback;
+            audio->Serial = command->Serial;
+            audio->Stopped = false;
+            audio->Paused = false;
+            audio->Origin = command->Origin;
+            audio->Loop = command->Loop;
+            audio->LoopPoint = command->LoopPoint;
+            audio->Fading = MusicFade_None;
+            audio->Pan = command->Pan;
+            audio->Speed = command->Speed;
+            audio->Volume = command->Volume;
+            break;
+        case AudioCommand_PushMusic:
+            audio = command->Music;
+            if (MixMusicStack.size() > 0 && command->Seconds > 0.0) {
+                AudioChannel* front = MixMusicStack.front();
+                front->Fading = MusicFade_In;
+                front->FadeTimer = 0.0f;
+                front->FadeTimerMax = command->Seconds;
+            }
+
+            audio->Playback->Seek(command->Sample);
+            if (audio->Playback->ConversionStream)
+                SDL_AudioStreamClear(audio->Playback->ConversionStream);
 
-    switch (DeviceFormat.format) {
-        case AUDIO_U8: PAN_STREAM_PTR(Uint8); break;
-        case AUDIO_S8: PAN_STREAM_PTR(Sint8); break;
-        case AUDIO_U16SYS: PAN_STREAM_PTR(Uint16); break;
-        case AUDIO_S16SYS: PAN_STREAM_PTR(Sint16); break;
-        case AUDIO_S32SYS: PAN_STREAM_PTR(Sint32); break;
-        case AUDIO_F32SYS: PAN_STREAM_PTR(float); break;
+            MixMusicStack.push_front(audio);
+            break;
+        case AudioCommand_RemoveMusic:
+            for (size_t i = 0; i < MixMusicStack.size(); ) {
+                if (MixMusicStack[i]->Audio == command->Sound) {
+                    AudioManager::Retire(AudioRetired_Music, MixMusicStack[i]);
+                    MixMusicStack.erase(MixMusicStack.begin() + i);
+                }
+                else i++;
+            }
+            break;
+        case AudioCommand_ClearMusic:
+            for (size_t i = 0; i < MixMusicStack.size(); i++)
+                AudioManager::Retire(AudioRetired_Music, MixMusicStack[i]);
+            MixMusicStack.clear();
+            break;
+        case AudioCommand_FadeOutMusic:
+            if (MixMusicStack.size() > 0) {
+                MixMusicStack[0]->Fading = MusicFade_Out;
+                MixMusicStack[0]->FadeTimer = command->Seconds;
+                MixMusicStack[0]->FadeTimerMax = command->Seconds;
+            }
+            break;
+        case AudioCommand_AlterMusic:
+            if (MixMusicStack.size() > 0) {
+                MixMusicStack[0]->Pan = command->Pan;
+                MixMusicStack[0]->Speed = command->Speed;
+                MixMusicStack[0]->Volume = command->Volume;
+            }
+            break;
+        case AudioCommand_PauseMusic:
+        case AudioCommand_ResumeMusic:
+            if (MixMusicStack.size() > 0)
+                MixMusicStack[0]->Paused = command->Type == AudioCommand_PauseMusic;
+            break;
+        case AudioCommand_ClearSounds:
+            for (int i = 0; i < SoundArrayLength; i++) {
+                SoundArray[i].Stopped = true;
+                if (SoundArray[i].Playback) {
+                    AudioManager::Retire(AudioRetired_Playback, SoundArray[i].Playback);
+                    SoundArray[i].Playback = NULL;
+                }
+            }
+            break;
+        case AudioCommand_AlterChannel:
+            audio = &SoundArray[command->Channel];
+            if (!audio->Stopped && !audio->Paused) {
+                audio->Pan = command->Pan;
+                audio->Speed = command->Speed;
+                audio->Volume = command->Volume;
+            }
+            break;
+        case AudioCommand_PauseChannel:
+            SoundArray[command->Channel].Paused = true;
+            break;
+        case AudioCommand_UnpauseChannel:
+            SoundArray[command->Channel].Paused = false;
+            break;
+        case AudioCommand_StopChannel:
+            SoundArray[command->Channel].Stopped = true;
+            break;
+        case AudioCommand_PauseSound:
+        case AudioCommand_UnpauseSound:
+        case AudioCommand_StopSound:
+            for (int i = 0; i < SoundArrayLength; i++) {
+                if (SoundArray[i].Audio != command->Sound)
+                    continue;
+                if (command->Type == AudioCommand_StopSound)
+                    SoundArray[i].Stopped = true;
+                else
+                    SoundArray[i].Paused = command->Type == AudioCommand_PauseSound;
+            }
+            break;
+        case AudioCommand_PauseAll:
+        case AudioCommand_UnpauseAll:
+            for (int i = 0; i < SoundArrayLength; i++)
+                SoundArray[i].Paused = command->Type == AudioCommand_PauseAll;
+            break;
+        case AudioCommand_StopAll:
+            for (int i = 0; i < SoundArrayLength; i++)
+                SoundArray[i].Stopped = true;
+            break;
+        case AudioCommand_StopOriginSound:
+            for (int i = 0; i < SoundArrayLength; i++) {
+                if (SoundArray[i].Audio == command->Sound && SoundArray[i].Origin == command->Origin)
+                    SoundArray[i].Stopped = true;
+            }
+            break;
+        case AudioCommand_StopAllOriginSounds:
+            for (int i = 0; i < SoundArrayLength; i++) {
+                if (SoundArray[i].Origin == command->Origin)
+                    SoundArray[i].Stopped = true;
+            }
+            break;
     }
-#undef DEFINE_STREAM_PTR
-#undef PAN_STREAM_PTR
 }
 
 PRIVATE STATIC bool  AudioManager::HandleFading(AudioChannel* audio) {
@@ -599,7 +875,38 @@ PRIVATE STATIC bool  AudioManager::HandleFading(AudioChannel* audio) {
     }
     return false;
 }
-PUBLIC STATIC bool   AudioManager::AudioPlayMix(AudioChannel* audio, Uint8* stream, int len, float volume) {
+
+// Fills part of a voice's window with frames from its playback, asking
+// for more whenever what's buffered runs out. Returns how many it got,
+// and whether it got to the end of the sound.
+PRIVATE STATIC Uint32 AudioManager::PullFrames(AudioChannel* audio, float* dest, Uint32 count, bool* ended) {
+    AudioPlayback* playback = audio->Playback;
+    int channels = DeviceFormat.channels;
+
+    Uint32 pulled = 0;
+    while (pulled < count) {
+        if (playback->BufferPosition >= playback->BufferedSamples) {
+            int bytes = playback->RequestSamples(DeviceFormat.samples, audio->Loop, audio->LoopPoint);
+            if (bytes == REQUEST_EOF)
+                *ended = true;
+            if (bytes <= 0 || playback->BufferPosition >= playback->BufferedSamples)
+                break;
+        }
+
+        Uint32 frames = playback->BufferedSamples - playback->BufferPosition;
+        if (frames > count - pulled)
+            frames = count - pulled;
+
+        AudioMixer::ConvertSamples(dest + (size_t)pulled * channels,
+            playback->Buffer + (size_t)playback->BufferPosition * BytesPerSample,
+            DeviceFormat.format, (size_t)frames * channels);
+
+        playback->BufferPosition += frames;
+        pulled += frames;
+    }
+    return pulled;
+}
+PUBLIC STATIC bool   AudioManager::AudioPlayMix(AudioChannel* audio, float* bus, int frames, float volume) {
     if (AudioManager::HandleFading(audio))
         return true;
 
@@ -607,110 +914,86 @@ PUBLIC STATIC bool   AudioManager::AudioPlayMix(AudioChannel* audio, Uint8* stre
     if (!playback || !audio->Playback->SoundData)
         return false;
 
-    int bytesPerSample = BytesPerSample;
-    int bytes = playback->BufferedSamples * bytesPerSample;
+    int channels = DeviceFormat.channels;
+    Uint32 step = audio->Speed < MIX_MAX_SPEED ? audio->Speed : MIX_MAX_SPEED;
 
-    unsigned advanceAccumulator = 0;
-    unsigned advanceReadIndex = 0;
-    unsigned advance = 0;
-    unsigned speed = audio->Speed;
-
-    // Read more bytes
-    if (bytes == 0) {
-        bytes = playback->RequestSamples(DeviceFormat.samples, audio->Loop, audio->LoopPoint);
-    }
-    else {
-        advanceReadIndex = len - bytes;
-    }
-
-    int mixVolume;
+    float gain = MasterVolume * volume;
     if (audio->Fading)
-        mixVolume = (int)(SDL_MIX_MAXVOLUME * MasterVolume * volume * (audio->FadeTimer / audio->FadeTimerMax));
-    else
-        mixVolume = (int)(SDL_MIX_MAXVOLUME * MasterVolume * volume);
-
-    float volumeL = 1.0f;
-    float volumeR = 1.0f;
+        gain *= (float)(audio->FadeTimer / audio->FadeTimerMax);
 
-    bool doPanning = audio->Pan != 0.0f && DeviceFormat.channels == 2;
-    if (doPanning) {
+    float gainL = gain;
+    float gainR = gain;
+    if (audio->Pan != 0.0f && channels == 2) {
         if (audio->Pan < 0.f)
-            volumeR += audio->Pan;
+            gainR *= 1.0f + audio->Pan;
         else
-            volumeL -= audio->Pan;
+            gainL *= 1.0f - audio->Pan;
     }
 
-    switch (bytes) {
-        // End of file
-        case REQUEST_EOF:
-            return true; // Stop playing audio.
-        // Waiting
-        case REQUEST_CONVERTING:
-            break;
-        // Error
-        case REQUEST_ERROR:
-            break;
-        // Normal
-        default:
-            if (speed == 0x10000) {
-                if (!doPanning)
-                    SDL_MixAudioFormat(stream, playback->Buffer, DeviceFormat.format, (Uint32)bytes, mixVolume);
-                else {
-                    Uint32 mixAdvance = MixBufferSize * bytesPerSample;
-                    for (Uint32 o = 0; o < (unsigned)len; o += mixAdvance) {
-                        AudioManager::MixAudioLR(MixBuffer, playback->Buffer + advanceReadIndex, MixBufferSize, volumeL, volumeR);
-                        SDL_MixAudioFormat(stream + o, MixBuffer, DeviceFormat.format, mixAdvance, mixVolume);
-                        advanceReadIndex += mixAdvance;
-                    }
-                }
+    // The window is sized up front; the audio thread can't allocate
+    if (playback->MixFrameCapacity < MIX_WINDOW_FRAMES)
+        return false;
 
-                playback->BufferedSamples -= bytes / bytesPerSample;
-            }
-            else for (Uint32 o = 0; o < (unsigned)len; o += bytesPerSample) {
-                advanceAccumulator += speed;
-                advance = advanceAccumulator >> 16;
-                advanceAccumulator &= 0xFFFF;
-
-                if (doPanning) {
-                    AudioManager::MixAudioLR(MixBuffer, playback->Buffer + advanceReadIndex, 1, volumeL, volumeR);
-                    SDL_MixAudioFormat(stream + o, MixBuffer, DeviceFormat.format, (Uint32)bytesPerSample, mixVolume);
-                }
-                else
-                    SDL_MixAudioFormat(stream + o, playback->Buffer + advanceReadIndex, DeviceFormat.format, (Uint32)bytesPerSample, mixVolume);
+    // Starts off with a silent frame before the first one
+    if (playback->MixFrameCount == 0) {
+        memset(playback->MixFrames, 0, channels * sizeof(float));
+        playback->MixFrameCount = 1;
+        playback->MixPosition = 0x10000;
+    }
 
-                advanceReadIndex += advance * bytesPerSample;
-                if (playback->BufferedSamples <= advance) {
-                    playback->BufferedSamples = 0;
-                    advanceReadIndex = 0;
+    bool ended = false;
+    for (int done = 0; done < frames && !ended; done += MIX_CHUNK_FRAMES) {
+        int count = frames - done < MIX_CHUNK_FRAMES ? frames - done : MIX_CHUNK_FRAMES;
+
+        Uint32 needed = AudioMixer::GetFramesNeeded(playback->MixPosition, step, count);
+        if (needed > playback->MixFrameCount) {
+            // Whatever can't be had yet is silent
+            Uint32 missing = needed - playback->MixFrameCount;
+            float* dest = playback->MixFrames + (size_t)playback->MixFrameCount * channels;
+            Uint32 pulled = AudioManager::PullFrames(audio, dest, missing, &ended);
+            memset(dest + (size_t)pulled * channels, 0, (size_t)(missing - pulled) * channels * sizeof(float));
+            playback->MixFrameCount = needed;
+        }
 
-                    bytes = playback->RequestSamples(DeviceFormat.samples, audio->Loop, audio->LoopPoint);
-                }
-                else
-                    playback->BufferedSamples -= advance;
-            }
+        AudioMixer::MixVoice(bus + (size_t)done * channels, channels, playback->MixFrames, playback->MixPosition, step, count, gainL, gainR);
+
+        // Keep the frame before the next one to be played, and everything after it
+        Uint32 position = playback->MixPosition + step * count;
+        Uint32 drop = (position >> 16) - 1;
+        if (drop) {
+            playback->MixFrameCount -= drop;
+            memmove(playback->MixFrames, playback->MixFrames + (size_t)drop * channels, (size_t)playback->MixFrameCount * channels * sizeof(float));
+        }
+        playback->MixPosition = position - (drop << 16);
     }
-    return false;
+    return ended;
 }
 
 PUBLIC STATIC void   AudioManager::AudioCallback(void* data, Uint8* stream, int len) {
-    memset(stream, 0x00, len);
+    int frames = len / BytesPerSample;
+    if ((size_t)frames > MixBusFrames) {
+        memset(stream, 0x00, len);
+        return;
+    }
 
-    if (AudioManager::AudioQueueSize >= (size_t)len) {
-        SDL_MixAudioFormat(stream, AudioManager::AudioQueue, DeviceFormat.format, (Uint32)len, (int)(SDL_MIX_MAXVOLUME * MasterVolume));
+    size_t samples = (size_t)frames * DeviceFormat.channels;
+    memset(MixBus, 0, samples * sizeof(float));
 
-        AudioManager::AudioQueueSize -= len;
-        if (AudioManager::AudioQueueSize > 0)
-            memmove(AudioManager::AudioQueue, AudioManager::AudioQueue + len, AudioManager::AudioQueueSize);
-    }
+    AudioManager::RunCommands();
+
+    if ((size_t)len <= StreamBufferSize && AudioQueue->Read(StreamBuffer, len))
+        AudioMixer::MixSamples(MixBus, StreamBuffer, DeviceFormat.format, samples, MasterVolume);
 
     // Make track system
-    if (MusicStack.size() > 0) {
-        AudioChannel* audio = MusicStack.front();
+    if (MixMusicStack.size() > 0) {
+        AudioChannel* audio = MixMusicStack.front();
         if (!audio->Paused) {
-            if (AudioManager::AudioPlayMix(audio, stream, len, audio->Volume * MusicVolume)) {
-                delete audio;
-                MusicStack.pop_front();
+            if (AudioManager::AudioPlayMix(audio, MixBus, frames, audio->Volume * MusicVolume)) {
+                AudioManager::Retire(AudioRetired_Music, audio);
+                MixMusicStack.pop_front();
             }
+            else if (audio->Playback && audio->Playback->SoundData)
+                SDL_AtomicSet(&audio->Position, (int)audio->Playback->SoundData->TellSample());
         }
     }
 
@@ -719,41 +1002,40 @@ PUBLIC STATIC void   AudioManager::AudioCallback(void* data, Uint8* stream, int
         if (!audio->Audio || audio->Stopped || audio->Paused)
             continue;
 
-        if (AudioManager::AudioPlayMix(audio, stream, len, audio->Volume * SoundVolume)) {
+        if (AudioManager::AudioPlayMix(audio, MixBus, frames, audio->Volume * SoundVolume)) {
             audio->Stopped = true;
+            SDL_AtomicSet(&audio->EndedSerial, (int)audio->Serial);
         }
     }
 
-    if (LowPassFilter > 0.0) {
-        size_t channels = 2;
-        if (SDL_AUDIO_ISFLOAT(DeviceFormat.format)) {
-            size_t samples = len / sizeof(float) / channels;
-
-            float* in  = (float*)stream;
-            float* out = (float*)stream;
-            for (size_t i = 0; i < samples; i++) {
-                *out++ = ProcessSampleFloat(*in++, 1);
-                *out++ = ProcessSampleFloat(*in++, 0);
-            }
-        }
-        else {
-            size_t samples = len / sizeof(Sint16) / channels;
-
-            Sint16* in  = (Sint16*)stream;
-            Sint16* out = (Sint16*)stream;
-            for (size_t i = 0; i < samples; i++) {
-                *out++ = (Sint16)ProcessSample(*in++, 1);
-                *out++ = (Sint16)ProcessSample(*in++, 0);
-            }
+    if (LowPassFilter > 0.0 && DeviceFormat.channels == 2) {
+        float* sample = MixBus;
+        for (int i = 0; i < frames; i++) {
+            sample[0] = ProcessSampleFloat(sample[0], 1);
+            sample[1] = ProcessSampleFloat(sample[1], 0);
+            sample += 2;
         }
     }
+
+    // Everything's clamped here, once
+    AudioMixer::WriteSamples(stream, MixBus, DeviceFormat.format, samples);
 }
 
 PUBLIC STATIC void   AudioManager::Dispose() {
-    Memory::Free(SoundArray);
-    Memory::Free(AudioQueue);
-    Memory::Free(MixBuffer);
-
+    // The callback has to be done for good before anything it uses goes
     SDL_PauseAudioDevice(Device, 1);
     SDL_CloseAudioDevice(Device);
+
+    Memory::Free(SoundArray);
+    Memory::Free(SoundStates);
+    Memory::Free(StreamBuffer);
+    Memory::Free(MixBus);
+
+    for (size_t i = 0; i < FreePlaybacks.size(); i++)
+        delete FreePlaybacks[i];
+    FreePlaybacks.clear();
+
+    delete CommandQueue;
+    delete RetireQueue;
+    delete AudioQueue;
 }
@@ -0,0 +1,432 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Includes/StandardSDL2.h>
+
+class AudioMixer {
+public:
+    static bool        UseSIMD;
+    static const char* Level;
+    static int         Interpolation;
+
+    enum {
+        INTERPOLATE_LINEAR,
+        INTERPOLATE_CUBIC,
+    };
+};
+#endif
+
+#include <Engine/Audio/AudioMixer.h>
+
+#include <Engine/Diagnostics/Log.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define MIXER_X86
+    #include <emmintrin.h>
+    #if defined(__GNUC__) || defined(__clang__)
+        #define MIXER_TARGET(features) __attribute__((target(features)))
+    #else
+        #define MIXER_TARGET(features)
+    #endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+    #define MIXER_NEON
+    #include <arm_neon.h>
+#endif
+
+// Voices are mixed into a bus of floats, where full scale is -1.0 to
+// 1.0, and only clamped once everything's been added up.
+//
+// A voice is read from a window of frames that's already been turned
+// into floats. Positions in it are 16.16 fixed point, and reading at a
+// position needs the frame before it and the two after it to be there,
+// so that it can be interpolated.
+
+typedef void (*VoiceMixFunction)(float* bus, const float* src, Uint32 position, Uint32 step, int frames, float gainL, float gainR);
+typedef void (*SampleReadFunction)(float* dest, const Sint16* src, size_t count);
+typedef void (*BusWriteFunction)(Sint16* dest, const float* bus, size_t count);
+
+bool        AudioMixer::UseSIMD = true;
+const char* AudioMixer::Level = "None";
+int         AudioMixer::Interpolation = AudioMixer::INTERPOLATE_LINEAR;
+
+static VoiceMixFunction MixUnity = NULL;
+static VoiceMixFunction MixLinear = NULL;
+static VoiceMixFunction MixCubic = NULL;
+static SampleReadFunction ReadS16 = NULL;
+static BusWriteFunction WriteS16 = NULL;
+
+#define FRACTION(position) ((float)((position) & 0xFFFF) * (1.0f / 65536.0f))
+
+// Catmull-Rom. The SIMD versions do the same operations in the same
+// order, so they come out the same as this.
+static inline float Cubic(float xm1, float x0, float x1, float x2, float t) {
+    float c1 = 0.5f * (x1 - xm1);
+    float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+    float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+    return ((c3 * t + c2) * t + c1) * t + x0;
+}
+
+// Scalar versions (stereo)
+static void MixUnityScalar(float* bus, const float* src, Uint32 position, Uint32 step, int frames, float gainL, float gainR) {
+    src += (position >> 16) * 2;
+    for (int i = 0; i < frames; i++) {
+        bus[i * 2]     += src[i * 2] * gainL;
+        bus[i * 2 + 1] += src[i * 2 + 1] * gainR;
+    }
+}
+static void MixLinearScalar(float* bus, const float* src, Uint32 position, Uint32 step, int frames, float gainL, float gainR) {
+    for (int i = 0; i < frames; i++, position += step) {
+        const float* x = src + (position >> 16) * 2;
+        float t = FRACTION(position);
+        bus[i * 2]     += (x[0] + t * (x[2] - x[0])) * gainL;
+        bus[i * 2 + 1] += (x[1] + t * (x[3] - x[1])) * gainR;
+    }
+}
+static void MixCubicScalar(float* bus, const float* src, Uint32 position, Uint32 step, int frames, float gainL, float gainR) {
+    for (int i = 0; i < frames; i++, position += step) {
+        const float* x = src + (position >> 16) * 2;
+        float t = FRACTION(position);
+        bus[i * 2]     += Cubic(x[-2], x[0], x[2], x[4], t) * gainL;
+        bus[i * 2 + 1] += Cubic(x[-1], x[1], x[3], x[5], t) * gainR;
+    }
+}
+static void ReadS16Scalar(float* dest, const Sint16* src, size_t count) {
+    for (size_t i = 0; i < count; i++)
+        dest[i] = (float)src[i] * (1.0f / 32768.0f);
+}
+static void WriteS16Scalar(Sint16* dest, const float* bus, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        float v = bus[i] * 32768.0f;
+        if (v > 32767.0f)
+            v = 32767.0f;
+        else if (v < -32768.0f)
+            v = -32768.0f;
+        dest[i] = (Sint16)lrintf(v);
+    }
+}
+
+#ifdef MIXER_X86
+// SSE2 versions (2 frames at a time)
+MIXER_TARGET("sse2") static inline __m128 LoadFramesSSE2(const float* a, const float* b) {
+    return _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)a), (const __m64*)b);
+}
+MIXER_TARGET("sse2") static inline __m128 GetFractionsSSE2(Uint32 position, Uint32 step) {
+    float t0 = FRACTION(position);
+    float t1 = FRACTION(position + step);
+    return _mm_setr_ps(t0, t0, t1, t1);
+}
+MIXER_TARGET("sse2") static inline void AddToBusSSE2(float* bus, __m128 s, __m128 gain) {
+    _mm_storeu_ps(bus, _mm_add_ps(_mm_loadu_ps(bus), _mm_mul_ps(s, gain)));
+}
+MIXER_TARGET("sse2") static void MixUnitySSE2(float* bus, const float* src, Uint32 position, Uint32 step, int frames, float gainL, float gainR) {
+    __m128 gain = _mm_setr_ps(gainL, gainR, gainL, gainR);
+    src += (position >> 16) * 2;
+
+    int i = 0;
+    for (; i + 2 <= frames; i += 2)
+        AddToBusSSE2(bus + i * 2, _mm_loadu_ps(src + i * 2), gain);
+    MixUnityScalar(bus + i * 2, src + i * 2, 0, step, frames - i, gainL, gainR);
+}
+MIXER_TARGET("sse2") static void MixLinearSSE2(float* bus, const float* src, Uint32 position, Uint32 step, int frames, float gainL, float gainR) {
+    __m128 gain = _mm_setr_ps(gainL, gainR, gainL, gainR);
+
+    int i = 0;
+    for (; i + 2 <= frames; i += 2, position += step * 2) {
+        const float* a = src + (position >> 16) * 2;
+        const float* b = src + ((position + step) >> 16) * 2;
+        __m128 x0 = LoadFramesSSE2(a, b);
+        __m128 x1 = LoadFramesSSE2(a + 2, b + 2);
+        __m128 t = GetFractionsSSE2(position, step);
+        AddToBusSSE2(bus + i * 2, _mm_add_ps(x0, _mm_mul_ps(t, _mm_sub_ps(x1, x0))), gain);
+    }
+    MixLinearScalar(bus + i * 2, src, position, step, frames - i, gainL, gainR);
+}
+MIXER_TARGET("sse2") static void MixCubicSSE2(float* bus, const float* src, Uint32 position, Uint32 step, int frames, float gainL, float gainR) {
+    __m128 gain = _mm_setr_ps(gainL, gainR, gainL, gainR);
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 two = _mm_set1_ps(2.0f);
+    __m128 twoAndAHalf = _mm_set1_ps(2.5f);
+    __m128 oneAndAHalf = _mm_set1_ps(1.5f);
+
+    int i = 0;
+    for (; i + 2 <= frames; i += 2, position += step * 2) {
+        const float* a = src + (position >> 16) * 2;
+        const float* b = src + ((position + step) >> 16) * 2;
+        __m128 xm1 = LoadFramesSSE2(a - 2, b - 2);
+        __m128 x0 = LoadFramesSSE2(a, b);
+        __m128 x1 = LoadFramesSSE2(a + 2, b + 2);
+        __m128 x2 = LoadFramesSSE2(a + 4, b + 4);
+        __m128 t = GetFractionsSSE2(position, step);
+
+        __m128 c1 = _mm_mul_ps(half, _mm_sub_ps(x1, xm1));
+        __m128 c2 = _mm_sub_ps(xm1, _mm_mul_ps(twoAndAHalf, x0));
+        c2 = _mm_add_ps(c2, _mm_mul_ps(two, x1));
+        c2 = _mm_sub_ps(c2, _mm_mul_ps(half, x2));
+        __m128 c3 = _mm_add_ps(_mm_mul_ps(half, _mm_sub_ps(x2, xm1)), _mm_mul_ps(oneAndAHalf, _mm_sub_ps(x0, x1)));
+
+        __m128 s = _mm_add_ps(_mm_mul_ps(c3, t), c2);
+        s = _mm_add_ps(_mm_mul_ps(s, t), c1);
+        s = _mm_add_ps(_mm_mul_ps(s, t), x0);
+        AddToBusSSE2(bus + i * 2, s, gain);
+    }
+    MixCubicScalar(bus + i * 2, src, position, step, frames - i, gainL, gainR);
+}
+MIXER_TARGET("sse2") static void ReadS16SSE2(float* dest, const Sint16* src, size_t count) {
+    __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dest + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    ReadS16Scalar(dest + i, src + i, count - i);
+}
+// Clamps before converting, since anything out of range converts to
+// the most negative integer rather than saturating.
+MIXER_TARGET("sse2") static void WriteS16SSE2(Sint16* dest, const float* bus, size_t count) {
+    __m128 scale = _mm_set1_ps(32768.0f);
+    __m128 max = _mm_set1_ps(32767.0f);
+    __m128 min = _mm_set1_ps(-32768.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(bus + i), scale), min), max);
+        __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(bus + i + 4), scale), min), max);
+        _mm_storeu_si128((__m128i*)(dest + i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+    }
+    WriteS16Scalar(dest + i, bus + i, count - i);
+}
+#endif
+
+#ifdef MIXER_NEON
+// NEON versions (2 frames at a time)
+static inline float32x4_t LoadFramesNEON(const float* a, const float* b) {
+    return vcombine_f32(vld1_f32(a), vld1_f32(b));
+}
+static inline float32x4_t GetFractionsNEON(Uint32 position, Uint32 step) {
+    float t[4];
+    t[0] = t[1] = FRACTION(position);
+    t[2] = t[3] = FRACTION(position + step);
+    return vld1q_f32(t);
+}
+static inline float32x4_t GetGainNEON(float gainL, float gainR) {
+    float gain[4] = { gainL, gainR, gainL, gainR };
+    return vld1q_f32(gain);
+}
+// Multiplies and adds separately, since a fused multiply-add wouldn't
+// round the same way the scalar versions do.
+static inline void AddToBusNEON(float* bus, float32x4_t s, float32x4_t gain) {
+    vst1q_f32(bus, vaddq_f32(vld1q_f32(bus), vmulq_f32(s, gain)));
+}
+static void ReadS16NEON(float* dest, const Sint16* src, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t x = vld1q_s16(src + i);
+        vst1q_f32(dest + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), 1.0f / 32768.0f));
+        vst1q_f32(dest + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), 1.0f / 32768.0f));
+    }
+    ReadS16Scalar(dest + i, src + i, count - i);
+}
+static void MixUnityNEON(float* bus, const float* src, Uint32 position, Uint32 step, int frames, float gainL, float gainR) {
+    float32x4_t gain = GetGainNEON(gainL, gainR);
+    src += (position >> 16) * 2;
+
+    int i = 0;
+    for (; i + 2 <= frames; i += 2)
+        AddToBusNEON(bus + i * 2, vld1q_f32(src + i * 2), gain);
+    MixUnityScalar(bus + i * 2, src + i * 2, 0, step, frames - i, gainL, gainR);
+}
+static void MixLinearNEON(float* bus, const float* src, Uint32 position, Uint32 step, int frames, float gainL, float gainR) {
+    float32x4_t gain = GetGainNEON(gainL, gainR);
+
+    int i = 0;
+    for (; i + 2 <= frames; i += 2, position += step * 2) {
+        const float* a = src + (position >> 16) * 2;
+        const float* b = src + ((position + step) >> 16) * 2;
+        float32x4_t x0 = LoadFramesNEON(a, b);
+        float32x4_t x1 = LoadFramesNEON(a + 2, b + 2);
+        float32x4_t t = GetFractionsNEON(position, step);
+        AddToBusNEON(bus + i * 2, vaddq_f32(x0, vmulq_f32(t, vsubq_f32(x1, x0))), gain);
+    }
+    MixLinearScalar(bus + i * 2, src, position, step, frames - i, gainL, gainR);
+}
+static void MixCubicNEON(float* bus, const float* src, Uint32 position, Uint32 step, int frames, float gainL, float gainR) {
+    float32x4_t gain = GetGainNEON(gainL, gainR);
+    float32x4_t half = vdupq_n_f32(0.5f);
+    float32x4_t two = vdupq_n_f32(2.0f);
+    float32x4_t twoAndAHalf = vdupq_n_f32(2.5f);
+    float32x4_t oneAndAHalf = vdupq_n_f32(1.5f);
+
+    int i = 0;
+    for (; i + 2 <= frames; i += 2, position += step * 2) {
+        const float* a = src + (position >> 16) * 2;
+        const float* b = src + ((position + step) >> 16) * 2;
+        float32x4_t xm1 = LoadFramesNEON(a - 2, b - 2);
+        float32x4_t x0 = LoadFramesNEON(a, b);
+        float32x4_t x1 = LoadFramesNEON(a + 2, b + 2);
+        float32x4_t x2 = LoadFramesNEON(a + 4, b + 4);
+        float32x4_t t = GetFractionsNEON(position, step);
+
+        float32x4_t c1 = vmulq_f32(half, vsubq_f32(x1, xm1));
+        float32x4_t c2 = vsubq_f32(xm1, vmulq_f32(twoAndAHalf, x0));
+        c2 = vaddq_f32(c2, vmulq_f32(two, x1));
+        c2 = vsubq_f32(c2, vmulq_f32(half, x2));
+        float32x4_t c3 = vaddq_f32(vmulq_f32(half, vsubq_f32(x2, xm1)), vmulq_f32(oneAndAHalf, vsubq_f32(x0, x1)));
+
+        float32x4_t s = vaddq_f32(vmulq_f32(c3, t), c2);
+        s = vaddq_f32(vmulq_f32(s, t), c1);
+        s = vaddq_f32(vmulq_f32(s, t), x0);
+        AddToBusNEON(bus + i * 2, s, gain);
+    }
+    MixCubicScalar(bus + i * 2, src, position, step, frames - i, gainL, gainR);
+}
+#endif
+
+PUBLIC STATIC void AudioMixer::Init() {
+    MixUnity = MixUnityScalar;
+    MixLinear = MixLinearScalar;
+    MixCubic = MixCubicScalar;
+    ReadS16 = ReadS16Scalar;
+    WriteS16 = WriteS16Scalar;
+    AudioMixer::Level = "None";
+
+    if (!AudioMixer::UseSIMD) {
+        Log::Print(Log::LOG_VERBOSE, "Audio mixer not using SIMD.");
+        return;
+    }
+
+#ifdef MIXER_X86
+    if (SDL_HasSSE2()) {
+        MixUnity = MixUnitySSE2;
+        MixLinear = MixLinearSSE2;
+        MixCubic = MixCubicSSE2;
+        ReadS16 = ReadS16SSE2;
+        WriteS16 = WriteS16SSE2;
+        AudioMixer::Level = "SSE2";
+    }
+#endif
+#ifdef MIXER_NEON
+    if (SDL_HasNEON()) {
+        MixUnity = MixUnityNEON;
+        MixLinear = MixLinearNEON;
+        MixCubic = MixCubicNEON;
+        ReadS16 = ReadS16NEON;
+        AudioMixer::Level = "NEON";
+    }
+#endif
+
+    Log::Print(Log::LOG_VERBOSE, "Audio mixer using %s.", AudioMixer::Level);
+}
+
+// How many frames of a voice's window mixing this many frames from
+// position on needs, counting the one before position. That's enough
+// to read every frame and to keep the one before wherever it stops.
+PUBLIC STATIC Uint32 AudioMixer::GetFramesNeeded(Uint32 position, Uint32 step, int frames) {
+    if (frames <= 0)
+        return (position >> 16) + 1;
+
+    Uint64 last = (((Uint64)position + (Uint64)step * (frames - 1)) >> 16) + 3;
+    Uint64 next = ((Uint64)position + (Uint64)step * frames) >> 16;
+    return (Uint32)(last > next ? last : next);
+}
+
+// Resamples a voice into the bus, which has the same number of channels.
+// Panning only applies to stereo; anything else just uses gainL.
+PUBLIC STATIC void AudioMixer::MixVoice(float* bus, int channels, const float* src, Uint32 position, Uint32 step, int frames, float gainL, float gainR) {
+    if (channels == 2) {
+        if (step == 0x10000 && !(position & 0xFFFF))
+            MixUnity(bus, src, position, step, frames, gainL, gainR);
+        else if (AudioMixer::Interpolation == AudioMixer::INTERPOLATE_CUBIC)
+            MixCubic(bus, src, position, step, frames, gainL, gainR);
+        else
+            MixLinear(bus, src, position, step, frames, gainL, gainR);
+        return;
+    }
+
+    bool cubic = AudioMixer::Interpolation == AudioMixer::INTERPOLATE_CUBIC;
+    for (int i = 0; i < frames; i++, position += step) {
+        const float* x = src + (position >> 16) * channels;
+        float t = FRACTION(position);
+        for (int c = 0; c < channels; c++) {
+            float s;
+            if (cubic)
+                s = Cubic(x[c - channels], x[c], x[c + channels], x[c + channels * 2], t);
+            else
+                s = x[c] + t * (x[c + channels] - x[c]);
+            bus[i * channels + c] += s * gainL;
+        }
+    }
+}
+
+#define FOR_EACH_FORMAT(DO) \
+    switch (format) { \
+        case AUDIO_U8:     DO(Uint8, 128.0f, 128.0f); break; \
+        case AUDIO_S8:     DO(Sint8, 128.0f, 0.0f); break; \
+        case AUDIO_U16SYS: DO(Uint16, 32768.0f, 32768.0f); break; \
+        case AUDIO_S16SYS: DO(Sint16, 32768.0f, 0.0f); break; \
+        case AUDIO_S32SYS: DO(Sint32, 2147483648.0f, 0.0f); break; \
+        case AUDIO_F32SYS: DO(float, 1.0f, 0.0f); break; \
+    }
+
+// Turns samples in the device's format into floats.
+PUBLIC STATIC void AudioMixer::ConvertSamples(float* dest, const Uint8* src, SDL_AudioFormat format, size_t count) {
+    if (format == AUDIO_S16SYS) {
+        ReadS16(dest, (const Sint16*)src, count);
+        return;
+    }
+
+#define CONVERT(type, scale, bias) { \
+    const type* in = (const type*)src; \
+    for (size_t i = 0; i < count; i++) \
+        dest[i] = ((float)in[i] - bias) * (1.0f / scale); \
+}
+    FOR_EACH_FORMAT(CONVERT)
+#undef CONVERT
+}
+// Adds samples in the device's format to the bus.
+PUBLIC STATIC void AudioMixer::MixSamples(float* bus, const Uint8* src, SDL_AudioFormat format, size_t count, float gain) {
+#define MIX(type, scale, bias) { \
+    const type* in = (const type*)src; \
+    gain *= 1.0f / scale; \
+    for (size_t i = 0; i < count; i++) \
+        bus[i] += ((float)in[i] - bias) * gain; \
+}
+    FOR_EACH_FORMAT(MIX)
+#undef MIX
+}
+// Clamps the bus and writes it out in the device's format.
+PUBLIC STATIC void AudioMixer::WriteSamples(Uint8* dest, const float* bus, SDL_AudioFormat format, size_t count) {
+    if (format == AUDIO_S16SYS) {
+        WriteS16((Sint16*)dest, bus, count);
+        return;
+    }
+
+#define WRITE(type, scale, bias) { \
+    type* out = (type*)dest; \
+    for (size_t i = 0; i < count; i++) { \
+        double v = (double)bus[i] * scale + bias; \
+        if (v > scale + bias - 1.0) \
+            v = scale + bias - 1.0; \
+        else if (v < bias - scale) \
+            v = bias - scale; \
+        out[i] = (type)v; \
+    } \
+}
+    switch (format) {
+        case AUDIO_U8:     WRITE(Uint8, 128.0, 128.0); break;
+        case AUDIO_S8:     WRITE(Sint8, 128.0, 0.0); break;
+        case AUDIO_U16SYS: WRITE(Uint16, 32768.0, 32768.0); break;
+        case AUDIO_S32SYS: WRITE(Sint32, 2147483648.0, 0.0); break;
+        case AUDIO_F32SYS: {
+            float* out = (float*)dest;
+            for (size_t i = 0; i < count; i++)
+                out[i] = bus[i] > 1.0f ? 1.0f : bus[i] < -1.0f ? -1.0f : bus[i];
+            break;
+        }
+    }
+#undef WRITE
+}
+
+#undef FOR_EACH_FORMAT
@@ -17,11 +17,23 @@ public:
     SoundFormat*     SoundData = NULL;
     bool             OwnsSoundData = false;
     Sint32           LoopIndex = -1;
+
+    // Frames taken out of Buffer so far
+    Uint32           BufferPosition = 0;
+
+    // Frames converted to floats for the mixer, starting with the one
+    // before MixPosition (16.16 fixed point)
+    float*           MixFrames = NULL;
+    Uint32           MixFrameCount = 0;
+    Uint32           MixFrameCapacity = 0;
+    Uint32           MixPosition = 0;
 };
 #endif
 
 #include <Engine/Audio/AudioPlayback.h>
+#include <Engine/Audio/AudioIncludes.h>
 #include <Engine/Audio/AudioManager.h>
+#include <Engine/Diagnostics/Memory.h>
 
 PUBLIC      AudioPlayback::AudioPlayback(SDL_AudioSpec format, size_t requiredSamples, size_t audioBytesPerSample, size_t deviceBytesPerSample) {
     Format = format;
@@ -32,6 +44,7 @@ PUBLIC      AudioPlayback::AudioPlayback(SDL_AudioSpec format, size_t requiredSa
     // Create sample buffers
     Buffer = (Uint8*)Memory::TrackedMalloc("Playback::Buffer", requiredSamples * deviceBytesPerSample);
     UnconvertedSampleBuffer = (Uint8*)Memory::TrackedMalloc("Playback::UnconvertedSampleBuffer", requiredSamples * audioBytesPerSample);
+    ReserveMixFrames();
 
     // Create sound conversion stream
     CreateConversionStream(format);
@@ -48,6 +61,8 @@ PUBLIC void AudioPlayback::Change(SDL_AudioSpec format, size_t requiredSamples,
     if (bufSize > RequiredSamples * BytesPerSample)
         UnconvertedSampleBuffer = (Uint8*)Memory::Realloc(UnconvertedSampleBuffer, bufSize);
 
+    ReserveMixFrames();
+
     Format = format;
     RequiredSamples = requiredSamples;
     BytesPerSample = audioBytesPerSample;
@@ -84,6 +99,11 @@ PUBLIC void AudioPlayback::Dispose() {
         Memory::Free(UnconvertedSampleBuffer);
         UnconvertedSampleBuffer = NULL;
     }
+    if (MixFrames) {
+        Memory::Free(MixFrames);
+        MixFrames = NULL;
+        MixFrameCapacity = 0;
+    }
     if (ConversionStream) {
         SDL_FreeAudioStream(ConversionStream);
         ConversionStream = NULL;
@@ -116,6 +136,7 @@ PUBLIC int AudioPlayback::RequestSamples(int samples, bool loop, int sample_to_l
             return AudioManager::REQUEST_EOF;
 
         BufferedSamples = num_samples;
+        BufferPosition = 0;
 
         num_samples *= SoundData->SampleSize;
         return num_samples;
@@ -160,6 +181,7 @@ PUBLIC int AudioPlayback::RequestSamples(int samples, bool loop, int sample_to_l
         return AudioManager::REQUEST_CONVERTING;
 
     BufferedSamples = received_bytes / AudioManager::BytesPerSample;
+    BufferPosition = 0;
 
     return received_bytes;
 }
@@ -169,6 +191,27 @@ PUBLIC void AudioPlayback::Seek(int samples) {
         return;
 
     SoundData->SeekSample(samples);
+    ResetMix();
+}
+
+// Makes room for the biggest window the mixer can need, so that the
+// audio thread never has to allocate.
+PRIVATE void AudioPlayback::ReserveMixFrames() {
+    int channels = AudioManager::DeviceFormat.channels;
+    if (MixFrames || channels <= 0)
+        return;
+
+    MixFrames = (float*)Memory::TrackedMalloc("Playback::MixFrames", (size_t)MIX_WINDOW_FRAMES * channels * sizeof(float));
+    if (MixFrames)
+        MixFrameCapacity = MIX_WINDOW_FRAMES;
+}
+// Throws away anything buffered, so playback picks up from wherever
+// the sound data is now.
+PUBLIC void AudioPlayback::ResetMix() {
+    BufferedSamples = 0;
+    BufferPosition = 0;
+    MixFrameCount = 0;
+    MixPosition = 0;
 }
 
 PUBLIC AudioPlayback::~AudioPlayback() {
@@ -0,0 +1,82 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Includes/StandardSDL2.h>
+
+class AudioRing {
+public:
+    Uint8*       Data = NULL;
+    Uint32       Capacity = 0;
+    SDL_atomic_t ReadPosition;
+    SDL_atomic_t WritePosition;
+};
+#endif
+
+#include <Engine/Audio/AudioRing.h>
+
+#include <Engine/Diagnostics/Memory.h>
+
+// A ring buffer for handing bytes from one thread to one other thread
+// without either of them waiting on a lock. Only the writing thread
+// moves WritePosition and only the reading thread moves ReadPosition.
+// Both just count up and wrap around, so the difference between them
+// is always how much is in the ring. SDL's atomic get and set are full
+// memory barriers, so whatever gets copied in before a position moves
+// is there for the other thread once it sees it move.
+
+PUBLIC AudioRing::AudioRing(Uint32 capacity, const char* identifier) {
+    Capacity = 1;
+    while (Capacity < capacity)
+        Capacity <<= 1;
+
+    Data = (Uint8*)Memory::TrackedMalloc(identifier, Capacity);
+    if (!Data)
+        Capacity = 0;
+
+    SDL_AtomicSet(&ReadPosition, 0);
+    SDL_AtomicSet(&WritePosition, 0);
+}
+
+// How much there is to read. Only meant for the reading thread, though
+// the writing thread gets a number that's never too high.
+PUBLIC Uint32 AudioRing::GetAvailable() {
+    return (Uint32)SDL_AtomicGet(&WritePosition) - (Uint32)SDL_AtomicGet(&ReadPosition);
+}
+// How much room there is to write. Only meant for the writing thread.
+PUBLIC Uint32 AudioRing::GetFree() {
+    return Capacity - GetAvailable();
+}
+
+// Writes all of it or none of it.
+PUBLIC bool AudioRing::Write(const void* data, Uint32 size) {
+    Uint32 write = (Uint32)SDL_AtomicGet(&WritePosition);
+    Uint32 read = (Uint32)SDL_AtomicGet(&ReadPosition);
+    if (size > Capacity - (write - read))
+        return false;
+
+    Uint32 start = write & (Capacity - 1);
+    Uint32 first = Capacity - start < size ? Capacity - start : size;
+    memcpy(Data + start, data, first);
+    memcpy(Data, (const Uint8*)data + first, size - first);
+
+    SDL_AtomicSet(&WritePosition, (int)(write + size));
+    return true;
+}
+// Reads all of it or none of it.
+PUBLIC bool AudioRing::Read(void* data, Uint32 size) {
+    Uint32 read = (Uint32)SDL_AtomicGet(&ReadPosition);
+    Uint32 write = (Uint32)SDL_AtomicGet(&WritePosition);
+    if (size > write - read)
+        return false;
+
+    Uint32 start = read & (Capacity - 1);
+    Uint32 first = Capacity - start < size ? Capacity - start : size;
+    memcpy(data, Data + start, first);
+    memcpy((Uint8*)data + first, Data, size - first);
+
+    SDL_AtomicSet(&ReadPosition, (int)(read + size));
+    return true;
+}
+
+PUBLIC AudioRing::~AudioRing() {
+    Memory::Free(Data);
+}
@@ -20,7 +20,9 @@ public:
 #include <Engine/IO/MemoryStream.h>
 #include <Engine/Utilities/StringUtils.h>
 
-#define BYTECODE_VERSION 0x0002
+// 0x0003: Superinstructions from BytecodeOptimizer. Older versions
+//         never contain them, so they still load as-is.
+#define BYTECODE_VERSION 0x0003
 
 const char*         Bytecode::Magic = "HTVM";
 Uint32              Bytecode::LatestVersion = BYTECODE_VERSION;
@@ -178,16 +180,20 @@ PUBLIC void        Bytecode::Write(Stream* stream, const char* sourceFilename, H
         stream->WriteUInt32(constSize);
         for (int i = 0; i < constSize; i++) {
             VMValue constt = (*chunk->Constants)[i];
-            Uint8 type = (Uint8)constt.Type;
+            Uint8 type = (Uint8)VALUE_TYPE(constt);
             stream->WriteByte(type);
 
             switch (type) {
-                case VAL_INTEGER:
-                    stream->WriteBytes(&AS_INTEGER(constt), sizeof(int));
+                case VAL_INTEGER: {
+                    int value = AS_INTEGER(constt);
+                    stream->WriteBytes(&value, sizeof(int));
                     break;
-                case VAL_DECIMAL:
-                    stream->WriteBytes(&AS_DECIMAL(constt), sizeof(float));
+                }
+                case VAL_DECIMAL: {
+                    float value = AS_DECIMAL(constt);
+                    stream->WriteBytes(&value, sizeof(float));
                     break;
+                }
                 case VAL_OBJECT:
                     if (OBJECT_TYPE(constt) == OBJ_STRING) {
                         ObjString* str = AS_STRING(constt);
@@ -0,0 +1,655 @@
+#if INTERFACE
+#include <Engine/Bytecode/Types.h>
+#include <Engine/Bytecode/CompilerEnums.h>
+
+class BytecodeOptimizer {
+};
+#endif
+
+#include <Engine/Bytecode/BytecodeOptimizer.h>
+
+// Same as the states in Compiler::GetWithStatement.
+enum {
+    WITH_STATE_INIT,
+    WITH_STATE_ITERATE,
+    WITH_STATE_FINISH,
+    WITH_STATE_INIT_SLOTTED,
+};
+
+// Passes stop early once nothing changes.
+#define OPTIMIZER_MAX_PASSES 8
+// How many jumps in a row get followed when threading.
+#define OPTIMIZER_MAX_THREADING 8
+
+PUBLIC STATIC int BytecodeOptimizer::GetInstructionLength(Uint8* code, int offset, int count) {
+    switch (code[offset]) {
+        case OP_NULL:
+        case OP_TRUE:
+        case OP_FALSE:
+        case OP_POP:
+        case OP_RETURN:
+        case OP_ADD:
+        case OP_SUBTRACT:
+        case OP_MULTIPLY:
+        case OP_DIVIDE:
+        case OP_MODULO:
+        case OP_NEGATE:
+        case OP_INCREMENT:
+        case OP_DECREMENT:
+        case OP_BITSHIFT_LEFT:
+        case OP_BITSHIFT_RIGHT:
+        case OP_BW_NOT:
+        case OP_BW_AND:
+        case OP_BW_OR:
+        case OP_BW_XOR:
+        case OP_LG_NOT:
+        case OP_LG_AND:
+        case OP_LG_OR:
+        case OP_EQUAL:
+        case OP_EQUAL_NOT:
+        case OP_GREATER:
+        case OP_GREATER_EQUAL:
+        case OP_LESS:
+        case OP_LESS_EQUAL:
+        case OP_PRINT:
+        case OP_ENUM_NEXT:
+        case OP_SAVE_VALUE:
+        case OP_LOAD_VALUE:
+        case OP_GET_ELEMENT:
+        case OP_SET_ELEMENT:
+        case OP_TYPEOF:
+        case OP_GET_SUPERCLASS:
+        case OP_DEFINE_MODULE_LOCAL:
+            return 1;
+        case OP_GET_LOCAL:
+        case OP_SET_LOCAL:
+        case OP_COPY:
+        case OP_POPN:
+        case OP_CALL:
+        case OP_NEW:
+        case OP_EVENT:
+        case OP_INCREMENT_LOCAL:
+        case OP_DECREMENT_LOCAL:
+            return 2;
+        case OP_JUMP:
+        case OP_JUMP_BACK:
+        case OP_JUMP_IF_FALSE:
+        case OP_GET_MODULE_LOCAL:
+        case OP_SET_MODULE_LOCAL:
+            return 3;
+        case OP_CONSTANT:
+        case OP_DEFINE_GLOBAL:
+        case OP_GET_GLOBAL:
+        case OP_SET_GLOBAL:
+        case OP_GET_PROPERTY:
+        case OP_SET_PROPERTY:
+        case OP_HAS_PROPERTY:
+        case OP_NEW_ARRAY:
+        case OP_NEW_MAP:
+        case OP_IMPORT:
+        case OP_IMPORT_MODULE:
+        case OP_INHERIT:
+        case OP_NEW_ENUM:
+        case OP_ADD_ENUM:
+        case OP_USE_NAMESPACE:
+            return 5;
+        case OP_CLASS:
+        case OP_METHOD:
+        case OP_GET_LOCAL_PROPERTY:
+            return 6;
+        case OP_INVOKE:
+            return 7;
+        case OP_JUMP_IF_LESS_LOCAL_CONST:
+            return 8;
+        case OP_WITH:
+            if (offset + 1 >= count)
+                return -1;
+            return code[offset + 1] == WITH_STATE_INIT_SLOTTED ? 5 : 4;
+    }
+
+    // Switch tables, failsafes and anything else with
+    // offsets we don't know how to move.
+    return -1;
+}
+// Returns 1 if the instruction jumps forward by its operand,
+// -1 if it jumps backward, and 0 if it doesn't jump at all.
+// The offset is always the last two bytes of the instruction.
+PRIVATE STATIC int  BytecodeOptimizer::GetJumpDirection(BytecodeInstruction* instruction) {
+    switch (instruction->Code[0]) {
+        case OP_JUMP:
+        case OP_JUMP_IF_FALSE:
+        case OP_JUMP_IF_LESS_LOCAL_CONST:
+            return 1;
+        case OP_JUMP_BACK:
+            return -1;
+        case OP_WITH:
+            switch (instruction->Code[1]) {
+                case WITH_STATE_INIT:
+                case WITH_STATE_INIT_SLOTTED:
+                    return 1;
+                case WITH_STATE_ITERATE:
+                    return -1;
+            }
+            break;
+    }
+    return 0;
+}
+
+PRIVATE STATIC bool BytecodeOptimizer::Decode(Chunk* chunk, vector<BytecodeInstruction>& instructions) {
+    vector<int> indexAt(chunk->Count, -1);
+    vector<int> targets;
+
+    for (int offset = 0; offset < chunk->Count; ) {
+        int length = GetInstructionLength(chunk->Code, offset, chunk->Count);
+        if (length < 0 || offset + length > chunk->Count)
+            return false;
+
+        BytecodeInstruction instruction;
+        memcpy(instruction.Code, chunk->Code + offset, length);
+        instruction.Length = length;
+        instruction.Line = chunk->Lines ? chunk->Lines[offset] : 0;
+        instruction.Target = -1;
+        instruction.Removed = false;
+
+        int target = -1;
+        int direction = GetJumpDirection(&instruction);
+        if (direction) {
+            Sint16 jump = (Sint16)(instruction.Code[length - 2] | instruction.Code[length - 1] << 8);
+            target = offset + length + direction * jump;
+            if (target < 0 || target >= chunk->Count)
+                return false;
+        }
+
+        indexAt[offset] = (int)instructions.size();
+        instructions.push_back(instruction);
+        targets.push_back(target);
+
+        offset += length;
+    }
+
+    for (size_t i = 0; i < instructions.size(); i++) {
+        if (targets[i] < 0)
+            continue;
+
+        // Jumping into the middle of an instruction
+        if (indexAt[targets[i]] < 0)
+            return false;
+
+        instructions[i].Target = indexAt[targets[i]];
+    }
+
+    return true;
+}
+PRIVATE STATIC bool BytecodeOptimizer::Emit(Chunk* chunk, vector<BytecodeInstruction>& instructions, vector<VMValue>& constants) {
+    int count = (int)instructions.size();
+    vector<int> offsets(count);
+
+    int offset = 0;
+    for (int i = 0; i < count; i++) {
+        offsets[i] = offset;
+        if (!instructions[i].Removed)
+            offset += instructions[i].Length;
+    }
+
+    // Re-encode jumps now that everything has moved
+    for (int i = 0; i < count; i++) {
+        BytecodeInstruction* instruction = &instructions[i];
+        if (instruction->Removed || instruction->Target < 0)
+            continue;
+
+        if (instruction->Target >= count || instructions[instruction->Target].Removed)
+            return false;
+
+        int distance = offsets[instruction->Target] - (offsets[i] + instruction->Length);
+        int jump;
+        switch (instruction->Code[0]) {
+            case OP_JUMP:
+            case OP_JUMP_BACK:
+                // Threading can turn a forward jump into a backward one and vice versa
+                if (distance < 0) {
+                    instruction->Code[0] = OP_JUMP_BACK;
+                    jump = -distance;
+                }
+                else {
+                    instruction->Code[0] = OP_JUMP;
+                    jump = distance;
+                }
+                break;
+            case OP_WITH:
+                jump = GetJumpDirection(instruction) * distance;
+                if (jump < 0)
+                    return false;
+                break;
+            default:
+                jump = distance;
+                break;
+        }
+
+        if (jump < INT16_MIN || jump > INT16_MAX)
+            return false;
+
+        instruction->Code[instruction->Length - 2] = jump & 0xFF;
+        instruction->Code[instruction->Length - 1] = (jump >> 8) & 0xFF;
+    }
+
+    for (size_t i = 0; i < constants.size(); i++)
+        chunk->AddConstant(constants[i]);
+
+    chunk->Count = 0;
+    for (int i = 0; i < count; i++) {
+        if (instructions[i].Removed)
+            continue;
+        for (int b = 0; b < instructions[i].Length; b++)
+            chunk->Write(instructions[i].Code[b], instructions[i].Line);
+    }
+
+    return true;
+}
+
+PRIVATE STATIC int  BytecodeOptimizer::NextInstruction(vector<BytecodeInstruction>& instructions, int index) {
+    while (index < (int)instructions.size() && instructions[index].Removed)
+        index++;
+    return index;
+}
+PRIVATE STATIC void BytecodeOptimizer::RemoveInstruction(vector<BytecodeInstruction>& instructions, int index) {
+    instructions[index].Removed = true;
+}
+// Points every jump at the first instruction still present at or after
+// its target. Only jumps to the next instruction and the tails of folded
+// or fused sequences ever get removed, so this never changes behavior.
+PRIVATE STATIC void BytecodeOptimizer::ResolveTargets(vector<BytecodeInstruction>& instructions, vector<bool>& targeted) {
+    targeted.assign(instructions.size(), false);
+    for (size_t i = 0; i < instructions.size(); i++) {
+        BytecodeInstruction* instruction = &instructions[i];
+        if (instruction->Removed || instruction->Target < 0)
+            continue;
+
+        instruction->Target = NextInstruction(instructions, instruction->Target);
+        if (instruction->Target < (int)instructions.size())
+            targeted[instruction->Target] = true;
+    }
+}
+// Fills `sequence` with the next `count` instructions starting at `index`,
+// failing if any past the first is a jump target.
+PRIVATE STATIC bool BytecodeOptimizer::GetSequence(vector<BytecodeInstruction>& instructions, vector<bool>& targeted, int index, int* sequence, int count) {
+    for (int i = 0; i < count; i++) {
+        if (index >= (int)instructions.size())
+            return false;
+        if (i > 0 && targeted[index])
+            return false;
+        sequence[i] = index;
+        index = NextInstruction(instructions, index + 1);
+    }
+    return true;
+}
+PRIVATE STATIC bool BytecodeOptimizer::MatchSequence(vector<BytecodeInstruction>& instructions, int* sequence, const Uint8* ops, int count) {
+    for (int i = 0; i < count; i++) {
+        if (instructions[sequence[i]].Code[0] != ops[i])
+            return false;
+    }
+    return true;
+}
+
+PRIVATE STATIC VMValue BytecodeOptimizer::GetConstant(Chunk* chunk, vector<VMValue>& constants, Uint32 index) {
+    Uint32 count = (Uint32)chunk->Constants->size();
+    if (index < count)
+        return (*chunk->Constants)[index];
+    return constants[index - count];
+}
+PRIVATE STATIC bool BytecodeOptimizer::ConstantsMatch(VMValue a, VMValue b) {
+    if (VALUE_TYPE(a) != VALUE_TYPE(b))
+        return false;
+    if (IS_INTEGER(a))
+        return AS_INTEGER(a) == AS_INTEGER(b);
+    if (IS_DECIMAL(a)) {
+        float a_d = AS_DECIMAL(a);
+        float b_d = AS_DECIMAL(b);
+        return memcmp(&a_d, &b_d, sizeof(float)) == 0;
+    }
+    return false;
+}
+// New constants are only added to the chunk once the whole
+// chunk has been optimized successfully.
+PRIVATE STATIC Uint32 BytecodeOptimizer::AddConstant(Chunk* chunk, vector<VMValue>& constants, VMValue value) {
+    Uint32 count = (Uint32)chunk->Constants->size();
+    for (Uint32 i = 0; i < count; i++) {
+        if (ConstantsMatch((*chunk->Constants)[i], value))
+            return i;
+    }
+    for (size_t i = 0; i < constants.size(); i++) {
+        if (ConstantsMatch(constants[i], value))
+            return count + (Uint32)i;
+    }
+    constants.push_back(value);
+    return count + (Uint32)constants.size() - 1;
+}
+
+// These follow the VMThread::Values_* functions exactly. Anything that
+// would throw at runtime (or is undefined in C++) is left alone.
+PRIVATE STATIC bool BytecodeOptimizer::FoldUnary(Uint8 op, VMValue a, VMValue* result) {
+    if (IS_INTEGER(a)) {
+        int a_d = AS_INTEGER(a);
+        switch (op) {
+            case OP_NEGATE:
+                if (a_d == INT32_MIN)
+                    return false;
+                *result = INTEGER_VAL(-a_d);
+                return true;
+            case OP_BW_NOT:
+                *result = INTEGER_VAL(~a_d);
+                return true;
+        }
+    }
+    else if (IS_DECIMAL(a)) {
+        switch (op) {
+            case OP_NEGATE:
+                *result = DECIMAL_VAL(-AS_DECIMAL(a));
+                return true;
+        }
+    }
+    return false;
+}
+PRIVATE STATIC bool BytecodeOptimizer::FoldBinary(Uint8 op, VMValue a, VMValue b, VMValue* result) {
+    if (!(IS_INTEGER(a) || IS_DECIMAL(a)) || !(IS_INTEGER(b) || IS_DECIMAL(b)))
+        return false;
+
+    // If one of the operands is a decimal, they both become one
+    if (IS_DECIMAL(a) || IS_DECIMAL(b)) {
+        float a_d = IS_DECIMAL(a) ? AS_DECIMAL(a) : (float)AS_INTEGER(a);
+        float b_d = IS_DECIMAL(b) ? AS_DECIMAL(b) : (float)AS_INTEGER(b);
+        switch (op) {
+            case OP_ADD:           *result = DECIMAL_VAL(a_d + b_d); return true;
+            case OP_SUBTRACT:      *result = DECIMAL_VAL(a_d - b_d); return true;
+            case OP_MULTIPLY:      *result = DECIMAL_VAL(a_d * b_d); return true;
+            case OP_DIVIDE:
+                if (b_d == 0.0)
+                    return false;
+                *result = DECIMAL_VAL(a_d / b_d);
+                return true;
+            case OP_LESS:          *result = INTEGER_VAL(a_d < b_d); return true;
+            case OP_GREATER:       *result = INTEGER_VAL(a_d > b_d); return true;
+            case OP_LESS_EQUAL:    *result = INTEGER_VAL(a_d <= b_d); return true;
+            case OP_GREATER_EQUAL: *result = INTEGER_VAL(a_d >= b_d); return true;
+        }
+        return false;
+    }
+
+    int a_d = AS_INTEGER(a);
+    int b_d = AS_INTEGER(b);
+    switch (op) {
+        case OP_ADD:           *result = INTEGER_VAL((int)((Uint32)a_d + (Uint32)b_d)); return true;
+        case OP_SUBTRACT:      *result = INTEGER_VAL((int)((Uint32)a_d - (Uint32)b_d)); return true;
+        case OP_MULTIPLY:      *result = INTEGER_VAL((int)((Uint32)a_d * (Uint32)b_d)); return true;
+        case OP_DIVIDE:
+        case OP_MODULO:
+            if (b_d == 0 || (a_d == INT32_MIN && b_d == -1))
+                return false;
+            *result = INTEGER_VAL(op == OP_DIVIDE ? a_d / b_d : a_d % b_d);
+            return true;
+        case OP_BITSHIFT_LEFT:
+            if (b_d < 0 || b_d > 31)
+                return false;
+            *result = INTEGER_VAL((int)((Uint32)a_d << b_d));
+            return true;
+        case OP_BITSHIFT_RIGHT:
+            if (b_d < 0 || b_d > 31)
+                return false;
+            *result = INTEGER_VAL(a_d >> b_d);
+            return true;
+        case OP_BW_AND:        *result = INTEGER_VAL(a_d & b_d); return true;
+        case OP_BW_OR:         *result = INTEGER_VAL(a_d | b_d); return true;
+        case OP_BW_XOR:        *result = INTEGER_VAL(a_d ^ b_d); return true;
+        case OP_LESS:          *result = INTEGER_VAL(a_d < b_d); return true;
+        case OP_GREATER:       *result = INTEGER_VAL(a_d > b_d); return true;
+        case OP_LESS_EQUAL:    *result = INTEGER_VAL(a_d <= b_d); return true;
+        case OP_GREATER_EQUAL: *result = INTEGER_VAL(a_d >= b_d); return true;
+    }
+    return false;
+}
+PRIVATE STATIC void BytecodeOptimizer::SetConstantOperand(BytecodeInstruction* instruction, Uint32 index) {
+    instruction->Code[1] = index & 0xFF;
+    instruction->Code[2] = index >> 8 & 0xFF;
+    instruction->Code[3] = index >> 16 & 0xFF;
+    instruction->Code[4] = index >> 24 & 0xFF;
+}
+PRIVATE STATIC Uint32 BytecodeOptimizer::GetConstantOperand(BytecodeInstruction* instruction) {
+    return *(Uint32*)&instruction->Code[1];
+}
+
+// CONSTANT a, CONSTANT b, <op>  ->  CONSTANT (a <op> b)
+// CONSTANT a, <op>              ->  CONSTANT (<op> a)
+PRIVATE STATIC bool BytecodeOptimizer::FoldConstants(Chunk* chunk, vector<BytecodeInstruction>& instructions, vector<VMValue>& constants) {
+    vector<bool> targeted;
+    ResolveTargets(instructions, targeted);
+
+    bool changed = false;
+    int sequence[3];
+    for (int i = NextInstruction(instructions, 0); i < (int)instructions.size(); ) {
+        if (instructions[i].Code[0] != OP_CONSTANT) {
+            i = NextInstruction(instructions, i + 1);
+            continue;
+        }
+
+        VMValue a = GetConstant(chunk, constants, GetConstantOperand(&instructions[i]));
+        VMValue result;
+
+        if (GetSequence(instructions, targeted, i, sequence, 3)
+            && instructions[sequence[1]].Code[0] == OP_CONSTANT) {
+            VMValue b = GetConstant(chunk, constants, GetConstantOperand(&instructions[sequence[1]]));
+            if (FoldBinary(instructions[sequence[2]].Code[0], a, b, &result)) {
+                SetConstantOperand(&instructions[i], AddConstant(chunk, constants, result));
+                RemoveInstruction(instructions, sequence[1]);
+                RemoveInstruction(instructions, sequence[2]);
+                changed = true;
+                // Stay here; the result may fold with what comes next
+                continue;
+            }
+        }
+
+        if (GetSequence(instructions, targeted, i, sequence, 2)
+            && FoldUnary(instructions[sequence[1]].Code[0], a, &result)) {
+            SetConstantOperand(&instructions[i], AddConstant(chunk, constants, result));
+            RemoveInstruction(instructions, sequence[1]);
+            changed = true;
+            continue;
+        }
+
+        i = NextInstruction(instructions, i + 1);
+    }
+    return changed;
+}
+
+PRIVATE STATIC void BytecodeOptimizer::ReplaceSequence(vector<BytecodeInstruction>& instructions, int* sequence, int count, Uint8* code, int length) {
+    BytecodeInstruction* instruction = &instructions[sequence[0]];
+    memcpy(instruction->Code, code, length);
+    instruction->Length = length;
+    for (int i = 1; i < count; i++)
+        RemoveInstruction(instructions, sequence[i]);
+}
+PRIVATE STATIC bool BytecodeOptimizer::FuseInstructions(vector<BytecodeInstruction>& instructions) {
+    vector<bool> targeted;
+    ResolveTargets(instructions, targeted);
+
+    bool changed = false;
+    int sequence[8];
+    Uint8 code[8];
+    for (int i = NextInstruction(instructions, 0); i < (int)instructions.size(); i = NextInstruction(instructions, i + 1)) {
+        BytecodeInstruction* instruction = &instructions[i];
+        if (instruction->Code[0] != OP_GET_LOCAL)
+            continue;
+
+        Uint8 slot = instruction->Code[1];
+
+        // "x++;" and "x--;" as statements
+        if (GetSequence(instructions, targeted, i, sequence, 8)) {
+            Uint8 op = instructions[sequence[3]].Code[0];
+            const Uint8 ops[] = { OP_GET_LOCAL, OP_COPY, OP_SAVE_VALUE, op, OP_SET_LOCAL, OP_POP, OP_LOAD_VALUE, OP_POP };
+            if ((op == OP_INCREMENT || op == OP_DECREMENT)
+                && MatchSequence(instructions, sequence, ops, 8)
+                && instructions[sequence[1]].Code[1] == 1
+                && instructions[sequence[4]].Code[1] == slot) {
+                code[0] = op == OP_INCREMENT ? OP_INCREMENT_LOCAL : OP_DECREMENT_LOCAL;
+                code[1] = slot;
+                ReplaceSequence(instructions, sequence, 8, code, 2);
+                changed = true;
+                continue;
+            }
+        }
+
+        // Same thing, without keeping the old value around
+        if (GetSequence(instructions, targeted, i, sequence, 4)) {
+            Uint8 op = instructions[sequence[1]].Code[0];
+            const Uint8 ops[] = { OP_GET_LOCAL, op, OP_SET_LOCAL, OP_POP };
+            if ((op == OP_INCREMENT || op == OP_DECREMENT)
+                && MatchSequence(instructions, sequence, ops, 4)
+                && instructions[sequence[2]].Code[1] == slot) {
+                code[0] = op == OP_INCREMENT ? OP_INCREMENT_LOCAL : OP_DECREMENT_LOCAL;
+                code[1] = slot;
+                ReplaceSequence(instructions, sequence, 4, code, 2);
+                changed = true;
+                continue;
+            }
+
+            // Loop conditions, ie. "x < 10"
+            const Uint8 lessOps[] = { OP_GET_LOCAL, OP_CONSTANT, OP_LESS, OP_JUMP_IF_FALSE };
+            if (MatchSequence(instructions, sequence, lessOps, 4)) {
+                int target = instructions[sequence[3]].Target;
+                code[0] = OP_JUMP_IF_LESS_LOCAL_CONST;
+                code[1] = slot;
+                memcpy(&code[2], &instructions[sequence[1]].Code[1], 4);
+                code[6] = code[7] = 0xFF; // Filled in by Emit
+                ReplaceSequence(instructions, sequence, 4, code, 8);
+                instruction->Target = target;
+                changed = true;
+                continue;
+            }
+        }
+
+        if (GetSequence(instructions, targeted, i, sequence, 2)
+            && instructions[sequence[1]].Code[0] == OP_GET_PROPERTY) {
+            code[0] = OP_GET_LOCAL_PROPERTY;
+            code[1] = slot;
+            memcpy(&code[2], &instructions[sequence[1]].Code[1], 4);
+            ReplaceSequence(instructions, sequence, 2, code, 6);
+            changed = true;
+            continue;
+        }
+    }
+    return changed;
+}
+
+// A jump that lands on an unconditional jump goes straight to where
+// that one goes. A failed conditional jump that lands on another
+// OP_JUMP_IF_FALSE will fail that one too, since the value is still
+// on the stack.
+PRIVATE STATIC bool BytecodeOptimizer::ThreadJumps(vector<BytecodeInstruction>& instructions) {
+    vector<bool> targeted;
+    ResolveTargets(instructions, targeted);
+
+    bool changed = false;
+    for (int i = NextInstruction(instructions, 0); i < (int)instructions.size(); i = NextInstruction(instructions, i + 1)) {
+        BytecodeInstruction* instruction = &instructions[i];
+
+        bool conditional;
+        switch (instruction->Code[0]) {
+            case OP_JUMP:
+            case OP_JUMP_BACK:
+                conditional = false;
+                break;
+            case OP_JUMP_IF_FALSE:
+            case OP_JUMP_IF_LESS_LOCAL_CONST:
+                conditional = true;
+                break;
+            default:
+                continue;
+        }
+
+        for (int hops = 0; hops < OPTIMIZER_MAX_THREADING; hops++) {
+            if (instruction->Target >= (int)instructions.size())
+                break;
+
+            BytecodeInstruction* target = &instructions[instruction->Target];
+            Uint8 op = target->Code[0];
+            if (op != OP_JUMP && op != OP_JUMP_BACK && !(conditional && op == OP_JUMP_IF_FALSE))
+                break;
+
+            int next = NextInstruction(instructions, target->Target);
+            if (next == i || next == instruction->Target)
+                break;
+
+            instruction->Target = next;
+            changed = true;
+        }
+    }
+    return changed;
+}
+// Removes jumps to the very next instruction, and jumps that can never
+// run because they follow another jump or a return and nothing jumps to them.
+PRIVATE STATIC bool BytecodeOptimizer::RemoveDeadJumps(vector<BytecodeInstruction>& instructions) {
+    vector<bool> targeted;
+    ResolveTargets(instructions, targeted);
+
+    bool changed = false;
+    int previous = -1;
+    for (int i = NextInstruction(instructions, 0); i < (int)instructions.size(); i = NextInstruction(instructions, i + 1)) {
+        BytecodeInstruction* instruction = &instructions[i];
+        Uint8 op = instruction->Code[0];
+        if (op == OP_JUMP || op == OP_JUMP_BACK) {
+            bool unreachable = false;
+            if (previous >= 0 && !targeted[i]) {
+                switch (instructions[previous].Code[0]) {
+                    case OP_JUMP:
+                    case OP_JUMP_BACK:
+                    case OP_RETURN:
+                        unreachable = true;
+                        break;
+                }
+            }
+
+            if (unreachable || instruction->Target == NextInstruction(instructions, i + 1)) {
+                RemoveInstruction(instructions, i);
+                changed = true;
+                continue;
+            }
+        }
+        previous = i;
+    }
+    return changed;
+}
+
+PUBLIC STATIC bool  BytecodeOptimizer::Optimize(Chunk* chunk) {
+    // Only freshly compiled chunks can be rewritten
+    if (!chunk->OwnsMemory || !chunk->Count || chunk->CacheIndex)
+        return false;
+
+    vector<BytecodeInstruction> instructions;
+    if (!Decode(chunk, instructions))
+        return false;
+
+    vector<VMValue> constants;
+    bool changed = false;
+    for (int pass = 0; pass < OPTIMIZER_MAX_PASSES; pass++) {
+        bool passChanged = false;
+        if (FoldConstants(chunk, instructions, constants))
+            passChanged = true;
+        if (FuseInstructions(instructions))
+            passChanged = true;
+        if (ThreadJumps(instructions))
+            passChanged = true;
+        if (RemoveDeadJumps(instructions))
+            passChanged = true;
+
+        if (!passChanged)
+            break;
+
+        changed = true;
+    }
+
+    if (!changed)
+        return false;
+
+    vector<bool> targeted;
+    ResolveTargets(instructions, targeted);
+
+    return Emit(chunk, instructions, constants);
+}
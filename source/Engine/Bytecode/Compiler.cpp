@@ -13,6 +13,7 @@ public:
     static bool                 ShowWarnings;
     static bool                 WriteDebugInfo;
     static bool                 WriteSourceFilename;
+    static bool                 OptimizeBytecode;
 
     class Compiler* Enclosing = nullptr;
     ObjFunction*    Function = nullptr;
@@ -35,6 +36,7 @@ public:
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Bytecode/Compiler.h>
 #include <Engine/Bytecode/Bytecode.h>
+#include <Engine/Bytecode/BytecodeOptimizer.h>
 #include <Engine/Bytecode/GarbageCollector.h>
 #include <Engine/Bytecode/ScriptManager.h>
 #include <Engine/Bytecode/Values.h>
@@ -52,6 +54,7 @@ HashMap<Token>*      Compiler::TokenMap = NULL;
 bool                 Compiler::ShowWarnings = false;
 bool                 Compiler::WriteDebugInfo = false;
 bool                 Compiler::WriteSourceFilename = false;
+bool                 Compiler::OptimizeBytecode = false;
 
 #define Panic(returnMe) if (parser.PanicMode) { SynchronizeToken(); return returnMe; }
 
@@ -2902,6 +2905,26 @@ PUBLIC STATIC int    Compiler::ClassInstruction(const char* name, Chunk* chunk,
 PUBLIC STATIC int    Compiler::EnumInstruction(const char* name, Chunk* chunk, int offset) {
     return Compiler::HashInstruction(name, chunk, offset);
 }
+PUBLIC STATIC int    Compiler::LocalHashInstruction(const char* name, Chunk* chunk, int offset) {
+    uint8_t slot = chunk->Code[offset + 1];
+    uint32_t hash = *(uint32_t*)&chunk->Code[offset + 2];
+    printf("%-16s %9d #%08X", name, slot, hash);
+    if (TokenMap->Exists(hash)) {
+        Token t = TokenMap->Get(hash);
+        printf(" (%.*s)", (int)t.Length, t.Start);
+    }
+    printf("\n");
+    return offset + 6;
+}
+PUBLIC STATIC int    Compiler::LocalConstantJumpInstruction(const char* name, Chunk* chunk, int offset) {
+    uint8_t slot = chunk->Code[offset + 1];
+    int constant = *(int*)&chunk->Code[offset + 2];
+    int16_t jump = (int16_t)(chunk->Code[offset + 6] | chunk->Code[offset + 7] << 8);
+    printf("%-16s %9d '", name, slot);
+    Values::PrintValue(NULL, (*chunk->Constants)[constant]);
+    printf("' -> %d\n", offset + 8 + jump);
+    return offset + 8;
+}
 PUBLIC STATIC int    Compiler::WithInstruction(const char* name, Chunk* chunk, int offset) {
     uint8_t slot = chunk->Code[offset + 1];
     if (slot == 0) {
@@ -3064,6 +3087,14 @@ PUBLIC STATIC int    Compiler::DebugInstruction(Chunk* chunk, int offset) {
             return SimpleInstruction("OP_INHERIT", offset);
         case OP_METHOD:
             return MethodInstruction("OP_METHOD", chunk, offset);
+        case OP_INCREMENT_LOCAL:
+            return LocalInstruction("OP_INCREMENT_LOCAL", chunk, offset);
+        case OP_DECREMENT_LOCAL:
+            return LocalInstruction("OP_DECREMENT_LOCAL", chunk, offset);
+        case OP_GET_LOCAL_PROPERTY:
+            return LocalHashInstruction("OP_GET_LOCAL_PROPERTY", chunk, offset);
+        case OP_JUMP_IF_LESS_LOCAL_CONST:
+            return LocalConstantJumpInstruction("OP_JUMP_IF_LESS_LOCAL_CONST", chunk, offset);
         default:
             printf("\x1b[1;93mUnknown opcode %d\x1b[m\n", instruction);
             return chunk->Count + 1;
@@ -3095,6 +3126,7 @@ PUBLIC STATIC void   Compiler::Init() {
     Compiler::ShowWarnings = false;
     Compiler::WriteDebugInfo = true;
     Compiler::WriteSourceFilename = true;
+    Compiler::OptimizeBytecode = true;
 }
 PUBLIC STATIC void   Compiler::PrepareCompiling() {
     if (Compiler::TokenMap == NULL) {
@@ -3149,6 +3181,16 @@ PRIVATE void         Compiler::WriteBytecode(Stream* stream, const char* filenam
         TokenMap->Clear();
 }
 PUBLIC bool          Compiler::Compile(const char* filename, const char* source, const char* output) {
+    Stream* stream = FileStream::New(output, FileStream::WRITE_ACCESS);
+    if (!stream) return false;
+
+    bool result = Compile(filename, source, stream);
+
+    stream->Close();
+
+    return result;
+}
+PUBLIC bool          Compiler::Compile(const char* filename, const char* source, Stream* output) {
     scanner.Line = 1;
     scanner.Start = (char*)source;
     scanner.Current = (char*)source;
@@ -3176,6 +3218,11 @@ PUBLIC bool          Compiler::Compile(const char* filename, const char* source,
 
     Finish();
 
+    if (Compiler::OptimizeBytecode) {
+        for (size_t c = 0; c < Compiler::Functions.size(); c++)
+            BytecodeOptimizer::Optimize(&Compiler::Functions[c]->Chunk);
+    }
+
     bool debugCompiler = false;
     Application::Settings->GetBool("dev", "debugCompiler", &debugCompiler);
     if (debugCompiler) {
@@ -3186,12 +3233,7 @@ PUBLIC bool          Compiler::Compile(const char* filename, const char* source,
         }
     }
 
-    Stream* stream = FileStream::New(output, FileStream::WRITE_ACCESS);
-    if (!stream) return false;
-
-    WriteBytecode(stream, filename);
-
-    stream->Close();
+    WriteBytecode(output, filename);
 
     return !parser.HadError;
 }
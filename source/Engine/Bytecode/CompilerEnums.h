@@ -56,4 +56,13 @@ struct ParseRule {
     enum Precedence Precedence;
 };
 
+// A decoded instruction, used by BytecodeOptimizer.
+struct BytecodeInstruction {
+    Uint8 Code[8];
+    int   Length;
+    int   Line;
+    int   Target;  // Index of the instruction jumped to, or -1
+    bool  Removed;
+};
+
 #endif /* ENGINE_COMPILER_ENUMS */
@@ -14,6 +14,26 @@ public:
     static bool         Print;
     static bool         FilterSweepEnabled;
     static int          FilterSweepType;
+
+    static bool         Incremental;
+    static GCState      State;
+
+    static Uint32       CycleCount;
+    static Uint32       StepCount;
+    static double       LastStepTime;
+    static double       LongestStepTime;
+    static double       GrayTime;
+    static double       BlackenTime;
+    static double       FreeTime;
+    static Uint32       ObjectsSwept;
+    static Uint32       ObjectsFreed;
+    static size_t       CycleStartSize;
+
+private:
+    static Obj*         SweepList;
+    static Obj**        SweepCursor;
+    static int          ObjectTypeFreed[MAX_OBJ_TYPE];
+    static int          ObjectTypeCounts[MAX_OBJ_TYPE];
 };
 #endif
 
@@ -39,16 +59,126 @@ bool         GarbageCollector::Print = false;
 bool         GarbageCollector::FilterSweepEnabled = false;
 int          GarbageCollector::FilterSweepType = 0;
 
+bool         GarbageCollector::Incremental = false;
+GCState      GarbageCollector::State = GC_STATE_IDLE;
+
+Uint32       GarbageCollector::CycleCount = 0;
+Uint32       GarbageCollector::StepCount = 0;
+double       GarbageCollector::LastStepTime = 0.0;
+double       GarbageCollector::LongestStepTime = 0.0;
+double       GarbageCollector::GrayTime = 0.0;
+double       GarbageCollector::BlackenTime = 0.0;
+double       GarbageCollector::FreeTime = 0.0;
+Uint32       GarbageCollector::ObjectsSwept = 0;
+Uint32       GarbageCollector::ObjectsFreed = 0;
+size_t       GarbageCollector::CycleStartSize = 0;
+
+Obj*         GarbageCollector::SweepList = NULL;
+Obj**        GarbageCollector::SweepCursor = NULL;
+int          GarbageCollector::ObjectTypeFreed[MAX_OBJ_TYPE];
+int          GarbageCollector::ObjectTypeCounts[MAX_OBJ_TYPE];
+
 PUBLIC STATIC void GarbageCollector::Init() {
     GarbageCollector::RootObject = NULL;
     GarbageCollector::NextGC = 0x100000;
+    GarbageCollector::State = GC_STATE_IDLE;
+    GarbageCollector::GrayList.clear();
+    GarbageCollector::SweepList = NULL;
+    GarbageCollector::SweepCursor = NULL;
 }
 
 PUBLIC STATIC void GarbageCollector::Collect() {
+    // Finish any cycle that's already in progress, since
+    // objects that became garbage after it started would
+    // otherwise survive this collection.
+    if (State != GC_STATE_IDLE)
+        FinishCycle();
+
+    double collectStart = Clock::GetTicks();
+
+    BeginCycle();
+    FinishCycle();
+
+    LastStepTime = LongestStepTime = Clock::GetTicks() - collectStart;
+}
+PUBLIC STATIC bool GarbageCollector::Step() {
+    double stepStart = Clock::GetTicks();
+    double deadline = stepStart + MaxTimeAlotted;
+
+    if (State == GC_STATE_IDLE)
+        BeginCycle();
+
+    if (State == GC_STATE_MARKING) {
+        if (MarkStep(deadline))
+            Remark();
+    }
+    if (State == GC_STATE_SWEEPING && Clock::GetTicks() < deadline)
+        SweepStep(deadline);
+
+    LastStepTime = Clock::GetTicks() - stepStart;
+    if (LongestStepTime < LastStepTime)
+        LongestStepTime = LastStepTime;
+    StepCount++;
+
+    return State == GC_STATE_IDLE;
+}
+PUBLIC STATIC void GarbageCollector::WriteBarrier(VMValue value) {
+    // Values stored into an already blackened object would
+    // never be traversed, so gray them as they're written.
+    if (State == GC_STATE_MARKING)
+        GrayValue(value);
+}
+PUBLIC STATIC void GarbageCollector::OnAllocate(Obj* object) {
+    // Objects created during marking are grayed, so that the
+    // values they're initialized with get traversed too.
+    if (State == GC_STATE_MARKING) {
+        object->IsDark = true;
+        GrayList.push_back(object);
+    }
+}
+
+PRIVATE STATIC void GarbageCollector::BeginCycle() {
     GrayList.clear();
 
+    StepCount = 0;
+    LongestStepTime = 0.0;
+    GrayTime = 0.0;
+    BlackenTime = 0.0;
+    FreeTime = 0.0;
+    ObjectsSwept = 0;
+    ObjectsFreed = 0;
+    CycleStartSize = GarbageSize;
+
+    memset(ObjectTypeFreed, 0, sizeof(ObjectTypeFreed));
+    memset(ObjectTypeCounts, 0, sizeof(ObjectTypeCounts));
+
     double grayElapsed = Clock::GetTicks();
+    GrayRoots();
+    GrayTime += Clock::GetTicks() - grayElapsed;
 
+    State = GC_STATE_MARKING;
+}
+PRIVATE STATIC void GarbageCollector::FinishCycle() {
+    if (State == GC_STATE_MARKING) {
+        MarkStep(0.0);
+        Remark();
+    }
+    if (State == GC_STATE_SWEEPING)
+        SweepStep(0.0);
+}
+PRIVATE STATIC void GarbageCollector::EndCycle() {
+    State = GC_STATE_IDLE;
+    CycleCount++;
+
+    for (size_t i = 0; i < MAX_OBJ_TYPE; i++) {
+        if (ObjectTypeCounts[i])
+            Log::Print(Log::LOG_VERBOSE, "Freed %d %s objects out of %d.", ObjectTypeFreed[i], GetObjectTypeString(i), ObjectTypeCounts[i]);
+    }
+
+    GarbageCollector::NextGC = GarbageCollector::GarbageSize + (1024 * 1024);
+}
+
+PRIVATE STATIC void GarbageCollector::GrayRoots() {
     // Mark threads (should lock here for safety)
     for (Uint32 t = 0; t < ScriptManager::ThreadCount; t++) {
         VMThread* thread = ScriptManager::Threads + t;
@@ -104,30 +234,55 @@ PUBLIC STATIC void GarbageCollector::Collect() {
     for (size_t i = 0; i < ScriptManager::ClassImplList.size(); i++) {
         GrayObject(ScriptManager::ClassImplList[i]);
     }
-
-    grayElapsed = Clock::GetTicks() - grayElapsed;
-
+}
+PRIVATE STATIC bool GarbageCollector::MarkStep(double deadline) {
     double blackenElapsed = Clock::GetTicks();
 
     // Traverse references
-    for (size_t i = 0; i < GrayList.size(); i++) {
-        BlackenObject(GrayList[i]);
+    Uint32 count = 0;
+    while (GrayList.size()) {
+        Obj* object = GrayList.back();
+        GrayList.pop_back();
+        BlackenObject(object);
+
+        if (deadline > 0.0 && (++count & 0xFF) == 0 && Clock::GetTicks() >= deadline)
+            break;
     }
 
-    blackenElapsed = Clock::GetTicks() - blackenElapsed;
+    BlackenTime += Clock::GetTicks() - blackenElapsed;
 
-    double freeElapsed = Clock::GetTicks();
+    return GrayList.size() == 0;
+}
+PRIVATE STATIC void GarbageCollector::Remark() {
+    // Roots aren't behind the write barrier, so scan them
+    // again and finish marking without yielding.
+    double grayElapsed = Clock::GetTicks();
+    GrayRoots();
+    GrayTime += Clock::GetTicks() - grayElapsed;
+
+    MarkStep(0.0);
 
-    int objectTypeFreed[MAX_OBJ_TYPE] = { 0 };
-    int objectTypeCounts[MAX_OBJ_TYPE] = { 0 };
+    // Detach the marked list; objects allocated while
+    // sweeping start a new one and are left alone.
+    SweepList = RootObject;
+    SweepCursor = &SweepList;
+    RootObject = NULL;
+
+    State = GC_STATE_SWEEPING;
+}
+PRIVATE STATIC bool GarbageCollector::SweepStep(double deadline) {
+    double freeElapsed = Clock::GetTicks();
 
     // Collect the white objects
-    Obj** object = &GarbageCollector::RootObject;
+    Uint32 count = 0;
+    Obj** object = SweepCursor;
     while (*object != NULL) {
-        objectTypeCounts[(*object)->Type]++;
+        ObjectTypeCounts[(*object)->Type]++;
+        ObjectsSwept++;
 
         if (!((*object)->IsDark)) {
-            objectTypeFreed[(*object)->Type]++;
+            ObjectTypeFreed[(*object)->Type]++;
+            ObjectsFreed++;
 
             // This object wasn't reached, so remove it from the list and
             // free it.
@@ -142,20 +297,26 @@ PUBLIC STATIC void GarbageCollector::Collect() {
             (*object)->IsDark = false;
             object = &(*object)->Next;
         }
+
+        if (deadline > 0.0 && (++count & 0xFF) == 0 && Clock::GetTicks() >= deadline)
+            break;
     }
+    SweepCursor = object;
 
-    freeElapsed = Clock::GetTicks() - freeElapsed;
+    FreeTime += Clock::GetTicks() - freeElapsed;
 
-    Log::Print(Log::LOG_VERBOSE, "Sweep: Graying took %.1f ms", grayElapsed);
-    Log::Print(Log::LOG_VERBOSE, "Sweep: Blackening took %.1f ms", blackenElapsed);
-    Log::Print(Log::LOG_VERBOSE, "Sweep: Freeing took %.1f ms", freeElapsed);
+    if (*object != NULL)
+        return false;
 
-    for (size_t i = 0; i < MAX_OBJ_TYPE; i++) {
-        if (objectTypeCounts[i])
-            Log::Print(Log::LOG_VERBOSE, "Freed %d %s objects out of %d.", objectTypeFreed[i], GetObjectTypeString(i), objectTypeCounts[i]);
-    }
+    // Put the survivors back in front of whatever was
+    // allocated during the sweep.
+    *object = RootObject;
+    RootObject = SweepList;
+    SweepList = NULL;
+    SweepCursor = NULL;
 
-    GarbageCollector::NextGC = GarbageCollector::GarbageSize + (1024 * 1024);
+    EndCycle();
+    return true;
 }
 
 PRIVATE STATIC void GarbageCollector::FreeValue(VMValue value) {
@@ -243,6 +404,8 @@ PRIVATE STATIC void GarbageCollector::BlackenObject(Obj* object) {
         }
         case OBJ_INSTANCE: {
             ObjInstance* instance = (ObjInstance*)object;
+            for (int i = 0; i < instance->Shape->SlotCount; i++)
+                GrayValue(instance->Slots[i]);
             GrayHashMap(instance->Fields);
             break;
         }
@@ -0,0 +1,606 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Bytecode/Types.h>
+
+class RegisterTier {
+public:
+    static int    Mode;
+    static Uint32 HotCallCount;
+    static Uint32 Threshold;
+    static Uint32 TranslatedCount;
+    static Uint32 RejectedCount;
+};
+#endif
+
+#include <Engine/Bytecode/RegisterTier.h>
+#include <Engine/Bytecode/BytecodeOptimizer.h>
+#include <Engine/Bytecode/ScriptManager.h>
+#include <Engine/Diagnostics/Log.h>
+
+int    RegisterTier::Mode = VM_TIER_AUTO;
+Uint32 RegisterTier::HotCallCount = 64;
+Uint32 RegisterTier::Threshold = 64;
+Uint32 RegisterTier::TranslatedCount = 0;
+Uint32 RegisterTier::RejectedCount = 0;
+
+// Functions are translated from their (already optimized) bytecode
+// by tracking what every stack slot holds. Locals and constants that
+// get pushed aren't copied anywhere until something needs them to be
+// in their slot, so "a = b + 1" becomes a single instruction reading
+// b and the constant and writing a.
+//
+// Anything that isn't arithmetic, a local or a jump (calls, properties,
+// globals, returns...) is left to the stack interpreter: the register
+// code stops with every slot where the stack interpreter expects it,
+// the stack interpreter runs that instruction and hands the frame back
+// at the next one.
+
+enum {
+    // Already in its own slot
+    OPERAND_REGISTER,
+    // Still the value of another slot
+    OPERAND_SLOT,
+    OPERAND_CONSTANT,
+};
+
+struct RegisterOperand {
+    Uint8  Kind;
+    Uint32 Index;
+};
+
+struct RegisterTranslator {
+    Chunk*                      Source;
+    vector<RegisterInstruction> Code;
+    vector<VMValue>             Constants;
+    vector<RegisterOperand>     Stack;
+    vector<RegisterEntry>       Entries;
+    // First register instruction of each bytecode instruction.
+    vector<int>                 IndexAt;
+    // Stack depth each bytecode instruction starts at, once known.
+    vector<int>                 DepthAt;
+    vector<bool>                Targeted;
+    int                         Offset;
+    // Instruction that made the value on top of the stack, if it was
+    // made by the previous bytecode instruction.
+    int                         Producer;
+    // Last point where nothing was pending, and nothing has been
+    // emitted since. The stack interpreter can rerun from there
+    // instead of the pending values being written out.
+    int                         CleanOffset;
+    int                         CleanDepth;
+    int                         CleanCount;
+};
+
+static RegisterOperand ResolveOperand(RegisterTranslator* t, int position) {
+    RegisterOperand operand = t->Stack[position];
+    if (operand.Kind == OPERAND_REGISTER) {
+        operand.Kind = OPERAND_SLOT;
+        operand.Index = position;
+    }
+    return operand;
+}
+static int  EmitRegister(RegisterTranslator* t, Uint8 op, int a, RegisterOperand* b, RegisterOperand* c, int depth) {
+    RegisterInstruction instruction;
+    memset(&instruction, 0, sizeof(instruction));
+    instruction.Op = op;
+    instruction.A = (Uint16)a;
+    if (b) {
+        instruction.B = b->Index;
+        if (b->Kind == OPERAND_CONSTANT)
+            instruction.Kinds |= REG_B_CONSTANT;
+    }
+    if (c) {
+        instruction.C = c->Index;
+        if (c->Kind == OPERAND_CONSTANT)
+            instruction.Kinds |= REG_C_CONSTANT;
+    }
+    instruction.Offset = t->Offset;
+    instruction.Depth = depth;
+    t->Code.push_back(instruction);
+    return (int)t->Code.size() - 1;
+}
+static void MaterializeOperand(RegisterTranslator* t, int position) {
+    if (t->Stack[position].Kind == OPERAND_REGISTER)
+        return;
+
+    RegisterOperand operand = t->Stack[position];
+    EmitRegister(t, REG_MOVE, position, &operand, NULL, (int)t->Stack.size());
+    t->Stack[position].Kind = OPERAND_REGISTER;
+}
+static void FlushOperands(RegisterTranslator* t) {
+    for (size_t i = 0; i < t->Stack.size(); i++)
+        MaterializeOperand(t, (int)i);
+}
+// Writes out anything still reading a slot that's about to change.
+static void ReleaseSlot(RegisterTranslator* t, int slot) {
+    for (size_t i = 0; i < t->Stack.size(); i++) {
+        if (t->Stack[i].Kind == OPERAND_SLOT && t->Stack[i].Index == (Uint32)slot)
+            MaterializeOperand(t, (int)i);
+    }
+}
+static bool HasPendingOperands(RegisterTranslator* t) {
+    for (size_t i = 0; i < t->Stack.size(); i++) {
+        if (t->Stack[i].Kind != OPERAND_REGISTER)
+            return true;
+    }
+    return false;
+}
+static void PushOperand(RegisterTranslator* t, Uint8 kind, Uint32 index) {
+    RegisterOperand operand;
+    operand.Kind = kind;
+    operand.Index = index;
+    t->Stack.push_back(operand);
+}
+static Uint32 AddRegisterConstant(RegisterTranslator* t, VMValue value) {
+    for (size_t i = t->Source->Constants->size(); i < t->Constants.size(); i++) {
+        if (VALUE_TYPE(t->Constants[i]) == VALUE_TYPE(value) && ScriptManager::ValuesEqual(t->Constants[i], value))
+            return (Uint32)i;
+    }
+    t->Constants.push_back(value);
+    return (Uint32)t->Constants.size() - 1;
+}
+static Uint8 GetRegisterOp(Uint8 op) {
+    switch (op) {
+        case OP_ADD:            return REG_ADD;
+        case OP_SUBTRACT:       return REG_SUBTRACT;
+        case OP_MULTIPLY:       return REG_MULTIPLY;
+        case OP_DIVIDE:         return REG_DIVIDE;
+        case OP_MODULO:         return REG_MODULO;
+        case OP_BITSHIFT_LEFT:  return REG_BITSHIFT_LEFT;
+        case OP_BITSHIFT_RIGHT: return REG_BITSHIFT_RIGHT;
+        case OP_BW_AND:         return REG_BW_AND;
+        case OP_BW_OR:          return REG_BW_OR;
+        case OP_BW_XOR:         return REG_BW_XOR;
+        case OP_LG_AND:         return REG_LG_AND;
+        case OP_LG_OR:          return REG_LG_OR;
+        case OP_EQUAL:          return REG_EQUAL;
+        case OP_EQUAL_NOT:      return REG_EQUAL_NOT;
+        case OP_GREATER:        return REG_GREATER;
+        case OP_GREATER_EQUAL:  return REG_GREATER_EQUAL;
+        case OP_LESS:           return REG_LESS;
+        case OP_LESS_EQUAL:     return REG_LESS_EQUAL;
+        case OP_NEGATE:         return REG_NEGATE;
+        case OP_BW_NOT:         return REG_BW_NOT;
+        case OP_LG_NOT:         return REG_LG_NOT;
+        case OP_INCREMENT:      return REG_INCREMENT;
+        case OP_DECREMENT:      return REG_DECREMENT;
+    }
+    return REG_FALLBACK;
+}
+// How an instruction left to the stack interpreter changes the
+// stack depth. Returns false for ones the register tier can't
+// work around (classes, enums, with, switch...)
+static bool GetFallbackEffect(Uint8* code, int* effect) {
+    switch (code[0]) {
+        case OP_GET_GLOBAL:
+        case OP_GET_MODULE_LOCAL:
+        case OP_GET_LOCAL_PROPERTY:
+        case OP_EVENT:
+            *effect = 1;
+            return true;
+        case OP_SET_GLOBAL:
+        case OP_GET_PROPERTY:
+        case OP_HAS_PROPERTY:
+        case OP_SET_MODULE_LOCAL:
+        case OP_GET_SUPERCLASS:
+        case OP_TYPEOF:
+        case OP_IMPORT:
+        case OP_IMPORT_MODULE:
+            *effect = 0;
+            return true;
+        case OP_DEFINE_GLOBAL:
+        case OP_SET_PROPERTY:
+        case OP_GET_ELEMENT:
+        case OP_DEFINE_MODULE_LOCAL:
+        case OP_PRINT:
+        case OP_RETURN:
+            *effect = -1;
+            return true;
+        case OP_SET_ELEMENT:
+            *effect = -2;
+            return true;
+        case OP_CALL:
+        case OP_INVOKE:
+        case OP_NEW:
+            *effect = -code[1];
+            return true;
+        case OP_NEW_ARRAY:
+        case OP_NEW_MAP: {
+            Uint32 count = code[1] | code[2] << 8 | code[3] << 16 | code[4] << 24;
+            if (count > 0xFFFF)
+                return false;
+            *effect = 1 - (int)count * (code[0] == OP_NEW_MAP ? 2 : 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool TranslateInstruction(RegisterTranslator* t, Uint8* code, int length, bool* reachable) {
+    int depth = (int)t->Stack.size();
+    int producer = t->Producer;
+    t->Producer = -1;
+
+    RegisterOperand a, b;
+    switch (code[0]) {
+        case OP_CONSTANT: {
+            Uint32 index = code[1] | code[2] << 8 | code[3] << 16 | code[4] << 24;
+            if (index >= t->Source->Constants->size())
+                return false;
+            PushOperand(t, OPERAND_CONSTANT, index);
+            return true;
+        }
+        case OP_NULL:
+            PushOperand(t, OPERAND_CONSTANT, AddRegisterConstant(t, NULL_VAL));
+            return true;
+        case OP_TRUE:
+            PushOperand(t, OPERAND_CONSTANT, AddRegisterConstant(t, INTEGER_VAL(1)));
+            return true;
+        case OP_FALSE:
+            PushOperand(t, OPERAND_CONSTANT, AddRegisterConstant(t, INTEGER_VAL(0)));
+            return true;
+
+        case OP_GET_LOCAL: {
+            int slot = code[1];
+            if (slot >= depth)
+                return false;
+            a = ResolveOperand(t, slot);
+            t->Stack.push_back(a);
+            return true;
+        }
+        case OP_SET_LOCAL: {
+            int slot = code[1];
+            if (slot >= depth - 1)
+                return false;
+
+            size_t count = t->Code.size();
+            ReleaseSlot(t, slot);
+
+            // Have whatever made the value write it to the local
+            // instead, and leave the local on the stack.
+            if (producer >= 0 && producer == (int)count - 1 && count == t->Code.size()
+                && !t->Targeted[t->Offset]) {
+                t->Code[producer].A = slot;
+                t->Stack[slot].Kind = OPERAND_REGISTER;
+                t->Stack[depth - 1].Kind = OPERAND_SLOT;
+                t->Stack[depth - 1].Index = slot;
+                t->Entries[t->Offset].Index = -1;
+                t->CleanOffset = -1;
+                return true;
+            }
+
+            a = ResolveOperand(t, depth - 1);
+            if (a.Kind == OPERAND_SLOT && a.Index == (Uint32)slot)
+                return true;
+            EmitRegister(t, REG_MOVE, slot, &a, NULL, depth);
+            t->Stack[slot].Kind = OPERAND_REGISTER;
+            return true;
+        }
+        case OP_INCREMENT_LOCAL:
+        case OP_DECREMENT_LOCAL: {
+            int slot = code[1];
+            if (slot >= depth)
+                return false;
+            ReleaseSlot(t, slot);
+            a = ResolveOperand(t, slot);
+            EmitRegister(t, code[0] == OP_INCREMENT_LOCAL ? REG_INCREMENT : REG_DECREMENT, slot, &a, NULL, depth);
+            t->Stack[slot].Kind = OPERAND_REGISTER;
+            return true;
+        }
+
+        case OP_POP:
+            if (depth < 1)
+                return false;
+            t->Stack.pop_back();
+            return true;
+        case OP_POPN:
+            if (depth < code[1])
+                return false;
+            t->Stack.resize(depth - code[1]);
+            return true;
+        case OP_COPY: {
+            int count = code[1];
+            if (depth < count)
+                return false;
+            for (int i = 0; i < count; i++)
+                t->Stack.push_back(ResolveOperand(t, depth - count + i));
+            return true;
+        }
+        case OP_SAVE_VALUE:
+            if (depth < 1)
+                return false;
+            a = ResolveOperand(t, depth - 1);
+            EmitRegister(t, REG_SAVE_VALUE, 0, &a, NULL, depth);
+            t->Stack.pop_back();
+            return true;
+        case OP_LOAD_VALUE:
+            t->Producer = EmitRegister(t, REG_LOAD_VALUE, depth, NULL, NULL, depth);
+            PushOperand(t, OPERAND_REGISTER, 0);
+            return true;
+
+        case OP_ADD:
+        case OP_SUBTRACT:
+        case OP_MULTIPLY:
+        case OP_DIVIDE:
+        case OP_MODULO:
+        case OP_BITSHIFT_LEFT:
+        case OP_BITSHIFT_RIGHT:
+        case OP_BW_AND:
+        case OP_BW_OR:
+        case OP_BW_XOR:
+        case OP_LG_AND:
+        case OP_LG_OR:
+        case OP_EQUAL:
+        case OP_EQUAL_NOT:
+        case OP_GREATER:
+        case OP_GREATER_EQUAL:
+        case OP_LESS:
+        case OP_LESS_EQUAL:
+            if (depth < 2)
+                return false;
+            a = ResolveOperand(t, depth - 2);
+            b = ResolveOperand(t, depth - 1);
+            t->Producer = EmitRegister(t, GetRegisterOp(code[0]), depth - 2, &a, &b, depth);
+            t->Stack.resize(depth - 2);
+            PushOperand(t, OPERAND_REGISTER, 0);
+            return true;
+        case OP_NEGATE:
+        case OP_BW_NOT:
+        case OP_LG_NOT:
+        case OP_INCREMENT:
+        case OP_DECREMENT:
+            if (depth < 1)
+                return false;
+            a = ResolveOperand(t, depth - 1);
+            t->Producer = EmitRegister(t, GetRegisterOp(code[0]), depth - 1, &a, NULL, depth);
+            t->Stack[depth - 1].Kind = OPERAND_REGISTER;
+            return true;
+
+        case OP_JUMP:
+        case OP_JUMP_BACK:
+        case OP_JUMP_IF_FALSE:
+        case OP_JUMP_IF_LESS_LOCAL_CONST: {
+            Sint16 jump = (Sint16)(code[length - 2] | code[length - 1] << 8);
+            int target = t->Offset + length + (code[0] == OP_JUMP_BACK ? -jump : jump);
+            if (target < 0 || target >= t->Source->Count)
+                return false;
+
+            size_t count = t->Code.size();
+            FlushOperands(t);
+
+            int index;
+            if (code[0] == OP_JUMP_IF_LESS_LOCAL_CONST) {
+                Uint32 constant = code[2] | code[3] << 8 | code[4] << 16 | code[5] << 24;
+                if (code[1] >= depth || constant >= t->Source->Constants->size())
+                    return false;
+                a = ResolveOperand(t, code[1]);
+                b.Kind = OPERAND_CONSTANT;
+                b.Index = constant;
+                index = EmitRegister(t, REG_JUMP_IF_NOT_LESS, depth, &a, &b, depth);
+                PushOperand(t, OPERAND_REGISTER, 0);
+            }
+            else if (code[0] == OP_JUMP_IF_FALSE) {
+                if (depth < 1)
+                    return false;
+
+                Uint8 op = producer >= 0 ? t->Code[producer].Op : (Uint8)REG_FALLBACK;
+                if (producer == (int)count - 1 && count == t->Code.size()
+                    && op >= REG_EQUAL && op <= REG_LESS_EQUAL
+                    && !t->Targeted[t->Offset]) {
+                    // Comparison and jump in one
+                    index = producer;
+                    t->Code[index].Op = op - REG_EQUAL + REG_JUMP_IF_NOT_EQUAL;
+                    t->Entries[t->Offset].Index = -1;
+                    t->CleanOffset = -1;
+                }
+                else {
+                    a = ResolveOperand(t, depth - 1);
+                    index = EmitRegister(t, REG_JUMP_IF_FALSE, 0, &a, NULL, depth);
+                }
+            }
+            else {
+                index = EmitRegister(t, REG_JUMP, 0, NULL, NULL, depth);
+                *reachable = false;
+            }
+            // Resolved to an instruction index once everything is translated
+            t->Code[index].Target = target;
+
+            int targetDepth = (int)t->Stack.size();
+            if (t->DepthAt[target] >= 0 && t->DepthAt[target] != targetDepth)
+                return false;
+            if (target <= t->Offset && t->IndexAt[target] < 0)
+                return false;
+            t->DepthAt[target] = targetDepth;
+            return true;
+        }
+    }
+
+    int effect;
+    if (!GetFallbackEffect(code, &effect))
+        return false;
+    if (depth + effect < 0)
+        return false;
+
+    // If nothing's been emitted since the stack interpreter's view was
+    // last complete, it can just redo the pushes on its own.
+    if (t->CleanOffset >= 0 && t->CleanCount == (int)t->Code.size()) {
+        int index = EmitRegister(t, REG_FALLBACK, 0, NULL, NULL, t->CleanDepth);
+        t->Code[index].Offset = t->CleanOffset;
+    }
+    else {
+        FlushOperands(t);
+        EmitRegister(t, REG_FALLBACK, 0, NULL, NULL, depth);
+    }
+
+    t->Stack.clear();
+    for (int i = 0; i < depth + effect; i++)
+        PushOperand(t, OPERAND_REGISTER, 0);
+
+    if (code[0] == OP_RETURN)
+        *reachable = false;
+    return true;
+}
+
+PRIVATE STATIC RegisterChunk* RegisterTier::Translate(ObjFunction* function) {
+    Chunk* chunk = &function->Chunk;
+    if (!chunk->Count)
+        return NULL;
+
+    RegisterTranslator t;
+    t.Source = chunk;
+    t.Constants = *chunk->Constants;
+    t.IndexAt.assign(chunk->Count, -1);
+    t.DepthAt.assign(chunk->Count, -1);
+    t.Targeted.assign(chunk->Count, false);
+    t.Entries.resize(chunk->Count);
+    for (int i = 0; i < chunk->Count; i++) {
+        t.Entries[i].Index = -1;
+        t.Entries[i].Depth = 0;
+    }
+    t.Producer = -1;
+    t.CleanOffset = -1;
+    t.CleanDepth = 0;
+    t.CleanCount = 0;
+
+    // Find jump targets, since values can't stay pending across them.
+    for (int offset = 0; offset < chunk->Count; ) {
+        int length = BytecodeOptimizer::GetInstructionLength(chunk->Code, offset, chunk->Count);
+        if (length < 0 || offset + length > chunk->Count)
+            return NULL;
+
+        Uint8* code = chunk->Code + offset;
+        if (code[0] == OP_JUMP || code[0] == OP_JUMP_BACK
+            || code[0] == OP_JUMP_IF_FALSE || code[0] == OP_JUMP_IF_LESS_LOCAL_CONST) {
+            Sint16 jump = (Sint16)(code[length - 2] | code[length - 1] << 8);
+            int target = offset + length + (code[0] == OP_JUMP_BACK ? -jump : jump);
+            if (target < 0 || target >= chunk->Count)
+                return NULL;
+            t.Targeted[target] = true;
+        }
+
+        offset += length;
+    }
+
+    // Slot 0 is the function or receiver, then the arguments.
+    for (int i = 0; i < function->Arity + 1; i++)
+        PushOperand(&t, OPERAND_REGISTER, 0);
+
+    bool reachable = true;
+    for (int offset = 0; offset < chunk->Count; ) {
+        int length = BytecodeOptimizer::GetInstructionLength(chunk->Code, offset, chunk->Count);
+        t.Offset = offset;
+
+        if (t.Targeted[offset]) {
+            if (reachable) {
+                FlushOperands(&t);
+                if (t.DepthAt[offset] >= 0 && t.DepthAt[offset] != (int)t.Stack.size())
+                    return NULL;
+            }
+            else if (t.DepthAt[offset] >= 0) {
+                reachable = true;
+                t.Stack.clear();
+                for (int i = 0; i < t.DepthAt[offset]; i++)
+                    PushOperand(&t, OPERAND_REGISTER, 0);
+            }
+            t.Producer = -1;
+        }
+
+        // Dead code, or only reachable by jumping backwards into it
+        if (!reachable) {
+            offset += length;
+            continue;
+        }
+
+        t.IndexAt[offset] = (int)t.Code.size();
+        t.DepthAt[offset] = (int)t.Stack.size();
+        if (!HasPendingOperands(&t)) {
+            t.CleanOffset = offset;
+            t.CleanDepth = (int)t.Stack.size();
+            t.CleanCount = (int)t.Code.size();
+            t.Entries[offset].Index = (int)t.Code.size();
+            t.Entries[offset].Depth = (Uint32)t.Stack.size();
+        }
+
+        if (!TranslateInstruction(&t, chunk->Code + offset, length, &reachable))
+            return NULL;
+
+        if ((int)t.Stack.size() >= 0xFFFF)
+            return NULL;
+
+        offset += length;
+    }
+
+    // Running off the end of the function
+    if (reachable)
+        return NULL;
+
+    for (size_t i = 0; i < t.Code.size(); i++) {
+        RegisterInstruction* instruction = &t.Code[i];
+        if (instruction->Op != REG_JUMP && instruction->Op != REG_JUMP_IF_FALSE
+            && (instruction->Op < REG_JUMP_IF_NOT_EQUAL || instruction->Op > REG_JUMP_IF_NOT_LESS_EQUAL))
+            continue;
+
+        int index = t.IndexAt[instruction->Target];
+        if (index < 0)
+            return NULL;
+        instruction->Target = index;
+    }
+
+    // Entering right before a fallback would only leave again.
+    for (int i = 0; i < chunk->Count; i++) {
+        int index = t.Entries[i].Index;
+        if (index >= 0 && (index >= (int)t.Code.size() || t.Code[index].Op == REG_FALLBACK))
+            t.Entries[i].Index = -1;
+    }
+
+    RegisterChunk* registers = (RegisterChunk*)Memory::TrackedMalloc("RegisterTier::Chunk", sizeof(RegisterChunk));
+    registers->Count = (int)t.Code.size();
+    registers->Code = (RegisterInstruction*)Memory::TrackedMalloc("RegisterTier::Code", sizeof(RegisterInstruction) * (registers->Count + 1));
+    memcpy(registers->Code, t.Code.data(), sizeof(RegisterInstruction) * registers->Count);
+    registers->Entries = (RegisterEntry*)Memory::TrackedMalloc("RegisterTier::Entries", sizeof(RegisterEntry) * chunk->Count);
+    memcpy(registers->Entries, t.Entries.data(), sizeof(RegisterEntry) * chunk->Count);
+    registers->ConstantCount = (int)t.Constants.size();
+    registers->Constants = (VMValue*)Memory::TrackedMalloc("RegisterTier::Constants", sizeof(VMValue) * (registers->ConstantCount + 1));
+    for (int i = 0; i < registers->ConstantCount; i++)
+        registers->Constants[i] = t.Constants[i];
+    return registers;
+}
+
+PUBLIC STATIC void RegisterTier::SetMode(int mode) {
+    Mode = mode;
+    switch (mode) {
+        case VM_TIER_REGISTER:
+            Threshold = 0;
+            break;
+        default:
+            Threshold = HotCallCount;
+            break;
+    }
+}
+// Called from VMThread::Call once a function has been called
+// Threshold times.
+PUBLIC STATIC bool RegisterTier::Compile(ObjFunction* function) {
+    if (Mode == VM_TIER_STACK || function->Chunk.Registers)
+        return false;
+
+    bool result = false;
+    if (ScriptManager::Lock()) {
+        // Another thread may have gotten here first.
+        if (function->Chunk.Registers) {
+            ScriptManager::Unlock();
+            return false;
+        }
+
+        RegisterChunk* registers = Translate(function);
+        if (registers) {
+            function->Chunk.Registers = registers;
+            TranslatedCount++;
+            result = true;
+        }
+        else {
+            RejectedCount++;
+        }
+        ScriptManager::Unlock();
+    }
+    return result;
+}
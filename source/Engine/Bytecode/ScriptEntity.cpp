@@ -13,14 +13,15 @@ public:
 
 #include <Engine/Bytecode/ScriptEntity.h>
 #include <Engine/Bytecode/Compiler.h>
+#include <Engine/Bytecode/GarbageCollector.h>
 #include <Engine/Bytecode/StandardLibrary.h>
 #include <Engine/Scene.h>
 
 bool ScriptEntity::DisableAutoAnimate = false;
 
-#define LINK_INT(VAR) Instance->Fields->Put(#VAR, INTEGER_LINK_VAL(&VAR))
-#define LINK_DEC(VAR) Instance->Fields->Put(#VAR, DECIMAL_LINK_VAL(&VAR))
-#define LINK_BOOL(VAR) Instance->Fields->Put(#VAR, INTEGER_LINK_VAL(&VAR))
+#define LINK_INT(VAR) PutInstanceField(Instance, #VAR, INTEGER_LINK_VAL(&VAR))
+#define LINK_DEC(VAR) PutInstanceField(Instance, #VAR, DECIMAL_LINK_VAL(&VAR))
+#define LINK_BOOL(VAR) PutInstanceField(Instance, #VAR, INTEGER_LINK_VAL(&VAR))
 
 bool   SavedHashes = false;
 Uint32 Hash_Create = 0;
@@ -355,7 +356,7 @@ PUBLIC void ScriptEntity::LinkFields() {
     * \ns Instance
     * \desc The horizontal on-screen range where the entity can update. If this is set to <code>0.0</code>, the entity will update regardless of the camera's horizontal position.
     */
-    Instance->Fields->Put("UpdateRegionW", DECIMAL_LINK_VAL(&OnScreenHitboxW));
+    PutInstanceField(Instance, "UpdateRegionW", DECIMAL_LINK_VAL(&OnScreenHitboxW));
     /***
     * \field UpdateRegionH
     * \type Decimal
@@ -363,7 +364,7 @@ PUBLIC void ScriptEntity::LinkFields() {
     * \ns Instance
     * \desc The vertical on-screen range where the entity can update. If this is set to <code>0.0</code>, the entity will update regardless of the camera's vertical position.
     */
-    Instance->Fields->Put("UpdateRegionH", DECIMAL_LINK_VAL(&OnScreenHitboxH));
+    PutInstanceField(Instance, "UpdateRegionH", DECIMAL_LINK_VAL(&OnScreenHitboxH));
     /***
     * \field UpdateRegionTop
     * \type Decimal
@@ -371,7 +372,7 @@ PUBLIC void ScriptEntity::LinkFields() {
     * \ns Instance
     * \desc The top on-screen range where the entity can update. If set to <code>0.0</code>, the entity will use its <linkto ref="instance.UpdateRegionH">UpdateRegionH</linkto> instead.
     */
-    Instance->Fields->Put("UpdateRegionTop", DECIMAL_LINK_VAL(&OnScreenRegionTop));
+    PutInstanceField(Instance, "UpdateRegionTop", DECIMAL_LINK_VAL(&OnScreenRegionTop));
     /***
     * \field UpdateRegionLeft
     * \type Decimal
@@ -379,7 +380,7 @@ PUBLIC void ScriptEntity::LinkFields() {
     * \ns Instance
     * \desc The left on-screen range where the entity can update. If set to <code>0.0</code>, the entity will use its <linkto ref="instance.UpdateRegionW">UpdateRegionW</linkto> instead.
     */
-    Instance->Fields->Put("UpdateRegionLeft", DECIMAL_LINK_VAL(&OnScreenRegionLeft));
+    PutInstanceField(Instance, "UpdateRegionLeft", DECIMAL_LINK_VAL(&OnScreenRegionLeft));
     /***
     * \field UpdateRegionRight
     * \type Decimal
@@ -387,7 +388,7 @@ PUBLIC void ScriptEntity::LinkFields() {
     * \ns Instance
     * \desc The left on-screen range where the entity can update. If set to <code>0.0</code>, the entity will use its <linkto ref="instance.UpdateRegionW">UpdateRegionW</linkto> instead.
     */
-    Instance->Fields->Put("UpdateRegionRight", DECIMAL_LINK_VAL(&OnScreenRegionRight));
+    PutInstanceField(Instance, "UpdateRegionRight", DECIMAL_LINK_VAL(&OnScreenRegionRight));
     /***
     * \field UpdateRegionBottom
     * \type Decimal
@@ -395,7 +396,7 @@ PUBLIC void ScriptEntity::LinkFields() {
     * \ns Instance
     * \desc The bottom on-screen range where the entity can update. If set to <code>0.0</code>, the entity will use its <linkto ref="instance.UpdateRegionH">UpdateRegionH</linkto> instead.
     */
-    Instance->Fields->Put("UpdateRegionBottom", DECIMAL_LINK_VAL(&OnScreenRegionBottom));
+    PutInstanceField(Instance, "UpdateRegionBottom", DECIMAL_LINK_VAL(&OnScreenRegionBottom));
     /***
     * \field RenderRegionW
     * \type Decimal
@@ -452,7 +453,7 @@ PUBLIC void ScriptEntity::LinkFields() {
     * \ns Instance
     * \desc The width of the hitbox.
     */
-    Instance->Fields->Put("HitboxW", DECIMAL_LINK_VAL(&Hitbox.Width));
+    PutInstanceField(Instance, "HitboxW", DECIMAL_LINK_VAL(&Hitbox.Width));
     /***
     * \field HitboxH
     * \type Decimal
@@ -460,7 +461,7 @@ PUBLIC void ScriptEntity::LinkFields() {
     * \ns Instance
     * \desc The height of the hitbox.
     */
-    Instance->Fields->Put("HitboxH", DECIMAL_LINK_VAL(&Hitbox.Height));
+    PutInstanceField(Instance, "HitboxH", DECIMAL_LINK_VAL(&Hitbox.Height));
     /***
     * \field HitboxOffX
     * \type Decimal
@@ -468,7 +469,7 @@ PUBLIC void ScriptEntity::LinkFields() {
     * \ns Instance
     * \desc The horizontal offset of the hitbox.
     */
-    Instance->Fields->Put("HitboxOffX", DECIMAL_LINK_VAL(&Hitbox.OffsetX));
+    PutInstanceField(Instance, "HitboxOffX", DECIMAL_LINK_VAL(&Hitbox.OffsetX));
     /***
     * \field HitboxOffY
     * \type Decimal
@@ -476,7 +477,7 @@ PUBLIC void ScriptEntity::LinkFields() {
     * \ns Instance
     * \desc The vertical offset of the hitbox.
     */
-    Instance->Fields->Put("HitboxOffY", DECIMAL_LINK_VAL(&Hitbox.OffsetY));
+    PutInstanceField(Instance, "HitboxOffY", DECIMAL_LINK_VAL(&Hitbox.OffsetY));
 
     /***
     * \field HitboxLeft
@@ -681,7 +682,7 @@ PUBLIC void ScriptEntity::LinkFields() {
     * \ns Instance
     * \desc See <linkto ref="instance.Persistence"></linkto> instead.
     */
-    Instance->Fields->Put("Persistent", INTEGER_LINK_VAL(&Persistence));
+    PutInstanceField(Instance, "Persistent", INTEGER_LINK_VAL(&Persistence));
     /***
     * \field Interactable
     * \type Boolean
@@ -707,8 +708,9 @@ PUBLIC void ScriptEntity::LinkFields() {
 PRIVATE bool ScriptEntity::GetCallableValue(Uint32 hash, VMValue& value) {
     // First look for a field which may shadow a method.
     VMValue result;
-    if (Instance->Fields->GetIfExists(hash, &result)) {
-        value = result;
+    VMValue* field = GetInstanceField(Instance, hash);
+    if (field) {
+        value = *field;
         return true;
     }
 
@@ -733,6 +735,9 @@ PRIVATE ObjFunction* ScriptEntity::GetCallableFunction(Uint32 hash) {
     return NULL;
 }
 PUBLIC bool ScriptEntity::RunFunction(Uint32 hash) {
+    return RunFunction(hash, ScriptManager::Threads + 0);
+}
+PUBLIC bool ScriptEntity::RunFunction(Uint32 hash, VMThread* thread) {
     if (!Instance)
         return false;
 
@@ -743,8 +748,6 @@ PUBLIC bool ScriptEntity::RunFunction(Uint32 hash) {
     if (!ScriptEntity::GetCallableValue(hash, value))
         return true;
 
-    VMThread* thread = ScriptManager::Threads + 0;
-
     VMValue* stackTop = thread->StackTop;
 
     thread->Push(OBJECT_VAL(Instance));
@@ -820,7 +823,7 @@ PUBLIC bool ScriptEntity::ChangeClass(const char* className) {
     List->Add(this);
 
     // Change the script-side class proper
-    Instance->Object.Class = newClass;
+    SetInstanceClass(Instance, newClass);
 
     return true;
 }
@@ -849,19 +852,21 @@ PUBLIC void ScriptEntity::CopyFields(ScriptEntity* other) {
 }
 
 PUBLIC void ScriptEntity::CopyVMFields(ScriptEntity* other) {
-    Table* srcFields = Instance->Fields;
-    Table* destFields = other->Instance->Fields;
+    ObjInstance* destInstance = other->Instance;
 
-    destFields->Clear();
+    ClearInstanceFields(destInstance);
 
-    srcFields->WithAll([destFields](Uint32 key, VMValue value) -> void {
+    // Link the built-in fields again, since they have been removed.
+    // Doing this first puts them in the same slots as in the source.
+    other->LinkFields();
+
+    ForAllInstanceFields(Instance, [destInstance](Uint32 key, VMValue value) -> void {
         // Don't copy linked fields, because they point to this entity's built-in fields
-        if (value.Type != VAL_LINKED_INTEGER && value.Type != VAL_LINKED_DECIMAL)
-            destFields->Put(key, value);
+        if (VALUE_TYPE(value) != VAL_LINKED_INTEGER && VALUE_TYPE(value) != VAL_LINKED_DECIMAL) {
+            GarbageCollector::WriteBarrier(value);
+            PutInstanceField(destInstance, key, value);
+        }
     });
-
-    // Link the built-in fields again, since they have been removed
-    other->LinkFields();
 }
 
 // Events called from C++
@@ -963,6 +968,12 @@ PUBLIC void ScriptEntity::Update() {
 
     RunFunction(Hash_Update);
 }
+PUBLIC void ScriptEntity::UpdateOnThread(Uint32 threadID) {
+    // Only active entities get queued, and one that's deactivated by
+    // another while the update runs is removed after it, so this
+    // doesn't check Active; that would depend on which ran first.
+    RunFunction(Hash_Update, ScriptManager::Threads + threadID);
+}
 PUBLIC void ScriptEntity::UpdateLate() {
     if (!Active) return;
 
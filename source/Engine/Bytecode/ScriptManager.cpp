@@ -1,5 +1,6 @@
 #if INTERFACE
 need_t ScriptEntity;
+need_t EntityStorage;
 
 #include <Engine/Includes/Standard.h>
 #include <Engine/Bytecode/VMThread.h>
@@ -31,6 +32,8 @@ public:
     static vector<ObjNamespace*>       AllNamespaces;
     static vector<ObjClass*>           ClassImplList;
 
+    static Uint32                      InlineCacheEpoch;
+
     static SDL_mutex*                  GlobalLock;
 };
 #endif
@@ -52,6 +55,7 @@ public:
 #include <Engine/Hashing/FNV1A.h>
 #include <Engine/ResourceTypes/ResourceManager.h>
 #include <Engine/TextFormats/XML/XMLParser.h>
+#include <Engine/Types/EntityStorage.h>
 
 #include <Engine/Bytecode/Compiler.h>
 
@@ -73,11 +77,19 @@ HashMap<char*>*             ScriptManager::Tokens = NULL;
 vector<ObjNamespace*>       ScriptManager::AllNamespaces;
 vector<ObjClass*>           ScriptManager::ClassImplList;
 
+Uint32                      ScriptManager::InlineCacheEpoch = 1;
+
 SDL_mutex*                  ScriptManager::GlobalLock = NULL;
 
 // #define DEBUG_STRESS_GC
 
 PUBLIC STATIC void    ScriptManager::RequestGarbageCollection() {
+    if (GarbageCollector::Incremental) {
+        if (GarbageCollector::State != GC_STATE_IDLE || GarbageCollector::GarbageSize > GarbageCollector::NextGC)
+            StepGarbageCollection();
+        return;
+    }
+
 #ifndef DEBUG_STRESS_GC
     if (GarbageCollector::GarbageSize > GarbageCollector::NextGC)
 #endif
@@ -103,6 +115,21 @@ PUBLIC STATIC void    ScriptManager::ForceGarbageCollection() {
     }
 }
 
+PUBLIC STATIC void    ScriptManager::StepGarbageCollection() {
+    if (ScriptManager::Lock()) {
+        if (ScriptManager::ThreadCount > 1) {
+            ScriptManager::Unlock();
+            return;
+        }
+
+        if (GarbageCollector::Step()) {
+            Log::Print(Log::LOG_INFO, "%04X: Freed garbage from %u to %u (%d) in %u steps, next GC at %d", Scene::Frame, (Uint32)GarbageCollector::CycleStartSize, (Uint32)GarbageCollector::GarbageSize, GarbageCollector::GarbageSize - GarbageCollector::CycleStartSize, GarbageCollector::StepCount, GarbageCollector::NextGC);
+        }
+
+        ScriptManager::Unlock();
+    }
+}
+
 PUBLIC STATIC void    ScriptManager::ResetStack() {
     Threads[0].ResetStack();
 }
@@ -127,6 +154,8 @@ PUBLIC STATIC void    ScriptManager::Init() {
 
     memset(VMThread::InstructionIgnoreMap, 0, sizeof(VMThread::InstructionIgnoreMap));
 
+    InvalidateInlineCaches();
+
     GlobalLock = SDL_CreateMutex();
 
     for (Uint32 i = 0; i < sizeof(Threads) / sizeof(VMThread); i++) {
@@ -278,6 +307,11 @@ PRIVATE STATIC void    ScriptManager::FreeClass(ObjClass* klass) {
     // to free them.
     delete klass->Fields;
 
+    FreeClassShapes(klass);
+
+    // Another class may end up at this address.
+    InvalidateInlineCaches();
+
     if (klass->Name)
         FreeValue(OBJECT_VAL(klass->Name));
 
@@ -382,7 +416,7 @@ PUBLIC STATIC VMValue ScriptManager::CastValueAsString(VMValue v) {
 }
 PUBLIC STATIC VMValue ScriptManager::CastValueAsInteger(VMValue v) {
     float a;
-    switch (v.Type) {
+    switch (VALUE_TYPE(v)) {
         case VAL_DECIMAL:
         case VAL_LINKED_DECIMAL:
             a = AS_DECIMAL(v);
@@ -399,7 +433,7 @@ PUBLIC STATIC VMValue ScriptManager::CastValueAsInteger(VMValue v) {
 }
 PUBLIC STATIC VMValue ScriptManager::CastValueAsDecimal(VMValue v) {
     int a;
-    switch (v.Type) {
+    switch (VALUE_TYPE(v)) {
         case VAL_DECIMAL:
             return v;
         case VAL_LINKED_DECIMAL:
@@ -428,8 +462,8 @@ PUBLIC STATIC VMValue ScriptManager::Concatenate(VMValue va, VMValue vb) {
 }
 
 PUBLIC STATIC bool    ScriptManager::ValuesSortaEqual(VMValue a, VMValue b) {
-    if ((a.Type == VAL_DECIMAL && b.Type == VAL_INTEGER) ||
-        (a.Type == VAL_INTEGER && b.Type == VAL_DECIMAL)) {
+    if ((VALUE_TYPE(a) == VAL_DECIMAL && VALUE_TYPE(b) == VAL_INTEGER) ||
+        (VALUE_TYPE(a) == VAL_INTEGER && VALUE_TYPE(b) == VAL_DECIMAL)) {
         float a_d = AS_DECIMAL(CastValueAsDecimal(a));
         float b_d = AS_DECIMAL(CastValueAsDecimal(b));
         return (a_d == b_d);
@@ -450,16 +484,16 @@ PUBLIC STATIC bool    ScriptManager::ValuesSortaEqual(VMValue a, VMValue b) {
     return ScriptManager::ValuesEqual(a, b);
 }
 PUBLIC STATIC bool    ScriptManager::ValuesEqual(VMValue a, VMValue b) {
-    if (a.Type == VAL_LINKED_INTEGER) goto SKIP_CHECK;
-    if (a.Type == VAL_LINKED_DECIMAL) goto SKIP_CHECK;
-    if (b.Type == VAL_LINKED_INTEGER) goto SKIP_CHECK;
-    if (b.Type == VAL_LINKED_DECIMAL) goto SKIP_CHECK;
+    if (VALUE_TYPE(a) == VAL_LINKED_INTEGER) goto SKIP_CHECK;
+    if (VALUE_TYPE(a) == VAL_LINKED_DECIMAL) goto SKIP_CHECK;
+    if (VALUE_TYPE(b) == VAL_LINKED_INTEGER) goto SKIP_CHECK;
+    if (VALUE_TYPE(b) == VAL_LINKED_DECIMAL) goto SKIP_CHECK;
 
-    if (a.Type != b.Type) return false;
+    if (VALUE_TYPE(a) != VALUE_TYPE(b)) return false;
 
     SKIP_CHECK:
 
-    switch (a.Type) {
+    switch (VALUE_TYPE(a)) {
         case VAL_LINKED_INTEGER:
         case VAL_INTEGER: return AS_INTEGER(a) == AS_INTEGER(b);
 
@@ -473,9 +507,9 @@ PUBLIC STATIC bool    ScriptManager::ValuesEqual(VMValue a, VMValue b) {
     return false;
 }
 PUBLIC STATIC bool    ScriptManager::ValueFalsey(VMValue a) {
-    if (a.Type == VAL_NULL) return true;
+    if (VALUE_TYPE(a) == VAL_NULL) return true;
 
-    switch (a.Type) {
+    switch (VALUE_TYPE(a)) {
         case VAL_LINKED_INTEGER:
         case VAL_INTEGER: return AS_INTEGER(a) == 0;
         case VAL_LINKED_DECIMAL:
@@ -525,10 +559,7 @@ PUBLIC STATIC void    ScriptManager::FreeValue(VMValue value) {
             }
             case OBJ_INSTANCE: {
                 ObjInstance* instance = AS_INSTANCE(value);
-
-                // An instance does not own its values, so it's not allowed
-                // to free them.
-                delete instance->Fields;
+                FreeInstanceFields(instance);
 
                 FREE_OBJ(instance, ObjInstance);
                 break;
@@ -594,7 +625,9 @@ PUBLIC STATIC void    ScriptManager::DefineMethod(VMThread* thread, ObjFunction*
     VMValue methodValue = OBJECT_VAL(function);
 
     ObjClass* klass = AS_CLASS(thread->Peek(0));
+    GarbageCollector::WriteBarrier(methodValue);
     klass->Methods->Put(hash, methodValue);
+    InvalidateInlineCaches();
 
     if (hash == klass->Hash)
         klass->Initializer = methodValue;
@@ -608,8 +641,13 @@ PUBLIC STATIC void    ScriptManager::DefineNative(ObjClass* klass, const char* n
     if (klass == NULL) return;
     if (name == NULL) return;
 
-    if (!klass->Methods->Exists(name))
-        klass->Methods->Put(name, OBJECT_VAL(NewNative(function)));
+    if (!klass->Methods->Exists(name)) {
+        ObjNative* native = NewNative(function);
+        native->ClassName = klass->Name;
+        native->Name = name;
+        klass->Methods->Put(name, OBJECT_VAL(native));
+        InvalidateInlineCaches();
+    }
 }
 PUBLIC STATIC void    ScriptManager::GlobalLinkInteger(ObjClass* klass, const char* name, int* value) {
     if (name == NULL) return;
@@ -645,6 +683,13 @@ PUBLIC STATIC void    ScriptManager::GlobalConstDecimal(ObjClass* klass, const c
     else
         klass->Methods->Put(name, DECIMAL_VAL(value));
 }
+PUBLIC STATIC void    ScriptManager::InvalidateInlineCaches() {
+    // Method entries in every inline cache are tagged with the epoch
+    // they were filled in, so moving it drops all of them at once.
+    InlineCacheEpoch++;
+    if (InlineCacheEpoch == 0)
+        InlineCacheEpoch = 1;
+}
 PUBLIC STATIC ObjClass* ScriptManager::GetClassParent(ObjClass* klass) {
     if (!klass->Parent && klass->ParentHash) {
         VMValue parent;
@@ -731,13 +776,23 @@ PUBLIC STATIC bool    ScriptManager::CallFunction(char* functionName) {
     return true;
 }
 PUBLIC STATIC Entity* ScriptManager::SpawnObject(const char* objectName) {
+    return SpawnObject(objectName, NULL);
+}
+PUBLIC STATIC Entity* ScriptManager::SpawnObject(const char* objectName, EntityStorage* storage) {
     ObjClass* klass = GetObjectClass(objectName);
     if (!klass) {
         Log::Print(Log::LOG_ERROR, "Could not find class of %s!", objectName);
         return nullptr;
     }
 
-    ScriptEntity* object = new ScriptEntity;
+    ScriptEntity* object;
+    void* slot = storage ? storage->Allocate() : NULL;
+    if (slot) {
+        object = new (slot) ScriptEntity;
+        object->Storage = storage;
+    }
+    else
+        object = new ScriptEntity;
 
     ObjInstance* instance = NewInstance(klass);
     object->Link(instance);
@@ -892,7 +947,11 @@ PUBLIC STATIC ObjClass* ScriptManager::GetObjectClass(const char* className) {
     return nullptr;
 }
 PUBLIC STATIC Entity* ScriptManager::ObjectSpawnFunction(ObjectList* list) {
-    return ScriptManager::SpawnObject(list->ObjectName);
+    // Entities of the same class are kept together in memory, so
+    // walking the scene's lists doesn't jump all over the heap.
+    if (!list->Storage)
+        list->Storage = new EntityStorage(sizeof(ScriptEntity));
+    return ScriptManager::SpawnObject(list->ObjectName, list->Storage);
 }
 PUBLIC STATIC void    ScriptManager::LoadClasses() {
     SourceFileMap::ClassMap->ForAll([](Uint32, vector<Uint32>* filenameHashList) -> void {
@@ -97,6 +97,7 @@ PUBLIC STATIC void SourceFileMap::CheckInit() {
 
     Application::Settings->GetBool("compiler", "writeDebugInfo", &Compiler::WriteDebugInfo);
     Application::Settings->GetBool("compiler", "writeSourceFilename", &Compiler::WriteSourceFilename);
+    Application::Settings->GetBool("compiler", "optimize", &Compiler::OptimizeBytecode);
 
     SourceFileMap::Initialized = true;
 }
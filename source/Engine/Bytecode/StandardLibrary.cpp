@@ -18,8 +18,11 @@ public:
 #include <Engine/Bytecode/ScriptEntity.h>
 #include <Engine/Bytecode/ScriptManager.h>
 #include <Engine/Bytecode/Compiler.h>
+#include <Engine/Bytecode/GarbageCollector.h>
 #include <Engine/Bytecode/Values.h>
+#include <Engine/Bytecode/VMProfiler.h>
 #include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/Memory.h>
 #include <Engine/Filesystem/File.h>
 #include <Engine/Filesystem/Directory.h>
 #include <Engine/Hashing/CombinedHash.h>
@@ -42,10 +45,13 @@ public:
 #include <Engine/ResourceTypes/ImageFormats/PNG.h>
 #include <Engine/ResourceTypes/ImageFormats/GIF.h>
 #include <Engine/ResourceTypes/SceneFormats/RSDKSceneReader.h>
+#include <Engine/ResourceTypes/ResourceLoader.h>
 #include <Engine/ResourceTypes/ResourceManager.h>
 #include <Engine/ResourceTypes/ResourceType.h>
+#include <Engine/Scene/ParallelUpdate.h>
 #include <Engine/Scene/SceneEnums.h>
 #include <Engine/Scene/SceneInfo.h>
+#include <Engine/Scene/SpatialGrid.h>
 #include <Engine/TextFormats/JSON/jsmn.h>
 #include <Engine/Utilities/ColorUtils.h>
 #include <Engine/Utilities/StringUtils.h>
@@ -79,7 +85,7 @@ public:
 namespace LOCAL {
     inline int             GetInteger(VMValue* args, int index, Uint32 threadID) {
         int value = 0;
-        switch (args[index].Type) {
+        switch (VALUE_TYPE(args[index])) {
             case VAL_INTEGER:
             case VAL_LINKED_INTEGER:
                 value = AS_INTEGER(args[index]);
@@ -93,7 +99,7 @@ namespace LOCAL {
     }
     inline float           GetDecimal(VMValue* args, int index, Uint32 threadID) {
         float value = 0.0f;
-        switch (args[index].Type) {
+        switch (VALUE_TYPE(args[index])) {
             case VAL_DECIMAL:
             case VAL_LINKED_DECIMAL:
                 value = AS_DECIMAL(args[index]);
@@ -1051,6 +1057,90 @@ VMValue Application_SetGameDescription(int argCount, VMValue* args, Uint32 threa
     StringUtils::Copy(Application::GameDescription, string, sizeof(Application::GameDescription));
     return NULL_VAL;
 }
+/***
+ * Application.StartProfiler
+ * \desc Starts the script profiler. While it runs, every instruction, script function and native function call is measured.
+ * \ns Application
+ */
+VMValue Application_StartProfiler(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(0);
+    VMProfiler::Start();
+    return NULL_VAL;
+}
+/***
+ * Application.StopProfiler
+ * \desc Stops the script profiler, prints a summary to the log, and writes the measured call stacks to a file in the collapsed stack format used by flame graph tools.
+ * \paramOpt filename (String): The file to write to. Defaults to the <code>profilerOutput</code> setting.
+ * \return Returns whether the file was written.
+ * \ns Application
+ */
+VMValue Application_StopProfiler(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_AT_LEAST_ARGCOUNT(0);
+    char* filename = GET_ARG_OPT(0, GetString, VMProfiler::OutputFilename);
+    if (!VMProfiler::Enabled)
+        return INTEGER_VAL(false);
+    VMProfiler::Stop();
+    VMProfiler::PrintSummary();
+    return INTEGER_VAL(VMProfiler::Write(filename));
+}
+/***
+ * Application.IsProfilerRunning
+ * \desc Gets whether the script profiler is running.
+ * \return Returns a Boolean value.
+ * \ns Application
+ */
+VMValue Application_IsProfilerRunning(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(0);
+    return INTEGER_VAL(VMProfiler::Enabled);
+}
+/***
+ * Application.GetMemoryUsage
+ * \desc Gets how much memory the engine knows to be in use, in bytes. Nothing is counted unless the <code>countMemory</code> or <code>trackMemory</code> setting is on. With only <code>countMemory</code>, just allocations made with a tag are counted.
+ * \return Returns an Integer value.
+ * \ns Application
+ */
+VMValue Application_GetMemoryUsage(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(0);
+    return INTEGER_VAL((int)Memory::MemoryUsage);
+}
+static void PutMemoryStat(ObjMap* map, const char* key, VMValue value) {
+    map->Values->Put(key, value);
+    map->Keys->Put(key, StringUtils::Duplicate(key));
+}
+/***
+ * Application.GetMemoryStats
+ * \desc Gets memory statistics for each tag the engine allocates memory with, biggest first. Empty unless the <code>countMemory</code> or <code>trackMemory</code> setting is on. Rates are measured over the time since the last call, once at least a second has gone by.
+ * \return Returns an Array of Maps, each with a <code>Name</code> (String, or <code>null</code> for untagged allocations), <code>LiveBytes</code>, <code>PeakBytes</code> and <code>LiveCount</code> (Integer), <code>TotalAllocations</code> and <code>TotalBytes</code> (Decimal), and <code>AllocationRate</code> and <code>ByteRate</code> (Decimal) per second.
+ * \ns Application
+ */
+VMValue Application_GetMemoryStats(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(0);
+
+    vector<MemoryTagStats> tagStats;
+    Memory::GetTagStats(&tagStats);
+
+    ObjArray* array = NULL;
+    if (ScriptManager::Lock()) {
+        array = NewArray();
+        for (size_t i = 0; i < tagStats.size(); i++) {
+            MemoryTagStats& stats = tagStats[i];
+            ObjMap* map = NewMap();
+            array->Values->push_back(OBJECT_VAL(map));
+
+            PutMemoryStat(map, "Name", stats.Name ? OBJECT_VAL(CopyString(stats.Name)) : NULL_VAL);
+            PutMemoryStat(map, "LiveBytes", INTEGER_VAL((int)stats.LiveBytes));
+            PutMemoryStat(map, "PeakBytes", INTEGER_VAL((int)stats.PeakBytes));
+            PutMemoryStat(map, "LiveCount", INTEGER_VAL((int)stats.LiveCount));
+            PutMemoryStat(map, "TotalAllocations", DECIMAL_VAL((float)stats.TotalAllocations));
+            PutMemoryStat(map, "TotalBytes", DECIMAL_VAL((float)stats.TotalBytes));
+            PutMemoryStat(map, "AllocationRate", DECIMAL_VAL(stats.AllocationRate));
+            PutMemoryStat(map, "ByteRate", DECIMAL_VAL(stats.ByteRate));
+        }
+        ScriptManager::Unlock();
+    }
+
+    return OBJECT_VAL(array);
+}
 /***
  * Application.SetCursorVisible
  * \desc Sets the visibility of the cursor.
@@ -1223,6 +1313,7 @@ VMValue Array_Push(int argCount, VMValue* args, Uint32 threadID) {
 
     if (ScriptManager::Lock()) {
         ObjArray* array = GET_ARG(0, GetArray);
+        GarbageCollector::WriteBarrier(args[1]);
         array->Values->push_back(args[1]);
         ScriptManager::Unlock();
     }
@@ -1261,6 +1352,7 @@ VMValue Array_Insert(int argCount, VMValue* args, Uint32 threadID) {
     if (ScriptManager::Lock()) {
         ObjArray* array = GET_ARG(0, GetArray);
         int       index = GET_ARG(1, GetInteger);
+        GarbageCollector::WriteBarrier(args[2]);
         array->Values->insert(array->Values->begin() + index, args[2]);
         ScriptManager::Unlock();
     }
@@ -1360,6 +1452,7 @@ VMValue Array_SetAll(int argCount, VMValue* args, Uint32 threadID) {
             else if (endIndex >= arraySize)
                 endIndex = arraySize - 1;
 
+            GarbageCollector::WriteBarrier(value);
             for (size_t i = startIndex; i <= endIndex; i++) {
                 (*array->Values)[i] = value;
             }
@@ -5750,7 +5843,7 @@ VMValue Input_ParseAxisName(int argCount, VMValue* args, Uint32 threadID) {
  * \param x (Number): X position of where to place the new instance.
  * \param y (Number): Y position of where to place the new instance.
  * \paramOpt flag (any type): Value to pass to the <code>Create</code> event. (Default: <code>0</code>)
- * \return Returns the new instance.
+ * \return Returns the new instance. If this is called from a parallel-safe object's <code>Update</code>, the instance is only added to the scene, and its <code>Create</code> event only called, after every parallel update has finished.
  * \ns Instance
  */
 VMValue Instance_Create(int argCount, VMValue* args, Uint32 threadID) {
@@ -5767,8 +5860,16 @@ VMValue Instance_Create(int argCount, VMValue* args, Uint32 threadID) {
         return NULL_VAL;
     }
 
+    // Object storage and the initializer's thread are shared, so
+    // parallel updates take turns spawning.
+    bool parallel = ParallelUpdate::IsRunning();
+    if (parallel && !ScriptManager::Lock())
+        return NULL_VAL;
+
     ScriptEntity* obj = (ScriptEntity*)objectList->Spawn();
     if (!obj) {
+        if (parallel)
+            ScriptManager::Unlock();
         THROW_ERROR("Could not spawn object of class \"%s\"!", objectName);
         return NULL_VAL;
     }
@@ -5778,7 +5879,6 @@ VMValue Instance_Create(int argCount, VMValue* args, Uint32 threadID) {
     obj->InitialX = x;
     obj->InitialY = y;
     obj->List = objectList;
-    Scene::AddDynamic(objectList, obj);
 
     ObjInstance* instance = obj->Instance;
 
@@ -5786,9 +5886,22 @@ VMValue Instance_Create(int argCount, VMValue* args, Uint32 threadID) {
     if (HasInitializer(instance->Object.Class))
         obj->Initialize();
 
+    if (parallel)
+        ScriptManager::Unlock();
+
+    // During a parallel update, the instance is added to the scene and
+    // gets its Create event once every worker is done.
+    if (ParallelUpdate::DeferSpawn(obj, flag, threadID))
+        return OBJECT_VAL(instance);
+
+    Scene::AddDynamic(objectList, obj);
+
     obj->Create(flag);
     obj->PostCreate();
 
+    // The hitbox is usually only set by now.
+    SpatialGrid::Refresh(obj);
+
     return OBJECT_VAL(instance);
 }
 /***
@@ -6108,6 +6221,7 @@ static int JSON_FillMap(ObjMap* map, const char* text, jsmntok_t* t, size_t coun
                 default:
                     break;
             }
+            GarbageCollector::WriteBarrier(val);
             map->Values->Put(keyHash, val);
         }
     }
@@ -6206,6 +6320,7 @@ static int JSON_FillArray(ObjArray* arr, const char* text, jsmntok_t* t, size_t
             default:
                 break;
         }
+        GarbageCollector::WriteBarrier(val);
         arr->Values->push_back(val);
     }
     return tokcount + 1;
@@ -6878,6 +6993,7 @@ VMValue Matrix_Copy(int argCount, VMValue* args, Uint32 threadID) {
     ObjArray* matrixDestination = GET_ARG(0, GetArray);
     ObjArray* matrixSource = GET_ARG(1, GetArray);
     for (int i = 0; i < 16; i++) {
+        GarbageCollector::WriteBarrier((*matrixSource->Values)[i]);
         (*matrixDestination->Values)[i] = (*matrixSource->Values)[i];
     }
     return NULL_VAL;
@@ -7655,10 +7771,7 @@ VMValue Music_StopWithFadeOut(int argCount, VMValue* args, Uint32 threadID) {
  */
 VMValue Music_Pause(int argCount, VMValue* args, Uint32 threadID) {
     CHECK_ARGCOUNT(0);
-    AudioManager::Lock();
-    if (AudioManager::MusicStack.size() > 0)
-        AudioManager::MusicStack[0]->Paused = true;
-    AudioManager::Unlock();
+    AudioManager::PauseMusic();
     return NULL_VAL;
 }
 /***
@@ -7669,10 +7782,7 @@ VMValue Music_Pause(int argCount, VMValue* args, Uint32 threadID) {
  */
 VMValue Music_Resume(int argCount, VMValue* args, Uint32 threadID) {
     CHECK_ARGCOUNT(0);
-    AudioManager::Lock();
-    if (AudioManager::MusicStack.size() > 0)
-        AudioManager::MusicStack[0]->Paused = false;
-    AudioManager::Unlock();
+    AudioManager::ResumeMusic();
     return NULL_VAL;
 }
 /***
@@ -7805,7 +7915,7 @@ VMValue Number_ToString(int argCount, VMValue* args, Uint32 threadID) {
         base = GET_ARG(1, GetInteger);
     }
 
-    switch (args[0].Type) {
+    switch (VALUE_TYPE(args[0])) {
         case VAL_DECIMAL:
         case VAL_LINKED_DECIMAL: {
             float n = GET_ARG(0, GetDecimal);
@@ -7916,6 +8026,40 @@ VMValue Object_GetActivity(int argCount, VMValue* args, Uint32 threadID) {
 
     return INTEGER_VAL(-1);
 }
+/***
+ * Object.SetParallelSafe
+ * \desc Marks an object class as safe to update in parallel. Its Update events then run across worker threads after the other objects have updated, in no particular order, so they should only change the entity's own fields.
+ * \param className (String): Name of the object class.
+ * \param parallelSafe (Boolean): Whether the class is parallel-safe.
+ * \ns Object
+ */
+VMValue Object_SetParallelSafe(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(2);
+
+    char* objectName = GET_ARG(0, GetString);
+
+    if (Scene::ObjectLists->Exists(Scene::ObjectLists->HashFunction(objectName, strlen(objectName))))
+        Scene::GetObjectList(objectName)->ParallelSafe = !!GET_ARG(1, GetInteger);
+
+    return NULL_VAL;
+}
+/***
+ * Object.GetParallelSafe
+ * \desc Gets whether an object class is marked as safe to update in parallel.
+ * \param className (String): Name of the object class.
+ * \return Returns whether the object class is parallel-safe.
+ * \ns Object
+ */
+VMValue Object_GetParallelSafe(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(1);
+
+    char* objectName = GET_ARG(0, GetString);
+
+    if (Scene::ObjectLists->Exists(Scene::ObjectLists->HashFunction(objectName, strlen(objectName))))
+        return INTEGER_VAL(Scene::GetObjectList(objectName)->ParallelSafe);
+
+    return INTEGER_VAL(false);
+}
 // #endregion
 
 // #region Palette
@@ -7951,6 +8095,7 @@ if (index < 0 || index >= 0x100) { \
  */
 VMValue Palette_LoadFromResource(int argCount, VMValue* args, Uint32 threadID) {
     CHECK_AT_LEAST_ARGCOUNT(2);
+    SoftwareRenderer::FlushCommands();
     int palIndex        = GET_ARG(0, GetInteger);
     char* filename      = GET_ARG(1, GetString);
     int disabledRows    = GET_ARG_OPT(2, GetInteger, 0);
@@ -8105,6 +8250,7 @@ VMValue Palette_LoadFromResource(int argCount, VMValue* args, Uint32 threadID) {
  */
 VMValue Palette_LoadFromImage(int argCount, VMValue* args, Uint32 threadID) {
     CHECK_ARGCOUNT(2);
+    SoftwareRenderer::FlushCommands();
     int palIndex = GET_ARG(0, GetInteger);
     Image* image = GET_ARG(1, GetImage);
 
@@ -8160,6 +8306,7 @@ VMValue Palette_GetColor(int argCount, VMValue* args, Uint32 threadID) {
  */
 VMValue Palette_SetColor(int argCount, VMValue* args, Uint32 threadID) {
     CHECK_ARGCOUNT(3);
+    SoftwareRenderer::FlushCommands();
     int palIndex = GET_ARG(0, GetInteger);
     int colorIndex = GET_ARG(1, GetInteger);
     Uint32 hex = (Uint32)GET_ARG(2, GetInteger);
@@ -8199,6 +8346,7 @@ VMValue Palette_GetColorTransparent(int argCount, VMValue* args, Uint32 threadID
  */
 VMValue Palette_SetColorTransparent(int argCount, VMValue* args, Uint32 threadID) {
     CHECK_ARGCOUNT(3);
+    SoftwareRenderer::FlushCommands();
     int palIndex = GET_ARG(0, GetInteger);
     int colorIndex = GET_ARG(1, GetInteger);
     bool isTransparent = !!GET_ARG(2, GetInteger);
@@ -8232,6 +8380,7 @@ inline Uint32 PMP_ColorBlend(Uint32 color1, Uint32 color2, int percent) {
 }
 VMValue Palette_MixPalettes(int argCount, VMValue* args, Uint32 threadID) {
     CHECK_ARGCOUNT(6);
+    SoftwareRenderer::FlushCommands();
     int palIndexDest = GET_ARG(0, GetInteger);
     int palIndex1 = GET_ARG(1, GetInteger);
     int palIndex2 = GET_ARG(2, GetInteger);
@@ -8265,6 +8414,7 @@ VMValue Palette_MixPalettes(int argCount, VMValue* args, Uint32 threadID) {
  */
 VMValue Palette_RotateColorsLeft(int argCount, VMValue* args, Uint32 threadID) {
     CHECK_ARGCOUNT(3);
+    SoftwareRenderer::FlushCommands();
     int palIndex = GET_ARG(0, GetInteger);
     int colorIndexStart = GET_ARG(1, GetInteger);
     int count = GET_ARG(2, GetInteger);
@@ -8292,6 +8442,7 @@ VMValue Palette_RotateColorsLeft(int argCount, VMValue* args, Uint32 threadID) {
  */
 VMValue Palette_RotateColorsRight(int argCount, VMValue* args, Uint32 threadID) {
     CHECK_ARGCOUNT(3);
+    SoftwareRenderer::FlushCommands();
     int palIndex = GET_ARG(0, GetInteger);
     int colorIndexStart = GET_ARG(1, GetInteger);
     int count = GET_ARG(2, GetInteger);
@@ -8321,6 +8472,7 @@ VMValue Palette_RotateColorsRight(int argCount, VMValue* args, Uint32 threadID)
  */
 VMValue Palette_CopyColors(int argCount, VMValue* args, Uint32 threadID) {
     CHECK_ARGCOUNT(5);
+    SoftwareRenderer::FlushCommands();
     int palIndexFrom = GET_ARG(0, GetInteger);
     int colorIndexStartFrom = GET_ARG(1, GetInteger);
     int palIndexTo = GET_ARG(2, GetInteger);
@@ -8364,6 +8516,7 @@ VMValue Palette_UsePaletteIndexLines(int argCount, VMValue* args, Uint32 threadI
  */
 VMValue Palette_SetPaletteIndexLines(int argCount, VMValue* args, Uint32 threadID) {
     CHECK_ARGCOUNT(3);
+    SoftwareRenderer::FlushCommands();
     int palIndex        = GET_ARG(0, GetInteger);
     Sint32 lineStart    = (int)GET_ARG(1, GetDecimal);
     Sint32 lineEnd      = (int)GET_ARG(2, GetDecimal);
@@ -8542,7 +8695,9 @@ VMValue Resources_LoadMusic(int argCount, VMValue* args, Uint32 threadID) {
     if (Scene::GetResource(list, resource, index))
         return INTEGER_VAL((int)index);
 
-    resource->AsMusic = new (std::nothrow) ISound(filename);
+    resource->AsMusic = ResourceLoader::TakeSound(filename);
+    if (!resource->AsMusic)
+        resource->AsMusic = new (std::nothrow) ISound(filename);
     if (resource->AsMusic->LoadFailed) {
         delete resource->AsMusic;
         delete resource;
@@ -8572,7 +8727,9 @@ VMValue Resources_LoadSound(int argCount, VMValue* args, Uint32 threadID) {
     if (Scene::GetResource(list, resource, index))
         return INTEGER_VAL((int)index);
 
-    resource->AsSound = new (std::nothrow) ISound(filename);
+    resource->AsSound = ResourceLoader::TakeSound(filename);
+    if (!resource->AsSound)
+        resource->AsSound = new (std::nothrow) ISound(filename);
     if (resource->AsSound->LoadFailed) {
         delete resource->AsSound;
         delete resource;
@@ -8672,6 +8829,81 @@ VMValue Resources_LoadVideo(int argCount, VMValue* args, Uint32 threadID) {
     return INTEGER_VAL(-1);
 #endif
 }
+/***
+ * Resources.Preload
+ * \desc Starts loading resources in the background, so that loading them later (for example, in the next Scene) doesn't have to wait for them. Images, sounds and music are decoded ahead of time; anything else is read into memory.
+ * \param filenames (Array): Filenames of the resources.
+ * \return Returns an ID to check on the resources with.
+ * \ns Resources
+ */
+VMValue Resources_Preload(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(1);
+    vector<char*> filenames;
+    if (ScriptManager::Lock()) {
+        ObjArray* array = GET_ARG(0, GetArray);
+        for (size_t i = 0; i < array->Values->size(); i++) {
+            VMValue value = (*array->Values)[i];
+            if (IS_STRING(value))
+                filenames.push_back(StringUtils::Duplicate(AS_CSTRING(value)));
+        }
+        ScriptManager::Unlock();
+    }
+
+    int group = ResourceLoader::Preload(filenames);
+    for (size_t i = 0; i < filenames.size(); i++)
+        Memory::Free(filenames[i]);
+
+    return INTEGER_VAL(group);
+}
+/***
+ * Resources.GetPreloadProgress
+ * \desc Gets how much of a preload has finished.
+ * \param preloadID (Integer): The ID returned by <linkto ref="Resources.Preload"></linkto>.
+ * \return Returns a Decimal value between 0.0 and 1.0.
+ * \ns Resources
+ */
+VMValue Resources_GetPreloadProgress(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(1);
+    int group = GET_ARG(0, GetInteger);
+    return DECIMAL_VAL(ResourceLoader::GetProgress(group));
+}
+/***
+ * Resources.IsPreloaded
+ * \desc Checks whether everything in a preload has finished loading.
+ * \param preloadID (Integer): The ID returned by <linkto ref="Resources.Preload"></linkto>.
+ * \return Returns <code>true</code> if the preload has finished, <code>false</code> if otherwise.
+ * \ns Resources
+ */
+VMValue Resources_IsPreloaded(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(1);
+    int group = GET_ARG(0, GetInteger);
+    return INTEGER_VAL(ResourceLoader::IsDone(group));
+}
+/***
+ * Resources.WaitForPreload
+ * \desc Waits until everything in a preload has finished loading.
+ * \param preloadID (Integer): The ID returned by <linkto ref="Resources.Preload"></linkto>.
+ * \ns Resources
+ */
+VMValue Resources_WaitForPreload(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(1);
+    int group = GET_ARG(0, GetInteger);
+    ResourceLoader::Wait(group);
+    return NULL_VAL;
+}
+/***
+ * Resources.ReleasePreload
+ * \desc Frees any resources in a preload that haven't been loaded yet.
+ * \param preloadID (Integer): The ID returned by <linkto ref="Resources.Preload"></linkto>.
+ * \ns Resources
+ */
+VMValue Resources_ReleasePreload(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(1);
+    int group = GET_ARG(0, GetInteger);
+    if (group > 0)
+        ResourceLoader::Release(group);
+    return NULL_VAL;
+}
 /***
  * Resources.FileExists
  * \desc Checks to see if a Resource exists with the given filename.
@@ -8979,6 +9211,114 @@ VMValue Scene_CheckObjectCollisionPlatform(int argCount, VMValue* args, Uint32 t
     }
     return INTEGER_VAL(!!Scene::CheckObjectCollisionPlatform(thisEnt, &thisBox, otherEnt, &otherBox, setValues));
 }
+/***
+ * Scene.GetObjectsInRegion
+ * \desc Gets every active instance whose hitbox touches a rectangle, using the scene's spatial grid instead of checking every instance.
+ * \param x (Number): X position of the rectangle.
+ * \param y (Number): Y position of the rectangle.
+ * \param width (Number): Width of the rectangle.
+ * \param height (Number): Height of the rectangle.
+ * \paramOpt className (String): Only get instances of this object class.
+ * \return Returns an Array of instances.
+ * \ns Scene
+ */
+VMValue Scene_GetObjectsInRegion(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_AT_LEAST_ARGCOUNT(4);
+    float x           = GET_ARG(0, GetDecimal);
+    float y           = GET_ARG(1, GetDecimal);
+    float width       = GET_ARG(2, GetDecimal);
+    float height      = GET_ARG(3, GetDecimal);
+    char* objectName  = GET_ARG_OPT(4, GetString, NULL);
+
+    ObjArray* array = NewArray();
+
+    ObjectList* objectList = NULL;
+    if (objectName) {
+        if (!Scene::ObjectLists->Exists(objectName))
+            return OBJECT_VAL(array);
+        objectList = Scene::ObjectLists->Get(objectName);
+    }
+
+    vector<Entity*> results;
+    SpatialGrid::GetInRegion(x, y, width, height, objectList, &results);
+    for (size_t i = 0; i < results.size(); i++)
+        array->Values->push_back(OBJECT_VAL(((ScriptEntity*)results[i])->Instance));
+
+    return OBJECT_VAL(array);
+}
+/***
+ * Scene.GetClosestObject
+ * \desc Gets the active instance closest to a point, using the scene's spatial grid instead of checking every instance.
+ * \param x (Number): X position of the point.
+ * \param y (Number): Y position of the point.
+ * \paramOpt className (String): Only get instances of this object class.
+ * \paramOpt maxDistance (Number): Only get instances up to this far away from the point.
+ * \return Returns the closest instance, or <code>null</code> if no instance was found.
+ * \ns Scene
+ */
+VMValue Scene_GetClosestObject(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_AT_LEAST_ARGCOUNT(2);
+    float x           = GET_ARG(0, GetDecimal);
+    float y           = GET_ARG(1, GetDecimal);
+    char* objectName  = GET_ARG_OPT(2, GetString, NULL);
+    float maxDistance = GET_ARG_OPT(3, GetDecimal, 0.0f);
+
+    ObjectList* objectList = NULL;
+    if (objectName) {
+        if (!Scene::ObjectLists->Exists(objectName))
+            return NULL_VAL;
+        objectList = Scene::ObjectLists->Get(objectName);
+    }
+
+    ScriptEntity* object = (ScriptEntity*)SpatialGrid::GetClosest(x, y, objectList, maxDistance);
+    if (object)
+        return OBJECT_VAL(object->Instance);
+
+    return NULL_VAL;
+}
+/***
+ * Scene.GetOverlappingPairs
+ * \desc Gets every pair of active instances of two object classes whose hitboxes are touching, the same way <code>CollideWithObject</code> checks it. If both classes are the same, each pair is only returned once.
+ * \param classA (String): Name of the first object class.
+ * \param classB (String): Name of the second object class.
+ * \return Returns an Array of pairs, each one an Array with an instance of the first class and an instance of the second class.
+ * \ns Scene
+ */
+VMValue Scene_GetOverlappingPairs(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(2);
+    char* objectNameA = GET_ARG(0, GetString);
+    char* objectNameB = GET_ARG(1, GetString);
+
+    ObjArray* array = NewArray();
+    if (!Scene::ObjectLists->Exists(objectNameA) || !Scene::ObjectLists->Exists(objectNameB))
+        return OBJECT_VAL(array);
+
+    vector<Entity*> results;
+    SpatialGrid::GetOverlappingPairs(Scene::ObjectLists->Get(objectNameA), Scene::ObjectLists->Get(objectNameB), &results);
+    for (size_t i = 0; i + 1 < results.size(); i += 2) {
+        ObjArray* pair = NewArray();
+        pair->Values->push_back(OBJECT_VAL(((ScriptEntity*)results[i])->Instance));
+        pair->Values->push_back(OBJECT_VAL(((ScriptEntity*)results[i + 1])->Instance));
+        array->Values->push_back(OBJECT_VAL(pair));
+    }
+
+    return OBJECT_VAL(array);
+}
+/***
+ * Scene.SetSpatialGridCellSize
+ * \desc Sets the size of the cells in the scene's spatial grid, which is used by <linkto ref="Scene.GetObjectsInRegion"></linkto>, <linkto ref="Scene.GetClosestObject"></linkto> and <linkto ref="Scene.GetOverlappingPairs"></linkto>. Cells around the size of a typical hitbox work best. (default: <code>64</code>)
+ * \param size (Integer): The cell size, in pixels.
+ * \ns Scene
+ */
+VMValue Scene_SetSpatialGridCellSize(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_ARGCOUNT(1);
+    int size = GET_ARG(0, GetInteger);
+    if (size < 1)
+        THROW_ERROR("Cell size %d must be greater than zero.", size);
+    else
+        SpatialGrid::SetCellSize(size);
+    return NULL_VAL;
+}
 /***
  * Scene.Load
  * \desc Changes active scene to the one in the specified resource file.
@@ -9980,6 +10320,7 @@ VMValue Scene_SetTile(int argCount, VMValue* args, Uint32 threadID) {
     *tile |= collA;
     *tile |= collB;
 
+    Scene::UpdateCollisionTile(layer, x, y);
     Scene::AnyLayerTileChange = true;
 
     return NULL_VAL;
@@ -10011,6 +10352,7 @@ VMValue Scene_SetTileCollisionSides(int argCount, VMValue* args, Uint32 threadID
     *tile |= collA;
     *tile |= collB;
 
+    Scene::UpdateCollisionTile(layer, x, y);
     Scene::AnyLayerTileChange = true;
 
     return NULL_VAL;
@@ -10680,7 +11022,7 @@ VMValue Scene_SetLayerDeformOffsetB(int argCount, VMValue* args, Uint32 threadID
 VMValue Scene_SetLayerCustomScanlineFunction(int argCount, VMValue* args, Uint32 threadID) {
     CHECK_ARGCOUNT(2);
     int index = GET_ARG(0, GetInteger);
-    if (args[0].Type == VAL_NULL) {
+    if (VALUE_TYPE(args[0]) == VAL_NULL) {
         Scene::Layers[index].UsingCustomScanlineFunction = false;
     }
     else {
@@ -10738,7 +11080,7 @@ VMValue Scene_SetTileScanline(int argCount, VMValue* args, Uint32 threadID) {
 VMValue Scene_SetLayerCustomRenderFunction(int argCount, VMValue* args, Uint32 threadID) {
     CHECK_ARGCOUNT(2);
     int index = GET_ARG(0, GetInteger);
-    if (args[0].Type == VAL_NULL) {
+    if (VALUE_TYPE(args[0]) == VAL_NULL) {
         Scene::Layers[index].UsingCustomRenderFunction = false;
     }
     else {
@@ -13650,6 +13992,132 @@ VMValue TileCollision_Line(int argCount, VMValue* args, Uint32 threadID) {
     }
     return INTEGER_VAL(false);
 }
+static bool GetSensorProbeValue(VMValue value, float* out) {
+    if (IS_DECIMAL(value))
+        *out = AS_DECIMAL(value);
+    else if (IS_INTEGER(value))
+        *out = (float)AS_INTEGER(value);
+    else
+        return false;
+    return true;
+}
+/***
+ * TileCollision.LineBatch
+ * \desc Checks for tile collisions along many lines at once, the same way <linkto ref="TileCollision.Line"></linkto> does for one.
+ * \param probes (Array): Five numbers for each line to check: X position, Y position, direction type (0: Down, 1: Right, 2: Up, 3: Left), length, and collision field.
+ * \param results (Array): Array to write the results to. It gets resized to hold four values for each line: whether or not it collided (Boolean), the X and Y positions where it collided (Number), and the tile angle at the collision (Integer).
+ * \paramOpt compareAngle (Integer): Only count a collision if the angle is within 0x20 this value. Defaults to <code>-1</code>, for no angle comparison.
+ * \return Returns how many of the lines collided, as an Integer value.
+ * \ns TileCollision
+ */
+VMValue TileCollision_LineBatch(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_AT_LEAST_ARGCOUNT(2);
+    ObjArray* probeArray = GET_ARG(0, GetArray);
+    ObjArray* results = GET_ARG(1, GetArray);
+    int compareAngle = GET_ARG_OPT(2, GetInteger, -1);
+
+    vector<SensorProbe> probes;
+    if (ScriptManager::Lock()) {
+        size_t probeValues = probeArray->Values->size();
+        if (probeValues % 5 != 0) {
+            ScriptManager::Unlock();
+            THROW_ERROR("Expected the probe array's length to be a multiple of 5, but got %d.", (int)probeValues);
+            return INTEGER_VAL(0);
+        }
+
+        probes.resize(probeValues / 5);
+        for (size_t i = 0; i < probes.size(); i++) {
+            float values[5];
+            for (int v = 0; v < 5; v++) {
+                if (!GetSensorProbeValue((*probeArray->Values)[i * 5 + v], &values[v])) {
+                    ScriptManager::Unlock();
+                    THROW_ERROR("Expected probe array value %d to be a Number.", (int)(i * 5 + v));
+                    return INTEGER_VAL(0);
+                }
+            }
+
+            probes[i].X = (int)std::floor(values[0]);
+            probes[i].Y = (int)std::floor(values[1]);
+            probes[i].Direction = (int)values[2];
+            probes[i].Length = (int)values[3];
+            probes[i].Plane = (int)values[4];
+            probes[i].CompareAngle = compareAngle;
+        }
+        ScriptManager::Unlock();
+    }
+
+    vector<Sensor> sensors(probes.size());
+    int hits = Scene::CollisionInLineBatch(probes.data(), sensors.data(), (int)probes.size());
+
+    if (ScriptManager::Lock()) {
+        results->Values->resize(sensors.size() * 4);
+        for (size_t i = 0; i < sensors.size(); i++) {
+            VMValue* result = &(*results->Values)[i * 4];
+            result[0] = INTEGER_VAL(sensors[i].Collided);
+            result[1] = DECIMAL_VAL((float)sensors[i].X);
+            result[2] = DECIMAL_VAL((float)sensors[i].Y);
+            result[3] = INTEGER_VAL(sensors[i].Angle);
+        }
+        ScriptManager::Unlock();
+    }
+    return INTEGER_VAL(hits);
+}
+/***
+ * TileCollision.LineObjects
+ * \desc Checks for a tile collision in a straight line from every active instance of an object class, writing the results into each instance the same way <linkto ref="TileCollision.Line"></linkto> does.
+ * \param className (String): Name of the object class.
+ * \param xOffset (Number): X offset from each instance's position to start checking from.
+ * \param yOffset (Number): Y offset from each instance's position to start checking from.
+ * \param directionType (Integer): Ordinal direction to check in. (0: Down, 1: Right, 2: Up, 3: Left)
+ * \param length (Integer): How many pixels to check.
+ * \param collisionField (Integer): Low (0) or high (1) field to check, or <code>-1</code> to use each instance's own collision plane.
+ * \paramOpt compareAngle (Integer): Only count a collision if the angle is within 0x20 this value. Defaults to <code>-1</code>, for no angle comparison.
+ * \return Returns how many of the instances' sensors collided, as an Integer value.
+ * \ns TileCollision
+ */
+VMValue TileCollision_LineObjects(int argCount, VMValue* args, Uint32 threadID) {
+    CHECK_AT_LEAST_ARGCOUNT(6);
+    char* objectName = GET_ARG(0, GetString);
+    float xOffset = GET_ARG(1, GetDecimal);
+    float yOffset = GET_ARG(2, GetDecimal);
+    int angleMode = GET_ARG(3, GetInteger);
+    int length = (int)GET_ARG(4, GetDecimal);
+    int collisionField = GET_ARG(5, GetInteger);
+    int compareAngle = GET_ARG_OPT(6, GetInteger, -1);
+
+    if (!Scene::ObjectLists->Exists(objectName))
+        return INTEGER_VAL(0);
+
+    ObjectList* objectList = Scene::ObjectLists->Get(objectName);
+
+    vector<Entity*> entities;
+    vector<SensorProbe> probes;
+    for (Entity* ent = objectList->EntityFirst; ent; ent = ent->NextEntityInList) {
+        if (!ent->Active || !ent->Interactable)
+            continue;
+
+        SensorProbe probe;
+        probe.X = (int)std::floor(ent->X + xOffset);
+        probe.Y = (int)std::floor(ent->Y + yOffset);
+        probe.Direction = angleMode;
+        probe.Length = length;
+        probe.Plane = collisionField < 0 ? ent->CollisionPlane : collisionField;
+        probe.CompareAngle = compareAngle;
+        probes.push_back(probe);
+        entities.push_back(ent);
+    }
+
+    vector<Sensor> sensors(probes.size());
+    int hits = Scene::CollisionInLineBatch(probes.data(), sensors.data(), (int)probes.size());
+
+    for (size_t i = 0; i < entities.size(); i++) {
+        entities[i]->SensorX = (float)sensors[i].X;
+        entities[i]->SensorY = (float)sensors[i].Y;
+        entities[i]->SensorCollided = sensors[i].Collided;
+        entities[i]->SensorAngle = sensors[i].Angle;
+    }
+    return INTEGER_VAL(hits);
+}
 // #endregion
 
 // #region TileInfo
@@ -13922,6 +14390,12 @@ VMValue Thread_RunEvent(int argCount, VMValue* args, Uint32 threadID) {
         return NULL_VAL;
     }
 
+    // The VMThreads past this point are in use by parallel updates.
+    if (ScriptManager::ThreadCount >= ParallelUpdate::FirstThreadIndex) {
+        THROW_ERROR("No script threads left to run event on.");
+        return NULL_VAL;
+    }
+
     int subArgCount = argCount - 1;
 
     _Thread_Bundle* bundle = (_Thread_Bundle*)malloc(sizeof(_Thread_Bundle) + subArgCount * sizeof(VMValue));
@@ -15224,6 +15698,11 @@ PUBLIC STATIC void StandardLibrary::Link() {
     DEF_NATIVE(Application, SetGameDescription);
     DEF_NATIVE(Application, SetCursorVisible);
     DEF_NATIVE(Application, GetCursorVisible);
+    DEF_NATIVE(Application, StartProfiler);
+    DEF_NATIVE(Application, StopProfiler);
+    DEF_NATIVE(Application, IsProfilerRunning);
+    DEF_NATIVE(Application, GetMemoryUsage);
+    DEF_NATIVE(Application, GetMemoryStats);
     /***
     * \enum KeyBind_Fullscreen
     * \desc Fullscreen keybind.
@@ -15284,6 +15763,11 @@ PUBLIC STATIC void StandardLibrary::Link() {
     * \desc App quit keybind. (dev)
     */
     DEF_ENUM_CLASS(KeyBind, DevQuit);
+    /***
+    * \enum KeyBind_DevProfiler
+    * \desc Script profiler toggle keybind. (dev)
+    */
+    DEF_ENUM_CLASS(KeyBind, DevProfiler);
     // #endregion
 
     // #region Audio
@@ -16564,6 +17048,8 @@ PUBLIC STATIC void StandardLibrary::Link() {
     DEF_NATIVE(Object, Loaded);
     DEF_NATIVE(Object, SetActivity);
     DEF_NATIVE(Object, GetActivity);
+    DEF_NATIVE(Object, SetParallelSafe);
+    DEF_NATIVE(Object, GetParallelSafe);
     // #endRegion
 
     // #region Palette
@@ -16592,6 +17078,11 @@ PUBLIC STATIC void StandardLibrary::Link() {
     DEF_NATIVE(Resources, LoadMusic);
     DEF_NATIVE(Resources, LoadSound);
     DEF_NATIVE(Resources, LoadVideo);
+    DEF_NATIVE(Resources, Preload);
+    DEF_NATIVE(Resources, GetPreloadProgress);
+    DEF_NATIVE(Resources, IsPreloaded);
+    DEF_NATIVE(Resources, WaitForPreload);
+    DEF_NATIVE(Resources, ReleasePreload);
     DEF_NATIVE(Resources, FileExists);
     DEF_NATIVE(Resources, ReadAllText);
 
@@ -16616,6 +17107,10 @@ PUBLIC STATIC void StandardLibrary::Link() {
     DEF_NATIVE(Scene, CheckObjectCollisionCircle);
     DEF_NATIVE(Scene, CheckObjectCollisionBox);
     DEF_NATIVE(Scene, CheckObjectCollisionPlatform);
+    DEF_NATIVE(Scene, GetObjectsInRegion);
+    DEF_NATIVE(Scene, GetClosestObject);
+    DEF_NATIVE(Scene, GetOverlappingPairs);
+    DEF_NATIVE(Scene, SetSpatialGridCellSize);
     DEF_NATIVE(Scene, Load);
     DEF_NATIVE(Scene, LoadNoPersistency);
     DEF_NATIVE(Scene, LoadPosition);
@@ -16992,6 +17487,8 @@ PUBLIC STATIC void StandardLibrary::Link() {
     DEF_NATIVE(TileCollision, Point);
     DEF_NATIVE(TileCollision, PointExtended);
     DEF_NATIVE(TileCollision, Line);
+    DEF_NATIVE(TileCollision, LineBatch);
+    DEF_NATIVE(TileCollision, LineObjects);
     /***
     * \enum SensorDirection_Down
     * \desc Down sensor direction.
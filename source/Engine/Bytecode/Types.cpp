@@ -9,6 +9,7 @@
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
 #include <Engine/Hashing/FNV1A.h>
+#include <Engine/Hashing/Murmur.h>
 
 #define ALLOCATE_OBJ(type, objectType) \
     (type*)AllocateObject(sizeof(type), objectType)
@@ -28,6 +29,8 @@ static Obj*       AllocateObject(size_t size, ObjType type) {
     object->Next = GarbageCollector::RootObject;
     GarbageCollector::RootObject = object;
 
+    GarbageCollector::OnAllocate(object);
+
     return object;
 }
 static ObjString* AllocateString(char* chars, size_t length, Uint32 hash) {
@@ -83,6 +86,7 @@ ObjFunction*      NewFunction() {
     function->Module = NULL;
     function->Name = NULL;
     function->ClassName = NULL;
+    function->CallCount = 0;
     function->Chunk.Init();
     return function;
 }
@@ -90,6 +94,8 @@ ObjNative*        NewNative(NativeFn function) {
     ObjNative* native = ALLOCATE_OBJ(ObjNative, OBJ_NATIVE);
     Memory::Track(native, "NewNative");
     native->Function = function;
+    native->ClassName = NULL;
+    native->Name = NULL;
     return native;
 }
 ObjUpvalue*       NewUpvalue(VMValue* slot) {
@@ -111,6 +117,186 @@ ObjClosure*       NewClosure(ObjFunction* function) {
     closure->UpvalueCount = function->UpvalueCount;
     return closure;
 }
+
+// Instance shapes
+static ClassShape* NewShape(ClassShape* parent, Uint32 hash) {
+    ClassShape* shape = (ClassShape*)Memory::TrackedMalloc("ClassShape", sizeof(ClassShape));
+    shape->Parent = parent;
+    shape->FirstChild = NULL;
+    shape->NextSibling = NULL;
+    shape->Hash = hash;
+
+    if (!parent) {
+        shape->SlotCount = 0;
+        shape->SlotMap = new HashMap<int>(NULL, 16);
+        shape->OwnsSlotMap = true;
+        return shape;
+    }
+
+    shape->SlotCount = parent->SlotCount + 1;
+
+    // The first child carries on its parent's chain, so it can keep
+    // adding to the same map. Any other child branches off and needs
+    // its own copy.
+    if (!parent->FirstChild) {
+        shape->SlotMap = parent->SlotMap;
+        shape->OwnsSlotMap = false;
+    }
+    else {
+        shape->SlotMap = new HashMap<int>(NULL, 16);
+        shape->OwnsSlotMap = true;
+        for (ClassShape* s = parent; s->Parent; s = s->Parent)
+            shape->SlotMap->Put(s->Hash, s->SlotCount - 1);
+    }
+    shape->SlotMap->Put(hash, shape->SlotCount - 1);
+
+    shape->NextSibling = parent->FirstChild;
+    parent->FirstChild = shape;
+    return shape;
+}
+static void       FreeShape(ClassShape* shape) {
+    ClassShape* child = shape->FirstChild;
+    while (child) {
+        ClassShape* next = child->NextSibling;
+        FreeShape(child);
+        child = next;
+    }
+
+    if (shape->OwnsSlotMap)
+        delete shape->SlotMap;
+    Memory::Free(shape);
+}
+static ClassShape* GetRootShape(ObjClass* klass) {
+    if (!klass->Shape) {
+        klass->Shape = NewShape(NULL, 0);
+        klass->ShapeCount = 1;
+    }
+    return klass->Shape;
+}
+static ClassShape* GetShapeTransition(ObjClass* klass, ClassShape* shape, Uint32 hash) {
+    for (ClassShape* child = shape->FirstChild; child; child = child->NextSibling) {
+        if (child->Hash == hash)
+            return child;
+    }
+
+    // Past these, fields go in the instance's table instead
+    if (shape->SlotCount >= SHAPE_MAX_SLOTS || klass->ShapeCount >= SHAPE_MAX_COUNT)
+        return NULL;
+
+    klass->ShapeCount++;
+    return NewShape(shape, hash);
+}
+int               GetShapeSlot(ClassShape* shape, Uint32 hash) {
+    int slot;
+    if (shape->SlotMap->GetIfExists(hash, &slot) && slot < shape->SlotCount)
+        return slot;
+    return -1;
+}
+void              FreeClassShapes(ObjClass* klass) {
+    if (klass->Shape) {
+        FreeShape(klass->Shape);
+        klass->Shape = NULL;
+        klass->ShapeCount = 0;
+    }
+}
+VMValue*          GetInstanceField(ObjInstance* instance, Uint32 hash) {
+    int slot = GetShapeSlot(instance->Shape, hash);
+    if (slot >= 0)
+        return &instance->Slots[slot];
+
+    if (instance->Fields) {
+        slot = instance->Fields->GetSlot(hash);
+        if (slot >= 0)
+            return &instance->Fields->Data[slot].Data;
+    }
+    return NULL;
+}
+void              PutInstanceField(ObjInstance* instance, Uint32 hash, VMValue value) {
+    VMValue* field = GetInstanceField(instance, hash);
+    if (field) {
+        *field = value;
+        return;
+    }
+
+    ObjClass* klass = instance->Object.Class;
+    ClassShape* shape = GetShapeTransition(klass, instance->Shape, hash);
+    if (!shape) {
+        if (!instance->Fields)
+            instance->Fields = new Table(NULL, 16);
+        instance->Fields->Put(hash, value);
+        return;
+    }
+
+    if (shape->SlotCount > instance->SlotCapacity) {
+        // Start off with as many slots as the last instance
+        // of this class ended up needing.
+        int capacity = instance->SlotCapacity ? instance->SlotCapacity * 2 : 8;
+        if (capacity < klass->ShapeSlotHint)
+            capacity = klass->ShapeSlotHint;
+        if (capacity > SHAPE_MAX_SLOTS)
+            capacity = SHAPE_MAX_SLOTS;
+
+        if (!instance->Slots)
+            instance->Slots = (VMValue*)Memory::TrackedMalloc("ObjInstance::Slots", sizeof(VMValue) * capacity);
+        else
+            instance->Slots = (VMValue*)Memory::Realloc(instance->Slots, sizeof(VMValue) * capacity);
+        instance->SlotCapacity = capacity;
+    }
+
+    instance->Slots[shape->SlotCount - 1] = value;
+    instance->Shape = shape;
+
+    if (klass->ShapeSlotHint < shape->SlotCount)
+        klass->ShapeSlotHint = shape->SlotCount;
+}
+void              PutInstanceField(ObjInstance* instance, const char* name, VMValue value) {
+    PutInstanceField(instance, Murmur::EncryptString(name), value);
+}
+void              ForAllInstanceFields(ObjInstance* instance, std::function<void(Uint32, VMValue)> forFunc) {
+    // Shape fields go in the order they were added
+    Uint32 hashes[SHAPE_MAX_SLOTS];
+    int count = instance->Shape->SlotCount;
+    for (ClassShape* shape = instance->Shape; shape->Parent; shape = shape->Parent)
+        hashes[shape->SlotCount - 1] = shape->Hash;
+    for (int i = 0; i < count; i++)
+        forFunc(hashes[i], instance->Slots[i]);
+
+    if (instance->Fields)
+        instance->Fields->WithAll(forFunc);
+}
+void              ClearInstanceFields(ObjInstance* instance) {
+    instance->Shape = GetRootShape(instance->Object.Class);
+    if (instance->Fields)
+        instance->Fields->Clear();
+}
+void              SetInstanceClass(ObjInstance* instance, ObjClass* klass) {
+    if (instance->Object.Class == klass)
+        return;
+
+    // Shapes belong to a class, so lay the fields out again
+    // in the new class's.
+    vector<std::pair<Uint32, VMValue>> fields;
+    ForAllInstanceFields(instance, [&fields](Uint32 hash, VMValue value) -> void {
+        fields.push_back(std::make_pair(hash, value));
+    });
+
+    instance->Object.Class = klass;
+    ClearInstanceFields(instance);
+    for (size_t i = 0; i < fields.size(); i++)
+        PutInstanceField(instance, fields[i].first, fields[i].second);
+}
+void              FreeInstanceFields(ObjInstance* instance) {
+    // An instance does not own its values, so it's not allowed
+    // to free them.
+    if (instance->Slots)
+        Memory::Free(instance->Slots);
+    delete instance->Fields;
+
+    instance->Slots = NULL;
+    instance->SlotCapacity = 0;
+    instance->Fields = NULL;
+}
+
 ObjClass*         NewClass(Uint32 hash) {
     ObjClass* klass = ALLOCATE_OBJ(ObjClass, OBJ_CLASS);
     Memory::Track(klass, "NewClass");
@@ -126,18 +312,25 @@ ObjClass*         NewClass(Uint32 hash) {
     klass->Type = CLASS_TYPE_NORMAL;
     klass->ParentHash = 0;
     klass->Parent = NULL;
+    klass->Shape = NULL;
+    klass->ShapeCount = 0;
+    klass->ShapeSlotHint = 0;
     return klass;
 }
 ObjInstance*      NewInstance(ObjClass* klass) {
     ObjInstance* instance = ALLOCATE_OBJ(ObjInstance, OBJ_INSTANCE);
     Memory::Track(instance, "NewInstance");
     instance->Object.Class = klass;
-    instance->Fields = new Table(NULL, 16);
+    instance->Shape = GetRootShape(klass);
+    instance->Slots = NULL;
+    instance->SlotCapacity = 0;
+    instance->Fields = NULL;
     instance->EntityPtr = NULL;
     instance->PropertyGet = NULL;
     instance->PropertySet = NULL;
     return instance;
 }
+
 ObjBoundMethod*   NewBoundMethod(VMValue receiver, ObjFunction* method) {
     ObjBoundMethod* bound = ALLOCATE_OBJ(ObjBoundMethod, OBJ_BOUND_METHOD);
     Memory::Track(bound, "NewBoundMethod");
@@ -195,9 +388,9 @@ ObjModule*        NewModule() {
 }
 
 bool              ValuesEqual(VMValue a, VMValue b) {
-    if (a.Type != b.Type) return false;
+    if (VALUE_TYPE(a) != VALUE_TYPE(b)) return false;
 
-    switch (a.Type) {
+    switch (VALUE_TYPE(a)) {
         case VAL_INTEGER: return AS_INTEGER(a) == AS_INTEGER(b);
         case VAL_DECIMAL: return AS_DECIMAL(a) == AS_DECIMAL(b);
         case VAL_OBJECT:  return AS_OBJECT(a) == AS_OBJECT(b);
@@ -254,10 +447,10 @@ const char*       GetObjectTypeString(Uint32 type) {
     return "Unknown Object Type";
 }
 const char*       GetValueTypeString(VMValue value) {
-    if (value.Type == VAL_OBJECT)
+    if (VALUE_TYPE(value) == VAL_OBJECT)
         return GetObjectTypeString(OBJECT_TYPE(value));
     else
-        return GetTypeString(value.Type);
+        return GetTypeString(VALUE_TYPE(value));
 }
 
 void              Chunk::Init() {
@@ -266,6 +459,12 @@ void              Chunk::Init() {
     Code = NULL;
     Lines = NULL;
     Constants = new vector<VMValue>();
+    CacheIndex = NULL;
+    CacheIndexSize = 0;
+    Caches = NULL;
+    CacheCount = 0;
+    CacheCapacity = 0;
+    Registers = NULL;
 }
 void              Chunk::Alloc() {
     if (!Code)
@@ -299,6 +498,25 @@ void              Chunk::Free() {
         Constants->shrink_to_fit();
         delete Constants;
     }
+
+    if (CacheIndex) {
+        Memory::Free(CacheIndex);
+        CacheIndex = NULL;
+        CacheIndexSize = 0;
+    }
+    if (Caches) {
+        Memory::Free(Caches);
+        Caches = NULL;
+        CacheCount = 0;
+        CacheCapacity = 0;
+    }
+    if (Registers) {
+        Memory::Free(Registers->Code);
+        Memory::Free(Registers->Entries);
+        Memory::Free(Registers->Constants);
+        Memory::Free(Registers);
+        Registers = NULL;
+    }
 }
 void              Chunk::Write(Uint8 byte, int line) {
     if (Capacity < Count + 1) {
@@ -314,3 +532,35 @@ int               Chunk::AddConstant(VMValue value) {
     Constants->push_back(value);
     return (int)Constants->size() - 1;
 }
+InlineCache*      Chunk::GetInlineCache(int offset) {
+    if (!CacheIndex) {
+        CacheIndexSize = Count + 1;
+        CacheIndex = (Uint16*)Memory::TrackedCalloc("Chunk::CacheIndex", CacheIndexSize, sizeof(Uint16));
+    }
+    if (offset < 0 || offset >= CacheIndexSize)
+        return NULL;
+
+    Uint16 index = CacheIndex[offset];
+    if (index)
+        return &Caches[index - 1];
+
+    // Sites past this point just don't get cached
+    if (CacheCount == INLINE_CACHE_MAX)
+        return NULL;
+
+    if (CacheCount == CacheCapacity) {
+        int oldCapacity = CacheCapacity;
+        CacheCapacity = GROW_CAPACITY(oldCapacity);
+        if (CacheCapacity > INLINE_CACHE_MAX)
+            CacheCapacity = INLINE_CACHE_MAX;
+        if (!Caches)
+            Caches = (InlineCache*)Memory::TrackedMalloc("Chunk::Caches", sizeof(InlineCache) * CacheCapacity);
+        else
+            Caches = (InlineCache*)Memory::Realloc(Caches, sizeof(InlineCache) * CacheCapacity);
+    }
+
+    InlineCache* cache = &Caches[CacheCount++];
+    memset(cache, 0, sizeof(InlineCache));
+    CacheIndex[offset] = (Uint16)CacheCount;
+    return cache;
+}
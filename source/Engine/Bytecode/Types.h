@@ -29,6 +29,36 @@ enum {
 
 struct Obj;
 
+#ifdef USING_VM_TAGGED_VALUES
+// Packs a value into 64 bits: the type goes in the upper 16 bits, and the
+// payload (a 32-bit number, or a pointer) in the lower 48 bits.
+struct VMValue {
+    Uint64    Bits;
+};
+
+#define VALUE_TAG_SHIFT    48
+#define VALUE_PAYLOAD_MASK 0x0000FFFFFFFFFFFFULL
+
+static inline VMValue MakeTaggedValue(Uint32 type, Uint64 payload) {
+    VMValue val;
+    val.Bits = ((Uint64)type << VALUE_TAG_SHIFT) | (payload & VALUE_PAYLOAD_MASK);
+    return val;
+}
+static inline void*   GetTaggedPointer(VMValue value) {
+    return (void*)(uintptr_t)(value.Bits & VALUE_PAYLOAD_MASK);
+}
+static inline Uint32  GetDecimalBits(float value) {
+    Uint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+static inline float   GetTaggedDecimal(VMValue value) {
+    Uint32 bits = (Uint32)value.Bits;
+    float decimal;
+    memcpy(&decimal, &bits, sizeof(decimal));
+    return decimal;
+}
+#else
 struct VMValue {
     Uint32    Type;
     union {
@@ -39,6 +69,59 @@ struct VMValue {
         float* LinkedDecimal;
     } as;
 };
+#endif
+
+#define INLINE_CACHE_ENTRIES 4
+#define INLINE_CACHE_MAX     0xFFFF
+
+// One receiver class seen at a property access or invoke site.
+// Field entries (Slot >= 0) point at where the field was found,
+// either in an instance shape's slots or in a table. Table slots
+// are checked against the table on every hit. Shape entries and
+// method entries (Slot < 0) are only valid while Epoch matches
+// ScriptManager::InlineCacheEpoch.
+struct InlineCacheEntry {
+    struct ObjClass*   Class;
+    struct ClassShape* Shape;
+    Uint32             Epoch;
+    int                Slot;
+    VMValue            Method;
+};
+struct InlineCache {
+    InlineCacheEntry Entries[INLINE_CACHE_ENTRIES];
+    Uint32           Next;
+};
+
+// Register tier code for a hot function (see RegisterTier.cpp.)
+// Registers are the frame's stack slots; B and C are constants
+// instead when their Kinds bit is set. Offset and Depth are the
+// bytecode offset and stack depth the instruction was made from.
+#define REG_B_CONSTANT 1
+#define REG_C_CONSTANT 2
+
+struct RegisterInstruction {
+    Uint8  Op;
+    Uint8  Kinds;
+    Uint16 A;
+    Uint32 B;
+    Uint32 C;
+    Uint32 Target;
+    Uint32 Offset;
+    Uint32 Depth;
+};
+// Where the stack interpreter can hand a frame over, per bytecode
+// offset. Index is -1 where it can't.
+struct RegisterEntry {
+    Sint32 Index;
+    Uint32 Depth;
+};
+struct RegisterChunk {
+    RegisterInstruction* Code;
+    int                  Count;
+    RegisterEntry*       Entries;
+    VMValue*             Constants;
+    int                  ConstantCount;
+};
 
 struct Chunk {
     int              Count;
@@ -49,11 +132,23 @@ struct Chunk {
     vector<VMValue>* Constants;
     bool             OwnsMemory;
 
+    // Inline caches, allocated the first time a site runs.
+    // CacheIndex maps a bytecode offset to its cache (plus one.)
+    Uint16*          CacheIndex;
+    int              CacheIndexSize;
+    InlineCache*     Caches;
+    int              CacheCount;
+    int              CacheCapacity;
+
+    // Set once the function has been translated for the register tier.
+    RegisterChunk*   Registers;
+
     void Init();
     void Alloc();
     void Free();
     void Write(Uint8 byte, int line);
     int  AddConstant(VMValue value);
+    InlineCache* GetInlineCache(int offset);
 };
 
 struct BytecodeContainer {
@@ -65,35 +160,58 @@ const char* GetTypeString(Uint32 type);
 const char* GetObjectTypeString(Uint32 type);
 const char* GetValueTypeString(VMValue value);
 
-#define IS_NULL(value)  ((value).Type == VAL_NULL)
-#define IS_INTEGER(value)  ((value).Type == VAL_INTEGER)
-#define IS_DECIMAL(value)  ((value).Type == VAL_DECIMAL)
-#define IS_OBJECT(value)   ((value).Type == VAL_OBJECT)
-
-#define AS_INTEGER(value)  (value.Type == VAL_INTEGER ? (value).as.Integer : *((value).as.LinkedInteger))
-#define AS_DECIMAL(value)  (value.Type == VAL_DECIMAL ? (value).as.Decimal : *((value).as.LinkedDecimal))
-#define AS_OBJECT(value)   ((value).as.Object)
-
-#ifdef WIN32
-    #define NULL_VAL           (VMValue { })
-    static inline VMValue INTEGER_VAL(int value) { VMValue val; val.Type = VAL_INTEGER; val.as.Integer = value; return val; }
-    static inline VMValue DECIMAL_VAL(float value) { VMValue val; val.Type = VAL_DECIMAL; val.as.Decimal = value; return val; }
-    static inline VMValue OBJECT_VAL(void* value) { VMValue val; val.Type = VAL_OBJECT; val.as.Object = (Obj*)value; return val; }
-    static inline VMValue INTEGER_LINK_VAL(int* value) { VMValue val; val.Type = VAL_LINKED_INTEGER; val.as.LinkedInteger = value; return val; }
-    static inline VMValue DECIMAL_LINK_VAL(float* value) { VMValue val; val.Type = VAL_LINKED_DECIMAL; val.as.LinkedDecimal = value; return val; }
+#ifdef USING_VM_TAGGED_VALUES
+    #define VALUE_TYPE(value)  ((Uint32)((value).Bits >> VALUE_TAG_SHIFT))
 #else
-    #define NULL_VAL           ((VMValue) { VAL_NULL, { .Integer = 0 } })
-    #define INTEGER_VAL(value) ((VMValue) { VAL_INTEGER, { .Integer = value } })
-    #define DECIMAL_VAL(value) ((VMValue) { VAL_DECIMAL, { .Decimal = value } })
-    #define OBJECT_VAL(object) ((VMValue) { VAL_OBJECT, { .Object = (Obj*)object } })
-    #define INTEGER_LINK_VAL(value)  ((VMValue) { VAL_LINKED_INTEGER, { .LinkedInteger = value } })
-    #define DECIMAL_LINK_VAL(value)  ((VMValue) { VAL_LINKED_DECIMAL, { .LinkedDecimal = value } })
+    #define VALUE_TYPE(value)  ((value).Type)
 #endif
 
-#define IS_LINKED_INTEGER(value) ((value).Type == VAL_LINKED_INTEGER)
-#define IS_LINKED_DECIMAL(value) ((value).Type == VAL_LINKED_DECIMAL)
-#define AS_LINKED_INTEGER(value)  (*((value).as.LinkedInteger))
-#define AS_LINKED_DECIMAL(value)  (*((value).as.LinkedDecimal))
+#define IS_NULL(value)  (VALUE_TYPE(value) == VAL_NULL)
+#define IS_INTEGER(value)  (VALUE_TYPE(value) == VAL_INTEGER)
+#define IS_DECIMAL(value)  (VALUE_TYPE(value) == VAL_DECIMAL)
+#define IS_OBJECT(value)   (VALUE_TYPE(value) == VAL_OBJECT)
+
+#ifdef USING_VM_TAGGED_VALUES
+    #define AS_INTEGER(value)  (VALUE_TYPE(value) == VAL_INTEGER ? (int)(Uint32)(value).Bits : *((int*)GetTaggedPointer(value)))
+    #define AS_DECIMAL(value)  (VALUE_TYPE(value) == VAL_DECIMAL ? GetTaggedDecimal(value) : *((float*)GetTaggedPointer(value)))
+    #define AS_OBJECT(value)   ((Obj*)GetTaggedPointer(value))
+
+    #define NULL_VAL           MakeTaggedValue(VAL_NULL, 0)
+    #define INTEGER_VAL(value) MakeTaggedValue(VAL_INTEGER, (Uint32)(int)(value))
+    #define DECIMAL_VAL(value) MakeTaggedValue(VAL_DECIMAL, GetDecimalBits(value))
+    #define OBJECT_VAL(object) MakeTaggedValue(VAL_OBJECT, (uintptr_t)(object))
+    #define INTEGER_LINK_VAL(value)  MakeTaggedValue(VAL_LINKED_INTEGER, (uintptr_t)(value))
+    #define DECIMAL_LINK_VAL(value)  MakeTaggedValue(VAL_LINKED_DECIMAL, (uintptr_t)(value))
+
+    #define AS_LINKED_INTEGER(value)  (*((int*)GetTaggedPointer(value)))
+    #define AS_LINKED_DECIMAL(value)  (*((float*)GetTaggedPointer(value)))
+#else
+    #define AS_INTEGER(value)  (VALUE_TYPE(value) == VAL_INTEGER ? (value).as.Integer : *((value).as.LinkedInteger))
+    #define AS_DECIMAL(value)  (VALUE_TYPE(value) == VAL_DECIMAL ? (value).as.Decimal : *((value).as.LinkedDecimal))
+    #define AS_OBJECT(value)   ((value).as.Object)
+
+    #ifdef WIN32
+        #define NULL_VAL           (VMValue { })
+        static inline VMValue INTEGER_VAL(int value) { VMValue val; val.Type = VAL_INTEGER; val.as.Integer = value; return val; }
+        static inline VMValue DECIMAL_VAL(float value) { VMValue val; val.Type = VAL_DECIMAL; val.as.Decimal = value; return val; }
+        static inline VMValue OBJECT_VAL(void* value) { VMValue val; val.Type = VAL_OBJECT; val.as.Object = (Obj*)value; return val; }
+        static inline VMValue INTEGER_LINK_VAL(int* value) { VMValue val; val.Type = VAL_LINKED_INTEGER; val.as.LinkedInteger = value; return val; }
+        static inline VMValue DECIMAL_LINK_VAL(float* value) { VMValue val; val.Type = VAL_LINKED_DECIMAL; val.as.LinkedDecimal = value; return val; }
+    #else
+        #define NULL_VAL           ((VMValue) { VAL_NULL, { .Integer = 0 } })
+        #define INTEGER_VAL(value) ((VMValue) { VAL_INTEGER, { .Integer = value } })
+        #define DECIMAL_VAL(value) ((VMValue) { VAL_DECIMAL, { .Decimal = value } })
+        #define OBJECT_VAL(object) ((VMValue) { VAL_OBJECT, { .Object = (Obj*)object } })
+        #define INTEGER_LINK_VAL(value)  ((VMValue) { VAL_LINKED_INTEGER, { .LinkedInteger = value } })
+        #define DECIMAL_LINK_VAL(value)  ((VMValue) { VAL_LINKED_DECIMAL, { .LinkedDecimal = value } })
+    #endif
+
+    #define AS_LINKED_INTEGER(value)  (*((value).as.LinkedInteger))
+    #define AS_LINKED_DECIMAL(value)  (*((value).as.LinkedDecimal))
+#endif
+
+#define IS_LINKED_INTEGER(value) (VALUE_TYPE(value) == VAL_LINKED_INTEGER)
+#define IS_LINKED_DECIMAL(value) (VALUE_TYPE(value) == VAL_LINKED_DECIMAL)
 
 #define IS_NUMBER(value)        (IS_DECIMAL(value) || IS_INTEGER(value) || IS_LINKED_DECIMAL(value) || IS_LINKED_INTEGER(value))
 #define IS_NOT_NUMBER(value)    (!IS_DECIMAL(value) && !IS_INTEGER(value) && !IS_LINKED_DECIMAL(value) && !IS_LINKED_INTEGER(value))
@@ -185,10 +303,13 @@ struct ObjFunction {
     ObjString*   Name;
     ObjString*   ClassName;
     Uint32       NameHash;
+    Uint32       CallCount;
 };
 struct ObjNative {
-    Obj      Object;
-    NativeFn Function;
+    Obj         Object;
+    NativeFn    Function;
+    ObjString*  ClassName;
+    const char* Name;
 };
 struct ObjUpvalue {
     Obj      Object;
@@ -202,6 +323,24 @@ struct ObjClosure {
     ObjUpvalue** Upvalues;
     int          UpvalueCount;
 };
+#define SHAPE_MAX_SLOTS 256
+#define SHAPE_MAX_COUNT 1024
+
+// Field layout shared by every instance of a class that had the same
+// fields added in the same order. Each shape adds one field (Hash) to
+// its parent, so a field keeps its slot all the way down a chain.
+// SlotMap is shared along a chain; entries at or past SlotCount belong
+// to descendants, and a shape that branches off takes its own copy.
+struct ClassShape {
+    ClassShape*   Parent;
+    ClassShape*   FirstChild;
+    ClassShape*   NextSibling;
+    Uint32        Hash;
+    int           SlotCount;
+    HashMap<int>* SlotMap;
+    bool          OwnsSlotMap;
+};
+
 struct ObjClass {
     Obj         Object;
     ObjString*  Name;
@@ -216,13 +355,19 @@ struct ObjClass {
     Uint8       Type;
     Uint32      ParentHash;
     ObjClass*   Parent;
+    ClassShape* Shape;
+    int         ShapeCount;
+    int         ShapeSlotHint;
 };
 struct ObjInstance {
-    Obj        Object;
-    Table*     Fields;
-    void*      EntityPtr;
-    ValueGetFn PropertyGet;
-    ValueSetFn PropertySet;
+    Obj         Object;
+    ClassShape* Shape;
+    VMValue*    Slots;
+    int         SlotCapacity;
+    Table*      Fields; // Fields that didn't fit in the shape, NULL until needed
+    void*       EntityPtr;
+    ValueGetFn  PropertyGet;
+    ValueSetFn  PropertySet;
 };
 struct ObjBoundMethod {
     Obj          Object;
@@ -278,6 +423,22 @@ ObjNamespace*      NewNamespace(Uint32 hash);
 ObjEnum*           NewEnum(Uint32 hash);
 ObjModule*         NewModule();
 
+int                GetShapeSlot(ClassShape* shape, Uint32 hash);
+void               FreeClassShapes(ObjClass* klass);
+VMValue*           GetInstanceField(ObjInstance* instance, Uint32 hash);
+void               PutInstanceField(ObjInstance* instance, Uint32 hash, VMValue value);
+void               PutInstanceField(ObjInstance* instance, const char* name, VMValue value);
+void               ForAllInstanceFields(ObjInstance* instance, std::function<void(Uint32, VMValue)> forFunc);
+void               ClearInstanceFields(ObjInstance* instance);
+void               SetInstanceClass(ObjInstance* instance, ObjClass* klass);
+void               FreeInstanceFields(ObjInstance* instance);
+
+enum GCState {
+    GC_STATE_IDLE,
+    GC_STATE_MARKING,
+    GC_STATE_SWEEPING
+};
+
 #define FREE_OBJ(obj, type) \
     assert(GarbageCollector::GarbageSize >= sizeof(type)); \
     GarbageCollector::GarbageSize -= sizeof(type); \
@@ -405,8 +566,57 @@ enum   OpCode {
     OP_SET_MODULE_LOCAL,
     OP_DEFINE_MODULE_LOCAL,
     OP_USE_NAMESPACE,
+    // Superinstructions (only emitted by BytecodeOptimizer)
+    OP_INCREMENT_LOCAL,
+    OP_DECREMENT_LOCAL,
+    OP_GET_LOCAL_PROPERTY,
+    OP_JUMP_IF_LESS_LOCAL_CONST,
 
     OP_SYNC = 0xFF,
 };
+enum   RegisterOpCode {
+    REG_MOVE,
+    REG_ADD,
+    REG_SUBTRACT,
+    REG_MULTIPLY,
+    REG_DIVIDE,
+    REG_MODULO,
+    REG_BITSHIFT_LEFT,
+    REG_BITSHIFT_RIGHT,
+    REG_BW_AND,
+    REG_BW_OR,
+    REG_BW_XOR,
+    REG_LG_AND,
+    REG_LG_OR,
+    REG_EQUAL,
+    REG_EQUAL_NOT,
+    REG_GREATER,
+    REG_GREATER_EQUAL,
+    REG_LESS,
+    REG_LESS_EQUAL,
+    REG_NEGATE,
+    REG_BW_NOT,
+    REG_LG_NOT,
+    REG_INCREMENT,
+    REG_DECREMENT,
+    REG_SAVE_VALUE,
+    REG_LOAD_VALUE,
+    REG_JUMP,
+    REG_JUMP_IF_FALSE,
+    // Comparison followed by OP_JUMP_IF_FALSE
+    REG_JUMP_IF_NOT_EQUAL,
+    REG_JUMP_IF_NOT_EQUAL_NOT,
+    REG_JUMP_IF_NOT_GREATER,
+    REG_JUMP_IF_NOT_GREATER_EQUAL,
+    REG_JUMP_IF_NOT_LESS,
+    REG_JUMP_IF_NOT_LESS_EQUAL,
+    // Hands the frame back to the stack interpreter at Offset
+    REG_FALLBACK,
+};
+enum   VMTierMode {
+    VM_TIER_AUTO,
+    VM_TIER_STACK,
+    VM_TIER_REGISTER,
+};
 
 #endif /* ENGINE_BYTECODE_TYPES_H */
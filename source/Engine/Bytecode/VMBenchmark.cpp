@@ -0,0 +1,318 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Bytecode/Types.h>
+
+class VMBenchmark {
+public:
+    static int  DefaultIterations;
+};
+#endif
+
+#include <Engine/Bytecode/VMBenchmark.h>
+
+#include <Engine/Bytecode/BytecodeOptimizer.h>
+#include <Engine/Bytecode/GarbageCollector.h>
+#include <Engine/Bytecode/RegisterTier.h>
+#include <Engine/Bytecode/ScriptManager.h>
+#include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Hashing/Murmur.h>
+
+int VMBenchmark::DefaultIterations = 5000000;
+
+// Locals used by the benchmark loops. Slot 0 is the function itself.
+enum {
+    BENCH_SLOT_COUNTER = 1,
+    BENCH_SLOT_ACCUMULATOR,
+    BENCH_SLOT_OBJECT,
+};
+
+// Instructions executed by the loop condition and counter increment
+// on every iteration.
+#define BENCH_LOOP_INSTRUCTIONS 10
+
+#define BENCH_LOOP_COUNT 4
+
+PRIVATE STATIC void VMBenchmark::EmitByte(ObjFunction* function, Uint8 byte) {
+    function->Chunk.Write(byte, 0);
+}
+PRIVATE STATIC void VMBenchmark::EmitUint16(ObjFunction* function, Uint16 value) {
+    EmitByte(function, value & 0xFF);
+    EmitByte(function, value >> 8 & 0xFF);
+}
+PRIVATE STATIC void VMBenchmark::EmitUint32(ObjFunction* function, Uint32 value) {
+    EmitByte(function, value & 0xFF);
+    EmitByte(function, value >> 8 & 0xFF);
+    EmitByte(function, value >> 16 & 0xFF);
+    EmitByte(function, value >> 24 & 0xFF);
+}
+PRIVATE STATIC void VMBenchmark::EmitConstant(ObjFunction* function, VMValue value) {
+    Uint32 index = (Uint32)function->Chunk.AddConstant(value);
+    EmitByte(function, OP_CONSTANT);
+    EmitUint32(function, index);
+}
+PRIVATE STATIC void VMBenchmark::EmitLocal(ObjFunction* function, Uint8 op, Uint8 slot) {
+    EmitByte(function, op);
+    EmitByte(function, slot);
+}
+
+PRIVATE STATIC void VMBenchmark::EmitProperty(ObjFunction* function, Uint8 op, Uint32 hash) {
+    EmitByte(function, op);
+    EmitUint32(function, hash);
+}
+
+PRIVATE STATIC ObjFunction* VMBenchmark::BeginLoop(ObjModule* module, const char* name, int iterations, VMValue accumulator, VMValue object, int* loopStart, int* exitJump) {
+    ObjFunction* function = NewFunction();
+    function->Name = CopyString(name);
+    function->Module = module;
+    module->Functions->push_back(function);
+
+    EmitConstant(function, INTEGER_VAL(0)); // counter
+    EmitConstant(function, accumulator);
+    EmitConstant(function, object);
+
+    // while (counter < iterations)
+    *loopStart = function->Chunk.Count;
+    EmitLocal(function, OP_GET_LOCAL, BENCH_SLOT_COUNTER);
+    EmitConstant(function, INTEGER_VAL(iterations));
+    EmitByte(function, OP_LESS);
+    EmitByte(function, OP_JUMP_IF_FALSE);
+    *exitJump = function->Chunk.Count;
+    EmitUint16(function, 0xFFFF);
+    EmitByte(function, OP_POP);
+
+    return function;
+}
+PRIVATE STATIC void VMBenchmark::EndLoop(ObjFunction* function, int loopStart, int exitJump) {
+    // counter++
+    EmitLocal(function, OP_GET_LOCAL, BENCH_SLOT_COUNTER);
+    EmitByte(function, OP_INCREMENT);
+    EmitLocal(function, OP_SET_LOCAL, BENCH_SLOT_COUNTER);
+    EmitByte(function, OP_POP);
+
+    EmitByte(function, OP_JUMP_BACK);
+    EmitUint16(function, (Uint16)(function->Chunk.Count - loopStart + 2));
+
+    Uint16 jump = (Uint16)(function->Chunk.Count - (exitJump + 2));
+    function->Chunk.Code[exitJump] = jump & 0xFF;
+    function->Chunk.Code[exitJump + 1] = jump >> 8 & 0xFF;
+
+    EmitByte(function, OP_POP);
+    EmitLocal(function, OP_GET_LOCAL, BENCH_SLOT_ACCUMULATOR);
+    EmitByte(function, OP_RETURN);
+}
+
+// Copies a loop and runs it through the optimizer, before either
+// one has run (the optimizer won't touch chunks with inline caches.)
+PRIVATE STATIC ObjFunction* VMBenchmark::OptimizeLoop(ObjModule* module, ObjFunction* function) {
+    ObjFunction* optimized = NewFunction();
+    optimized->Name = function->Name;
+    optimized->Module = module;
+    module->Functions->push_back(optimized);
+
+    for (int i = 0; i < function->Chunk.Count; i++)
+        optimized->Chunk.Write(function->Chunk.Code[i], function->Chunk.Lines[i]);
+    for (size_t i = 0; i < function->Chunk.Constants->size(); i++)
+        optimized->Chunk.AddConstant((*function->Chunk.Constants)[i]);
+
+    BytecodeOptimizer::Optimize(&optimized->Chunk);
+    return optimized;
+}
+
+PRIVATE STATIC double VMBenchmark::RunLoop(ObjFunction* function, const char* name, int iterations, int bodyInstructions) {
+    VMThread* thread = &ScriptManager::Threads[0];
+
+    thread->Push(OBJECT_VAL(function));
+
+    double elapsed = Clock::GetTicks();
+    thread->RunFunction(function, 0);
+    elapsed = Clock::GetTicks() - elapsed;
+
+    double instructions = (double)iterations * (bodyInstructions + BENCH_LOOP_INSTRUCTIONS);
+    double rate = elapsed > 0.0 ? instructions / (elapsed * 1000.0) : 0.0;
+
+    Log::Print(Log::LOG_INFO, "%-20s %9.3f ms  %9.2f M instructions/s", name, elapsed, rate);
+    return rate;
+}
+
+PRIVATE STATIC void VMBenchmark::PrintFootprint() {
+    size_t elementSize = sizeof(HashMapElement<VMValue>);
+    size_t stackSize = sizeof(((VMThread*)NULL)->Stack);
+
+    Log::Print(Log::LOG_IMPORTANT, "Value Footprint:");
+    Log::Print(Log::LOG_INFO, "VMValue:              %8u bytes", (Uint32)sizeof(VMValue));
+    Log::Print(Log::LOG_INFO, "Table entry:          %8u bytes", (Uint32)elementSize);
+    Log::Print(Log::LOG_INFO, "Thread stack:         %8u bytes (%u total)", (Uint32)stackSize,
+        (Uint32)(stackSize * (sizeof(ScriptManager::Threads) / sizeof(VMThread))));
+
+    // Walk the live heap and add up what's spent on value storage
+    size_t tableBytes = 0;
+    size_t slotBytes = 0;
+    size_t arrayBytes = 0;
+    size_t constantBytes = 0;
+    for (Obj* object = GarbageCollector::RootObject; object; object = object->Next) {
+        switch (object->Type) {
+            case OBJ_INSTANCE: {
+                ObjInstance* instance = (ObjInstance*)object;
+                slotBytes += instance->SlotCapacity * sizeof(VMValue);
+                if (instance->Fields)
+                    tableBytes += instance->Fields->Capacity * elementSize;
+                break;
+            }
+            case OBJ_CLASS:
+                tableBytes += ((ObjClass*)object)->Fields->Capacity * elementSize;
+                tableBytes += ((ObjClass*)object)->Methods->Capacity * elementSize;
+                break;
+            case OBJ_MAP:
+                tableBytes += ((ObjMap*)object)->Values->Capacity * elementSize;
+                break;
+            case OBJ_ARRAY:
+                arrayBytes += ((ObjArray*)object)->Values->capacity() * sizeof(VMValue);
+                break;
+            case OBJ_FUNCTION:
+                constantBytes += ((ObjFunction*)object)->Chunk.Constants->capacity() * sizeof(VMValue);
+                break;
+            default:
+                break;
+        }
+    }
+    if (ScriptManager::Globals)
+        tableBytes += ScriptManager::Globals->Capacity * elementSize;
+    if (ScriptManager::Constants)
+        tableBytes += ScriptManager::Constants->Capacity * elementSize;
+
+    Log::Print(Log::LOG_INFO, "Live tables:          %8u bytes", (Uint32)tableBytes);
+    Log::Print(Log::LOG_INFO, "Live instance slots:  %8u bytes", (Uint32)slotBytes);
+    Log::Print(Log::LOG_INFO, "Live arrays:          %8u bytes", (Uint32)arrayBytes);
+    Log::Print(Log::LOG_INFO, "Live constants:       %8u bytes", (Uint32)constantBytes);
+}
+
+PUBLIC STATIC void VMBenchmark::Run(int iterations) {
+    if (iterations <= 0)
+        iterations = DefaultIterations;
+
+#ifdef USING_VM_TAGGED_VALUES
+    Log::Print(Log::LOG_IMPORTANT, "VM Benchmark (tagged values, %d iterations):", iterations);
+#else
+    Log::Print(Log::LOG_IMPORTANT, "VM Benchmark (%d iterations):", iterations);
+#endif
+
+    // Keep the benchmark functions in a module so they're owned
+    // (and freed) the same way compiled ones are.
+    ObjModule* module = NewModule();
+    ScriptManager::ModuleList.push_back(module);
+
+    int loopStart, exitJump;
+    ObjFunction* function;
+    ObjFunction* optimized[BENCH_LOOP_COUNT];
+    const char* names[BENCH_LOOP_COUNT];
+    int bodyInstructions[BENCH_LOOP_COUNT];
+    int loop = 0;
+    double totalRate = 0.0;
+
+    // accumulator = (accumulator + counter) & 0xFFFF
+    function = BeginLoop(module, "IntegerArithmetic", iterations, INTEGER_VAL(0), NULL_VAL, &loopStart, &exitJump);
+    EmitLocal(function, OP_GET_LOCAL, BENCH_SLOT_ACCUMULATOR);
+    EmitLocal(function, OP_GET_LOCAL, BENCH_SLOT_COUNTER);
+    EmitByte(function, OP_ADD);
+    EmitConstant(function, INTEGER_VAL(0xFFFF));
+    EmitByte(function, OP_BW_AND);
+    EmitLocal(function, OP_SET_LOCAL, BENCH_SLOT_ACCUMULATOR);
+    EmitByte(function, OP_POP);
+    EndLoop(function, loopStart, exitJump);
+    names[loop] = "Integer arithmetic";
+    bodyInstructions[loop] = 7;
+    optimized[loop++] = OptimizeLoop(module, function);
+    totalRate += RunLoop(function, "Integer arithmetic", iterations, 7);
+
+    // accumulator = accumulator * 0.5 + 1.0
+    function = BeginLoop(module, "DecimalArithmetic", iterations, DECIMAL_VAL(0.0f), NULL_VAL, &loopStart, &exitJump);
+    EmitLocal(function, OP_GET_LOCAL, BENCH_SLOT_ACCUMULATOR);
+    EmitConstant(function, DECIMAL_VAL(0.5f));
+    EmitByte(function, OP_MULTIPLY);
+    EmitConstant(function, DECIMAL_VAL(1.0f));
+    EmitByte(function, OP_ADD);
+    EmitLocal(function, OP_SET_LOCAL, BENCH_SLOT_ACCUMULATOR);
+    EmitByte(function, OP_POP);
+    EndLoop(function, loopStart, exitJump);
+    names[loop] = "Decimal arithmetic";
+    bodyInstructions[loop] = 7;
+    optimized[loop++] = OptimizeLoop(module, function);
+    totalRate += RunLoop(function, "Decimal arithmetic", iterations, 7);
+
+    // accumulator = array[counter & 63]; array[counter & 63] = counter
+    ObjArray* array = NewArray();
+    for (int i = 0; i < 64; i++)
+        array->Values->push_back(INTEGER_VAL(i));
+
+    function = BeginLoop(module, "ArrayAccess", iterations, INTEGER_VAL(0), OBJECT_VAL(array), &loopStart, &exitJump);
+    EmitLocal(function, OP_GET_LOCAL, BENCH_SLOT_OBJECT);
+    EmitLocal(function, OP_GET_LOCAL, BENCH_SLOT_COUNTER);
+    EmitConstant(function, INTEGER_VAL(63));
+    EmitByte(function, OP_BW_AND);
+    EmitByte(function, OP_GET_ELEMENT);
+    EmitLocal(function, OP_SET_LOCAL, BENCH_SLOT_ACCUMULATOR);
+    EmitByte(function, OP_POP);
+    EmitLocal(function, OP_GET_LOCAL, BENCH_SLOT_OBJECT);
+    EmitLocal(function, OP_GET_LOCAL, BENCH_SLOT_COUNTER);
+    EmitConstant(function, INTEGER_VAL(63));
+    EmitByte(function, OP_BW_AND);
+    EmitLocal(function, OP_GET_LOCAL, BENCH_SLOT_COUNTER);
+    EmitByte(function, OP_SET_ELEMENT);
+    EmitByte(function, OP_POP);
+    EndLoop(function, loopStart, exitJump);
+    names[loop] = "Array access";
+    bodyInstructions[loop] = 14;
+    optimized[loop++] = OptimizeLoop(module, function);
+    totalRate += RunLoop(function, "Array access", iterations, 14);
+
+    // object.X = object.X + object.XSpeed
+    Uint32 hashX = Murmur::EncryptString("X");
+    Uint32 hashXSpeed = Murmur::EncryptString("XSpeed");
+    ObjClass* klass = NewClass(Murmur::EncryptString("BenchmarkObject"));
+    ObjInstance* instance = NewInstance(klass);
+    PutInstanceField(instance, "Y", DECIMAL_VAL(0.0f));
+    PutInstanceField(instance, hashX, DECIMAL_VAL(0.0f));
+    PutInstanceField(instance, hashXSpeed, DECIMAL_VAL(0.25f));
+
+    function = BeginLoop(module, "PropertyAccess", iterations, INTEGER_VAL(0), OBJECT_VAL(instance), &loopStart, &exitJump);
+    EmitLocal(function, OP_GET_LOCAL, BENCH_SLOT_OBJECT);
+    EmitLocal(function, OP_GET_LOCAL, BENCH_SLOT_OBJECT);
+    EmitProperty(function, OP_GET_PROPERTY, hashX);
+    EmitLocal(function, OP_GET_LOCAL, BENCH_SLOT_OBJECT);
+    EmitProperty(function, OP_GET_PROPERTY, hashXSpeed);
+    EmitByte(function, OP_ADD);
+    EmitProperty(function, OP_SET_PROPERTY, hashX);
+    EmitByte(function, OP_POP);
+    EndLoop(function, loopStart, exitJump);
+    names[loop] = "Property access";
+    bodyInstructions[loop] = 8;
+    optimized[loop++] = OptimizeLoop(module, function);
+    totalRate += RunLoop(function, "Property access", iterations, 8);
+
+    Log::Print(Log::LOG_INFO, "Average:             %9.2f M instructions/s", totalRate / BENCH_LOOP_COUNT);
+
+    // Same loops after constant folding and superinstructions. Rates still
+    // count the original instructions, so they compare directly.
+    Log::Print(Log::LOG_IMPORTANT, "Optimized bytecode:");
+    totalRate = 0.0;
+    for (int i = 0; i < BENCH_LOOP_COUNT; i++)
+        totalRate += RunLoop(optimized[i], names[i], iterations, bodyInstructions[i]);
+    Log::Print(Log::LOG_INFO, "Average:             %9.2f M instructions/s", totalRate / BENCH_LOOP_COUNT);
+
+    // The optimized loops again, translated for the register tier
+    // regardless of how hot they are.
+    Log::Print(Log::LOG_IMPORTANT, "Register tier:");
+    int lastMode = RegisterTier::Mode;
+    RegisterTier::SetMode(VM_TIER_REGISTER);
+    totalRate = 0.0;
+    for (int i = 0; i < BENCH_LOOP_COUNT; i++) {
+        if (!RegisterTier::Compile(optimized[i]))
+            Log::Print(Log::LOG_WARN, "%s could not be translated", names[i]);
+        totalRate += RunLoop(optimized[i], names[i], iterations, bodyInstructions[i]);
+    }
+    Log::Print(Log::LOG_INFO, "Average:             %9.2f M instructions/s", totalRate / BENCH_LOOP_COUNT);
+    RegisterTier::SetMode(lastMode);
+
+    PrintFootprint();
+}
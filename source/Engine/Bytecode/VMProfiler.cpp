@@ -0,0 +1,497 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Bytecode/Types.h>
+
+class VMProfiler {
+public:
+    static bool   Enabled;
+    static Uint64 InstructionCounts[8][0x100];
+    static char   OutputFilename[256];
+};
+#endif
+
+#include <Engine/Bytecode/VMProfiler.h>
+
+#include <Engine/Bytecode/ScriptManager.h>
+#include <Engine/Bytecode/VMThread.h>
+#include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/IO/FileStream.h>
+
+bool   VMProfiler::Enabled = false;
+Uint64 VMProfiler::InstructionCounts[8][0x100];
+char   VMProfiler::OutputFilename[256] = "profile.folded";
+
+// How many rows each table in the summary gets.
+#define PROFILER_SUMMARY_ROWS 20
+
+// Functions and natives form a call tree per thread. Every distinct
+// call path gets its own node, which is what the collapsed stack
+// output needs.
+struct ProfileNode {
+    void*        Key;
+    Uint32       Hash;
+    bool         IsNative;
+    char*        Name;
+    Uint32       Calls;
+    double       TotalTime;
+    double       SelfTime;
+    ProfileNode* Parent;
+    ProfileNode* FirstChild;
+    ProfileNode* Next;
+};
+struct ProfileEntry {
+    ProfileNode* Node;
+    Uint32       FrameIndex;
+    bool         IsNative;
+    double       Start;
+    double       ChildTime;
+};
+struct ProfileThread {
+    ProfileNode  Root;
+    // A native can sit between any two frames.
+    ProfileEntry Stack[FRAMES_MAX * 2 + 1];
+    int          Depth;
+};
+struct ProfileTotal {
+    const char* Name;
+    bool        IsNative;
+    Uint32      Calls;
+    double      TotalTime;
+    double      SelfTime;
+};
+
+static ProfileThread ProfileThreads[8];
+static double        ProfileStartTime = 0.0;
+static double        ProfileDuration = 0.0;
+
+// This must follow the existing opcode order.
+static const char* OpcodeNames[] = {
+    "OP_ERROR",
+    "OP_CONSTANT",
+    "OP_DEFINE_GLOBAL",
+    "OP_GET_PROPERTY",
+    "OP_SET_PROPERTY",
+    "OP_GET_GLOBAL",
+    "OP_SET_GLOBAL",
+    "OP_GET_LOCAL",
+    "OP_SET_LOCAL",
+    "OP_PRINT_STACK",
+    "OP_INHERIT",
+    "OP_RETURN",
+    "OP_METHOD",
+    "OP_CLASS",
+    "OP_CALL",
+    "OP_SUPER",
+    "OP_INVOKE",
+    "OP_JUMP",
+    "OP_JUMP_IF_FALSE",
+    "OP_JUMP_BACK",
+    "OP_POP",
+    "OP_COPY",
+    "OP_ADD",
+    "OP_SUBTRACT",
+    "OP_MULTIPLY",
+    "OP_DIVIDE",
+    "OP_MODULO",
+    "OP_NEGATE",
+    "OP_INCREMENT",
+    "OP_DECREMENT",
+    "OP_BITSHIFT_LEFT",
+    "OP_BITSHIFT_RIGHT",
+    "OP_NULL",
+    "OP_TRUE",
+    "OP_FALSE",
+    "OP_BW_NOT",
+    "OP_BW_AND",
+    "OP_BW_OR",
+    "OP_BW_XOR",
+    "OP_LG_NOT",
+    "OP_LG_AND",
+    "OP_LG_OR",
+    "OP_EQUAL",
+    "OP_EQUAL_NOT",
+    "OP_GREATER",
+    "OP_GREATER_EQUAL",
+    "OP_LESS",
+    "OP_LESS_EQUAL",
+    "OP_PRINT",
+    "OP_ENUM_NEXT",
+    "OP_SAVE_VALUE",
+    "OP_LOAD_VALUE",
+    "OP_WITH",
+    "OP_GET_ELEMENT",
+    "OP_SET_ELEMENT",
+    "OP_NEW_ARRAY",
+    "OP_NEW_MAP",
+    "OP_SWITCH_TABLE",
+    "OP_FAILSAFE",
+    "OP_EVENT",
+    "OP_TYPEOF",
+    "OP_NEW",
+    "OP_IMPORT",
+    "OP_SWITCH",
+    "OP_POPN",
+    "OP_HAS_PROPERTY",
+    "OP_IMPORT_MODULE",
+    "OP_ADD_ENUM",
+    "OP_NEW_ENUM",
+    "OP_GET_SUPERCLASS",
+    "OP_GET_MODULE_LOCAL",
+    "OP_SET_MODULE_LOCAL",
+    "OP_DEFINE_MODULE_LOCAL",
+    "OP_USE_NAMESPACE",
+    "OP_INCREMENT_LOCAL",
+    "OP_DECREMENT_LOCAL",
+    "OP_GET_LOCAL_PROPERTY",
+    "OP_JUMP_IF_LESS_LOCAL_CONST",
+};
+
+static char* CopyProfileName(const char* name) {
+    size_t length = strlen(name);
+    char* copy = (char*)Memory::TrackedMalloc("VMProfiler::Name", length + 1);
+    // Semicolons and spaces separate frames and counts in the output.
+    for (size_t i = 0; i < length; i++)
+        copy[i] = (name[i] == ';' || name[i] == ' ') ? '_' : name[i];
+    copy[length] = 0;
+    return copy;
+}
+static char* GetFunctionProfileName(ObjFunction* function) {
+    char name[256];
+    const char* functionName = VMThread::GetToken(function->NameHash);
+
+    if (function->ClassName)
+        snprintf(name, sizeof name, "%s::%s", function->ClassName->Chars, functionName);
+    else if (!strcmp(functionName, "main") && function->Module && function->Module->SourceFilename)
+        snprintf(name, sizeof name, "main(%s)", function->Module->SourceFilename->Chars);
+    else
+        snprintf(name, sizeof name, "%s", functionName);
+
+    return CopyProfileName(name);
+}
+static char* GetNativeProfileName(ObjNative* native) {
+    char name[256];
+
+    if (native->ClassName && native->Name)
+        snprintf(name, sizeof name, "%s.%s", native->ClassName->Chars, native->Name);
+    else if (native->Name)
+        snprintf(name, sizeof name, "%s", native->Name);
+    else
+        snprintf(name, sizeof name, "native@%p", (void*)native->Function);
+
+    return CopyProfileName(name);
+}
+
+static ProfileNode* GetChildNode(ProfileNode* parent, void* key, Uint32 hash, bool isNative) {
+    ProfileNode* previous = NULL;
+    for (ProfileNode* node = parent->FirstChild; node; node = node->Next) {
+        if (node->Key == key && node->Hash == hash && node->IsNative == isNative) {
+            // Keep hot children at the front of the list.
+            if (previous) {
+                previous->Next = node->Next;
+                node->Next = parent->FirstChild;
+                parent->FirstChild = node;
+            }
+            return node;
+        }
+        previous = node;
+    }
+
+    ProfileNode* node = (ProfileNode*)Memory::TrackedCalloc("VMProfiler::Node", 1, sizeof(ProfileNode));
+    node->Key = key;
+    node->Hash = hash;
+    node->IsNative = isNative;
+    node->Parent = parent;
+    node->Next = parent->FirstChild;
+    parent->FirstChild = node;
+    return node;
+}
+static void FreeChildNodes(ProfileNode* parent) {
+    ProfileNode* node = parent->FirstChild;
+    while (node) {
+        ProfileNode* next = node->Next;
+        FreeChildNodes(node);
+        Memory::Free(node->Name);
+        Memory::Free(node);
+        node = next;
+    }
+    parent->FirstChild = NULL;
+}
+
+static void PopEntry(ProfileThread* thread, double now) {
+    ProfileEntry* entry = &thread->Stack[--thread->Depth];
+    double elapsed = now - entry->Start;
+    entry->Node->TotalTime += elapsed;
+    entry->Node->SelfTime += elapsed - entry->ChildTime;
+    if (thread->Depth > 0)
+        thread->Stack[thread->Depth - 1].ChildTime += elapsed;
+}
+// Frames can be dropped without returning (runtime errors), so anything
+// deeper than the frame being entered or left gets closed first.
+static void PopStaleEntries(ProfileThread* thread, Uint32 frameIndex, double now) {
+    while (thread->Depth > 0) {
+        ProfileEntry* top = &thread->Stack[thread->Depth - 1];
+        if (top->FrameIndex < frameIndex || (top->FrameIndex == frameIndex && top->IsNative))
+            break;
+        PopEntry(thread, now);
+    }
+}
+static ProfileNode* PushEntry(ProfileThread* thread, void* key, Uint32 hash, bool isNative, Uint32 frameIndex, double now) {
+    if (thread->Depth == (int)(sizeof(thread->Stack) / sizeof(thread->Stack[0])))
+        return NULL;
+
+    ProfileNode* parent = thread->Depth > 0 ? thread->Stack[thread->Depth - 1].Node : &thread->Root;
+    ProfileNode* node = GetChildNode(parent, key, hash, isNative);
+    node->Calls++;
+
+    ProfileEntry* entry = &thread->Stack[thread->Depth++];
+    entry->Node = node;
+    entry->FrameIndex = frameIndex;
+    entry->IsNative = isNative;
+    entry->Start = now;
+    entry->ChildTime = 0.0;
+    return node;
+}
+
+PUBLIC STATIC void VMProfiler::Reset() {
+    for (int i = 0; i < 8; i++) {
+        FreeChildNodes(&ProfileThreads[i].Root);
+        ProfileThreads[i].Depth = 0;
+    }
+    memset(InstructionCounts, 0, sizeof(InstructionCounts));
+    ProfileDuration = 0.0;
+}
+PUBLIC STATIC void VMProfiler::Start() {
+    if (Enabled)
+        return;
+
+    Reset();
+    ProfileStartTime = Clock::GetTicks();
+    Enabled = true;
+    Log::Print(Log::LOG_INFO, "VM profiler started.");
+}
+PUBLIC STATIC void VMProfiler::Stop() {
+    if (!Enabled)
+        return;
+
+    Enabled = false;
+
+    // Whatever is still running gets its time up to now.
+    double now = Clock::GetTicks();
+    for (int i = 0; i < 8; i++) {
+        while (ProfileThreads[i].Depth > 0)
+            PopEntry(&ProfileThreads[i], now);
+    }
+    ProfileDuration = now - ProfileStartTime;
+    Log::Print(Log::LOG_INFO, "VM profiler stopped after %.3f ms.", ProfileDuration);
+}
+PUBLIC STATIC void VMProfiler::Toggle() {
+    if (Enabled) {
+        Stop();
+        PrintSummary();
+        Write(OutputFilename);
+    }
+    else {
+        Start();
+    }
+}
+
+// Called by VMThread::Call after the function's frame is pushed.
+PUBLIC STATIC void VMProfiler::EnterFunction(Uint32 threadID, Uint32 frameIndex, ObjFunction* function) {
+    ProfileThread* thread = &ProfileThreads[threadID];
+    double now = Clock::GetTicks();
+    PopStaleEntries(thread, frameIndex, now);
+
+    ProfileNode* node = PushEntry(thread, function, function->NameHash, false, frameIndex, now);
+    if (node && !node->Name)
+        node->Name = GetFunctionProfileName(function);
+}
+// Called by OP_RETURN before the function's frame is popped.
+PUBLIC STATIC void VMProfiler::ExitFunction(Uint32 threadID, Uint32 frameIndex) {
+    ProfileThread* thread = &ProfileThreads[threadID];
+    double now = Clock::GetTicks();
+    while (thread->Depth > 0 && thread->Stack[thread->Depth - 1].FrameIndex > frameIndex)
+        PopEntry(thread, now);
+
+    // Frames that were already running when profiling started
+    // have no entry.
+    if (thread->Depth > 0) {
+        ProfileEntry* top = &thread->Stack[thread->Depth - 1];
+        if (top->FrameIndex == frameIndex && !top->IsNative)
+            PopEntry(thread, now);
+    }
+}
+// Natives run on top of the caller's frame, at the index the next
+// frame would take.
+PUBLIC STATIC void VMProfiler::EnterNative(Uint32 threadID, Uint32 frameIndex, ObjNative* native) {
+    ProfileThread* thread = &ProfileThreads[threadID];
+    double now = Clock::GetTicks();
+    PopStaleEntries(thread, frameIndex, now);
+
+    ProfileNode* node = PushEntry(thread, native, 0, true, frameIndex, now);
+    if (node && !node->Name)
+        node->Name = GetNativeProfileName(native);
+}
+PUBLIC STATIC void VMProfiler::ExitNative(Uint32 threadID, Uint32 frameIndex) {
+    ProfileThread* thread = &ProfileThreads[threadID];
+    double now = Clock::GetTicks();
+    PopStaleEntries(thread, frameIndex, now);
+
+    if (thread->Depth > 0) {
+        ProfileEntry* top = &thread->Stack[thread->Depth - 1];
+        if (top->FrameIndex == frameIndex && top->IsNative)
+            PopEntry(thread, now);
+    }
+}
+
+static void WriteProfileNode(Stream* stream, ProfileNode* node, std::string& path) {
+    size_t pathLength = path.size();
+    if (pathLength)
+        path += ";";
+    path += node->Name ? node->Name : "?";
+
+    // Counts are in microseconds of self time.
+    Uint64 weight = (Uint64)(node->SelfTime * 1000.0 + 0.5);
+    if (weight) {
+        char count[32];
+        snprintf(count, sizeof count, " %llu\n", (unsigned long long)weight);
+        stream->WriteBytes((void*)path.c_str(), path.size());
+        stream->WriteBytes(count, strlen(count));
+    }
+
+    for (ProfileNode* child = node->FirstChild; child; child = child->Next)
+        WriteProfileNode(stream, child, path);
+
+    path.resize(pathLength);
+}
+// Writes the call tree in the collapsed stack format that flame graph
+// tools read: one line per call path, frames separated by semicolons,
+// followed by the self time in microseconds.
+PUBLIC STATIC bool VMProfiler::Write(const char* filename) {
+    Stream* stream;
+    if (strncmp(filename, "save://", 7) == 0)
+        stream = FileStream::New(filename + 7, FileStream::SAVEGAME_ACCESS | FileStream::WRITE_ACCESS);
+    else
+        stream = FileStream::New(filename, FileStream::WRITE_ACCESS);
+    if (!stream) {
+        Log::Print(Log::LOG_ERROR, "Could not open \"%s\" for writing the VM profile!", filename);
+        return false;
+    }
+
+    std::string path;
+    for (int i = 0; i < 8; i++) {
+        ProfileNode* root = &ProfileThreads[i].Root;
+        if (!root->FirstChild)
+            continue;
+
+        // Other threads get their own root frame.
+        if (i > 0) {
+            char name[THREAD_NAME_MAX + 16];
+            if (ScriptManager::Threads[i].Name[0])
+                snprintf(name, sizeof name, "%s", ScriptManager::Threads[i].Name);
+            else
+                snprintf(name, sizeof name, "Thread%d", i);
+            path = name;
+        }
+        else {
+            path.clear();
+        }
+
+        for (ProfileNode* child = root->FirstChild; child; child = child->Next)
+            WriteProfileNode(stream, child, path);
+    }
+
+    stream->Close();
+
+    Log::Print(Log::LOG_INFO, "Wrote VM profile to \"%s\".", filename);
+    return true;
+}
+
+static void AddProfileTotals(ProfileNode* node, std::vector<ProfileTotal>& totals) {
+    size_t index;
+    for (index = 0; index < totals.size(); index++) {
+        if (totals[index].IsNative == node->IsNative && !strcmp(totals[index].Name, node->Name))
+            break;
+    }
+    if (index == totals.size()) {
+        ProfileTotal total;
+        total.Name = node->Name;
+        total.IsNative = node->IsNative;
+        total.Calls = 0;
+        total.TotalTime = 0.0;
+        total.SelfTime = 0.0;
+        totals.push_back(total);
+    }
+
+    // Recursive calls are already part of the outermost call's total.
+    bool recursive = false;
+    for (ProfileNode* parent = node->Parent; parent && parent->Name; parent = parent->Parent) {
+        if (parent->IsNative == node->IsNative && !strcmp(parent->Name, node->Name)) {
+            recursive = true;
+            break;
+        }
+    }
+
+    totals[index].Calls += node->Calls;
+    totals[index].SelfTime += node->SelfTime;
+    if (!recursive)
+        totals[index].TotalTime += node->TotalTime;
+
+    for (ProfileNode* child = node->FirstChild; child; child = child->Next)
+        AddProfileTotals(child, totals);
+}
+PUBLIC STATIC void VMProfiler::PrintSummary() {
+    // Instructions
+    Uint64 counts[0x100];
+    Uint64 instructionTotal = 0;
+    memset(counts, 0, sizeof(counts));
+    for (int i = 0; i < 8; i++) {
+        for (int op = 0; op < 0x100; op++) {
+            counts[op] += InstructionCounts[i][op];
+            instructionTotal += InstructionCounts[i][op];
+        }
+    }
+
+    std::vector<int> opcodes;
+    for (int op = 0; op < 0x100; op++) {
+        if (counts[op])
+            opcodes.push_back(op);
+    }
+    std::sort(opcodes.begin(), opcodes.end(), [&counts](int a, int b) -> bool {
+        return counts[a] > counts[b];
+    });
+
+    Log::Print(Log::LOG_IMPORTANT, "VM Profile (%.3f ms, %llu instructions):", ProfileDuration, (unsigned long long)instructionTotal);
+    for (size_t i = 0; i < opcodes.size() && i < PROFILER_SUMMARY_ROWS; i++) {
+        int op = opcodes[i];
+        const char* name = op < (int)(sizeof(OpcodeNames) / sizeof(OpcodeNames[0])) ? OpcodeNames[op] : "(unknown)";
+        Log::Print(Log::LOG_INFO, "%-28s %12llu  %6.2f%%", name,
+            (unsigned long long)counts[op], counts[op] * 100.0 / instructionTotal);
+    }
+
+    // Functions and natives
+    std::vector<ProfileTotal> totals;
+    for (int i = 0; i < 8; i++) {
+        for (ProfileNode* child = ProfileThreads[i].Root.FirstChild; child; child = child->Next)
+            AddProfileTotals(child, totals);
+    }
+    std::sort(totals.begin(), totals.end(), [](const ProfileTotal& a, const ProfileTotal& b) -> bool {
+        return a.SelfTime > b.SelfTime;
+    });
+
+    for (int native = 0; native < 2; native++) {
+        Log::Print(Log::LOG_IMPORTANT, native ? "Native calls:" : "Script functions:");
+        Log::Print(Log::LOG_INFO, "%-40s %10s %12s %12s", "Name", "Calls", "Self (ms)", "Total (ms)");
+
+        int rows = 0;
+        for (size_t i = 0; i < totals.size() && rows < PROFILER_SUMMARY_ROWS; i++) {
+            if (totals[i].IsNative != !!native)
+                continue;
+
+            Log::Print(Log::LOG_INFO, "%-40s %10u %12.3f %12.3f", totals[i].Name,
+                totals[i].Calls, totals[i].SelfTime, totals[i].TotalTime);
+            rows++;
+        }
+    }
+}
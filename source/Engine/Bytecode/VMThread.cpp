@@ -36,7 +36,10 @@ public:
 #include <Engine/Bytecode/ScriptEntity.h>
 #include <Engine/Bytecode/ScriptManager.h>
 #include <Engine/Bytecode/Compiler.h>
+#include <Engine/Bytecode/GarbageCollector.h>
+#include <Engine/Bytecode/RegisterTier.h>
 #include <Engine/Bytecode/Values.h>
+#include <Engine/Bytecode/VMProfiler.h>
 #include <Engine/Diagnostics/Clock.h>
 
 #ifndef _MSC_VER
@@ -394,6 +397,10 @@ PUBLIC int     VMThread::RunInstruction() {
             VM_ADD_DISPATCH(OP_SET_MODULE_LOCAL),
             VM_ADD_DISPATCH(OP_DEFINE_MODULE_LOCAL),
             VM_ADD_DISPATCH(OP_USE_NAMESPACE),
+            VM_ADD_DISPATCH(OP_INCREMENT_LOCAL),
+            VM_ADD_DISPATCH(OP_DECREMENT_LOCAL),
+            VM_ADD_DISPATCH(OP_GET_LOCAL_PROPERTY),
+            VM_ADD_DISPATCH(OP_JUMP_IF_LESS_LOCAL_CONST),
             VM_ADD_DISPATCH_NULL(OP_SYNC),
         };
         #define VM_START(ins) goto *dispatch_table[(ins)];
@@ -411,6 +418,12 @@ PUBLIC int     VMThread::RunInstruction() {
     Uint8 instruction;
 
     frame = &Frames[FrameCount - 1];
+    // Profiled code stays on the stack interpreter, so that every
+    // instruction gets counted.
+    if (VMProfiler::Enabled)
+        VMProfiler::InstructionCounts[ID][*frame->IP]++;
+    else if (frame->Function->Chunk.Registers)
+        RunRegisterCode(frame);
     frame->IPLast = frame->IP;
 
     #ifdef VM_DEBUG_INSTRUCTIONS
@@ -490,6 +503,10 @@ PUBLIC int     VMThread::RunInstruction() {
                 PRINT_CASE(OP_SET_MODULE_LOCAL)
                 PRINT_CASE(OP_DEFINE_MODULE_LOCAL)
                 PRINT_CASE(OP_USE_NAMESPACE)
+                PRINT_CASE(OP_INCREMENT_LOCAL)
+                PRINT_CASE(OP_DECREMENT_LOCAL)
+                PRINT_CASE(OP_GET_LOCAL_PROPERTY)
+                PRINT_CASE(OP_JUMP_IF_LESS_LOCAL_CONST)
 
                 default:
                     Log::Print(Log::LOG_ERROR, "Unknown opcode %d\n", frame->IP); break;
@@ -539,7 +556,7 @@ PUBLIC int     VMThread::RunInstruction() {
 
                 VMValue LHS = ScriptManager::Globals->Get(hash);
                 VMValue value = Peek(0);
-                switch (LHS.Type) {
+                switch (VALUE_TYPE(LHS)) {
                     case VAL_LINKED_INTEGER: {
                         VMValue result = ScriptManager::CastValueAsInteger(value);
                         if (IS_NULL(result)) {
@@ -609,6 +626,11 @@ PUBLIC int     VMThread::RunInstruction() {
         }
 
         // Object Properties (heap)
+        VM_CASE(OP_GET_LOCAL_PROPERTY): {
+            // Push the local and fall through to OP_GET_PROPERTY
+            Uint8 slot = ReadByte(frame);
+            Push(frame->Slots[slot]);
+        }
         VM_CASE(OP_GET_PROPERTY): {
             Uint32 hash = ReadUInt32(frame);
 
@@ -620,15 +642,13 @@ PUBLIC int     VMThread::RunInstruction() {
                 ObjInstance* instance = AS_INSTANCE(object);
 
                 if (ScriptManager::Lock()) {
-                    // Fields have priority over methods
-                    if (instance->Fields->GetIfExists(hash, &result)) {
-                        Pop();
-                        Push(ScriptManager::DelinkValue(result));
+                    ObjClass* klass = instance->Object.Class;
+                    InlineCache* cache = GetInlineCache(frame);
+                    if (GetPropertyCached(cache, (Obj*)instance, klass, GetInstanceFieldCached(cache, instance, hash), hash, instance->PropertyGet)) {
                         ScriptManager::Unlock();
                         VM_BREAK;
                     }
 
-                    ObjClass* klass = instance->Object.Class;
                     if (GetProperty((Obj*)instance, klass, hash, false, instance->PropertyGet)) {
                         ScriptManager::Unlock();
                         VM_BREAK;
@@ -643,6 +663,12 @@ PUBLIC int     VMThread::RunInstruction() {
                 ObjClass* klass = AS_CLASS(object);
 
                 if (ScriptManager::Lock()) {
+                    InlineCache* cache = GetInlineCache(frame);
+                    if (GetPropertyCached(cache, (Obj*)klass, klass, GetTableFieldCached(cache, klass, klass->Fields, hash), hash, klass->PropertyGet)) {
+                        ScriptManager::Unlock();
+                        VM_BREAK;
+                    }
+
                     if (GetProperty((Obj*)klass, klass, hash)) {
                         ScriptManager::Unlock();
                         VM_BREAK;
@@ -673,6 +699,12 @@ PUBLIC int     VMThread::RunInstruction() {
                 ObjClass* klass = AS_OBJECT(object)->Class;
 
                 if (ScriptManager::Lock()) {
+                    InlineCache* cache = GetInlineCache(frame);
+                    if (GetPropertyCached(cache, (Obj*)klass, klass, GetTableFieldCached(cache, klass, klass->Fields, hash), hash, klass->PropertyGet)) {
+                        ScriptManager::Unlock();
+                        VM_BREAK;
+                    }
+
                     if (GetProperty((Obj*)klass, klass, hash)) {
                         ScriptManager::Unlock();
                         VM_BREAK;
@@ -697,10 +729,9 @@ PUBLIC int     VMThread::RunInstruction() {
         }
         VM_CASE(OP_SET_PROPERTY): {
             Uint32 hash = ReadUInt32(frame);
-            VMValue field;
             VMValue value;
             VMValue object;
-            Table* fields;
+            ObjInstance* instance = NULL;
             ObjClass* klass;
             Obj* objPtr;
             ValueSetFn setter = nullptr;
@@ -708,15 +739,13 @@ PUBLIC int     VMThread::RunInstruction() {
             object = Peek(1);
 
             if (IS_INSTANCE(object)) {
-                ObjInstance* instance = AS_INSTANCE(object);
+                instance = AS_INSTANCE(object);
                 klass = instance->Object.Class;
-                fields = instance->Fields;
                 setter = instance->PropertySet;
                 objPtr = (Obj*)instance;
             }
             else if (IS_CLASS(object)) {
                 klass = AS_CLASS(object);
-                fields = klass->Fields;
                 setter = klass->PropertySet;
                 objPtr = (Obj*)klass;
             }
@@ -736,15 +765,31 @@ PUBLIC int     VMThread::RunInstruction() {
             if (ScriptManager::Lock()) {
                 value = Pop();
 
-                if (fields->GetIfExists(hash, &field)) {
-                    if (!SetProperty(fields, hash, field, value))
+                InlineCache* cache = GetInlineCache(frame);
+                VMValue* field;
+                if (instance)
+                    field = GetInstanceFieldCached(cache, instance, hash);
+                else
+                    field = GetTableFieldCached(cache, klass, klass->Fields, hash);
+
+                if (field) {
+                    if (!SetField(field, value))
                         goto FAIL_OP_SET_PROPERTY;
                 }
                 else {
                     if (setter && setter(objPtr, hash, value, this->ID))
                         goto SUCCESS_OP_SET_PROPERTY;
 
-                    fields->Put(hash, value);
+                    GarbageCollector::WriteBarrier(value);
+                    if (instance) {
+                        PutInstanceField(instance, hash, value);
+                    }
+                    else {
+                        klass->Fields->Put(hash, value);
+
+                        // A new class field can shadow an inherited method
+                        ScriptManager::InvalidateInlineCaches();
+                    }
                 }
 
 SUCCESS_OP_SET_PROPERTY:
@@ -772,7 +817,7 @@ SUCCESS_OP_SET_PROPERTY:
 
                 if (ScriptManager::Lock()) {
                     // Fields have priority over methods
-                    if (instance->Fields->Exists(hash)) {
+                    if (GetInstanceField(instance, hash)) {
                         Pop();
                         Push(INTEGER_VAL(true));
                         ScriptManager::Unlock();
@@ -924,6 +969,7 @@ SUCCESS_OP_SET_PROPERTY:
                         if (ThrowRuntimeError(false, "Index %d is out of bounds of array of size %d.", index, (int)array->Values->size()) == ERROR_RES_CONTINUE)
                             goto FAIL_OP_SET_ELEMENT;
                     }
+                    GarbageCollector::WriteBarrier(value);
                     (*array->Values)[index] = value;
                     ScriptManager::Unlock();
                 }
@@ -942,6 +988,7 @@ SUCCESS_OP_SET_PROPERTY:
                             goto FAIL_OP_SET_ELEMENT;
                     }
 
+                    GarbageCollector::WriteBarrier(value);
                     map->Values->Put(index, value);
                     map->Keys->Put(index, StringUtils::Duplicate(index));
                     ScriptManager::Unlock();
@@ -1191,6 +1238,9 @@ SUCCESS_OP_SET_PROPERTY:
         VM_CASE(OP_RETURN): {
             InterpretResult = Pop();
 
+            if (VMProfiler::Enabled)
+                VMProfiler::ExitFunction(ID, FrameCount - 1);
+
             FrameCount--;
             if (FrameCount == ReturnFrame) {
                 return INTERPRET_FINISHED;
@@ -1222,6 +1272,51 @@ SUCCESS_OP_SET_PROPERTY:
             VM_BREAK;
         }
 
+        // Superinstructions
+        VM_CASE(OP_INCREMENT_LOCAL): {
+            Uint8 slot = ReadByte(frame);
+            VMValue value = frame->Slots[slot];
+            if (IS_INTEGER(value))
+                frame->Slots[slot] = INTEGER_VAL(AS_INTEGER(value) + 1);
+            else {
+                Push(value);
+                frame->Slots[slot] = Values_Increment();
+            }
+            VM_BREAK;
+        }
+        VM_CASE(OP_DECREMENT_LOCAL): {
+            Uint8 slot = ReadByte(frame);
+            VMValue value = frame->Slots[slot];
+            if (IS_INTEGER(value))
+                frame->Slots[slot] = INTEGER_VAL(AS_INTEGER(value) - 1);
+            else {
+                Push(value);
+                frame->Slots[slot] = Values_Decrement();
+            }
+            VM_BREAK;
+        }
+        VM_CASE(OP_JUMP_IF_LESS_LOCAL_CONST): {
+            // GET_LOCAL, CONSTANT, LESS, JUMP_IF_FALSE in one go;
+            // the result stays on the stack just like it would have.
+            Uint8 slot = ReadByte(frame);
+            VMValue constant = ReadConstant(frame);
+            Sint32 offset = ReadSInt16(frame);
+            VMValue value = frame->Slots[slot];
+            VMValue result;
+            if (IS_INTEGER(value) && IS_INTEGER(constant))
+                result = INTEGER_VAL(AS_INTEGER(value) < AS_INTEGER(constant));
+            else {
+                Push(value);
+                Push(constant);
+                result = Values_LessThan();
+            }
+            Push(result);
+            if (ScriptManager::ValueFalsey(result)) {
+                frame->IP += offset;
+            }
+            VM_BREAK;
+        }
+
         // Numeric Operations
         VM_CASE(OP_ADD):            Push(Values_Plus());  VM_BREAK;
         VM_CASE(OP_SUBTRACT):       Push(Values_Minus());  VM_BREAK;
@@ -1273,7 +1368,7 @@ SUCCESS_OP_SET_PROPERTY:
                 case WITH_STATE_INIT:
                 case WITH_STATE_INIT_SLOTTED: {
                     VMValue receiver = Peek(0);
-                    if (receiver.Type == VAL_NULL) {
+                    if (VALUE_TYPE(receiver) == VAL_NULL) {
                         frame->IP += offset;
                         Pop(); // pop receiver
                         break;
@@ -1458,7 +1553,7 @@ SUCCESS_OP_SET_PROPERTY:
             VMValue receiver = Peek(argCount);
             VMValue result;
             if (IS_INSTANCE(receiver)) {
-                if (!InvokeForInstance(hash, argCount, isSuper)) {
+                if (!InvokeForInstance(hash, argCount, isSuper, frame)) {
                     if (ThrowRuntimeError(false, "Could not invoke %s!", GetVariableOrMethodName(hash)) == ERROR_RES_CONTINUE)
                         goto FAIL_OP_INVOKE;
 
@@ -1470,7 +1565,7 @@ SUCCESS_OP_SET_PROPERTY:
             }
             else if (IS_CLASS(receiver)) {
                 ObjClass* klass = AS_CLASS(receiver);
-                if (klass->Methods->GetIfExists(hash, &result)) {
+                if (FindMethodCached(frame, klass, hash, &result)) {
                     if (!CallValue(result, argCount)) {
                         if (ThrowRuntimeError(false, "Could not invoke %s!", GetVariableOrMethodName(hash)) == ERROR_RES_CONTINUE)
                             goto FAIL_OP_INVOKE;
@@ -1492,7 +1587,7 @@ SUCCESS_OP_SET_PROPERTY:
                     goto FAIL_OP_INVOKE;
                 }
 
-                if (klass->Methods->GetIfExists(hash, &result)) {
+                if (FindMethodCached(frame, klass, hash, &result)) {
                     if (!CallForObject(result, argCount)) {
                         if (ThrowRuntimeError(false, "Could not invoke %s!", GetVariableOrMethodName(hash)) == ERROR_RES_CONTINUE)
                             goto FAIL_OP_INVOKE;
@@ -1536,6 +1631,7 @@ SUCCESS_OP_SET_PROPERTY:
             ObjClass* klass = AS_CLASS(Peek(0));
             Uint32 hashSuper = ReadUInt32(frame);
             klass->ParentHash = hashSuper;
+            ScriptManager::InvalidateInlineCaches();
             VM_BREAK;
         }
         VM_CASE(OP_NEW): {
@@ -1621,6 +1717,7 @@ SUCCESS_OP_SET_PROPERTY:
 
             if (ScriptManager::Lock()) {
                 VMValue value = Pop();
+                GarbageCollector::WriteBarrier(value);
                 enumeration->Fields->Put(hash, value);
                 Pop();
                 Push(value);
@@ -1686,11 +1783,14 @@ SUCCESS_OP_SET_PROPERTY:
         }
         VM_CASE(OP_SET_MODULE_LOCAL): {
             Uint16 slot = ReadUInt16(frame);
-            if (slot < frame->Module->Locals->size())
+            if (slot < frame->Module->Locals->size()) {
+                GarbageCollector::WriteBarrier(Peek(0));
                 (*frame->Module->Locals)[slot] = Peek(0);
+            }
             VM_BREAK;
         }
         VM_CASE(OP_DEFINE_MODULE_LOCAL): {
+            GarbageCollector::WriteBarrier(Peek(0));
             frame->Module->Locals->push_back(Pop());
             VM_BREAK;
         }
@@ -1763,6 +1863,371 @@ SUCCESS_OP_SET_PROPERTY:
 
     return INTERPRET_OK;
 }
+
+// #region Register Tier
+#define REG_OPERAND_B (ins->Kinds & REG_B_CONSTANT ? constants[ins->B] : registers[ins->B])
+#define REG_OPERAND_C (ins->Kinds & REG_C_CONSTANT ? constants[ins->C] : registers[ins->C])
+
+// Anything without a fast path goes through the same functions the
+// stack interpreter uses, pushed above the frame's live slots.
+#define REG_GENERIC_UNARY(fn) \
+    frame->IPLast = frame->IPStart + ins->Offset; \
+    StackTop = registers + ins->Depth; \
+    Push(a); \
+    result = fn()
+#define REG_GENERIC_BINARY(fn) \
+    frame->IPLast = frame->IPStart + ins->Offset; \
+    StackTop = registers + ins->Depth; \
+    Push(a); \
+    Push(b); \
+    result = fn()
+
+#define REG_ARITHMETIC(op, fn) \
+    if (IS_INTEGER(a) && IS_INTEGER(b)) \
+        result = INTEGER_VAL(AS_INTEGER(a) op AS_INTEGER(b)); \
+    else if (IS_DECIMAL(a) && IS_DECIMAL(b)) \
+        result = DECIMAL_VAL(AS_DECIMAL(a) op AS_DECIMAL(b)); \
+    else { \
+        REG_GENERIC_BINARY(fn); \
+    }
+#define REG_INTEGER_ONLY(op, fn) \
+    if (IS_INTEGER(a) && IS_INTEGER(b)) \
+        result = INTEGER_VAL(AS_INTEGER(a) op AS_INTEGER(b)); \
+    else { \
+        REG_GENERIC_BINARY(fn); \
+    }
+#define REG_COMPARE(op, fn) \
+    if (IS_INTEGER(a) && IS_INTEGER(b)) \
+        result = INTEGER_VAL(AS_INTEGER(a) op AS_INTEGER(b)); \
+    else if (IS_DECIMAL(a) && IS_DECIMAL(b)) \
+        result = INTEGER_VAL(AS_DECIMAL(a) op AS_DECIMAL(b)); \
+    else { \
+        REG_GENERIC_BINARY(fn); \
+    }
+#define REG_EQUALITY(equal) \
+    if (IS_INTEGER(a) && IS_INTEGER(b)) \
+        result = INTEGER_VAL((AS_INTEGER(a) == AS_INTEGER(b)) == equal); \
+    else \
+        result = INTEGER_VAL(ScriptManager::ValuesSortaEqual(a, b) == equal)
+
+// Runs the frame's register tier code from where the stack interpreter
+// is, if it can be handed over there, until the next instruction only
+// the stack interpreter can run.
+PRIVATE void    VMThread::RunRegisterCode(CallFrame* frame) {
+    RegisterChunk* chunk = frame->Function->Chunk.Registers;
+    RegisterEntry* entry = &chunk->Entries[frame->IP - frame->IPStart];
+
+    // The depth won't match if an error was ignored partway through
+    // an instruction; the stack interpreter keeps the frame then.
+    if (entry->Index < 0 || StackTop != frame->Slots + entry->Depth)
+        return;
+
+    RegisterInstruction* code = chunk->Code;
+    RegisterInstruction* ins = code + entry->Index;
+    VMValue* registers = frame->Slots;
+    VMValue* constants = chunk->Constants;
+    VMValue a, b, result;
+
+    #ifdef USING_VM_DISPATCH_TABLE
+        #define REG_ADD_DISPATCH(op) &&REG_START_ ## op
+        // This must follow the existing register opcode order.
+        static const void* dispatch_table[] = {
+            REG_ADD_DISPATCH(REG_MOVE),
+            REG_ADD_DISPATCH(REG_ADD),
+            REG_ADD_DISPATCH(REG_SUBTRACT),
+            REG_ADD_DISPATCH(REG_MULTIPLY),
+            REG_ADD_DISPATCH(REG_DIVIDE),
+            REG_ADD_DISPATCH(REG_MODULO),
+            REG_ADD_DISPATCH(REG_BITSHIFT_LEFT),
+            REG_ADD_DISPATCH(REG_BITSHIFT_RIGHT),
+            REG_ADD_DISPATCH(REG_BW_AND),
+            REG_ADD_DISPATCH(REG_BW_OR),
+            REG_ADD_DISPATCH(REG_BW_XOR),
+            REG_ADD_DISPATCH(REG_LG_AND),
+            REG_ADD_DISPATCH(REG_LG_OR),
+            REG_ADD_DISPATCH(REG_EQUAL),
+            REG_ADD_DISPATCH(REG_EQUAL_NOT),
+            REG_ADD_DISPATCH(REG_GREATER),
+            REG_ADD_DISPATCH(REG_GREATER_EQUAL),
+            REG_ADD_DISPATCH(REG_LESS),
+            REG_ADD_DISPATCH(REG_LESS_EQUAL),
+            REG_ADD_DISPATCH(REG_NEGATE),
+            REG_ADD_DISPATCH(REG_BW_NOT),
+            REG_ADD_DISPATCH(REG_LG_NOT),
+            REG_ADD_DISPATCH(REG_INCREMENT),
+            REG_ADD_DISPATCH(REG_DECREMENT),
+            REG_ADD_DISPATCH(REG_SAVE_VALUE),
+            REG_ADD_DISPATCH(REG_LOAD_VALUE),
+            REG_ADD_DISPATCH(REG_JUMP),
+            REG_ADD_DISPATCH(REG_JUMP_IF_FALSE),
+            REG_ADD_DISPATCH(REG_JUMP_IF_NOT_EQUAL),
+            REG_ADD_DISPATCH(REG_JUMP_IF_NOT_EQUAL_NOT),
+            REG_ADD_DISPATCH(REG_JUMP_IF_NOT_GREATER),
+            REG_ADD_DISPATCH(REG_JUMP_IF_NOT_GREATER_EQUAL),
+            REG_ADD_DISPATCH(REG_JUMP_IF_NOT_LESS),
+            REG_ADD_DISPATCH(REG_JUMP_IF_NOT_LESS_EQUAL),
+            REG_ADD_DISPATCH(REG_FALLBACK),
+        };
+        #define REG_START(op) goto *dispatch_table[(op)];
+        #define REG_CASE(n) REG_START_ ## n
+        #define REG_DISPATCH() goto *dispatch_table[ins->Op]
+    #else
+        #define REG_START(op) switch ((op))
+        #define REG_CASE(n) case n
+        #define REG_DISPATCH() continue
+    #endif
+    #define REG_NEXT() ins++; REG_DISPATCH()
+    #define REG_TAKE_JUMP() ins = code + ins->Target; REG_DISPATCH()
+
+    for (;;) {
+        REG_START(ins->Op) {
+            REG_CASE(REG_MOVE):
+                registers[ins->A] = REG_OPERAND_B;
+                REG_NEXT();
+
+            // Numeric Operations
+            REG_CASE(REG_ADD):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_ARITHMETIC(+, Values_Plus);
+                registers[ins->A] = result;
+                REG_NEXT();
+            REG_CASE(REG_SUBTRACT):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_ARITHMETIC(-, Values_Minus);
+                registers[ins->A] = result;
+                REG_NEXT();
+            REG_CASE(REG_MULTIPLY):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_ARITHMETIC(*, Values_Multiply);
+                registers[ins->A] = result;
+                REG_NEXT();
+            REG_CASE(REG_DIVIDE):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                if (IS_INTEGER(a) && IS_INTEGER(b) && AS_INTEGER(b) != 0)
+                    result = INTEGER_VAL(AS_INTEGER(a) / AS_INTEGER(b));
+                else if (IS_DECIMAL(a) && IS_DECIMAL(b) && AS_DECIMAL(b) != 0.0f)
+                    result = DECIMAL_VAL(AS_DECIMAL(a) / AS_DECIMAL(b));
+                else {
+                    REG_GENERIC_BINARY(Values_Division);
+                }
+                registers[ins->A] = result;
+                REG_NEXT();
+            REG_CASE(REG_MODULO):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                if (IS_INTEGER(a) && IS_INTEGER(b) && AS_INTEGER(b) != 0)
+                    result = INTEGER_VAL(AS_INTEGER(a) % AS_INTEGER(b));
+                else {
+                    REG_GENERIC_BINARY(Values_Modulo);
+                }
+                registers[ins->A] = result;
+                REG_NEXT();
+            // Bit Operations
+            REG_CASE(REG_BITSHIFT_LEFT):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_INTEGER_ONLY(<<, Values_BitwiseLeft);
+                registers[ins->A] = result;
+                REG_NEXT();
+            REG_CASE(REG_BITSHIFT_RIGHT):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_INTEGER_ONLY(>>, Values_BitwiseRight);
+                registers[ins->A] = result;
+                REG_NEXT();
+            // Bitwise Operations
+            REG_CASE(REG_BW_AND):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_INTEGER_ONLY(&, Values_BitwiseAnd);
+                registers[ins->A] = result;
+                REG_NEXT();
+            REG_CASE(REG_BW_OR):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_INTEGER_ONLY(|, Values_BitwiseOr);
+                registers[ins->A] = result;
+                REG_NEXT();
+            REG_CASE(REG_BW_XOR):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_INTEGER_ONLY(^, Values_BitwiseXor);
+                registers[ins->A] = result;
+                REG_NEXT();
+            // Logical Operations
+            REG_CASE(REG_LG_AND):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_INTEGER_ONLY(&&, Values_LogicalAND);
+                registers[ins->A] = result;
+                REG_NEXT();
+            REG_CASE(REG_LG_OR):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_INTEGER_ONLY(||, Values_LogicalOR);
+                registers[ins->A] = result;
+                REG_NEXT();
+            // Equality and Comparison Operators
+            REG_CASE(REG_EQUAL):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_EQUALITY(true);
+                registers[ins->A] = result;
+                REG_NEXT();
+            REG_CASE(REG_EQUAL_NOT):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_EQUALITY(false);
+                registers[ins->A] = result;
+                REG_NEXT();
+            REG_CASE(REG_GREATER):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_COMPARE(>, Values_GreaterThan);
+                registers[ins->A] = result;
+                REG_NEXT();
+            REG_CASE(REG_GREATER_EQUAL):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_COMPARE(>=, Values_GreaterThanOrEqual);
+                registers[ins->A] = result;
+                REG_NEXT();
+            REG_CASE(REG_LESS):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_COMPARE(<, Values_LessThan);
+                registers[ins->A] = result;
+                REG_NEXT();
+            REG_CASE(REG_LESS_EQUAL):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_COMPARE(<=, Values_LessThanOrEqual);
+                registers[ins->A] = result;
+                REG_NEXT();
+            // Unary Operations
+            REG_CASE(REG_NEGATE):
+                a = REG_OPERAND_B;
+                if (IS_INTEGER(a))
+                    result = INTEGER_VAL(-AS_INTEGER(a));
+                else if (IS_DECIMAL(a))
+                    result = DECIMAL_VAL(-AS_DECIMAL(a));
+                else {
+                    REG_GENERIC_UNARY(Values_Negate);
+                }
+                registers[ins->A] = result;
+                REG_NEXT();
+            REG_CASE(REG_BW_NOT):
+                a = REG_OPERAND_B;
+                if (IS_INTEGER(a))
+                    result = INTEGER_VAL(~AS_INTEGER(a));
+                else {
+                    REG_GENERIC_UNARY(Values_BitwiseNOT);
+                }
+                registers[ins->A] = result;
+                REG_NEXT();
+            REG_CASE(REG_LG_NOT):
+                a = REG_OPERAND_B;
+                if (IS_INTEGER(a))
+                    result = INTEGER_VAL(!AS_INTEGER(a));
+                else {
+                    REG_GENERIC_UNARY(Values_LogicalNOT);
+                }
+                registers[ins->A] = result;
+                REG_NEXT();
+            REG_CASE(REG_INCREMENT):
+                a = REG_OPERAND_B;
+                if (IS_INTEGER(a))
+                    result = INTEGER_VAL(AS_INTEGER(a) + 1);
+                else if (IS_DECIMAL(a))
+                    result = DECIMAL_VAL(AS_DECIMAL(a) + 1.0f);
+                else {
+                    REG_GENERIC_UNARY(Values_Increment);
+                }
+                registers[ins->A] = result;
+                REG_NEXT();
+            REG_CASE(REG_DECREMENT):
+                a = REG_OPERAND_B;
+                if (IS_INTEGER(a))
+                    result = INTEGER_VAL(AS_INTEGER(a) - 1);
+                else if (IS_DECIMAL(a))
+                    result = DECIMAL_VAL(AS_DECIMAL(a) - 1.0f);
+                else {
+                    REG_GENERIC_UNARY(Values_Decrement);
+                }
+                registers[ins->A] = result;
+                REG_NEXT();
+
+            REG_CASE(REG_SAVE_VALUE):
+                RegisterValue = REG_OPERAND_B;
+                REG_NEXT();
+            REG_CASE(REG_LOAD_VALUE):
+                registers[ins->A] = RegisterValue;
+                REG_NEXT();
+
+            // Jumping
+            REG_CASE(REG_JUMP):
+                REG_TAKE_JUMP();
+            REG_CASE(REG_JUMP_IF_FALSE):
+                if (ScriptManager::ValueFalsey(REG_OPERAND_B)) {
+                    REG_TAKE_JUMP();
+                }
+                REG_NEXT();
+            REG_CASE(REG_JUMP_IF_NOT_EQUAL):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_EQUALITY(true);
+                goto COMPARE_JUMP;
+            REG_CASE(REG_JUMP_IF_NOT_EQUAL_NOT):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_EQUALITY(false);
+                goto COMPARE_JUMP;
+            REG_CASE(REG_JUMP_IF_NOT_GREATER):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_COMPARE(>, Values_GreaterThan);
+                goto COMPARE_JUMP;
+            REG_CASE(REG_JUMP_IF_NOT_GREATER_EQUAL):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_COMPARE(>=, Values_GreaterThanOrEqual);
+                goto COMPARE_JUMP;
+            REG_CASE(REG_JUMP_IF_NOT_LESS):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_COMPARE(<, Values_LessThan);
+                goto COMPARE_JUMP;
+            REG_CASE(REG_JUMP_IF_NOT_LESS_EQUAL):
+                a = REG_OPERAND_B;
+                b = REG_OPERAND_C;
+                REG_COMPARE(<=, Values_LessThanOrEqual);
+            COMPARE_JUMP:
+                // The result stays in its slot, like it would on the stack.
+                registers[ins->A] = result;
+                if (!AS_INTEGER(result)) {
+                    REG_TAKE_JUMP();
+                }
+                REG_NEXT();
+
+            REG_CASE(REG_FALLBACK):
+                frame->IP = frame->IPStart + ins->Offset;
+                StackTop = registers + ins->Depth;
+                return;
+        }
+    }
+
+    #undef REG_START
+    #undef REG_CASE
+    #undef REG_DISPATCH
+    #undef REG_NEXT
+    #undef REG_TAKE_JUMP
+}
+// #endregion
+
 PUBLIC void    VMThread::RunInstructionSet() {
     while (true) {
         // if (!ScriptManager::Lock()) break;
@@ -1936,23 +2401,6 @@ PRIVATE bool   VMThread::HasProperty(Obj* object, ObjClass* klass, Uint32 hash,
 PRIVATE bool   VMThread::HasProperty(Obj* object, ObjClass* klass, Uint32 hash) {
     return HasProperty(object, klass, true);
 }
-PRIVATE bool   VMThread::SetProperty(Table* fields, Uint32 hash, VMValue field, VMValue value) {
-    switch (field.Type) {
-        case VAL_LINKED_INTEGER:
-            if (!ScriptManager::DoIntegerConversion(value, this->ID))
-                return false;
-            AS_LINKED_INTEGER(field) = AS_INTEGER(value);
-            break;
-        case VAL_LINKED_DECIMAL:
-            if (!ScriptManager::DoDecimalConversion(value, this->ID))
-                return false;
-            AS_LINKED_DECIMAL(field) = AS_DECIMAL(value);
-            break;
-        default:
-            fields->Put(hash, value);
-    }
-    return true;
-}
 PRIVATE bool   VMThread::BindMethod(VMValue receiver, VMValue method) {
     ObjBoundMethod* bound = NewBoundMethod(receiver, AS_FUNCTION(method));
     Push(OBJECT_VAL(bound));
@@ -1977,6 +2425,9 @@ PRIVATE bool   VMThread::CallValue(VMValue callee, int argCount) {
             case OBJ_NATIVE: {
                 NativeFn nativeFn = AS_NATIVE(callee);
 
+                if (VMProfiler::Enabled)
+                    VMProfiler::EnterNative(ID, FrameCount, (ObjNative*)AS_OBJECT(callee));
+
                 VMValue returnValue = NULL_VAL;
                 try {
                     returnValue = nativeFn(argCount, StackTop - argCount, ID);
@@ -1985,6 +2436,9 @@ PRIVATE bool   VMThread::CallValue(VMValue callee, int argCount) {
                     (void)err;
                 }
 
+                if (VMProfiler::Enabled)
+                    VMProfiler::ExitNative(ID, FrameCount);
+
                 StackTop -= argCount; // Pop arguments
                 StackTop -= 1; // Pop receiver / class
                 Push(returnValue); // Push result
@@ -2006,6 +2460,9 @@ PRIVATE bool   VMThread::CallForObject(VMValue callee, int argCount) {
         if (OBJECT_TYPE(callee) == OBJ_NATIVE) {
             NativeFn native = AS_NATIVE(callee);
 
+            if (VMProfiler::Enabled)
+                VMProfiler::EnterNative(ID, FrameCount, (ObjNative*)AS_OBJECT(callee));
+
             VMValue returnValue = NULL_VAL;
             try {
                 // Calling a native function for an object needs to correctly pass the
@@ -2016,6 +2473,9 @@ PRIVATE bool   VMThread::CallForObject(VMValue callee, int argCount) {
                 (void)err;
             }
 
+            if (VMProfiler::Enabled)
+                VMProfiler::ExitNative(ID, FrameCount);
+
             StackTop -= argCount; // Pop arguments
             StackTop -= 1; // Pop receiver / class
             Push(returnValue); // Push returned value
@@ -2093,28 +2553,39 @@ PUBLIC bool    VMThread::Call(ObjFunction* function, int argCount) {
     frame->WithIteratorStackTop = frame->WithIteratorStack;
     frame->Module = function->Module;
 
+    if (VMProfiler::Enabled)
+        VMProfiler::EnterFunction(ID, FrameCount - 1, function);
+
+    // Hot functions move to the register tier.
+    if (function->CallCount <= RegisterTier::Threshold && function->CallCount++ == RegisterTier::Threshold)
+        RegisterTier::Compile(function);
+
     return true;
 }
-PUBLIC bool    VMThread::InvokeFromClass(ObjClass* klass, Uint32 hash, int argCount) {
+// The call site's inline cache is looked up under the same lock as it's
+// used, since another thread can grow the chunk's caches in between.
+PUBLIC bool    VMThread::InvokeFromClass(ObjClass* klass, Uint32 hash, int argCount, CallFrame* frame) {
+    VMValue method;
+    bool found = false;
     if (ScriptManager::Lock()) {
-        VMValue method;
-        if (klass->Methods->GetIfExists(hash, &method)) {
-            // Found the method, so just call it
-            return CallForObject(method, argCount);
-        }
-        else {
-            // If there is a parent class, walk up the inheritance chain until we find the method.
-            ObjClass* parentClass = ScriptManager::GetClassParent(klass);
-            if (parentClass) {
-                ScriptManager::Unlock();
-                return InvokeFromClass(parentClass, hash, argCount);
-            }
+        InlineCache* cache = frame ? GetInlineCache(frame) : NULL;
+        found = GetCachedMethod(cache, klass, &method);
+        if (!found && FindMethod(klass, hash, true, &method)) {
+            AddCacheEntry(cache, klass, NULL, -1, method);
+            found = true;
         }
         ScriptManager::Unlock();
     }
+
+    // Found the method, so just call it
+    if (found)
+        return CallForObject(method, argCount);
     return false;
 }
-PUBLIC bool    VMThread::InvokeForInstance(Uint32 hash, int argCount, bool isSuper) {
+PUBLIC bool    VMThread::InvokeFromClass(ObjClass* klass, Uint32 hash, int argCount) {
+    return InvokeFromClass(klass, hash, argCount, NULL);
+}
+PUBLIC bool    VMThread::InvokeForInstance(Uint32 hash, int argCount, bool isSuper, CallFrame* frame) {
     ObjInstance* instance = AS_INSTANCE(Peek(argCount));
     ObjClass* klass = instance->Object.Class;
 
@@ -2123,7 +2594,11 @@ PUBLIC bool    VMThread::InvokeForInstance(Uint32 hash, int argCount, bool isSup
         VMValue value;
         bool exists = false;
         if (ScriptManager::Lock()) {
-            exists = instance->Fields->GetIfExists(hash, &value);
+            VMValue* field = GetInstanceField(instance, hash);
+            if (field) {
+                value = *field;
+                exists = true;
+            }
             ScriptManager::Unlock();
         }
         if (exists) {
@@ -2133,29 +2608,216 @@ PUBLIC bool    VMThread::InvokeForInstance(Uint32 hash, int argCount, bool isSup
     else {
         ObjClass* parentClass = ScriptManager::GetClassParent(klass);
         if (parentClass)
-            return InvokeFromClass(parentClass, hash, argCount);
+            return InvokeFromClass(parentClass, hash, argCount, frame);
         else
             ThrowRuntimeError(false, "Instance's class does not have a parent to call method from.");
         return false;
     }
-    return InvokeFromClass(klass, hash, argCount);
+    return InvokeFromClass(klass, hash, argCount, frame);
+}
+PUBLIC bool    VMThread::InvokeForInstance(Uint32 hash, int argCount, bool isSuper) {
+    return InvokeForInstance(hash, argCount, isSuper, NULL);
 }
 PRIVATE bool   VMThread::DoClassExtension(VMValue value, VMValue originalValue, bool clearSrc) {
     ObjClass* src = AS_CLASS(value);
     ObjClass* dst = AS_CLASS(originalValue);
 
     src->Methods->WithAll([dst](Uint32 hash, VMValue value) -> void {
+        GarbageCollector::WriteBarrier(value);
         dst->Methods->Put(hash, value);
     });
     if (clearSrc)
         src->Methods->Clear();
 
     src->Fields->WithAll([dst](Uint32 hash, VMValue value) -> void {
+        GarbageCollector::WriteBarrier(value);
         dst->Fields->Put(hash, value);
     });
     if (clearSrc)
         src->Fields->Clear();
 
+    ScriptManager::InvalidateInlineCaches();
+
+    return true;
+}
+
+// Inline caches
+PRIVATE InlineCache* VMThread::GetInlineCache(CallFrame* frame) {
+    // Sites are told apart by where their operands end.
+    return frame->Function->Chunk.GetInlineCache((int)(frame->IP - frame->IPStart));
+}
+PRIVATE int    VMThread::GetCachedFieldSlot(InlineCache* cache, ObjClass* klass, Table* fields, Uint32 hash) {
+    if (!cache)
+        return -1;
+
+    for (int i = 0; i < INLINE_CACHE_ENTRIES; i++) {
+        InlineCacheEntry* entry = &cache->Entries[i];
+        if (entry->Class != klass || entry->Shape || entry->Slot < 0)
+            continue;
+
+        // The slot is checked every time, so a table that grew
+        // or was laid out differently just misses.
+        int slot = entry->Slot;
+        if (slot < fields->Capacity && fields->Data[slot].Used && fields->Data[slot].Key == hash)
+            return slot;
+    }
+    return -1;
+}
+PRIVATE int    VMThread::GetCachedShapeSlot(InlineCache* cache, ClassShape* shape) {
+    if (!cache)
+        return -1;
+
+    for (int i = 0; i < INLINE_CACHE_ENTRIES; i++) {
+        InlineCacheEntry* entry = &cache->Entries[i];
+        if (entry->Shape == shape && entry->Epoch == ScriptManager::InlineCacheEpoch)
+            return entry->Slot;
+    }
+    return -1;
+}
+PRIVATE bool   VMThread::GetCachedMethod(InlineCache* cache, ObjClass* klass, VMValue* result) {
+    if (!cache)
+        return false;
+
+    for (int i = 0; i < INLINE_CACHE_ENTRIES; i++) {
+        InlineCacheEntry* entry = &cache->Entries[i];
+        if (entry->Class == klass && entry->Slot < 0 && entry->Epoch == ScriptManager::InlineCacheEpoch) {
+            *result = entry->Method;
+            return true;
+        }
+    }
+    return false;
+}
+PRIVATE void   VMThread::AddCacheEntry(InlineCache* cache, ObjClass* klass, ClassShape* shape, int slot, VMValue method) {
+    if (!cache)
+        return;
+
+    InlineCacheEntry* entry = &cache->Entries[cache->Next];
+    cache->Next = (cache->Next + 1) % INLINE_CACHE_ENTRIES;
+
+    entry->Class = klass;
+    entry->Shape = shape;
+    entry->Epoch = ScriptManager::InlineCacheEpoch;
+    entry->Slot = slot;
+    entry->Method = method;
+}
+PRIVATE bool   VMThread::FindMethod(ObjClass* klass, Uint32 hash, bool walkParents, VMValue* result) {
+    while (klass) {
+        if (klass->Methods->GetIfExists(hash, result))
+            return true;
+        if (!walkParents)
+            break;
+        klass = ScriptManager::GetClassParent(klass);
+    }
+    return false;
+}
+PRIVATE bool   VMThread::FindProperty(Obj* object, ObjClass* klass, Uint32 hash, ValueGetFn getter, VMValue* result, bool* cacheable) {
+    // Same lookup order as GetProperty, minus the receiver's own fields.
+    // Only a method found before any getter was asked is cacheable,
+    // since fields and getters can change without the class changing.
+    bool checkFields = false;
+    *cacheable = true;
+    while (klass) {
+        if (checkFields && klass->Fields->GetIfExists(hash, result)) {
+            *result = ScriptManager::DelinkValue(*result);
+            *cacheable = false;
+            return true;
+        }
+        if (klass->Methods->GetIfExists(hash, result))
+            return true;
+        if (getter) {
+            *cacheable = false;
+            if (getter(object, hash, result, this->ID))
+                return true;
+        }
+
+        klass = ScriptManager::GetClassParent(klass);
+        if (klass) {
+            object = (Obj*)klass;
+            getter = klass->PropertyGet;
+            checkFields = true;
+        }
+    }
+    return false;
+}
+PRIVATE bool   VMThread::FindMethodCached(CallFrame* frame, ObjClass* klass, Uint32 hash, VMValue* result) {
+    bool found = false;
+    if (ScriptManager::Lock()) {
+        InlineCache* cache = GetInlineCache(frame);
+        found = GetCachedMethod(cache, klass, result);
+        if (!found && FindMethod(klass, hash, false, result)) {
+            AddCacheEntry(cache, klass, NULL, -1, *result);
+            found = true;
+        }
+        ScriptManager::Unlock();
+    }
+    return found;
+}
+PRIVATE VMValue* VMThread::GetTableFieldCached(InlineCache* cache, ObjClass* klass, Table* fields, Uint32 hash) {
+    if (!fields)
+        return NULL;
+
+    int slot = GetCachedFieldSlot(cache, klass, fields, hash);
+    if (slot < 0) {
+        slot = fields->GetSlot(hash);
+        if (slot < 0)
+            return NULL;
+        AddCacheEntry(cache, klass, NULL, slot, NULL_VAL);
+    }
+    return &fields->Data[slot].Data;
+}
+PRIVATE VMValue* VMThread::GetInstanceFieldCached(InlineCache* cache, ObjInstance* instance, Uint32 hash) {
+    ClassShape* shape = instance->Shape;
+    int slot = GetCachedShapeSlot(cache, shape);
+    if (slot < 0) {
+        slot = GetShapeSlot(shape, hash);
+        if (slot >= 0)
+            AddCacheEntry(cache, instance->Object.Class, shape, slot, NULL_VAL);
+    }
+    if (slot >= 0)
+        return &instance->Slots[slot];
+
+    // Fields that didn't fit in the shape
+    return GetTableFieldCached(cache, instance->Object.Class, instance->Fields, hash);
+}
+PRIVATE bool   VMThread::GetPropertyCached(InlineCache* cache, Obj* object, ObjClass* klass, VMValue* field, Uint32 hash, ValueGetFn getter) {
+    VMValue result;
+
+    // Fields have priority over methods
+    if (field) {
+        Pop();
+        Push(ScriptManager::DelinkValue(*field));
+        return true;
+    }
+
+    if (!GetCachedMethod(cache, klass, &result)) {
+        bool cacheable;
+        if (!FindProperty(object, klass, hash, getter, &result, &cacheable))
+            return false;
+        if (cacheable)
+            AddCacheEntry(cache, klass, NULL, -1, result);
+    }
+
+    Pop();
+    Push(result);
+    return true;
+}
+PRIVATE bool   VMThread::SetField(VMValue* slot, VMValue value) {
+    VMValue field = *slot;
+    switch (VALUE_TYPE(field)) {
+        case VAL_LINKED_INTEGER:
+            if (!ScriptManager::DoIntegerConversion(value, this->ID))
+                return false;
+            AS_LINKED_INTEGER(field) = AS_INTEGER(value);
+            break;
+        case VAL_LINKED_DECIMAL:
+            if (!ScriptManager::DoDecimalConversion(value, this->ID))
+                return false;
+            AS_LINKED_DECIMAL(field) = AS_DECIMAL(value);
+            break;
+        default:
+            GarbageCollector::WriteBarrier(value);
+            *slot = value;
+    }
     return true;
 }
 PUBLIC bool    VMThread::Import(VMValue value) {
@@ -2219,7 +2881,7 @@ PUBLIC VMValue VMThread::Values_Multiply() {
     Pop();
     Pop();
 
-    if (a.Type == VAL_DECIMAL || b.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL || VALUE_TYPE(b) == VAL_DECIMAL) {
         float a_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(a));
         float b_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(b));
         return DECIMAL_VAL(a_d * b_d);
@@ -2235,7 +2897,7 @@ PUBLIC VMValue VMThread::Values_Division() {
     CHECK_IS_NUM(a, "division", DECIMAL_VAL(1.0f));
     CHECK_IS_NUM(b, "division", DECIMAL_VAL(1.0f));
 
-    if (a.Type == VAL_DECIMAL || b.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL || VALUE_TYPE(b) == VAL_DECIMAL) {
         float a_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(a));
         float b_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(b));
         if (b_d == 0.0) {
@@ -2259,7 +2921,7 @@ PUBLIC VMValue VMThread::Values_Modulo() {
     CHECK_IS_NUM(a, "modulo", DECIMAL_VAL(1.0f));
     CHECK_IS_NUM(b, "modulo", DECIMAL_VAL(1.0f));
 
-    if (a.Type == VAL_DECIMAL || b.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL || VALUE_TYPE(b) == VAL_DECIMAL) {
         float a_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(a));
         float b_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(b));
         return DECIMAL_VAL(fmod(a_d, b_d));
@@ -2286,7 +2948,7 @@ PUBLIC VMValue VMThread::Values_Plus() {
     CHECK_IS_NUM(a, "plus", DECIMAL_VAL(0.0f));
     CHECK_IS_NUM(b, "plus", DECIMAL_VAL(0.0f));
 
-    if (a.Type == VAL_DECIMAL || b.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL || VALUE_TYPE(b) == VAL_DECIMAL) {
         float a_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(a));
         float b_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(b));
         Pop();
@@ -2309,7 +2971,7 @@ PUBLIC VMValue VMThread::Values_Minus() {
     Pop();
     Pop();
 
-    if (a.Type == VAL_DECIMAL || b.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL || VALUE_TYPE(b) == VAL_DECIMAL) {
         float a_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(a));
         float b_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(b));
         return DECIMAL_VAL(a_d - b_d);
@@ -2325,7 +2987,7 @@ PUBLIC VMValue VMThread::Values_BitwiseLeft() {
     CHECK_IS_NUM(a, "bitwise left", INTEGER_VAL(0));
     CHECK_IS_NUM(b, "bitwise left", INTEGER_VAL(0));
 
-    if (a.Type == VAL_DECIMAL || b.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL || VALUE_TYPE(b) == VAL_DECIMAL) {
         float a_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(a));
         float b_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(b));
         return DECIMAL_VAL((float)((int)a_d << (int)b_d));
@@ -2341,7 +3003,7 @@ PUBLIC VMValue VMThread::Values_BitwiseRight() {
     CHECK_IS_NUM(a, "bitwise right", INTEGER_VAL(0));
     CHECK_IS_NUM(b, "bitwise right", INTEGER_VAL(0));
 
-    if (a.Type == VAL_DECIMAL || b.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL || VALUE_TYPE(b) == VAL_DECIMAL) {
         float a_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(a));
         float b_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(b));
         return DECIMAL_VAL((float)((int)a_d >> (int)b_d));
@@ -2357,7 +3019,7 @@ PUBLIC VMValue VMThread::Values_BitwiseAnd() {
     CHECK_IS_NUM(a, "bitwise and", INTEGER_VAL(0));
     CHECK_IS_NUM(b, "bitwise and", INTEGER_VAL(0));
 
-    if (a.Type == VAL_DECIMAL || b.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL || VALUE_TYPE(b) == VAL_DECIMAL) {
         float a_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(a));
         float b_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(b));
         return DECIMAL_VAL((float)((int)a_d & (int)b_d));
@@ -2373,7 +3035,7 @@ PUBLIC VMValue VMThread::Values_BitwiseXor() {
     CHECK_IS_NUM(a, "xor", INTEGER_VAL(0));
     CHECK_IS_NUM(b, "xor", INTEGER_VAL(0));
 
-    if (a.Type == VAL_DECIMAL || b.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL || VALUE_TYPE(b) == VAL_DECIMAL) {
         float a_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(a));
         float b_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(b));
         return DECIMAL_VAL((float)((int)a_d ^ (int)b_d));
@@ -2389,7 +3051,7 @@ PUBLIC VMValue VMThread::Values_BitwiseOr() {
     CHECK_IS_NUM(a, "bitwise or", INTEGER_VAL(0));
     CHECK_IS_NUM(b, "bitwise or", INTEGER_VAL(0));
 
-    if (a.Type == VAL_DECIMAL || b.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL || VALUE_TYPE(b) == VAL_DECIMAL) {
         float a_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(a));
         float b_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(b));
         return DECIMAL_VAL((float)((int)a_d | (int)b_d));
@@ -2405,7 +3067,7 @@ PUBLIC VMValue VMThread::Values_LogicalAND() {
     CHECK_IS_NUM(a, "logical and", INTEGER_VAL(0));
     CHECK_IS_NUM(b, "logical and", INTEGER_VAL(0));
 
-    if (a.Type == VAL_DECIMAL || b.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL || VALUE_TYPE(b) == VAL_DECIMAL) {
         // float a_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(a));
         // float b_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(b));
         // return DECIMAL_VAL((float)((int)a_d & (int)b_d));
@@ -2422,7 +3084,7 @@ PUBLIC VMValue VMThread::Values_LogicalOR() {
     CHECK_IS_NUM(a, "logical or", INTEGER_VAL(0));
     CHECK_IS_NUM(b, "logical or", INTEGER_VAL(0));
 
-    if (a.Type == VAL_DECIMAL || b.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL || VALUE_TYPE(b) == VAL_DECIMAL) {
         // float a_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(a));
         // float b_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(b));
         // return DECIMAL_VAL((float)((int)a_d & (int)b_d));
@@ -2439,7 +3101,7 @@ PUBLIC VMValue VMThread::Values_LessThan() {
     CHECK_IS_NUM(a, "less than", INTEGER_VAL(0));
     CHECK_IS_NUM(b, "less than", INTEGER_VAL(0));
 
-    if (a.Type == VAL_DECIMAL || b.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL || VALUE_TYPE(b) == VAL_DECIMAL) {
         float a_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(a));
         float b_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(b));
         return INTEGER_VAL(a_d < b_d);
@@ -2455,7 +3117,7 @@ PUBLIC VMValue VMThread::Values_GreaterThan() {
     CHECK_IS_NUM(a, "greater than", INTEGER_VAL(0));
     CHECK_IS_NUM(b, "greater than", INTEGER_VAL(0));
 
-    if (a.Type == VAL_DECIMAL || b.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL || VALUE_TYPE(b) == VAL_DECIMAL) {
         float a_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(a));
         float b_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(b));
         return INTEGER_VAL(a_d > b_d);
@@ -2471,7 +3133,7 @@ PUBLIC VMValue VMThread::Values_LessThanOrEqual() {
     CHECK_IS_NUM(a, "less than or equal", INTEGER_VAL(0));
     CHECK_IS_NUM(b, "less than or equal", INTEGER_VAL(0));
 
-    if (a.Type == VAL_DECIMAL || b.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL || VALUE_TYPE(b) == VAL_DECIMAL) {
         float a_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(a));
         float b_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(b));
         return INTEGER_VAL(a_d <= b_d);
@@ -2487,7 +3149,7 @@ PUBLIC VMValue VMThread::Values_GreaterThanOrEqual() {
     CHECK_IS_NUM(a, "greater than or equal", INTEGER_VAL(0));
     CHECK_IS_NUM(b, "greater than or equal", INTEGER_VAL(0));
 
-    if (a.Type == VAL_DECIMAL || b.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL || VALUE_TYPE(b) == VAL_DECIMAL) {
         float a_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(a));
         float b_d = AS_DECIMAL(ScriptManager::CastValueAsDecimal(b));
         return INTEGER_VAL(a_d >= b_d);
@@ -2501,7 +3163,7 @@ PUBLIC VMValue VMThread::Values_Increment() {
 
     CHECK_IS_NUM(a, "increment", INTEGER_VAL(0));
 
-    if (a.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL) {
         float a_d = AS_DECIMAL(a);
         return DECIMAL_VAL(++a_d);
     }
@@ -2513,7 +3175,7 @@ PUBLIC VMValue VMThread::Values_Decrement() {
 
     CHECK_IS_NUM(a, "decrement", INTEGER_VAL(0));
 
-    if (a.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL) {
         float a_d = AS_DECIMAL(a);
         return DECIMAL_VAL(--a_d);
     }
@@ -2525,7 +3187,7 @@ PUBLIC VMValue VMThread::Values_Negate() {
 
     CHECK_IS_NUM(a, "negate", INTEGER_VAL(0));
 
-    if (a.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL) {
         return DECIMAL_VAL(-AS_DECIMAL(a));
     }
     return INTEGER_VAL(-AS_INTEGER(a));
@@ -2534,7 +3196,7 @@ PUBLIC VMValue VMThread::Values_LogicalNOT() {
     VMValue a = Pop();
 
     // HACK: Yikes.
-    switch (a.Type) {
+    switch (VALUE_TYPE(a)) {
         case VAL_NULL:
             return INTEGER_VAL(true);
         case VAL_OBJECT:
@@ -2551,7 +3213,7 @@ PUBLIC VMValue VMThread::Values_LogicalNOT() {
 }
 PUBLIC VMValue VMThread::Values_BitwiseNOT() {
     VMValue a = Pop();
-    if (a.Type == VAL_DECIMAL) {
+    if (VALUE_TYPE(a) == VAL_DECIMAL) {
         return DECIMAL_VAL((float)(~(int)AS_DECIMAL(a)));
     }
     return INTEGER_VAL(~AS_INTEGER(a));
@@ -2561,7 +3223,7 @@ PUBLIC VMValue VMThread::Value_TypeOf() {
 
     VMValue value = Pop();
 
-    switch (value.Type) {
+    switch (VALUE_TYPE(value)) {
         case VAL_NULL:
             valueType = "null";
             break;
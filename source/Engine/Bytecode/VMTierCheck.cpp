@@ -0,0 +1,218 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Bytecode/Types.h>
+
+class VMTierCheck {
+public:
+};
+#endif
+
+#include <Engine/Bytecode/VMTierCheck.h>
+
+#include <Engine/Bytecode/Compiler.h>
+#include <Engine/Bytecode/RegisterTier.h>
+#include <Engine/Bytecode/ScriptManager.h>
+#include <Engine/Bytecode/Values.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/IO/MemoryStream.h>
+
+// Each script is run once with only the stack interpreter, and once
+// with every function going to the register tier on its first call.
+// TierCheck() returns everything worth comparing.
+struct VMTierCheckScript {
+    const char* Name;
+    const char* Source;
+};
+
+static const VMTierCheckScript TierCheckScripts[] = {
+    { "TierCheck/IntegerLoop",
+        "event TierCheck() {\n"
+        "    var total = 0;\n"
+        "    for (var i = 0; i < 1000; i++) {\n"
+        "        total = (total + i * 3) % 65521;\n"
+        "        if (i & 1)\n"
+        "            total -= i >> 1;\n"
+        "        else\n"
+        "            total ^= i << 2;\n"
+        "        total = total | (i & 7);\n"
+        "    }\n"
+        "    var down = 10;\n"
+        "    while (down > 0) down--;\n"
+        "    return [total, down, -total, ~total, !total, 7 / 2, -7 % 3];\n"
+        "}\n" },
+    { "TierCheck/DecimalLoop",
+        "event TierCheck() {\n"
+        "    var x = 0.0;\n"
+        "    var v = 0.25;\n"
+        "    for (var i = 0; i < 500; i++) {\n"
+        "        x = x * 0.99 + v;\n"
+        "        if (x > 10) v = -v;\n"
+        "        x += i / 7;\n"
+        "        x = x + i % 3 - 1.5;\n"
+        "        x /= 1.01;\n"
+        "    }\n"
+        "    return [x, v, x >= 1.5, x <= v, x == x, 1 == 1.0, 0.5 != 0.5];\n"
+        "}\n" },
+    { "TierCheck/MixedValues",
+        "event TierCheck() {\n"
+        "    var s = \"\";\n"
+        "    var n = null;\n"
+        "    for (var i = 0; i < 20; i++) {\n"
+        "        s = s + i;\n"
+        "        if (i == 10) s += \",\";\n"
+        "        if (n == null) n = i;\n"
+        "        else n = n + 0.5;\n"
+        "    }\n"
+        "    var t = s == \"01\" ? 1 : 2;\n"
+        "    return [s, n, typeof n, !null, !0.0, -n, ~7, t, s != null];\n"
+        "}\n" },
+    { "TierCheck/CallsAndContainers",
+        "var TierCheckCounter = 0;\n"
+        "event TierCheckFib(n) {\n"
+        "    if (n < 2) return n;\n"
+        "    return TierCheckFib(n - 1) + TierCheckFib(n - 2);\n"
+        "}\n"
+        "event TierCheckBump(amount) {\n"
+        "    TierCheckCounter += amount;\n"
+        "    return TierCheckCounter;\n"
+        "}\n"
+        "event TierCheck() {\n"
+        "    var values = [0, 0, 0, 0, 0, 0, 0, 0];\n"
+        "    var map = { \"a\": 1, \"b\": 2.5 };\n"
+        "    for (var i = 0; i < 15; i++) {\n"
+        "        values[i & 7] += TierCheckFib(i);\n"
+        "        map[\"a\"] = map[\"a\"] + TierCheckBump(i);\n"
+        "    }\n"
+        "    return [values, map[\"a\"], map[\"b\"], TierCheckCounter];\n"
+        "}\n" },
+    { "TierCheck/ControlFlow",
+        "event TierCheck() {\n"
+        "    var hits = 0;\n"
+        "    var i = 0;\n"
+        "    while (i < 200) {\n"
+        "        i++;\n"
+        "        if (i % 3 == 0 && i % 5 != 0) continue;\n"
+        "        if (i > 150 || hits > 600) break;\n"
+        "        var j = 0;\n"
+        "        do {\n"
+        "            hits += j;\n"
+        "            j++;\n"
+        "        } while (j < i % 4);\n"
+        "        repeat (2) hits++;\n"
+        "    }\n"
+        "    return [hits, i];\n"
+        "}\n" },
+    { "TierCheck/Instances",
+        "class TierCheckVector {\n"
+        "    event Length() {\n"
+        "        return this.X * this.X + this.Y * this.Y;\n"
+        "    }\n"
+        "}\n"
+        "event TierCheck() {\n"
+        "    var v = new TierCheckVector();\n"
+        "    v.X = 3;\n"
+        "    v.Y = 4.0;\n"
+        "    var total = 0;\n"
+        "    for (var i = 0; i < 50; i++) {\n"
+        "        v.X += 1;\n"
+        "        total += v.Length();\n"
+        "    }\n"
+        "    return [total, v.X, v.Y];\n"
+        "}\n" },
+};
+
+PRIVATE STATIC char* VMTierCheck::RunScript(Uint32 filenameHash, BytecodeContainer bytecode, int mode) {
+    RegisterTier::SetMode(mode);
+
+    VMThread* thread = &ScriptManager::Threads[0];
+    if (!ScriptManager::RunBytecode(bytecode, filenameHash))
+        return NULL;
+
+    VMValue value;
+    if (!ScriptManager::Globals->GetIfExists("TierCheck", &value) || !IS_FUNCTION(value))
+        return NULL;
+
+    thread->Push(value);
+    VMValue result = thread->RunEntityFunction(AS_FUNCTION(value), 0);
+    thread->Pop();
+
+    char* textBuffer = (char*)malloc(256);
+
+    PrintBuffer buffer;
+    buffer.Buffer = &textBuffer;
+    buffer.WriteIndex = 0;
+    buffer.BufferSize = 256;
+    Values::PrintValue(&buffer, result);
+
+    return textBuffer;
+}
+
+PUBLIC STATIC bool VMTierCheck::Run() {
+    Log::Print(Log::LOG_IMPORTANT, "VM tier check:");
+
+    int lastMode = RegisterTier::Mode;
+    int count = sizeof(TierCheckScripts) / sizeof(TierCheckScripts[0]);
+    int passed = 0;
+    int skipped = 0;
+
+    for (int i = 0; i < count; i++) {
+        const VMTierCheckScript* script = &TierCheckScripts[i];
+
+        Compiler::PrepareCompiling();
+        MemoryStream* stream = MemoryStream::New(0x1000);
+        Compiler* compiler = new Compiler;
+        bool compiled = stream && compiler->Compile(script->Name, script->Source, stream);
+        delete compiler;
+        Compiler::FinishCompiling();
+
+        if (!compiled) {
+            Log::Print(Log::LOG_ERROR, "%-30s could not be compiled", script->Name);
+            if (stream)
+                stream->Close();
+            continue;
+        }
+
+        // Loaded functions point into their bytecode, so it's kept
+        // with the other sources until the script manager goes away.
+        BytecodeContainer bytecode;
+        bytecode.Size = stream->Position();
+        bytecode.Data = (Uint8*)Memory::TrackedMalloc("Bytecode::Data", bytecode.Size);
+        memcpy(bytecode.Data, stream->pointer_start, bytecode.Size);
+        stream->Close();
+
+        Uint32 filenameHash = ScriptManager::MakeFilenameHash((char*)script->Name);
+        if (ScriptManager::Sources->Exists(filenameHash))
+            Memory::Free(ScriptManager::Sources->Get(filenameHash).Data);
+        ScriptManager::Sources->Put(filenameHash, bytecode);
+
+        Uint32 translated = RegisterTier::TranslatedCount;
+        char* stackResult = RunScript(filenameHash, bytecode, VM_TIER_STACK);
+        char* registerResult = RunScript(filenameHash, bytecode, VM_TIER_REGISTER);
+        translated = RegisterTier::TranslatedCount - translated;
+
+        bool match = stackResult && registerResult && !strcmp(stackResult, registerResult);
+        if (match && !translated) {
+            // Both runs were on the stack interpreter, so nothing was checked
+            Log::Print(Log::LOG_WARN, "%-30s skipped (no functions on the register tier)", script->Name);
+            skipped++;
+        }
+        else if (match) {
+            Log::Print(Log::LOG_INFO, "%-30s ok (%u functions on the register tier)", script->Name, translated);
+            passed++;
+        }
+        else {
+            Log::Print(Log::LOG_ERROR, "%-30s MISMATCH", script->Name);
+            Log::Print(Log::LOG_ERROR, "    stack:    %s", stackResult ? stackResult : "(did not run)");
+            Log::Print(Log::LOG_ERROR, "    register: %s", registerResult ? registerResult : "(did not run)");
+        }
+
+        free(stackResult);
+        free(registerResult);
+    }
+
+    RegisterTier::SetMode(lastMode);
+
+    Log::Print(Log::LOG_INFO, "%d of %d scripts matched, %d skipped (%u functions translated, %u left on the stack interpreter)",
+        passed, count, skipped, RegisterTier::TranslatedCount, RegisterTier::RejectedCount);
+    return passed > 0 && passed + skipped == count;
+}
@@ -19,7 +19,7 @@ public:
     bool          Win32_PerformanceFrequencyEnabled = false;
     double        Win32_CPUFreq;
     Sint64        Win32_GameStartTime;
-    stack<double> Win32_ClockStack;
+    thread_local stack<double> Win32_ClockStack;
 #endif
 
 #include <stack>
@@ -28,7 +28,7 @@ public:
 #include <thread>
 
 std::chrono::steady_clock::time_point        GameStartTime;
-stack<std::chrono::steady_clock::time_point> ClockStack;
+thread_local stack<std::chrono::steady_clock::time_point> ClockStack;
 
 PUBLIC STATIC void   Clock::Init() {
 #ifdef USE_WIN32_CLOCK
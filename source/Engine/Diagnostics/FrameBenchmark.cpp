@@ -0,0 +1,428 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Diagnostics/PerformanceTypes.h>
+
+class FrameBenchmark {
+public:
+    static bool Active;
+    static int  DefaultFrameCount;
+    static int  FrameCount;
+    static bool HashFrames;
+    static char OutputFile[4096];
+    static char InputFile[4096];
+    static char RecordFile[4096];
+};
+#endif
+
+#include <Engine/Diagnostics/FrameBenchmark.h>
+
+#include <Engine/Application.h>
+#include <Engine/Graphics.h>
+#include <Engine/InputManager.h>
+#include <Engine/Scene.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Diagnostics/PerformanceMeasure.h>
+#include <Engine/Filesystem/File.h>
+#include <Engine/IO/FileStream.h>
+#include <Engine/Math/Math.h>
+#include <Engine/Rendering/Headless/HeadlessRenderer.h>
+#include <Engine/Utilities/StringUtils.h>
+
+bool FrameBenchmark::Active = false;
+int  FrameBenchmark::DefaultFrameCount = 600;
+int  FrameBenchmark::FrameCount = 0;
+bool FrameBenchmark::HashFrames = false;
+char FrameBenchmark::OutputFile[4096];
+char FrameBenchmark::InputFile[4096];
+char FrameBenchmark::RecordFile[4096];
+
+// Both the engine's and the scripts' random numbers start from this,
+// so that two runs of the same scene draw the same frames.
+#define BENCH_RANDOM_SEED 0x5EED
+
+#define BENCH_KEYBOARD_SIZE 0x120
+
+struct BenchInputEvent {
+    Uint32 Update;
+    Uint16 Scancode;
+    bool   Down;
+};
+struct BenchViewSample {
+    double SetupTime;
+    double ProjectionTime;
+    double ObjectEarlyTime;
+    double ObjectTime;
+    double ObjectLateTime;
+    double LayerTime;
+    double FinishTime;
+    double RenderTime;
+};
+struct BenchFrameSample {
+    Perf_Application App;
+    BenchViewSample  Views[MAX_SCENE_VIEWS];
+    Uint32           ViewMask;
+    Uint32           Hash;
+};
+
+static vector<BenchFrameSample> Samples;
+static vector<BenchInputEvent>  InputEvents;
+static size_t                   NextInputEvent = 0;
+static Uint8                    InputHeld[BENCH_KEYBOARD_SIZE];
+static Uint8                    InputRecorded[BENCH_KEYBOARD_SIZE];
+static Uint32                   InputUpdate = 0;
+static Stream*                  RecordStream = NULL;
+
+static bool LoadInputEvents(const char* filename) {
+    char* text = NULL;
+    if (!File::ReadAllBytes(filename, &text)) {
+        if (text)
+            Memory::Free(text);
+        return false;
+    }
+
+    // One event per line: the update it happens on, the key's name,
+    // and "down" or "up". Lines starting with '#' are comments.
+    int lineNumber = 0;
+    for (char* line = text, *next; line && *line; line = next) {
+        next = strchr(line, '\n');
+        if (next)
+            *next++ = 0;
+        lineNumber++;
+
+        char keyName[64];
+        char state[16];
+        unsigned update;
+        if (line[0] == '#' || line[0] == '\r' || line[0] == 0)
+            continue;
+        if (sscanf(line, "%u %63s %15s", &update, keyName, state) != 3) {
+            Log::Print(Log::LOG_WARN, "%s:%d: Expected \"<update> <key> <down|up>\"", filename, lineNumber);
+            continue;
+        }
+
+        int key = InputManager::ParseKeyName(keyName);
+        if (key < 0 || key >= NUM_KEYBOARD_KEYS) {
+            Log::Print(Log::LOG_WARN, "%s:%d: Unknown key \"%s\"", filename, lineNumber, keyName);
+            continue;
+        }
+
+        BenchInputEvent event;
+        event.Update = update;
+        event.Scancode = (Uint16)InputManager::KeyToSDLScancode[key];
+        event.Down = !strcmp(state, "down");
+        InputEvents.push_back(event);
+    }
+    Memory::Free(text);
+
+    std::stable_sort(InputEvents.begin(), InputEvents.end(), [](const BenchInputEvent& a, const BenchInputEvent& b) -> bool {
+        return a.Update < b.Update;
+    });
+    return true;
+}
+
+PUBLIC STATIC void FrameBenchmark::Start() {
+    if (FrameCount <= 0)
+        FrameCount = DefaultFrameCount;
+
+    if (HashFrames && !HeadlessRenderer::Backbuffer) {
+        Log::Print(Log::LOG_WARN, "Frame hashes need the headless renderer (--headless), so they won't be taken.");
+        HashFrames = false;
+    }
+
+    InputEvents.clear();
+    NextInputEvent = 0;
+    memset(InputHeld, 0, sizeof InputHeld);
+    if (InputFile[0]) {
+        if (!LoadInputEvents(InputFile))
+            Log::Print(Log::LOG_ERROR, "Could not read benchmark input \"%s\"!", InputFile);
+        else
+            Log::Print(Log::LOG_VERBOSE, "Loaded %u input events from \"%s\"", (Uint32)InputEvents.size(), InputFile);
+    }
+
+    srand(BENCH_RANDOM_SEED);
+    Math::SetRandSeed(BENCH_RANDOM_SEED);
+
+    // Every frame runs exactly one update, back to back.
+    Application::UpdatesPerFrame = 1;
+    Application::Stepper = false;
+
+    Samples.clear();
+    Samples.reserve(FrameCount);
+    InputUpdate = 0;
+    Active = true;
+
+    Log::Print(Log::LOG_IMPORTANT, "Frame Benchmark (%d frames, %s renderer)", FrameCount, Graphics::Renderer);
+}
+
+PUBLIC STATIC void FrameBenchmark::StartRecording() {
+    if (!RecordFile[0] || RecordStream)
+        return;
+
+    RecordStream = FileStream::New(RecordFile, FileStream::WRITE_ACCESS);
+    if (!RecordStream) {
+        Log::Print(Log::LOG_ERROR, "Could not open \"%s\" for recording input!", RecordFile);
+        return;
+    }
+
+    const char* header = "# update key state\n";
+    RecordStream->WriteBytes((void*)header, strlen(header));
+    memset(InputRecorded, 0, sizeof InputRecorded);
+    InputUpdate = 0;
+}
+
+// Called right after the input manager polls, once per update.
+// Recorded key states are laid over whatever the keyboard says.
+PUBLIC STATIC void FrameBenchmark::PollInput() {
+    if (!Active && !RecordStream)
+        return;
+
+    if (Active && InputEvents.size()) {
+        while (NextInputEvent < InputEvents.size() && InputEvents[NextInputEvent].Update <= InputUpdate) {
+            BenchInputEvent* event = &InputEvents[NextInputEvent++];
+            InputHeld[event->Scancode] = event->Down;
+        }
+        for (int i = 0; i < BENCH_KEYBOARD_SIZE; i++)
+            InputManager::KeyboardState[i] |= InputHeld[i];
+    }
+
+    if (RecordStream) {
+        for (int key = 0; key < NUM_KEYBOARD_KEYS; key++) {
+            int scancode = (int)InputManager::KeyToSDLScancode[key];
+            if (scancode <= 0 || scancode >= BENCH_KEYBOARD_SIZE)
+                continue;
+
+            Uint8 down = InputManager::KeyboardState[scancode] ? 1 : 0;
+            if (down == InputRecorded[scancode])
+                continue;
+
+            char* name = InputManager::GetKeyName(key);
+            if (!name)
+                continue;
+
+            char line[96];
+            snprintf(line, sizeof line, "%u %s %s\n", InputUpdate, name, down ? "down" : "up");
+            RecordStream->WriteBytes(line, strlen(line));
+            InputRecorded[scancode] = down;
+        }
+    }
+
+    InputUpdate++;
+}
+
+// Takes this frame's timings, and returns false once enough frames
+// have been run.
+PUBLIC STATIC bool FrameBenchmark::EndFrame() {
+    if (!Active)
+        return false;
+
+    BenchFrameSample sample;
+    memset(&sample, 0, sizeof sample);
+    sample.App = PerformanceMeasure::PERF_Application;
+
+    for (int viewIndex = 0; viewIndex < MAX_SCENE_VIEWS; viewIndex++) {
+        if (!Scene::Views[viewIndex].Active)
+            continue;
+
+        Perf_ViewRender* perf = &Scene::PERF_ViewRender[viewIndex];
+        BenchViewSample* view = &sample.Views[viewIndex];
+        view->SetupTime = perf->RenderSetupTime;
+        view->ProjectionTime = perf->ProjectionSetupTime;
+        view->ObjectEarlyTime = perf->ObjectRenderEarlyTime;
+        view->ObjectTime = perf->ObjectRenderTime;
+        view->ObjectLateTime = perf->ObjectRenderLateTime;
+        for (size_t l = 0; l < Scene::Layers.size() && l < 32; l++)
+            view->LayerTime += perf->LayerTileRenderTime[l];
+        view->FinishTime = perf->RenderFinishTime;
+        view->RenderTime = perf->RenderTime;
+        sample.ViewMask |= 1 << viewIndex;
+    }
+
+    if (HashFrames)
+        sample.Hash = HeadlessRenderer::GetFrameHash();
+
+    Samples.push_back(sample);
+    return (int)Samples.size() < FrameCount;
+}
+
+#define APP_FIELD_COUNT 9
+static const char* AppFieldNames[APP_FIELD_COUNT] = {
+    "EventTime",
+    "AfterSceneTime",
+    "PollTime",
+    "UpdateTime",
+    "ClearTime",
+    "RenderTime",
+    "FPSCounterTime",
+    "PresentTime",
+    "FrameTime",
+};
+#define VIEW_FIELD_COUNT 8
+static const char* ViewFieldNames[VIEW_FIELD_COUNT] = {
+    "RenderSetupTime",
+    "ProjectionSetupTime",
+    "ObjectRenderEarlyTime",
+    "ObjectRenderTime",
+    "ObjectRenderLateTime",
+    "LayerTileRenderTime",
+    "RenderFinishTime",
+    "RenderTime",
+};
+
+// Both structs are nothing but doubles (in the order the names above
+// are in), so they can be walked like arrays.
+static double GetAppField(BenchFrameSample* sample, int field) {
+    return ((double*)&sample->App)[field];
+}
+static double GetViewField(BenchFrameSample* sample, int view, int field) {
+    return ((double*)&sample->Views[view])[field];
+}
+
+static void WriteText(Stream* stream, const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof buffer, format, args);
+    va_end(args);
+    if (length > 0)
+        stream->WriteBytes(buffer, std::min(length, (int)sizeof(buffer) - 1));
+}
+static void WriteCSV(Stream* stream, Uint32 viewMask) {
+    WriteText(stream, "Frame");
+    for (int f = 0; f < APP_FIELD_COUNT; f++)
+        WriteText(stream, ",%s", AppFieldNames[f]);
+    for (int v = 0; v < MAX_SCENE_VIEWS; v++) {
+        if (!(viewMask & (1 << v)))
+            continue;
+        for (int f = 0; f < VIEW_FIELD_COUNT; f++)
+            WriteText(stream, ",View%d.%s", v, ViewFieldNames[f]);
+    }
+    if (FrameBenchmark::HashFrames)
+        WriteText(stream, ",Hash");
+    WriteText(stream, "\n");
+
+    for (size_t i = 0; i < Samples.size(); i++) {
+        BenchFrameSample* sample = &Samples[i];
+        WriteText(stream, "%u", (Uint32)i);
+        for (int f = 0; f < APP_FIELD_COUNT; f++)
+            WriteText(stream, ",%.4f", GetAppField(sample, f));
+        for (int v = 0; v < MAX_SCENE_VIEWS; v++) {
+            if (!(viewMask & (1 << v)))
+                continue;
+            for (int f = 0; f < VIEW_FIELD_COUNT; f++) {
+                if (sample->ViewMask & (1 << v))
+                    WriteText(stream, ",%.4f", GetViewField(sample, v, f));
+                else
+                    WriteText(stream, ",");
+            }
+        }
+        if (FrameBenchmark::HashFrames)
+            WriteText(stream, ",%08X", sample->Hash);
+        WriteText(stream, "\n");
+    }
+}
+static void WriteJSON(Stream* stream) {
+    WriteText(stream, "{\n  \"renderer\": \"%s\",\n  \"frames\": [\n", Graphics::Renderer);
+    for (size_t i = 0; i < Samples.size(); i++) {
+        BenchFrameSample* sample = &Samples[i];
+        WriteText(stream, "    { \"Frame\": %u", (Uint32)i);
+        for (int f = 0; f < APP_FIELD_COUNT; f++)
+            WriteText(stream, ", \"%s\": %.4f", AppFieldNames[f], GetAppField(sample, f));
+        if (FrameBenchmark::HashFrames)
+            WriteText(stream, ", \"Hash\": \"%08X\"", sample->Hash);
+
+        WriteText(stream, ", \"Views\": [");
+        bool first = true;
+        for (int v = 0; v < MAX_SCENE_VIEWS; v++) {
+            if (!(sample->ViewMask & (1 << v)))
+                continue;
+            WriteText(stream, "%s{ \"View\": %d", first ? "" : ", ", v);
+            for (int f = 0; f < VIEW_FIELD_COUNT; f++)
+                WriteText(stream, ", \"%s\": %.4f", ViewFieldNames[f], GetViewField(sample, v, f));
+            WriteText(stream, " }");
+            first = false;
+        }
+        WriteText(stream, "] }%s\n", i + 1 < Samples.size() ? "," : "");
+    }
+    WriteText(stream, "  ]\n}\n");
+}
+PUBLIC STATIC bool FrameBenchmark::Write(const char* filename) {
+    Stream* stream = FileStream::New(filename, FileStream::WRITE_ACCESS);
+    if (!stream) {
+        Log::Print(Log::LOG_ERROR, "Could not open \"%s\" for writing the benchmark results!", filename);
+        return false;
+    }
+
+    Uint32 viewMask = 0;
+    for (size_t i = 0; i < Samples.size(); i++)
+        viewMask |= Samples[i].ViewMask;
+
+    if (StringUtils::StrCaseStr(filename, ".json"))
+        WriteJSON(stream);
+    else
+        WriteCSV(stream, viewMask);
+
+    stream->Close();
+    return true;
+}
+
+static int CompareDoubles(const void* a, const void* b) {
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+PUBLIC STATIC void FrameBenchmark::Finish() {
+    if (!Active)
+        return;
+
+    Active = false;
+
+    size_t count = Samples.size();
+    if (count) {
+        Log::Print(Log::LOG_IMPORTANT, "Frame Benchmark results (%u frames):", (Uint32)count);
+        Log::Print(Log::LOG_INFO, "%-16s %9s %9s %9s", "", "avg ms", "min ms", "max ms");
+        for (int f = 0; f < APP_FIELD_COUNT; f++) {
+            double total = 0.0, low = GetAppField(&Samples[0], f), high = low;
+            for (size_t i = 0; i < count; i++) {
+                double value = GetAppField(&Samples[i], f);
+                total += value;
+                low = std::min(low, value);
+                high = std::max(high, value);
+            }
+            Log::Print(Log::LOG_INFO, "%-16s %9.3f %9.3f %9.3f", AppFieldNames[f], total / count, low, high);
+        }
+
+        double* frameTimes = (double*)Memory::Malloc(count * sizeof(double));
+        if (frameTimes) {
+            for (size_t i = 0; i < count; i++)
+                frameTimes[i] = Samples[i].App.FrameTime;
+            qsort(frameTimes, count, sizeof(double), CompareDoubles);
+            Log::Print(Log::LOG_INFO, "Frame time p50 %.3f ms, p95 %.3f ms, p99 %.3f ms",
+                frameTimes[count * 50 / 100], frameTimes[count * 95 / 100], frameTimes[count * 99 / 100]);
+            Memory::Free(frameTimes);
+        }
+
+        // One hash for the whole run, so runs can be compared at a glance.
+        if (HashFrames) {
+            Uint32 runHash = 0;
+            for (size_t i = 0; i < count; i++)
+                runHash = runHash * 31 + Samples[i].Hash;
+            Log::Print(Log::LOG_INFO, "Frame hash: %08X (last frame %08X)", runHash, Samples[count - 1].Hash);
+        }
+    }
+
+    if (OutputFile[0] && FrameBenchmark::Write(OutputFile))
+        Log::Print(Log::LOG_INFO, "Wrote benchmark results to \"%s\"", OutputFile);
+
+    Samples.clear();
+    Samples.shrink_to_fit();
+    InputEvents.clear();
+}
+
+PUBLIC STATIC void FrameBenchmark::Dispose() {
+    FrameBenchmark::Finish();
+
+    if (RecordStream) {
+        RecordStream->Close();
+        RecordStream = NULL;
+    }
+}
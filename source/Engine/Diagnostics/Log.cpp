@@ -16,6 +16,7 @@ public:
 #endif
 
 #include <Engine/Includes/Standard.h>
+#include <Engine/Includes/StandardSDL2.h>
 #include <Engine/Diagnostics/Log.h>
 
 #ifdef WIN32
@@ -43,6 +44,10 @@ const char* Log::LogFilename = TARGET_NAME ".log";
 
 bool        Log_Initialized = false;
 
+// Loader threads log too. Each thread formats into its own buffer, and
+// only one writes out at a time so lines don't get mixed together.
+static SDL_SpinLock Log_OutputLock = 0;
+
 #if WIN32 || LINUX
 #define USING_COLOR_CODES 1
 #endif
@@ -96,8 +101,8 @@ PUBLIC STATIC void Log::Print(int sev, const char* format, ...) {
     if (sev < Log::LogLevel)
         return;
 
-    static char* stringBuffer = NULL;
-    static size_t stringBufferSize = 0;
+    static thread_local char* stringBuffer = NULL;
+    static thread_local size_t stringBufferSize = 0;
     const char* severityText = NULL;
 
     va_list args;
@@ -141,6 +146,8 @@ PUBLIC STATIC void Log::Print(int sev, const char* format, ...) {
         }
     #endif
 
+    SDL_AtomicLock(&Log_OutputLock);
+
     FILE* f = NULL;
     if (WriteToFile) {
         f = fopen(LogFilename, "a");
@@ -197,4 +204,6 @@ PUBLIC STATIC void Log::Print(int sev, const char* format, ...) {
         fprintf(f, "%s\n", string);
         fclose(f);
     }
+
+    SDL_AtomicUnlock(&Log_OutputLock);
 }
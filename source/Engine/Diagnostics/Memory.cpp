@@ -1,30 +1,328 @@
 #if INTERFACE
 
 #include <Engine/Includes/Standard.h>
+#include <Engine/Diagnostics/MemoryTypes.h>
 
 class Memory {
-private:
-    static vector<void*>       TrackedMemory;
-    static vector<size_t>      TrackedSizes;
-    static vector<const char*> TrackedMemoryNames;
 public:
     static size_t              MemoryUsage;
     static bool                IsTracking;
+    static bool                IsCounting;
 };
 #endif
 
+#include <Engine/Diagnostics/Clock.h>
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
+#include <Engine/Includes/StandardSDL2.h>
 
 // #if defined(ANDROID)
 // #define NOTRACK
 // #endif
 
-vector<void*>        Memory::TrackedMemory;
-vector<size_t>       Memory::TrackedSizes;
-vector<const char*>  Memory::TrackedMemoryNames;
+// Allocations the tracker knows about are kept in an open-addressed
+// table keyed by pointer, so looking one up on free costs the same no
+// matter how many are live. Each identifier allocations are made with
+// is a tag, which keeps running totals for everything made with it.
+//
+// Tracking records every allocation, so that leaks can be listed by
+// name. Counting only records the ones made with an identifier, which
+// is all the per-tag totals need. Both cost a lookup and a lock on every
+// allocation, so both are off unless turned on with dev/trackMemory or
+// dev/countMemory.
+//
+// Everything here is plain data set up on first use, since allocations
+// can happen before static constructors have run.
+
+struct MemoryRecord {
+    void*  Pointer;
+    size_t Size;
+    Uint32 Tag;
+};
+struct MemoryTag {
+    MemoryTagStats Stats;
+    Uint64         LastAllocations;
+    Uint64         LastBytes;
+};
+
 size_t               Memory::MemoryUsage = 0;
 bool                 Memory::IsTracking = false;
+bool                 Memory::IsCounting = false;
+
+static SDL_SpinLock  TrackerLock = 0;
+
+static MemoryRecord* Records = NULL;
+static Uint32        RecordCapacity = 0;
+static Uint32        RecordCount = 0;
+static void*         LastRecorded = NULL;
+
+// Tag 0 is for allocations made without an identifier.
+static MemoryTag*    Tags = NULL;
+static Uint32        TagCount = 0;
+static Uint32        TagCapacity = 0;
+
+// The same string can live at more than one address, so several keys
+// can lead to one tag.
+static const char**  TagKeys = NULL;
+static Uint32*       TagKeyIndices = NULL;
+static Uint32        TagKeyCapacity = 0;
+static Uint32        TagKeyCount = 0;
+
+static double        RateSampleTime = -1.0;
+
+static inline bool IsRecording() {
+    return Memory::IsTracking || Memory::IsCounting;
+}
+static inline Uint32 HashPointer(const void* pointer) {
+    Uint64 value = (Uint64)(uintptr_t)pointer;
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDULL;
+    value ^= value >> 33;
+    return (Uint32)value;
+}
+
+// Records
+static bool GrowRecords() {
+    Uint32 capacity = RecordCapacity ? RecordCapacity << 1 : 1024;
+    MemoryRecord* records = (MemoryRecord*)calloc(capacity, sizeof(MemoryRecord));
+    if (!records)
+        return false;
+
+    for (Uint32 i = 0; i < RecordCapacity; i++) {
+        if (!Records[i].Pointer)
+            continue;
+
+        Uint32 slot = HashPointer(Records[i].Pointer) & (capacity - 1);
+        while (records[slot].Pointer)
+            slot = (slot + 1) & (capacity - 1);
+        records[slot] = Records[i];
+    }
+
+    free(Records);
+    Records = records;
+    RecordCapacity = capacity;
+    return true;
+}
+static MemoryRecord* FindRecord(void* pointer) {
+    if (!RecordCount)
+        return NULL;
+
+    Uint32 mask = RecordCapacity - 1;
+    for (Uint32 slot = HashPointer(pointer) & mask; Records[slot].Pointer; slot = (slot + 1) & mask) {
+        if (Records[slot].Pointer == pointer)
+            return &Records[slot];
+    }
+    return NULL;
+}
+static MemoryRecord* InsertRecord(void* pointer) {
+    if ((RecordCount + 1) * 4 > RecordCapacity * 3 && !GrowRecords())
+        return NULL;
+
+    Uint32 mask = RecordCapacity - 1;
+    Uint32 slot = HashPointer(pointer) & mask;
+    while (Records[slot].Pointer)
+        slot = (slot + 1) & mask;
+
+    Records[slot].Pointer = pointer;
+    RecordCount++;
+    return &Records[slot];
+}
+// Shifts back the records after the erased one, so that lookups never
+// have to step over holes.
+static void EraseRecord(MemoryRecord* record) {
+    Uint32 mask = RecordCapacity - 1;
+    Uint32 hole = (Uint32)(record - Records);
+    Uint32 slot = hole;
+    for (;;) {
+        slot = (slot + 1) & mask;
+        if (!Records[slot].Pointer)
+            break;
+
+        Uint32 home = HashPointer(Records[slot].Pointer) & mask;
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            Records[hole] = Records[slot];
+            hole = slot;
+        }
+    }
+    Records[hole].Pointer = NULL;
+    RecordCount--;
+}
+
+// Tags
+static Uint32 AddTag(const char* name) {
+    if (TagCount == TagCapacity) {
+        Uint32 capacity = TagCapacity ? TagCapacity << 1 : 64;
+        MemoryTag* tags = (MemoryTag*)realloc(Tags, capacity * sizeof(MemoryTag));
+        if (!tags)
+            return 0;
+
+        Tags = tags;
+        TagCapacity = capacity;
+    }
+
+    memset(&Tags[TagCount], 0, sizeof(MemoryTag));
+    Tags[TagCount].Stats.Name = name;
+    return TagCount++;
+}
+static bool GrowTagKeys() {
+    Uint32 capacity = TagKeyCapacity ? TagKeyCapacity << 1 : 256;
+    const char** keys = (const char**)calloc(capacity, sizeof(const char*));
+    Uint32* indices = (Uint32*)calloc(capacity, sizeof(Uint32));
+    if (!keys || !indices) {
+        free(keys);
+        free(indices);
+        return false;
+    }
+
+    for (Uint32 i = 0; i < TagKeyCapacity; i++) {
+        if (!TagKeys[i])
+            continue;
+
+        Uint32 slot = HashPointer(TagKeys[i]) & (capacity - 1);
+        while (keys[slot])
+            slot = (slot + 1) & (capacity - 1);
+        keys[slot] = TagKeys[i];
+        indices[slot] = TagKeyIndices[i];
+    }
+
+    free(TagKeys);
+    free(TagKeyIndices);
+    TagKeys = keys;
+    TagKeyIndices = indices;
+    TagKeyCapacity = capacity;
+    return true;
+}
+static Uint32 GetTag(const char* identifier) {
+    if (!TagCount)
+        AddTag(NULL);
+    if (!identifier || !TagCount)
+        return 0;
+
+    Uint32 mask = TagKeyCapacity - 1;
+    Uint32 slot = 0;
+    if (TagKeyCapacity) {
+        for (slot = HashPointer(identifier) & mask; TagKeys[slot]; slot = (slot + 1) & mask) {
+            if (TagKeys[slot] == identifier)
+                return TagKeyIndices[slot];
+        }
+    }
+
+    // First time seeing this pointer, so look for the tag by name.
+    Uint32 tag = 0;
+    for (Uint32 i = 1; i < TagCount; i++) {
+        if (!strcmp(Tags[i].Stats.Name, identifier)) {
+            tag = i;
+            break;
+        }
+    }
+    if (!tag) {
+        tag = AddTag(identifier);
+        if (!tag)
+            return 0;
+    }
+
+    if ((TagKeyCount + 1) * 2 > TagKeyCapacity) {
+        if (!GrowTagKeys())
+            return tag;
+
+        mask = TagKeyCapacity - 1;
+        slot = HashPointer(identifier) & mask;
+        while (TagKeys[slot])
+            slot = (slot + 1) & mask;
+    }
+    TagKeys[slot] = identifier;
+    TagKeyIndices[slot] = tag;
+    TagKeyCount++;
+    return tag;
+}
+static void AddLive(Uint32 tag, size_t size) {
+    MemoryTagStats& stats = Tags[tag].Stats;
+    stats.LiveBytes += size;
+    stats.LiveCount++;
+    if (stats.PeakBytes < stats.LiveBytes)
+        stats.PeakBytes = stats.LiveBytes;
+
+    Memory::MemoryUsage += size;
+}
+static void RemoveLive(Uint32 tag, size_t size) {
+    MemoryTagStats& stats = Tags[tag].Stats;
+    stats.LiveBytes -= size;
+    stats.LiveCount--;
+
+    Memory::MemoryUsage -= size;
+}
+static void UpdateRates() {
+    double now = Clock::GetTicks();
+    double elapsed = now - RateSampleTime;
+    if (RateSampleTime >= 0.0 && elapsed < 1000.0)
+        return;
+
+    for (Uint32 i = 0; i < TagCount; i++) {
+        MemoryTag& tag = Tags[i];
+        if (RateSampleTime >= 0.0) {
+            tag.Stats.AllocationRate = (float)((tag.Stats.TotalAllocations - tag.LastAllocations) * 1000.0 / elapsed);
+            tag.Stats.ByteRate = (float)((tag.Stats.TotalBytes - tag.LastBytes) * 1000.0 / elapsed);
+        }
+        tag.LastAllocations = tag.Stats.TotalAllocations;
+        tag.LastBytes = tag.Stats.TotalBytes;
+    }
+    RateSampleTime = now;
+}
+
+// These expect the lock to be held.
+static void RecordAllocation(void* pointer, size_t size, const char* identifier) {
+    Uint32 tag = GetTag(identifier);
+    if (!TagCount)
+        return;
+
+    Tags[tag].Stats.TotalAllocations++;
+    Tags[tag].Stats.TotalBytes += size;
+
+    if (!identifier && !Memory::IsTracking)
+        return;
+
+    // Anything still recorded here was freed without us hearing of it.
+    MemoryRecord* record = FindRecord(pointer);
+    if (record)
+        RemoveLive(record->Tag, record->Size);
+    else
+        record = InsertRecord(pointer);
+    if (!record)
+        return;
+
+    record->Size = size;
+    record->Tag = tag;
+    AddLive(tag, size);
+    LastRecorded = pointer;
+}
+static bool RemoveRecord(void* pointer, size_t* size, Uint32* tag) {
+    MemoryRecord* record = FindRecord(pointer);
+    if (!record)
+        return false;
+
+    RemoveLive(record->Tag, record->Size);
+    if (size)
+        *size = record->Size;
+    if (tag)
+        *tag = record->Tag;
+    EraseRecord(record);
+    return true;
+}
+// Moves a record, along with its allocation, over to another tag.
+static void RetagRecord(MemoryRecord* record, size_t size, const char* identifier) {
+    Uint32 tag = GetTag(identifier);
+
+    MemoryTagStats& from = Tags[record->Tag].Stats;
+    from.TotalAllocations--;
+    from.TotalBytes -= record->Size;
+    RemoveLive(record->Tag, record->Size);
+
+    Tags[tag].Stats.TotalAllocations++;
+    Tags[tag].Stats.TotalBytes += size;
+    record->Size = size;
+    record->Tag = tag;
+    AddLive(tag, size);
+}
 
 PUBLIC STATIC void   Memory::Memset4(void* dst, Uint32 val, size_t dwords) {
     #if defined(__GNUC__) && defined(i386)
@@ -55,199 +353,232 @@ PUBLIC STATIC void   Memory::Memset4(void* dst, Uint32 val, size_t dwords) {
 
 PUBLIC STATIC void*  Memory::Malloc(size_t size) {
     void* mem = malloc(size);
-    if (Memory::IsTracking) {
-        if (mem) {
-            MemoryUsage += size;
-
-            TrackedMemory.push_back(mem);
-            TrackedSizes.push_back(size);
-            TrackedMemoryNames.push_back(NULL);
-        }
-        else {
+    if (!mem) {
+        if (Memory::IsTracking)
             Log::Print(Log::LOG_ERROR, "Could not allocate memory for Malloc!");
-        }
+    }
+    else if (IsRecording()) {
+        SDL_AtomicLock(&TrackerLock);
+        RecordAllocation(mem, size, NULL);
+        SDL_AtomicUnlock(&TrackerLock);
     }
     return mem;
 }
 PUBLIC STATIC void*  Memory::Calloc(size_t count, size_t size) {
     void* mem = calloc(count, size);
-    if (Memory::IsTracking) {
-        if (mem) {
-            MemoryUsage += count * size;
-
-            TrackedMemory.push_back(mem);
-            TrackedSizes.push_back(count * size);
-            TrackedMemoryNames.push_back(NULL);
-        }
-        else {
+    if (!mem) {
+        if (Memory::IsTracking)
             Log::Print(Log::LOG_ERROR, "Could not allocate memory for Calloc!");
-        }
+    }
+    else if (IsRecording()) {
+        SDL_AtomicLock(&TrackerLock);
+        RecordAllocation(mem, count * size, NULL);
+        SDL_AtomicUnlock(&TrackerLock);
     }
     return mem;
 }
 PUBLIC STATIC void*  Memory::Realloc(void* pointer, size_t size) {
-    void* mem = realloc(pointer, size);
-    if (Memory::IsTracking) {
-        if (mem) {
-            for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
-                if (TrackedMemory[i] == pointer) {
-                    MemoryUsage += size - TrackedSizes[i];
-
-                    TrackedMemory[i] = mem;
-                    TrackedSizes[i] = size;
-                    return mem;
-                }
-            }
-        }
-        else {
-            Log::Print(Log::LOG_ERROR, "Could not allocate memory for Realloc!");
-        }
+    if (!IsRecording())
+        return realloc(pointer, size);
+
+    // Taken out first, since another thread could be handed the old
+    // address as soon as it's freed.
+    size_t oldSize = 0;
+    Uint32 tag = 0;
+    bool recorded = false;
+    if (pointer) {
+        SDL_AtomicLock(&TrackerLock);
+        recorded = RemoveRecord(pointer, &oldSize, &tag);
+        SDL_AtomicUnlock(&TrackerLock);
     }
+
+    void* mem = realloc(pointer, size);
+
+    SDL_AtomicLock(&TrackerLock);
+    if (mem)
+        RecordAllocation(mem, size, recorded ? Tags[tag].Stats.Name : NULL);
+    else if (recorded && size)
+        RecordAllocation(pointer, oldSize, Tags[tag].Stats.Name);
+    SDL_AtomicUnlock(&TrackerLock);
+
+    if (!mem && Memory::IsTracking)
+        Log::Print(Log::LOG_ERROR, "Could not allocate memory for Realloc!");
     return mem;
 }
 // Tracking functions
 PUBLIC STATIC void*  Memory::TrackedMalloc(const char* identifier, size_t size) {
     void* mem = malloc(size);
-    if (Memory::IsTracking) {
-        if (mem) {
-            MemoryUsage += size;
-
-            TrackedMemory.push_back(mem);
-            TrackedSizes.push_back(size);
-            TrackedMemoryNames.push_back(identifier);
-        }
-        else {
-            Log::Print(Log::LOG_ERROR, "Could not allocate memory for TrackedMalloc!");
-        }
-    }
-    else if (!mem) {
+    if (!mem) {
         Log::Print(Log::LOG_ERROR, "Could not allocate memory for TrackedMalloc!");
     }
+    else if (IsRecording()) {
+        SDL_AtomicLock(&TrackerLock);
+        RecordAllocation(mem, size, identifier);
+        SDL_AtomicUnlock(&TrackerLock);
+    }
     return mem;
 }
 PUBLIC STATIC void*  Memory::TrackedCalloc(const char* identifier, size_t count, size_t size) {
     void* mem = calloc(count, size);
-    if (Memory::IsTracking) {
-        if (mem) {
-            MemoryUsage += count * size;
-
-            TrackedMemory.push_back(mem);
-            TrackedSizes.push_back(count * size);
-            TrackedMemoryNames.push_back(identifier);
-        }
-        else {
+    if (!mem) {
+        if (Memory::IsTracking)
             Log::Print(Log::LOG_ERROR, "Could not allocate memory for TrackedCalloc!");
-        }
+    }
+    else if (IsRecording()) {
+        SDL_AtomicLock(&TrackerLock);
+        RecordAllocation(mem, count * size, identifier);
+        SDL_AtomicUnlock(&TrackerLock);
     }
     return mem;
 }
 PUBLIC STATIC void   Memory::Track(void* pointer, const char* identifier) {
-    if (Memory::IsTracking) {
-        for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
-            if (TrackedMemory[i] == pointer) {
-                TrackedMemoryNames[i] = identifier;
-                return;
-            }
-        }
-    }
+    if (!IsRecording())
+        return;
+
+    SDL_AtomicLock(&TrackerLock);
+    MemoryRecord* record = FindRecord(pointer);
+    if (record)
+        RetagRecord(record, record->Size, identifier);
+    SDL_AtomicUnlock(&TrackerLock);
 }
 PUBLIC STATIC void   Memory::Track(void* pointer, size_t size, const char* identifier) {
-    if (Memory::IsTracking) {
-        for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
-            if (TrackedMemory[i] == pointer) {
-                TrackedSizes[i] = size;
-                TrackedMemoryNames[i] = identifier;
-                return;
-            }
-        }
+    if (!IsRecording())
+        return;
 
-        TrackedMemory.push_back(pointer);
-        TrackedSizes.push_back(size);
-        TrackedMemoryNames.push_back(identifier);
-    }
+    SDL_AtomicLock(&TrackerLock);
+    MemoryRecord* record = FindRecord(pointer);
+    if (record)
+        RetagRecord(record, size, identifier);
+    else
+        RecordAllocation(pointer, size, identifier);
+    SDL_AtomicUnlock(&TrackerLock);
 }
 PUBLIC STATIC void   Memory::TrackLast(const char* identifier) {
-    if (Memory::IsTracking) {
-        if (TrackedMemoryNames.size() == 0) return;
-        TrackedMemoryNames[TrackedMemoryNames.size() - 1] = identifier;
-    }
+    if (!IsRecording())
+        return;
+
+    SDL_AtomicLock(&TrackerLock);
+    MemoryRecord* record = LastRecorded ? FindRecord(LastRecorded) : NULL;
+    if (record)
+        RetagRecord(record, record->Size, identifier);
+    SDL_AtomicUnlock(&TrackerLock);
 }
 PUBLIC STATIC void   Memory::Free(void* pointer) {
-    if (Memory::IsTracking) {
+    if (!pointer) return;
+
+    if (IsRecording()) {
+        size_t size = 0;
+        SDL_AtomicLock(&TrackerLock);
+        bool recorded = RemoveRecord(pointer, &size, NULL);
+        SDL_AtomicUnlock(&TrackerLock);
+
         #ifdef DEBUG
-        for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
-            if (TrackedMemory[i] == pointer) {
-                // 32-bit
-                size_t ptr_size = sizeof(void*);
-                if (ptr_size == 4) {
-                    size_t* debug = (size_t*)TrackedMemory[i];
-                    for (size_t d = 0, dSz = TrackedSizes[i] / ptr_size; d < dSz; d++) {
-                        debug[d] = 0xCDCDCDCDU;
-                    }
+        if (recorded && Memory::IsTracking) {
+            // 32-bit
+            size_t ptr_size = sizeof(void*);
+            if (ptr_size == 4) {
+                size_t* debug = (size_t*)pointer;
+                for (size_t d = 0, dSz = size / ptr_size; d < dSz; d++) {
+                    debug[d] = 0xCDCDCDCDU;
                 }
-                // 64-bit
-                else if (ptr_size == 8) {
-                    size_t* debug = (size_t*)TrackedMemory[i];
-                    for (size_t d = 0, dSz = TrackedSizes[i] / ptr_size; d < dSz; d++) {
-                        debug[d] = 0xCDCDCDCDCDCDCDCDU;
-                    }
+            }
+            // 64-bit
+            else if (ptr_size == 8) {
+                size_t* debug = (size_t*)pointer;
+                for (size_t d = 0, dSz = size / ptr_size; d < dSz; d++) {
+                    debug[d] = 0xCDCDCDCDCDCDCDCDU;
                 }
-                break;
             }
         }
+        #else
+        (void)recorded;
         #endif
     }
-    Memory::Remove(pointer);
-    if (!pointer) return;
 
     free(pointer);
 }
 PUBLIC STATIC void   Memory::Remove(void* pointer) {
     if (!pointer) return;
-    if (Memory::IsTracking) {
-        for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
-            if (TrackedMemory[i] == pointer) {
-                MemoryUsage -= TrackedSizes[i];
-                // printf("TrackedSizes[i]: %zu\n", TrackedSizes[i]);
-
-                TrackedMemoryNames.erase(TrackedMemoryNames.begin() + i);
-                TrackedMemory.erase(TrackedMemory.begin() + i);
-                TrackedSizes.erase(TrackedSizes.begin() + i);
-                return;
-            }
-        }
+    if (IsRecording()) {
+        SDL_AtomicLock(&TrackerLock);
+        RemoveRecord(pointer, NULL, NULL);
+        SDL_AtomicUnlock(&TrackerLock);
     }
 }
 
 PUBLIC STATIC const char* Memory::GetName(void* pointer) {
-    if (Memory::IsTracking) {
-        for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
-            if (TrackedMemory[i] == pointer) {
-                return TrackedMemoryNames[i];
-            }
-        }
+    const char* name = NULL;
+    if (IsRecording()) {
+        SDL_AtomicLock(&TrackerLock);
+        MemoryRecord* record = FindRecord(pointer);
+        if (record)
+            name = Tags[record->Tag].Stats.Name;
+        SDL_AtomicUnlock(&TrackerLock);
     }
-    return NULL;
+    return name;
+}
+
+// Fills the list with every tag that's been allocated with, biggest
+// first. Rates are worked out over the time since the last call, once
+// at least a second has gone by.
+PUBLIC STATIC void   Memory::GetTagStats(vector<MemoryTagStats>* stats) {
+    stats->clear();
+
+    SDL_AtomicLock(&TrackerLock);
+    UpdateRates();
+    for (Uint32 i = 0; i < TagCount; i++) {
+        if (Tags[i].Stats.TotalAllocations)
+            stats->push_back(Tags[i].Stats);
+    }
+    SDL_AtomicUnlock(&TrackerLock);
+
+    std::sort(stats->begin(), stats->end(), [](const MemoryTagStats& a, const MemoryTagStats& b) -> bool {
+        return a.LiveBytes > b.LiveBytes;
+    });
 }
 
 PUBLIC STATIC void   Memory::ClearTrackedMemory() {
-    TrackedMemoryNames.clear();
-    TrackedMemory.clear();
-    TrackedSizes.clear();
+    SDL_AtomicLock(&TrackerLock);
+    free(Records);
+    Records = NULL;
+    RecordCapacity = 0;
+    RecordCount = 0;
+    LastRecorded = NULL;
+    for (Uint32 i = 0; i < TagCount; i++) {
+        Tags[i].Stats.LiveBytes = 0;
+        Tags[i].Stats.LiveCount = 0;
+    }
+    MemoryUsage = 0;
+    SDL_AtomicUnlock(&TrackerLock);
 }
 PUBLIC STATIC size_t Memory::CheckLeak() {
     size_t total = 0;
-    for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
-        total += TrackedSizes[i];
+    SDL_AtomicLock(&TrackerLock);
+    for (Uint32 i = 0; i < RecordCapacity; i++) {
+        if (Records[i].Pointer)
+            total += Records[i].Size;
     }
+    SDL_AtomicUnlock(&TrackerLock);
     return total;
 }
 PUBLIC STATIC void   Memory::PrintLeak() {
+    // Copied out first, since logging could allocate.
+    vector<MemoryRecord> records;
+    vector<const char*> names;
+    SDL_AtomicLock(&TrackerLock);
+    for (Uint32 i = 0; i < RecordCapacity; i++) {
+        if (Records[i].Pointer) {
+            records.push_back(Records[i]);
+            names.push_back(Tags[Records[i].Tag].Stats.Name);
+        }
+    }
+    SDL_AtomicUnlock(&TrackerLock);
+
     size_t total = 0;
-    Log::Print(Log::LOG_VERBOSE, "Printing unfreed memory... (%u count)", TrackedMemory.size());
-    for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
-        Log::Print(Log::LOG_VERBOSE, " : %p [%u bytes] (%s)", TrackedMemory[i], TrackedSizes[i], TrackedMemoryNames[i] ? TrackedMemoryNames[i] : "no name");
-        total += TrackedSizes[i];
+    Log::Print(Log::LOG_VERBOSE, "Printing unfreed memory... (%u count)", records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        Log::Print(Log::LOG_VERBOSE, " : %p [%u bytes] (%s)", records[i].Pointer, records[i].Size, names[i] ? names[i] : "no name");
+        total += records[i].Size;
     }
     Log::Print(Log::LOG_VERBOSE, "Total: %u bytes (%.3f MB)", total, total / 1024 / 1024.0);
 }
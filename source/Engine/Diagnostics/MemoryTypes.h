@@ -0,0 +1,16 @@
+#ifndef ENGINE_DIAGNOSTICS_MEMORYTYPES
+#define ENGINE_DIAGNOSTICS_MEMORYTYPES
+
+struct MemoryTagStats {
+    const char* Name;
+    size_t      LiveBytes;
+    size_t      PeakBytes;
+    Uint32      LiveCount;
+    Uint64      TotalAllocations;
+    Uint64      TotalBytes;
+    // Per second, since the last time the stats were read
+    float       AllocationRate;
+    float       ByteRate;
+};
+
+#endif /* ENGINE_DIAGNOSTICS_MEMORYTYPES */
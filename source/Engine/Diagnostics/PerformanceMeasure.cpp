@@ -4,20 +4,23 @@
 
 class PerformanceMeasure {
 public:
-    static bool            Initialized;
-    static Perf_ViewRender PERF_ViewRender[MAX_SCENE_VIEWS];
+    static bool             Initialized;
+    static Perf_Application PERF_Application;
+    static Perf_ViewRender  PERF_ViewRender[MAX_SCENE_VIEWS];
 };
 #endif
 
 #include <Engine/Diagnostics/PerformanceMeasure.h>
 
-bool            PerformanceMeasure::Initialized = false;
-Perf_ViewRender PerformanceMeasure::PERF_ViewRender[MAX_SCENE_VIEWS];
+bool             PerformanceMeasure::Initialized = false;
+Perf_Application PerformanceMeasure::PERF_Application;
+Perf_ViewRender  PerformanceMeasure::PERF_ViewRender[MAX_SCENE_VIEWS];
 
 PUBLIC STATIC void PerformanceMeasure::Init() {
     if (PerformanceMeasure::Initialized)
         return;
 
     PerformanceMeasure::Initialized = true;
+    memset(&PerformanceMeasure::PERF_Application, 0, sizeof(PerformanceMeasure::PERF_Application));
     memset(PerformanceMeasure::PERF_ViewRender, 0, sizeof(PerformanceMeasure::PERF_ViewRender));
 }
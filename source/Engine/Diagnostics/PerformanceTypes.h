@@ -23,6 +23,15 @@ struct Perf_ViewRender {
     double RenderFinishTime;
     double RenderTime;
 };
+struct Perf_Renderer {
+    Uint32 DrawCalls;
+    Uint32 SpriteBatches;
+    Uint32 BatchedSprites;
+    Uint32 TextureBinds;
+    // Sprite draws that changed sheets without changing textures,
+    // because both sheets are on the same atlas page
+    Uint32 AtlasSheetSwitches;
+};
 
 
 #endif /* ENGINE_DIAGNOSTICS_PERFORMANCETYPES */
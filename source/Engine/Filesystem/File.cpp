@@ -17,6 +17,7 @@ private:
 #else
     #include <unistd.h>
 #endif
+#include <sys/stat.h>
 
 #if MACOSX || ANDROID
 #include <Engine/Includes/StandardSDL2.h>
@@ -60,6 +61,18 @@ PUBLIC STATIC bool File::Exists(const char* path) {
     #endif
 }
 
+PUBLIC STATIC bool   File::GetInfo(const char* path, Uint64* size, Sint64* modifiedTime) {
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return false;
+
+    if (size)
+        *size = (Uint64)st.st_size;
+    if (modifiedTime)
+        *modifiedTime = (Sint64)st.st_mtime;
+    return true;
+}
+
 PUBLIC STATIC size_t File::ReadAllBytes(const char* path, char** out) {
     FileStream* stream;
     if ((stream = FileStream::New(path, FileStream::READ_ACCESS))) {
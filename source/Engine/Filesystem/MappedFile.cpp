@@ -0,0 +1,108 @@
+#if INTERFACE
+
+#include <Engine/Includes/Standard.h>
+
+class MappedFile {
+public:
+    Uint8* Data = NULL;
+    size_t Size = 0;
+    void*  FileHandle = NULL;
+    void*  MappingHandle = NULL;
+};
+#endif
+
+#include <Engine/Filesystem/MappedFile.h>
+
+#if WIN32
+    #include <windows.h>
+#elif LINUX || MACOSX
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define CAN_MAP_FILES
+#endif
+
+PRIVATE bool MappedFile::Map(const char* filename) {
+#if WIN32
+    HANDLE fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(fileHandle, &size) || size.QuadPart == 0) {
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    HANDLE mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mappingHandle) {
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    void* data = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    Data = (Uint8*)data;
+    Size = (size_t)size.QuadPart;
+    FileHandle = (void*)fileHandle;
+    MappingHandle = (void*)mappingHandle;
+    return true;
+#elif defined(CAN_MAP_FILES)
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    Data = (Uint8*)data;
+    Size = (size_t)st.st_size;
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Maps a whole file read-only. Returns NULL when the platform can't map
+// files (or this one), so callers should fall back to regular reads.
+PUBLIC STATIC MappedFile* MappedFile::Open(const char* filename) {
+    MappedFile* file = new (std::nothrow) MappedFile;
+    if (!file)
+        return NULL;
+
+    if (!file->Map(filename)) {
+        delete file;
+        return NULL;
+    }
+    return file;
+}
+
+PUBLIC void MappedFile::Close() {
+#if WIN32
+    if (Data)
+        UnmapViewOfFile(Data);
+    if (MappingHandle)
+        CloseHandle((HANDLE)MappingHandle);
+    if (FileHandle)
+        CloseHandle((HANDLE)FileHandle);
+#elif defined(CAN_MAP_FILES)
+    if (Data)
+        munmap(Data, Size);
+#endif
+    delete this;
+}
@@ -15,6 +15,7 @@ public:
 #include <Engine/FontFace.h>
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
+#include <Engine/Rendering/TextureAtlas.h>
 
 #ifdef USING_FREETYPE
     #include <ft2build.h>
@@ -216,8 +217,10 @@ PUBLIC STATIC ISprite* FontFace::SpriteFromFont(Stream* stream, int pixelSize, c
 		}
 	}
 
-    sprite->Spritesheets[0] = Graphics::CreateTextureFromPixels(package->Width, package->Height, pixelData, package->Width * sizeof(Uint32));
-    sprite->SpritesheetsBorrowed[0] = false;
+    sprite->Spritesheets[0] = TextureAtlas::AddPixels(pixelData, package->Width, package->Height, &sprite->SpritesheetsOffsetX[0], &sprite->SpritesheetsOffsetY[0]);
+    sprite->SpritesheetsBorrowed[0] = sprite->Spritesheets[0] != NULL;
+    if (!sprite->Spritesheets[0])
+        sprite->Spritesheets[0] = Graphics::CreateTextureFromPixels(package->Width, package->Height, pixelData, package->Width * sizeof(Uint32));
     sprite->SpritesheetCount = 1;
 
 	// Add preliminary chars
@@ -3,6 +3,7 @@
 #include <Engine/Includes/StandardSDL2.h>
 
 #include <Engine/Application.h>
+#include <Engine/Diagnostics/PerformanceTypes.h>
 #include <Engine/Math/Matrix4x4.h>
 #include <Engine/ResourceTypes/ISprite.h>
 #include <Engine/ResourceTypes/IModel.h>
@@ -85,9 +86,13 @@ public:
     static bool                 UseTinting;
     static bool                 UseDepthTesting;
     static bool                 UseSoftwareRenderer;
+    static bool                 SpriteBatching;
 
     static unsigned             CurrentFrame;
 
+    static Perf_Renderer        FrameStats;
+    static Perf_Renderer        PERF_Renderer;
+
     // Rendering functions
     static GraphicsFunctions    Internal;
     static GraphicsFunctions*   GfxFunctions;
@@ -102,6 +107,8 @@ public:
 #include <Engine/Math/Math.h>
 
 #include <Engine/Rendering/Software/SoftwareRenderer.h>
+#include <Engine/Rendering/TextureAtlas.h>
+#include <Engine/Rendering/Headless/HeadlessRenderer.h>
 #ifdef USING_OPENGL
     #include <Engine/Rendering/GL/GLRenderer.h>
 #endif
@@ -174,13 +181,22 @@ bool                 Graphics::UsePaletteIndexLines = false;
 bool                 Graphics::UseTinting = false;
 bool                 Graphics::UseDepthTesting = false;
 bool                 Graphics::UseSoftwareRenderer = false;
+bool                 Graphics::SpriteBatching = true;
 
 unsigned             Graphics::CurrentFrame = 0;
 
+Perf_Renderer        Graphics::FrameStats = {};
+Perf_Renderer        Graphics::PERF_Renderer = {};
+
 GraphicsFunctions    Graphics::Internal;
 GraphicsFunctions*   Graphics::GfxFunctions = &Graphics::Internal;
 const char*          Graphics::Renderer = "default";
 
+// The last sprite sheet drawn from, for counting atlas sheet switches
+static Texture* LastSheetTexture = NULL;
+static int      LastSheetX = 0;
+static int      LastSheetY = 0;
+
 PUBLIC STATIC void     Graphics::Init() {
     Graphics::TextureMap = new HashMap<Texture*>(NULL, 32);
     Graphics::SpriteSheetTextureMap = new HashMap<Texture*>(NULL, 32);
@@ -221,6 +237,11 @@ PUBLIC STATIC void     Graphics::ChooseBackend() {
 
     // Set renderers
     Graphics::Renderer = NULL;
+    if (Application::Headless) {
+        Graphics::Renderer = "headless";
+        HeadlessRenderer::SetGraphicsFunctions();
+        return;
+    }
     if (Application::Settings->GetString("dev", "renderer", renderer, sizeof renderer)) {
         #ifdef USING_OPENGL
             if (!strcmp(renderer, "opengl")) {
@@ -308,6 +329,8 @@ PUBLIC STATIC void     Graphics::Reset() {
     Graphics::StencilOpFail = StencilOp_Keep;
 }
 PUBLIC STATIC void     Graphics::Dispose() {
+    TextureAtlas::Dispose();
+
     for (Uint32 i = 0; i < Graphics::VertexBuffers.size(); i++)
         Graphics::DeleteVertexBuffer(i);
     Graphics::VertexBuffers.clear();
@@ -324,6 +347,8 @@ PUBLIC STATIC void     Graphics::Dispose() {
 
     Graphics::SpriteSheetTextureMap->Clear();
 
+    if (Graphics::GfxFunctions != &SoftwareRenderer::BackendFunctions)
+        SoftwareRenderer::Dispose();
     Graphics::GfxFunctions->Dispose();
 
     delete Graphics::TextureMap;
@@ -395,7 +420,20 @@ PUBLIC STATIC int      Graphics::LockTexture(Texture* texture, void** pixels, in
     return Graphics::GfxFunctions->LockTexture(texture, pixels, pitch);
 }
 PUBLIC STATIC int      Graphics::UpdateTexture(Texture* texture, SDL_Rect* src, void* pixels, int pitch) {
-    memcpy(texture->Pixels, pixels, sizeof(Uint32) * texture->Width * texture->Height);
+    // The software renderer (also under the headless one) draws from
+    // these pixels, so anything it's recorded against the old ones has
+    // to be drawn first. Nothing is recorded with other renderers.
+    SoftwareRenderer::FlushCommands();
+
+    if (src) {
+        // Only the part of the texture being updated
+        Uint32* dest = (Uint32*)texture->Pixels + src->y * texture->Width + src->x;
+        for (int y = 0; y < src->h; y++)
+            memcpy(dest + y * texture->Width, (Uint8*)pixels + y * pitch, sizeof(Uint32) * src->w);
+    }
+    else if (texture->Pixels != pixels) {
+        memcpy(texture->Pixels, pixels, sizeof(Uint32) * texture->Width * texture->Height);
+    }
     if (Graphics::GfxFunctions == &SoftwareRenderer::BackendFunctions ||
         Graphics::NoInternalTextures)
         return 1;
@@ -410,6 +448,8 @@ PUBLIC STATIC int      Graphics::UpdateYUVTexture(Texture* texture, SDL_Rect* sr
     return Graphics::GfxFunctions->UpdateYUVTexture(texture, src, pixelsY, pitchY, pixelsU, pitchU, pixelsV, pitchV);
 }
 PUBLIC STATIC int      Graphics::SetTexturePalette(Texture* texture, void* palette, unsigned numPaletteColors) {
+    SoftwareRenderer::FlushCommands();
+
     texture->SetPalette((Uint32*)palette, numPaletteColors);
     if (Graphics::GfxFunctions == &SoftwareRenderer::BackendFunctions ||
         !Graphics::GfxFunctions->SetTexturePalette || Graphics::NoInternalTextures)
@@ -417,6 +457,8 @@ PUBLIC STATIC int      Graphics::SetTexturePalette(Texture* texture, void* palet
     return Graphics::GfxFunctions->SetTexturePalette(texture, palette, numPaletteColors);
 }
 PUBLIC STATIC int      Graphics::ConvertTextureToRGBA(Texture* texture) {
+    SoftwareRenderer::FlushCommands();
+
     texture->ConvertToRGBA();
     if (Graphics::GfxFunctions == &SoftwareRenderer::BackendFunctions ||
         Graphics::NoInternalTextures)
@@ -430,6 +472,8 @@ PUBLIC STATIC int      Graphics::ConvertTextureToPalette(Texture* texture, unsig
 
     memcpy(colors, Graphics::PaletteColors[paletteNumber], 256 * sizeof(Uint32));
 
+    SoftwareRenderer::FlushCommands();
+
     texture->ConvertToPalette(colors, 256);
     texture->SetPalette(colors, 256);
 
@@ -522,6 +566,12 @@ PUBLIC STATIC void     Graphics::Clear() {
 PUBLIC STATIC void     Graphics::Present() {
     Graphics::GfxFunctions->Present();
     Graphics::CurrentFrame++;
+
+    // Keep the counts from the frame that was just shown around
+    // for the performance snapshot.
+    Graphics::PERF_Renderer = Graphics::FrameStats;
+    memset(&Graphics::FrameStats, 0, sizeof(Graphics::FrameStats));
+    LastSheetTexture = NULL;
 }
 
 PUBLIC STATIC void     Graphics::SoftwareStart() {
@@ -897,10 +947,35 @@ PUBLIC STATIC void     Graphics::FillRectangle(float x, float y, float w, float
 PUBLIC STATIC void     Graphics::DrawTexture(Texture* texture, float sx, float sy, float sw, float sh, float x, float y, float w, float h) {
     Graphics::GfxFunctions->DrawTexture(texture, sx, sy, sw, sh, x, y, w, h);
 }
+// Counts sprite draws that switch to another sheet on the same atlas
+// page. Without the atlas, every one of these would have been a texture
+// bind, and a new sprite batch.
+PRIVATE STATIC void     Graphics::CountSheetSwitch(ISprite* sprite, int animation, int frame) {
+    if (!sprite || animation < 0 || animation >= (int)sprite->Animations.size())
+        return;
+    if (frame < 0 || frame >= (int)sprite->Animations[animation].Frames.size())
+        return;
+
+    int sheet = sprite->Animations[animation].Frames[frame].SheetNumber;
+    if (sheet < 0 || sheet >= sprite->SpritesheetCount)
+        return;
+
+    Texture* texture = sprite->Spritesheets[sheet];
+    int sheetX = sprite->SpritesheetsOffsetX[sheet];
+    int sheetY = sprite->SpritesheetsOffsetY[sheet];
+    if (texture == LastSheetTexture && (sheetX != LastSheetX || sheetY != LastSheetY))
+        Graphics::FrameStats.AtlasSheetSwitches++;
+
+    LastSheetTexture = texture;
+    LastSheetX = sheetX;
+    LastSheetY = sheetY;
+}
 PUBLIC STATIC void     Graphics::DrawSprite(ISprite* sprite, int animation, int frame, int x, int y, bool flipX, bool flipY, float scaleW, float scaleH, float rotation, unsigned paletteID) {
+    Graphics::CountSheetSwitch(sprite, animation, frame);
     Graphics::GfxFunctions->DrawSprite(sprite, animation, frame, x, y, flipX, flipY, scaleW, scaleH, rotation, paletteID);
 }
 PUBLIC STATIC void     Graphics::DrawSpritePart(ISprite* sprite, int animation, int frame, int sx, int sy, int sw, int sh, int x, int y, bool flipX, bool flipY, float scaleW, float scaleH, float rotation, unsigned paletteID) {
+    Graphics::CountSheetSwitch(sprite, animation, frame);
     Graphics::GfxFunctions->DrawSpritePart(sprite, animation, frame, sx, sy, sw, sh, x, y, flipX, flipY, scaleW, scaleH, rotation, paletteID);
 }
 PUBLIC STATIC void     Graphics::DrawSprite(ISprite* sprite, int animation, int frame, int x, int y, bool flipX, bool flipY, float scaleW, float scaleH, float rotation) {
@@ -910,9 +985,17 @@ PUBLIC STATIC void     Graphics::DrawSpritePart(ISprite* sprite, int animation,
     DrawSpritePart(sprite, animation, frame, sx, sy, sw, sh, x, y, flipX, flipY, scaleW, scaleH, rotation, 0);
 }
 
+PRIVATE STATIC bool     Graphics::CanUseSoftwareDraws() {
+    if (Graphics::GfxFunctions == &SoftwareRenderer::BackendFunctions)
+        return true;
+
+    // The headless renderer is the software renderer too, as long as
+    // there's a render target to draw into.
+    return Application::Headless && Graphics::CurrentRenderTarget;
+}
 PUBLIC STATIC void     Graphics::DrawTile(int tile, int x, int y, bool flipX, bool flipY) {
     // If possible, uses optimized software-renderer call instead.
-    if (Graphics::GfxFunctions == &SoftwareRenderer::BackendFunctions) {
+    if (Graphics::CanUseSoftwareDraws()) {
         SoftwareRenderer::DrawTile(tile, x, y, flipX, flipY);
         return;
     }
@@ -1193,7 +1276,7 @@ PUBLIC STATIC void     Graphics::DrawSceneLayer_VerticalParallax(SceneLayer* lay
 }
 PUBLIC STATIC void     Graphics::DrawSceneLayer(SceneLayer* layer, View* currentView, int layerIndex, bool useCustomFunction) {
     // If possible, uses optimized software-renderer call instead.
-    if (Graphics::GfxFunctions == &SoftwareRenderer::BackendFunctions) {
+    if (Graphics::CanUseSoftwareDraws()) {
         SoftwareRenderer::DrawSceneLayer(layer, currentView, layerIndex, useCustomFunction);
         return;
     }
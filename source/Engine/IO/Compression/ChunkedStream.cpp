@@ -0,0 +1,290 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/IO/Stream.h>
+class ChunkedStream : public Stream {
+public:
+    Uint8*  source_data = NULL;
+    Stream* source_stream = NULL;
+    size_t  source_offset = 0;
+    size_t  source_size = 0;
+
+    size_t  size = 0;
+    size_t  position = 0;
+
+    Uint32  chunk_size = 0;
+    Uint32  chunk_count = 0;
+    Uint64* chunk_offsets = NULL;
+
+    Uint8*  chunk = NULL;
+    Uint32  chunk_index = 0xFFFFFFFFU;
+    Uint8*  input = NULL;
+};
+#endif
+
+#include <Engine/IO/Compression/ChunkedStream.h>
+#include <Engine/IO/Compression/LZ4.h>
+#include <Engine/Diagnostics/Memory.h>
+
+// Data compressed as separate LZ4 chunks, with an index up front:
+//
+//     Uint32 chunkSize
+//     Uint32 chunkCount
+//     Uint64 chunkOffsets[chunkCount + 1]
+//
+// Offsets are from the start of the index. Every chunk but the last
+// holds chunkSize bytes once decompressed, and one that's no smaller
+// than that compressed is stored as is. Only the chunk being read from
+// is ever decompressed, so seeking anywhere is cheap.
+
+#define CHUNKED_STREAM_CHUNK_SIZE 0x10000
+#define CHUNKED_STREAM_MAX_CHUNK_SIZE 0x1000000
+
+static Uint32 GetChunkCount(size_t size, Uint32 chunkSize) {
+    return (Uint32)((size + chunkSize - 1) / chunkSize);
+}
+static size_t GetIndexSize(Uint32 chunkCount) {
+    return 8 + ((size_t)chunkCount + 1) * sizeof(Uint64);
+}
+// Checks an index against what it's supposed to describe.
+static bool CheckIndex(Uint32 chunkSize, Uint32 chunkCount, Uint64* offsets, size_t payloadSize, size_t size) {
+    if (chunkSize == 0 || chunkSize > CHUNKED_STREAM_MAX_CHUNK_SIZE || chunkCount != GetChunkCount(size, chunkSize))
+        return false;
+    if (offsets[0] != GetIndexSize(chunkCount) || offsets[chunkCount] > payloadSize)
+        return false;
+
+    for (Uint32 i = 0; i < chunkCount; i++) {
+        if (offsets[i + 1] < offsets[i] || offsets[i + 1] - offsets[i] > LZ4::GetMaxCompressedSize(chunkSize))
+            return false;
+    }
+    return true;
+}
+static bool DecompressChunk(Uint8* in, size_t in_sz, Uint8* out, size_t out_sz) {
+    if (in_sz == out_sz) {
+        memcpy(out, in, out_sz);
+        return true;
+    }
+    return LZ4::Decompress(in, in_sz, out, out_sz);
+}
+
+// Compresses data into the chunked layout. Returns NULL if it can't.
+PUBLIC STATIC Uint8* ChunkedStream::Compress(Uint8* data, size_t size, size_t* payloadSize) {
+    Uint32 chunkCount = GetChunkCount(size, CHUNKED_STREAM_CHUNK_SIZE);
+    size_t indexSize = GetIndexSize(chunkCount);
+    size_t maxSize = indexSize + (size_t)chunkCount * LZ4::GetMaxCompressedSize(CHUNKED_STREAM_CHUNK_SIZE);
+
+    Uint8* payload = (Uint8*)Memory::Malloc(maxSize);
+    if (!payload)
+        return NULL;
+
+    Uint32 header[2] = { CHUNKED_STREAM_CHUNK_SIZE, chunkCount };
+    memcpy(payload, header, sizeof header);
+
+    Uint64* offsets = (Uint64*)(payload + 8);
+    Uint64 offset = indexSize;
+    for (Uint32 i = 0; i < chunkCount; i++) {
+        size_t start = (size_t)i * CHUNKED_STREAM_CHUNK_SIZE;
+        size_t length = size - start < CHUNKED_STREAM_CHUNK_SIZE ? size - start : CHUNKED_STREAM_CHUNK_SIZE;
+
+        size_t compressed = LZ4::Compress(data + start, length, payload + offset, maxSize - offset);
+        if (compressed == 0 || compressed >= length) {
+            memcpy(payload + offset, data + start, length);
+            compressed = length;
+        }
+
+        offsets[i] = offset;
+        offset += compressed;
+    }
+    offsets[chunkCount] = offset;
+
+    *payloadSize = (size_t)offset;
+    return payload;
+}
+// Decompresses all of it at once.
+PUBLIC STATIC bool ChunkedStream::Decompress(Uint8* payload, size_t payloadSize, Uint8* out, size_t size) {
+    if (payloadSize < 8)
+        return false;
+
+    Uint32 header[2];
+    memcpy(header, payload, sizeof header);
+    if (payloadSize < GetIndexSize(header[1]))
+        return false;
+
+    Uint64* offsets = (Uint64*)Memory::Malloc(((size_t)header[1] + 1) * sizeof(Uint64));
+    if (!offsets)
+        return false;
+    memcpy(offsets, payload + 8, ((size_t)header[1] + 1) * sizeof(Uint64));
+
+    bool success = CheckIndex(header[0], header[1], offsets, payloadSize, size);
+    for (Uint32 i = 0; success && i < header[1]; i++) {
+        size_t start = (size_t)i * header[0];
+        size_t length = size - start < header[0] ? size - start : header[0];
+        success = DecompressChunk(payload + offsets[i], (size_t)(offsets[i + 1] - offsets[i]), out + start, length);
+    }
+
+    Memory::Free(offsets);
+    return success;
+}
+
+PUBLIC STATIC ChunkedStream* ChunkedStream::New(Uint8* data, size_t payloadSize, size_t size) {
+    ChunkedStream* stream = new (std::nothrow) ChunkedStream;
+    if (!stream) {
+        return NULL;
+    }
+
+    stream->source_data = data;
+    stream->source_size = payloadSize;
+    stream->size = size;
+    if (!stream->Start()) {
+        stream->Close();
+        return NULL;
+    }
+    return stream;
+}
+// Takes over the source stream, which gets closed along with this one.
+PUBLIC STATIC ChunkedStream* ChunkedStream::New(Stream* source, size_t offset, size_t payloadSize, size_t size) {
+    ChunkedStream* stream = new (std::nothrow) ChunkedStream;
+    if (!stream) {
+        return NULL;
+    }
+
+    stream->source_stream = source;
+    stream->source_offset = offset;
+    stream->source_size = payloadSize;
+    stream->size = size;
+    if (!stream->Start()) {
+        stream->source_stream = NULL;
+        stream->Close();
+        return NULL;
+    }
+    return stream;
+}
+
+PRIVATE       bool          ChunkedStream::ReadSource(size_t offset, void* data, size_t n) {
+    if (offset > source_size || n > source_size - offset)
+        return false;
+
+    if (source_data) {
+        memcpy(data, source_data + offset, n);
+        return true;
+    }
+
+    source_stream->Seek(source_offset + offset);
+    return source_stream->ReadBytes(data, n) == n;
+}
+PRIVATE       bool          ChunkedStream::Start() {
+    Uint32 header[2];
+    if (!ReadSource(0, header, sizeof header))
+        return false;
+
+    chunk_size = header[0];
+    chunk_count = header[1];
+    if (chunk_size == 0 || chunk_size > CHUNKED_STREAM_MAX_CHUNK_SIZE || chunk_count != GetChunkCount(size, chunk_size))
+        return false;
+
+    chunk_offsets = (Uint64*)Memory::Malloc(((size_t)chunk_count + 1) * sizeof(Uint64));
+    if (!chunk_offsets || !ReadSource(8, chunk_offsets, ((size_t)chunk_count + 1) * sizeof(Uint64)))
+        return false;
+    if (!CheckIndex(chunk_size, chunk_count, chunk_offsets, source_size, size))
+        return false;
+
+    chunk = (Uint8*)Memory::Malloc(chunk_size);
+    if (!chunk)
+        return false;
+
+    if (!source_data) {
+        input = (Uint8*)Memory::Malloc(LZ4::GetMaxCompressedSize(chunk_size));
+        if (!input)
+            return false;
+    }
+    return true;
+}
+PRIVATE       bool          ChunkedStream::LoadChunk(Uint32 index) {
+    if (index == chunk_index)
+        return true;
+    if (index >= chunk_count)
+        return false;
+
+    size_t start = (size_t)index * chunk_size;
+    size_t length = size - start < chunk_size ? size - start : chunk_size;
+    size_t compressed = (size_t)(chunk_offsets[index + 1] - chunk_offsets[index]);
+
+    Uint8* from;
+    if (source_data) {
+        from = source_data + chunk_offsets[index];
+    }
+    else {
+        if (!ReadSource((size_t)chunk_offsets[index], input, compressed))
+            return false;
+        from = input;
+    }
+
+    chunk_index = 0xFFFFFFFFU;
+    if (!DecompressChunk(from, compressed, chunk, length))
+        return false;
+
+    chunk_index = index;
+    return true;
+}
+
+PUBLIC        void          ChunkedStream::Close() {
+    Memory::Free(chunk_offsets);
+    Memory::Free(chunk);
+    Memory::Free(input);
+    chunk_offsets = NULL;
+    chunk = NULL;
+    input = NULL;
+    if (source_stream) {
+        source_stream->Close();
+        source_stream = NULL;
+    }
+
+    Stream::Close();
+}
+PUBLIC        void          ChunkedStream::Seek(Sint64 offset) {
+    if (offset < 0)
+        offset = 0;
+    if ((size_t)offset > size)
+        offset = size;
+    position = (size_t)offset;
+}
+PUBLIC        void          ChunkedStream::SeekEnd(Sint64 offset) {
+    Seek((Sint64)size + offset);
+}
+PUBLIC        void          ChunkedStream::Skip(Sint64 offset) {
+    Seek((Sint64)position + offset);
+}
+PUBLIC        size_t        ChunkedStream::Position() {
+    return position;
+}
+PUBLIC        size_t        ChunkedStream::Length() {
+    return size;
+}
+
+PUBLIC        size_t        ChunkedStream::ReadBytes(void* data, size_t n) {
+    if (n > size - position) {
+        n = size - position;
+    }
+
+    size_t read = 0;
+    while (read < n) {
+        Uint32 index = (Uint32)(position / chunk_size);
+        if (!LoadChunk(index))
+            break;
+
+        size_t start = (size_t)index * chunk_size;
+        size_t length = size - start < chunk_size ? size - start : chunk_size;
+        size_t within = position - start;
+        size_t count = length - within;
+        if (count > n - read)
+            count = n - read;
+
+        memcpy((Uint8*)data + read, chunk + within, count);
+        read += count;
+        position += count;
+    }
+    return read;
+}
+PUBLIC        size_t        ChunkedStream::WriteBytes(void* data, size_t n) {
+    // Cannot write to a resource.
+    return 0;
+}
@@ -0,0 +1,180 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/IO/Stream.h>
+class InflateStream : public Stream {
+public:
+    Uint8*  source_data = NULL;
+    Stream* source_stream = NULL;
+    size_t  source_offset = 0;
+    size_t  source_size = 0;
+    size_t  source_position = 0;
+
+    size_t  size = 0;
+    size_t  position = 0;
+
+    void*   inflater = NULL;
+    Uint8*  input = NULL;
+};
+#endif
+
+#include <Engine/IO/Compression/InflateStream.h>
+#include <Engine/Diagnostics/Memory.h>
+
+#undef min
+#undef max
+
+#define MINIZ_HEADER_FILE_ONLY
+#include <Libraries/miniz.h>
+
+// Inflates a zlib stream as it's read, so only what's been read so far
+// has been decompressed. Reading front to back is what this is for;
+// seeking backwards starts over from the beginning.
+
+#define INFLATE_INPUT_SIZE 0x4000
+
+PUBLIC STATIC InflateStream* InflateStream::New(Uint8* data, size_t compressedSize, size_t size) {
+    InflateStream* stream = new (std::nothrow) InflateStream;
+    if (!stream) {
+        return NULL;
+    }
+
+    stream->source_data = data;
+    stream->source_size = compressedSize;
+    stream->size = size;
+    if (!stream->Start()) {
+        Memory::Free(stream->inflater);
+        delete stream;
+        return NULL;
+    }
+    return stream;
+}
+// Takes over the source stream, which gets closed along with this one.
+PUBLIC STATIC InflateStream* InflateStream::New(Stream* source, size_t offset, size_t compressedSize, size_t size) {
+    InflateStream* stream = new (std::nothrow) InflateStream;
+    if (!stream) {
+        return NULL;
+    }
+
+    stream->source_stream = source;
+    stream->source_offset = offset;
+    stream->source_size = compressedSize;
+    stream->size = size;
+    stream->input = (Uint8*)Memory::Malloc(INFLATE_INPUT_SIZE);
+    if (!stream->input || !stream->Start()) {
+        Memory::Free(stream->inflater);
+        Memory::Free(stream->input);
+        delete stream;
+        return NULL;
+    }
+    return stream;
+}
+
+PRIVATE       bool          InflateStream::Start() {
+    z_stream* z = (z_stream*)inflater;
+    if (!z) {
+        z = (z_stream*)Memory::Calloc(1, sizeof(z_stream));
+        if (!z)
+            return false;
+        inflater = z;
+    }
+    else {
+        inflateEnd(z);
+        memset(z, 0, sizeof(z_stream));
+    }
+
+    source_position = 0;
+    position = 0;
+    return inflateInit(z) == Z_OK;
+}
+
+PUBLIC        void          InflateStream::Close() {
+    if (inflater) {
+        inflateEnd((z_stream*)inflater);
+        Memory::Free(inflater);
+        inflater = NULL;
+    }
+    Memory::Free(input);
+    input = NULL;
+    if (source_stream) {
+        source_stream->Close();
+        source_stream = NULL;
+    }
+
+    Stream::Close();
+}
+PUBLIC        void          InflateStream::Seek(Sint64 offset) {
+    if (offset < 0)
+        offset = 0;
+    if ((size_t)offset > size)
+        offset = size;
+
+    if ((size_t)offset < position)
+        Start();
+
+    // Inflate up to the new position, throwing away the output
+    Uint8 scratch[0x1000];
+    while (position < (size_t)offset) {
+        size_t n = (size_t)offset - position;
+        if (n > sizeof scratch)
+            n = sizeof scratch;
+        if (!ReadBytes(scratch, n))
+            break;
+    }
+}
+PUBLIC        void          InflateStream::SeekEnd(Sint64 offset) {
+    Seek((Sint64)size + offset);
+}
+PUBLIC        void          InflateStream::Skip(Sint64 offset) {
+    Seek((Sint64)position + offset);
+}
+PUBLIC        size_t        InflateStream::Position() {
+    return position;
+}
+PUBLIC        size_t        InflateStream::Length() {
+    return size;
+}
+
+PUBLIC        size_t        InflateStream::ReadBytes(void* data, size_t n) {
+    if (n > size - position) {
+        n = size - position;
+    }
+    if (n == 0) return 0;
+
+    z_stream* z = (z_stream*)inflater;
+    z->next_out = (Bytef*)data;
+    z->avail_out = (uInt)n;
+
+    while (z->avail_out) {
+        if (z->avail_in == 0 && source_position < source_size) {
+            size_t chunk = source_size - source_position;
+            if (source_data) {
+                if (chunk > 0x40000000)
+                    chunk = 0x40000000;
+                z->next_in = source_data + source_position;
+            }
+            else {
+                if (chunk > INFLATE_INPUT_SIZE)
+                    chunk = INFLATE_INPUT_SIZE;
+                source_stream->Seek(source_offset + source_position);
+                chunk = source_stream->ReadBytes(input, chunk);
+                z->next_in = input;
+            }
+            z->avail_in = (uInt)chunk;
+            source_position += chunk;
+        }
+
+        int status = inflate(z, Z_NO_FLUSH);
+        if (status == Z_STREAM_END)
+            break;
+        if (status != Z_OK)
+            break;
+    }
+
+    n -= z->avail_out;
+    position += n;
+    return n;
+}
+PUBLIC        size_t        InflateStream::WriteBytes(void* data, size_t n) {
+    // Cannot write to a resource.
+    return 0;
+}
@@ -0,0 +1,208 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+class LZ4 {
+public:
+
+};
+#endif
+
+#include <Engine/IO/Compression/LZ4.h>
+
+// LZ4's block format: a run of literals, then a match to copy from
+// earlier in the output, over and over. It doesn't compress as well as
+// zlib, but it decompresses many times faster.
+
+#define LZ4_MIN_MATCH     4
+// The last match has to start at least this far from the end, and the
+// last few bytes are always literals.
+#define LZ4_MF_LIMIT      12
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MAX_OFFSET    0xFFFF
+#define LZ4_HASH_BITS     12
+
+static inline Uint32 Read32(const Uint8* p) {
+    Uint32 value;
+    memcpy(&value, p, sizeof value);
+    return value;
+}
+static inline Uint32 Hash(Uint32 sequence) {
+    return (sequence * 2654435761U) >> (32 - LZ4_HASH_BITS);
+}
+static inline Uint8* WriteLength(Uint8* out, size_t length) {
+    while (length >= 255) {
+        *out++ = 255;
+        length -= 255;
+    }
+    *out++ = (Uint8)length;
+    return out;
+}
+
+PUBLIC STATIC size_t LZ4::GetMaxCompressedSize(size_t size) {
+    return size + size / 255 + 16;
+}
+
+// Returns the compressed size, or 0 if it didn't fit in the output.
+PUBLIC STATIC size_t LZ4::Compress(Uint8* in, size_t in_sz, Uint8* out, size_t out_sz) {
+    Uint32 table[1 << LZ4_HASH_BITS];
+    memset(table, 0, sizeof table);
+
+    Uint8* ip = in;
+    Uint8* anchor = in;
+    Uint8* end = in + in_sz;
+    Uint8* op = out;
+    Uint8* out_end = out + out_sz;
+
+    if (in_sz > LZ4_MF_LIMIT) {
+        Uint8* matchLimit = end - LZ4_LAST_LITERALS;
+        Uint8* mfLimit = end - LZ4_MF_LIMIT;
+
+        ip++;
+        while (ip <= mfLimit) {
+            Uint32 sequence = Read32(ip);
+            Uint32 hash = Hash(sequence);
+            Uint8* match = in + table[hash];
+            table[hash] = (Uint32)(ip - in);
+
+            if (match >= ip || ip - match > LZ4_MAX_OFFSET || Read32(match) != sequence) {
+                ip++;
+                continue;
+            }
+
+            // Grow the match backwards into the pending literals
+            while (ip > anchor && match > in && ip[-1] == match[-1]) {
+                ip--;
+                match--;
+            }
+
+            Uint8* matchEnd = ip + LZ4_MIN_MATCH;
+            Uint8* matchFrom = match + LZ4_MIN_MATCH;
+            while (matchEnd < matchLimit && *matchEnd == *matchFrom) {
+                matchEnd++;
+                matchFrom++;
+            }
+
+            size_t literalLength = ip - anchor;
+            size_t matchLength = matchEnd - ip - LZ4_MIN_MATCH;
+            if ((size_t)(out_end - op) < 1 + literalLength + literalLength / 255 + 1 + 2 + matchLength / 255 + 1)
+                return 0;
+
+            Uint8* token = op++;
+            if (literalLength >= 15) {
+                *token = 15 << 4;
+                op = WriteLength(op, literalLength - 15);
+            }
+            else {
+                *token = (Uint8)(literalLength << 4);
+            }
+            memcpy(op, anchor, literalLength);
+            op += literalLength;
+
+            size_t offset = ip - match;
+            *op++ = (Uint8)(offset & 0xFF);
+            *op++ = (Uint8)(offset >> 8);
+
+            if (matchLength >= 15) {
+                *token |= 15;
+                op = WriteLength(op, matchLength - 15);
+            }
+            else {
+                *token |= (Uint8)matchLength;
+            }
+
+            ip = matchEnd;
+            anchor = ip;
+
+            // Catches matches that start inside this one
+            table[Hash(Read32(ip - 2))] = (Uint32)(ip - 2 - in);
+        }
+    }
+
+    // Whatever's left goes out as literals
+    size_t literalLength = end - anchor;
+    if ((size_t)(out_end - op) < 1 + literalLength + literalLength / 255 + 1)
+        return 0;
+
+    Uint8* token = op++;
+    if (literalLength >= 15) {
+        *token = 15 << 4;
+        op = WriteLength(op, literalLength - 15);
+    }
+    else {
+        *token = (Uint8)(literalLength << 4);
+    }
+    memcpy(op, anchor, literalLength);
+    op += literalLength;
+
+    return op - out;
+}
+
+// Returns false unless the input decompresses to exactly out_sz bytes.
+PUBLIC STATIC bool LZ4::Decompress(Uint8* in, size_t in_sz, Uint8* out, size_t out_sz) {
+    Uint8* ip = in;
+    Uint8* in_end = in + in_sz;
+    Uint8* op = out;
+    Uint8* out_end = out + out_sz;
+
+    for (;;) {
+        if (ip >= in_end)
+            return false;
+
+        Uint8 token = *ip++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15) {
+            Uint8 byte;
+            do {
+                if (ip >= in_end)
+                    return false;
+                byte = *ip++;
+                literalLength += byte;
+            } while (byte == 255);
+        }
+        if (literalLength > (size_t)(in_end - ip) || literalLength > (size_t)(out_end - op))
+            return false;
+
+        memcpy(op, ip, literalLength);
+        op += literalLength;
+        ip += literalLength;
+
+        // The last sequence is only literals
+        if (ip == in_end)
+            break;
+
+        if (in_end - ip < 2)
+            return false;
+
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - out))
+            return false;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15) {
+            Uint8 byte;
+            do {
+                if (ip >= in_end)
+                    return false;
+                byte = *ip++;
+                matchLength += byte;
+            } while (byte == 255);
+        }
+        matchLength += LZ4_MIN_MATCH;
+        if (matchLength > (size_t)(out_end - op))
+            return false;
+
+        Uint8* match = op - offset;
+        if (offset >= matchLength) {
+            memcpy(op, match, matchLength);
+            op += matchLength;
+        }
+        else {
+            // Overlaps what's being written, which repeats it
+            for (size_t i = 0; i < matchLength; i++)
+                *op++ = *match++;
+        }
+    }
+
+    return op == out_end;
+}
@@ -11,18 +11,33 @@ public:
 
 #include <Engine/IO/ResourceStream.h>
 
+#include <Engine/IO/ResourceViewStream.h>
+#include <Engine/ResourceTypes/ResourceLoader.h>
 #include <Engine/ResourceTypes/ResourceManager.h>
 
 PUBLIC STATIC ResourceStream* ResourceStream::New(const char* filename) {
-    ResourceStream* stream = new (std::nothrow) ResourceStream;
+    if (!filename)
+        return NULL;
+
+    Uint8* view;
+    size_t viewSize;
+    ResourceStream* stream;
+    bool preloaded = ResourceLoader::TakeData(filename, &view, &viewSize);
+    if (!preloaded && ResourceManager::GetResourceView(filename, &view, &viewSize))
+        return ResourceViewStream::New(view, viewSize);
+
+    stream = new (std::nothrow) ResourceStream;
     if (!stream) {
+        if (preloaded)
+            Memory::Free(view);
         return NULL;
     }
 
-    if (!filename)
-        goto FREE;
-
-    if (!ResourceManager::LoadResource(filename, &stream->pointer_start, &stream->size))
+    if (preloaded) {
+        stream->pointer_start = view;
+        stream->size = viewSize;
+    }
+    else if (!ResourceManager::LoadResource(filename, &stream->pointer_start, &stream->size))
         goto FREE;
 
     stream->pointer = stream->pointer_start;
@@ -34,6 +49,25 @@ PUBLIC STATIC ResourceStream* ResourceStream::New(const char* filename) {
         return NULL;
 }
 
+// Same as New, except that large compressed resources are decompressed
+// as they're read, rather than all up front. Meant for reading a resource
+// from front to back.
+PUBLIC STATIC Stream*         ResourceStream::Open(const char* filename) {
+    return ResourceStream::Open(filename, false);
+}
+// Pass seekable if the reader seeks around a lot; then only resources
+// that can be seeked in cheaply are streamed.
+PUBLIC STATIC Stream*         ResourceStream::Open(const char* filename, bool seekable) {
+    if (!filename)
+        return NULL;
+
+    Stream* stream = ResourceManager::OpenStreamed(filename, seekable);
+    if (stream)
+        return stream;
+
+    return ResourceStream::New(filename);
+}
+
 PUBLIC        void            ResourceStream::Close() {
     Memory::Free(pointer_start);
     Stream::Close();
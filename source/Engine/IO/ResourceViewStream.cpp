@@ -0,0 +1,32 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/IO/ResourceStream.h>
+class ResourceViewStream : public ResourceStream {
+public:
+
+};
+#endif
+
+#include <Engine/IO/ResourceViewStream.h>
+
+// A read-only view of a resource that sits in a memory-mapped data file.
+// Reading it is the same as reading a ResourceStream, but nothing was
+// copied to make it and nothing is freed when it's closed. The memory
+// stays valid until the resource manager is disposed.
+
+PUBLIC STATIC ResourceViewStream* ResourceViewStream::New(Uint8* data, size_t size) {
+    ResourceViewStream* stream = new (std::nothrow) ResourceViewStream;
+    if (!stream) {
+        return NULL;
+    }
+
+    stream->pointer_start = data;
+    stream->pointer = data;
+    stream->size = size;
+
+    return stream;
+}
+
+PUBLIC        void                ResourceViewStream::Close() {
+    Stream::Close();
+}
@@ -68,7 +68,7 @@ PUBLIC Serializer::Serializer(Stream* stream) {
 }
 
 PRIVATE void Serializer::WriteValue(VMValue val) {
-    switch (val.Type) {
+    switch (VALUE_TYPE(val)) {
         case VAL_DECIMAL:
         case VAL_LINKED_DECIMAL: {
             float d = AS_DECIMAL(val);
@@ -145,6 +145,13 @@ public:
         Uint32 hash = HashFunction(key, strlen(key));
         return GetIfExists(hash, result);
     }
+    int    GetSlot(Uint32 hash) {
+        // Index into Data, valid until the map resizes or the key is removed.
+        Uint32 index = FindKey(hash);
+        if (index == 0xFFFFFFFFU)
+            return -1;
+        return (int)index;
+    }
 
     bool   Remove(Uint32 hash) {
         Uint32 index = TranslateIndex(hash);
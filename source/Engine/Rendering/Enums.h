@@ -145,6 +145,7 @@ struct BlendState {
 };
 
 typedef void (*PixelFunction)(Uint32*, Uint32*, BlendState&, int*, int*);
+typedef void (*SpanFunction)(Uint32*, Uint32*, int, BlendState&, int*, int*);
 typedef Uint32 (*TintFunction)(Uint32*, Uint32*, Uint32, Uint32);
 typedef bool (*StencilTestFunction)(Uint8*, Uint8, Uint8);
 typedef void (*StencilOpFunction)(Uint8*, Uint8);
@@ -167,6 +167,30 @@ struct   GL_Scene3DBatch {
     bool           ShouldDraw;
     vector<Uint32> VertexIndices;
 };
+struct   GL_SpriteBatchVert {
+    float x, y, z;
+    float u, v;
+};
+struct   GL_SpriteBatch {
+    Texture*                   TexturePtr;
+    bool                       UsePalette;
+    float                      Color[4];
+    Matrix4x4                  ProjectionMatrix;
+    vector<GL_SpriteBatchVert> Vertices;
+    GLuint                     Buffer;
+    bool                       Flushing;
+};
+
+// Sprites drawn one after another with the same texture, shader,
+// blend color and projection are collected into one vertex buffer,
+// and only drawn when something else needs to be drawn, some state
+// changes, or the frame ends.
+#define GL_SPRITE_BATCH_MAX 2048
+
+GL_SpriteBatch SpriteBatch;
+Matrix4x4      GL_IdentityMatrix;
+
+void GL_FlushSpriteBatch();
 
 GLenum GL_VertexIndexBufferFormat;
 size_t GL_VertexIndexBufferMaxElements;
@@ -251,6 +275,7 @@ void   GL_BindTexture(Texture* texture) {
         if (textureData) {
             glActiveTexture(GL_TEXTURE0); CHECK_GL();
             glBindTexture(GL_TEXTURE_2D, textureData->TextureID); CHECK_GL();
+            Graphics::FrameStats.TextureBinds++;
         }
         else {
             glBindTexture(GL_TEXTURE_2D, 0); CHECK_GL();
@@ -335,8 +360,11 @@ void   GL_SetModelViewMatrix(Matrix4x4* modelViewMatrix) {
     }
 }
 void   GL_Predraw(Texture* texture) {
+    GL_FlushSpriteBatch();
     GL_SetTexture(texture);
 
+    Graphics::FrameStats.DrawCalls++;
+
     // Update color if needed
     if (memcmp(&GLRenderer::CurrentShader->CachedBlendColors[0], &Graphics::BlendColors[0], sizeof(float) * 4) != 0) {
         memcpy(&GLRenderer::CurrentShader->CachedBlendColors[0], &Graphics::BlendColors[0], sizeof(float) * 4);
@@ -400,6 +428,113 @@ void   GL_DrawTexture(Texture* texture, float sx, float sy, float sw, float sh,
 
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4); CHECK_GL();
 }
+void   GL_FlushSpriteBatch() {
+    size_t vertexCount = SpriteBatch.Vertices.size();
+    if (!vertexCount || SpriteBatch.Flushing)
+        return;
+
+    // Setting up the shader can land back in here, so this makes
+    // sure that doesn't draw the batch twice.
+    SpriteBatch.Flushing = true;
+
+    // The palette setting may have changed since the batch started.
+    bool usePalettes = Graphics::UsePalettes;
+    Graphics::UsePalettes = SpriteBatch.UsePalette;
+    GL_SetTexture(SpriteBatch.TexturePtr);
+    Graphics::UsePalettes = usePalettes;
+
+    GLShader* shader = GLRenderer::CurrentShader;
+    if (memcmp(&shader->CachedBlendColors[0], &SpriteBatch.Color[0], sizeof(float) * 4) != 0) {
+        memcpy(&shader->CachedBlendColors[0], &SpriteBatch.Color[0], sizeof(float) * 4);
+
+        glUniform4f(shader->LocColor, SpriteBatch.Color[0], SpriteBatch.Color[1], SpriteBatch.Color[2], SpriteBatch.Color[3]); CHECK_GL();
+    }
+
+    // Vertices are already in view space.
+    GL_SetProjectionMatrix(&SpriteBatch.ProjectionMatrix);
+    GL_SetModelViewMatrix(&GL_IdentityMatrix);
+
+    if (!SpriteBatch.Buffer) {
+        glGenBuffers(1, &SpriteBatch.Buffer); CHECK_GL();
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, SpriteBatch.Buffer); CHECK_GL();
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(GL_SpriteBatchVert), &SpriteBatch.Vertices[0], GL_STREAM_DRAW); CHECK_GL();
+    glVertexAttribPointer(shader->LocPosition, 3, GL_FLOAT, GL_FALSE, sizeof(GL_SpriteBatchVert), 0); CHECK_GL();
+    glVertexAttribPointer(shader->LocTexCoord, 2, GL_FLOAT, GL_FALSE, sizeof(GL_SpriteBatchVert), (char*)NULL + 12); CHECK_GL();
+
+    glDrawArrays(GL_TRIANGLES, 0, vertexCount); CHECK_GL();
+    glBindBuffer(GL_ARRAY_BUFFER, 0); CHECK_GL();
+
+    Graphics::FrameStats.DrawCalls++;
+    Graphics::FrameStats.SpriteBatches++;
+    Graphics::FrameStats.BatchedSprites += vertexCount / 6;
+
+    SpriteBatch.Vertices.clear();
+    SpriteBatch.Flushing = false;
+}
+// Adds a textured quad to the sprite batch, going from (x0, y0) to
+// (x1, y1) before the model-view transform. Returns false if this
+// quad can't be batched, in which case it should be drawn as usual.
+bool   GL_AddSpriteQuad(Texture* texture, float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1) {
+    if (!Graphics::SpriteBatching || !texture)
+        return false;
+
+    GL_TextureData* textureData = (GL_TextureData*)texture->DriverData;
+    if (!textureData || textureData->YUV)
+        return false;
+
+    // The vertices get transformed here, which only works out if
+    // the model-view matrix doesn't need a perspective divide.
+    float* m = Graphics::ModelViewMatrix->Values;
+    if (m[3] != 0.0f || m[7] != 0.0f || m[11] != 0.0f || m[15] != 1.0f)
+        return false;
+
+    float color[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    if (Graphics::TextureBlend)
+        memcpy(color, Graphics::BlendColors, sizeof(color));
+
+    bool usePalette = texture->Paletted && Graphics::UsePalettes;
+    Matrix4x4* projectionMatrix = Scene::Views[Scene::ViewCurrent].ProjectionMatrix;
+
+    if (!SpriteBatch.Vertices.empty()) {
+        if (SpriteBatch.TexturePtr != texture
+            || SpriteBatch.UsePalette != usePalette
+            || memcmp(SpriteBatch.Color, color, sizeof(color)) != 0
+            || !Matrix4x4::Equals(&SpriteBatch.ProjectionMatrix, projectionMatrix)
+            || SpriteBatch.Vertices.size() >= GL_SPRITE_BATCH_MAX * 6)
+            GL_FlushSpriteBatch();
+    }
+
+    if (SpriteBatch.Vertices.empty()) {
+        SpriteBatch.TexturePtr = texture;
+        SpriteBatch.UsePalette = usePalette;
+        memcpy(SpriteBatch.Color, color, sizeof(color));
+        Matrix4x4::Copy(&SpriteBatch.ProjectionMatrix, projectionMatrix);
+    }
+
+    float xs[4] = { x0, x1, x0, x1 };
+    float ys[4] = { y0, y0, y1, y1 };
+    float us[4] = { u0, u1, u0, u1 };
+    float vs[4] = { v0, v0, v1, v1 };
+
+    GL_SpriteBatchVert corners[4];
+    for (int i = 0; i < 4; i++) {
+        corners[i].x = m[0] * xs[i] + m[4] * ys[i] + m[12];
+        corners[i].y = m[1] * xs[i] + m[5] * ys[i] + m[13];
+        corners[i].z = m[2] * xs[i] + m[6] * ys[i] + m[14];
+        corners[i].u = us[i];
+        corners[i].v = vs[i];
+    }
+
+    // Same winding as the triangle strip it replaces.
+    SpriteBatch.Vertices.push_back(corners[0]);
+    SpriteBatch.Vertices.push_back(corners[1]);
+    SpriteBatch.Vertices.push_back(corners[2]);
+    SpriteBatch.Vertices.push_back(corners[2]);
+    SpriteBatch.Vertices.push_back(corners[1]);
+    SpriteBatch.Vertices.push_back(corners[3]);
+    return true;
+}
 GLenum GL_GetBlendFactorFromHatchEnum(int factor) {
     switch (factor) {
         case BlendFactor_ZERO:
@@ -893,6 +1028,7 @@ void GL_DrawBatchedScene3D(GL_VertexBuffer *driverData, vector<Uint32>* vertexIn
     }
 
     glDrawElements(primitiveType, numIndices, GL_VertexIndexBufferFormat, (const void *)driverData->VertexIndexBuffer); CHECK_GL();
+    Graphics::FrameStats.DrawCalls++;
 }
 PolygonRenderer* GL_GetPolygonRenderer() {
     if (!polyRenderer.SetBuffers())
@@ -913,6 +1049,8 @@ PUBLIC STATIC void     GLRenderer::Init() {
     Graphics::SupportsBatching = true;
     Graphics::PreferredPixelFormat = SDL_PIXELFORMAT_ABGR8888;
 
+    Matrix4x4::Identity(&GL_IdentityMatrix);
+
     Log::Print(Log::LOG_INFO, "Renderer: OpenGL");
 
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
@@ -1137,6 +1275,12 @@ PUBLIC STATIC void     GLRenderer::SetGraphicsFunctions() {
     Graphics::Internal.SetDepthTesting = GLRenderer::SetDepthTesting;
 }
 PUBLIC STATIC void     GLRenderer::Dispose() {
+    SpriteBatch.Vertices.clear();
+    if (SpriteBatch.Buffer) {
+        glDeleteBuffers(1, &SpriteBatch.Buffer); CHECK_GL();
+        SpriteBatch.Buffer = 0;
+    }
+
     glDeleteBuffers(1, &BufferCircleFill); CHECK_GL();
     glDeleteBuffers(1, &BufferCircleStroke); CHECK_GL();
     glDeleteBuffers(1, &BufferSquareFill); CHECK_GL();
@@ -1268,6 +1412,7 @@ PUBLIC STATIC Texture* GLRenderer::CreateTexture(Uint32 format, Uint32 access, U
     }
 
     glBindTexture(textureData->TextureTarget, 0); CHECK_GL();
+    GL_LastTexture = nullptr;
 
     texture->ID = textureData->TextureID;
     Graphics::TextureMap->Put(texture->ID, texture);
@@ -1278,6 +1423,7 @@ PUBLIC STATIC int      GLRenderer::LockTexture(Texture* texture, void** pixels,
     return 0;
 }
 PUBLIC STATIC int      GLRenderer::UpdateTexture(Texture* texture, SDL_Rect* src, void* pixels, int pitch) {
+    GL_FlushSpriteBatch();
     Uint32 inputPixelsX = 0;
     Uint32 inputPixelsY = 0;
     Uint32 inputPixelsW = texture->Width;
@@ -1302,13 +1448,23 @@ PUBLIC STATIC int      GLRenderer::UpdateTexture(Texture* texture, SDL_Rect* src
     textureData->PixelDataFormat = GL_RGBA;
     textureData->PixelDataType = GL_UNSIGNED_BYTE;
 
+    // Textures can be updated between draws (atlas pages, for one), so
+    // this binds on the unit draws use, and the next draw has to know
+    // what's bound there now.
+    glActiveTexture(GL_TEXTURE0); CHECK_GL();
     glBindTexture(textureData->TextureTarget, textureData->TextureID); CHECK_GL();
     glTexSubImage2D(textureData->TextureTarget, 0,
         inputPixelsX, inputPixelsY, inputPixelsW, inputPixelsH,
         textureData->PixelDataFormat, textureData->PixelDataType, pixels); CHECK_GL();
+
+    if (textureData->TextureTarget == GL_TEXTURE_2D)
+        GL_LastTexture = texture;
+    else
+        GL_LastTexture = nullptr;
     return 0;
 }
 PUBLIC STATIC int      GLRenderer::UpdateTextureYUV(Texture* texture, SDL_Rect* src, void* pixelsY, int pitchY, void* pixelsU, int pitchU, void* pixelsV, int pitchV) {
+    GL_FlushSpriteBatch();
     int inputPixelsX = 0;
     int inputPixelsY = 0;
     int inputPixelsW = texture->Width;
@@ -1349,6 +1505,7 @@ PUBLIC STATIC void     GLRenderer::UnlockTexture(Texture* texture) {
 
 }
 PUBLIC STATIC void     GLRenderer::DisposeTexture(Texture* texture) {
+    GL_FlushSpriteBatch();
     GL_TextureData* textureData = (GL_TextureData*)texture->DriverData;
     if (!textureData)
         return;
@@ -1372,6 +1529,7 @@ PUBLIC STATIC void     GLRenderer::DisposeTexture(Texture* texture) {
 
 // Viewport and view-related functions
 PUBLIC STATIC void     GLRenderer::SetRenderTarget(Texture* texture) {
+    GL_FlushSpriteBatch();
     if (texture == NULL) {
         glBindFramebuffer(GL_FRAMEBUFFER, DefaultFramebuffer); CHECK_GL();
 
@@ -1401,6 +1559,7 @@ PUBLIC STATIC void     GLRenderer::SetRenderTarget(Texture* texture) {
     }
 }
 PUBLIC STATIC void     GLRenderer::ReadFramebuffer(void* pixels, int width, int height) {
+    GL_FlushSpriteBatch();
     glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
 
     if (Graphics::CurrentRenderTarget)
@@ -1422,6 +1581,7 @@ PUBLIC STATIC void     GLRenderer::UpdateWindowSize(int width, int height) {
     GLRenderer::UpdateViewport();
 }
 PUBLIC STATIC void     GLRenderer::UpdateViewport() {
+    GL_FlushSpriteBatch();
     Viewport* vp = &Graphics::CurrentViewport;
     if (Graphics::CurrentRenderTarget) {
         glViewport(vp->X * RetinaScale, vp->Y * RetinaScale, vp->Width * RetinaScale, vp->Height * RetinaScale); CHECK_GL();
@@ -1436,6 +1596,7 @@ PUBLIC STATIC void     GLRenderer::UpdateViewport() {
     GLRenderer::UpdateProjectionMatrix();
 }
 PUBLIC STATIC void     GLRenderer::UpdateClipRect() {
+    GL_FlushSpriteBatch();
     ClipArea clip = Graphics::CurrentClip;
     if (Graphics::CurrentClip.Enabled) {
         Viewport view = Graphics::CurrentViewport;
@@ -1505,6 +1666,8 @@ PUBLIC STATIC void     GLRenderer::MakePerspectiveMatrix(Matrix4x4* out, float f
 // Shader-related functions
 PUBLIC STATIC void     GLRenderer::UseShader(void* shader) {
     if (GLRenderer::CurrentShader != (GLShader*)shader) {
+        GL_FlushSpriteBatch();
+
         GLRenderer::CurrentShader = (GLShader*)shader;
         GLRenderer::CurrentShader->Use();
 
@@ -1513,6 +1676,7 @@ PUBLIC STATIC void     GLRenderer::UseShader(void* shader) {
     }
 }
 PUBLIC STATIC void     GLRenderer::SetUniformF(int location, int count, float* values) {
+    GL_FlushSpriteBatch();
     switch (count) {
         case 1: glUniform1f(location, values[0]); CHECK_GL(); break;
         case 2: glUniform2f(location, values[0], values[1]); CHECK_GL(); break;
@@ -1521,9 +1685,11 @@ PUBLIC STATIC void     GLRenderer::SetUniformF(int location, int count, float* v
     }
 }
 PUBLIC STATIC void     GLRenderer::SetUniformI(int location, int count, int* values) {
+    GL_FlushSpriteBatch();
     glUniform1iv(location, count, values); CHECK_GL();
 }
 PUBLIC STATIC void     GLRenderer::SetUniformTexture(Texture* texture, int uniform_index, int slot) {
+    GL_FlushSpriteBatch();
     GL_TextureData* textureData = (GL_TextureData*)texture->DriverData;
     glActiveTexture(GL_TEXTURE0 + slot); CHECK_GL();
     glUniform1i(uniform_index, slot); CHECK_GL();
@@ -1537,6 +1703,7 @@ PUBLIC STATIC void     GLRenderer::UpdateGlobalPalette() {
 
 // These guys
 PUBLIC STATIC void     GLRenderer::Clear() {
+    GL_FlushSpriteBatch();
     if (UseDepthTesting) {
         #ifdef GL_ES
         glClearDepthf(1.0f); CHECK_GL();
@@ -1550,6 +1717,7 @@ PUBLIC STATIC void     GLRenderer::Clear() {
     }
 }
 PUBLIC STATIC void     GLRenderer::Present() {
+    GL_FlushSpriteBatch();
 	SDL_GL_SwapWindow(Application::Window); CHECK_GL();
 }
 
@@ -1558,6 +1726,7 @@ PUBLIC STATIC void     GLRenderer::SetBlendColor(float r, float g, float b, floa
 
 }
 PUBLIC STATIC void     GLRenderer::SetBlendMode(int srcC, int dstC, int srcA, int dstA) {
+    GL_FlushSpriteBatch();
     glBlendFuncSeparate(
         GL_GetBlendFactorFromHatchEnum(srcC), GL_GetBlendFactorFromHatchEnum(dstC),
         GL_GetBlendFactorFromHatchEnum(srcA), GL_GetBlendFactorFromHatchEnum(dstA)); CHECK_GL();
@@ -1745,10 +1914,26 @@ PUBLIC STATIC void     GLRenderer::DrawSprite(ISprite* sprite, int animation, in
 
     // /*
     AnimFrame animframe = sprite->Animations[animation].Frames[frame];
+    Texture* texture = sprite->Spritesheets[animframe.SheetNumber];
+    if (animframe.ID && texture) {
+        float fX = flipX ? -1.0 : 1.0;
+        float fY = flipY ? -1.0 : 1.0;
+        if (GL_AddSpriteQuad(texture,
+            x + fX * animframe.OffsetX,
+            y + fY * animframe.OffsetY,
+            x + fX * (animframe.OffsetX + animframe.Width),
+            y + fY * (animframe.OffsetY + animframe.Height),
+            (float)animframe.X / texture->Width,
+            (float)animframe.Y / texture->Height,
+            (float)(animframe.X + animframe.Width) / texture->Width,
+            (float)(animframe.Y + animframe.Height) / texture->Height))
+            return;
+    }
+
     Graphics::Save();
         // Graphics::Rotate(0.0f, 0.0f, rotation);
         Graphics::Translate(x, y, 0.0f);
-        GL_DrawTextureBuffered(sprite->Spritesheets[animframe.SheetNumber], animframe.ID, ((int)flipY << 1) | (int)flipX);
+        GL_DrawTextureBuffered(texture, animframe.ID, ((int)flipY << 1) | (int)flipX);
     Graphics::Restore();
     //*/
 
@@ -1779,6 +1964,21 @@ PUBLIC STATIC void     GLRenderer::DrawSpritePart(ISprite* sprite, int animation
     if (sh >= animframe.Height - sy)
         sh  = animframe.Height - sy;
 
+    Texture* texture = sprite->Spritesheets[animframe.SheetNumber];
+    if (texture) {
+        float x0 = (x + fX * (sx + animframe.OffsetX)) * RetinaScale;
+        float y0 = (y + fY * (sy + animframe.OffsetY)) * RetinaScale;
+        if (GL_AddSpriteQuad(texture,
+            x0, y0,
+            x0 + fX * sw * RetinaScale,
+            y0 + fY * sh * RetinaScale,
+            (float)(animframe.X + sx) / texture->Width,
+            (float)(animframe.Y + sy) / texture->Height,
+            (float)(animframe.X + sx + sw) / texture->Width,
+            (float)(animframe.Y + sy + sh) / texture->Height))
+            return;
+    }
+
     GLRenderer::DrawTexture(sprite->Spritesheets[animframe.SheetNumber],
         animframe.X + sx, animframe.Y + sy,
         sw, sh,
@@ -1819,6 +2019,7 @@ PUBLIC STATIC void     GLRenderer::DrawModelSkinned(void* inModel, Uint16 armatu
     }
 }
 PUBLIC STATIC void     GLRenderer::DrawVertexBuffer(Uint32 vertexBufferIndex, Matrix4x4* modelMatrix, Matrix4x4* normalMatrix) {
+    GL_FlushSpriteBatch();
     if (Graphics::CurrentScene3D < 0 || vertexBufferIndex < 0 || vertexBufferIndex >= MAX_VERTEX_BUFFERS)
         return;
 
@@ -1859,6 +2060,7 @@ PUBLIC STATIC void     GLRenderer::ClearScene3D(Uint32 sceneIndex) {
     driverData->Changed = true;
 }
 PUBLIC STATIC void     GLRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 drawMode) {
+    GL_FlushSpriteBatch();
     if (sceneIndex < 0 || sceneIndex >= MAX_3D_SCENES)
         return;
 
@@ -1994,6 +2196,7 @@ PUBLIC STATIC void     GLRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 drawMod
                     PERF_STATE_CHANGE(perf);
                 }
                 glDrawArrays(state.PrimitiveType, face.VertexIndex, face.NumVertices); CHECK_GL();
+                Graphics::FrameStats.DrawCalls++;
                 PERF_DRAW_CALL(perf);
             }
 
@@ -2125,6 +2328,7 @@ PUBLIC STATIC void     GLRenderer::DeleteFrameBufferID(AnimFrame* frame) {
     }
 }
 PUBLIC STATIC void     GLRenderer::SetDepthTesting(bool enable) {
+    GL_FlushSpriteBatch();
     if (UseDepthTesting) {
         if (enable) {
             glEnable(GL_DEPTH_TEST); CHECK_GL();
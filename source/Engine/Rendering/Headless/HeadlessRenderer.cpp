@@ -0,0 +1,327 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Includes/StandardSDL2.h>
+#include <Engine/Math/Matrix4x4.h>
+#include <Engine/ResourceTypes/ISprite.h>
+#include <Engine/Rendering/Texture.h>
+
+class HeadlessRenderer {
+public:
+    static Texture* Backbuffer;
+};
+#endif
+
+#include <Engine/Rendering/Headless/HeadlessRenderer.h>
+
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Graphics.h>
+#include <Engine/Hashing/FNV1A.h>
+#include <Engine/Rendering/Software/SoftwareRenderer.h>
+
+// The headless renderer is the software renderer drawing into a
+// plain framebuffer that never gets shown. Anything drawn with no
+// render target set lands in the backbuffer instead, so the frame
+// can still be read back (or hashed) after it's presented.
+
+Texture* HeadlessRenderer::Backbuffer = NULL;
+
+#define BACKBUFFER_DRAW_START() \
+    Texture* previousTarget = Graphics::CurrentRenderTarget; \
+    if (!previousTarget) \
+        Graphics::CurrentRenderTarget = HeadlessRenderer::Backbuffer
+#define BACKBUFFER_DRAW_END() \
+    Graphics::CurrentRenderTarget = previousTarget
+
+static void CreateBackbuffer(int width, int height) {
+    if (HeadlessRenderer::Backbuffer) {
+        if ((int)HeadlessRenderer::Backbuffer->Width == width && (int)HeadlessRenderer::Backbuffer->Height == height)
+            return;
+
+        SoftwareRenderer::FlushCommands();
+        HeadlessRenderer::Backbuffer->Dispose();
+        Memory::Free(HeadlessRenderer::Backbuffer);
+    }
+
+    HeadlessRenderer::Backbuffer = Texture::New(SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, width, height);
+}
+
+// Initialization and disposal functions
+PUBLIC STATIC void     HeadlessRenderer::Init() {
+    Graphics::SupportsBatching = false;
+    Graphics::MaxTextureWidth = 16384;
+    Graphics::MaxTextureHeight = 16384;
+
+    // There's no display to sync to, so frames are paced by the clock.
+    Graphics::VsyncEnabled = false;
+
+    CreateBackbuffer((int)Graphics::CurrentViewport.Width, (int)Graphics::CurrentViewport.Height);
+
+    Log::Print(Log::LOG_INFO, "Renderer: Headless (%d x %d)", Backbuffer->Width, Backbuffer->Height);
+}
+PUBLIC STATIC Uint32   HeadlessRenderer::GetWindowFlags() {
+    return 0;
+}
+PUBLIC STATIC void     HeadlessRenderer::SetVSync(bool enabled) {
+
+}
+PUBLIC STATIC void     HeadlessRenderer::SetGraphicsFunctions() {
+    Graphics::PixelOffset = 0.0f;
+
+    // Everything that draws is the software renderer's. The functions
+    // it would hand off to the internal renderer are replaced below,
+    // since here the internal renderer is this one.
+    Graphics::Internal = SoftwareRenderer::BackendFunctions;
+
+    Graphics::Internal.Init = HeadlessRenderer::Init;
+    Graphics::Internal.GetWindowFlags = HeadlessRenderer::GetWindowFlags;
+    Graphics::Internal.SetVSync = HeadlessRenderer::SetVSync;
+    Graphics::Internal.SetGraphicsFunctions = HeadlessRenderer::SetGraphicsFunctions;
+    Graphics::Internal.Dispose = HeadlessRenderer::Dispose;
+
+    // Texture management functions
+    Graphics::Internal.CreateTexture = HeadlessRenderer::CreateTexture;
+    Graphics::Internal.LockTexture = HeadlessRenderer::LockTexture;
+    Graphics::Internal.UpdateTexture = HeadlessRenderer::UpdateTexture;
+
+    // Viewport and view-related functions
+    Graphics::Internal.ReadFramebuffer = HeadlessRenderer::ReadFramebuffer;
+    Graphics::Internal.UpdateWindowSize = HeadlessRenderer::UpdateWindowSize;
+    Graphics::Internal.UpdateViewport = HeadlessRenderer::UpdateViewport;
+    Graphics::Internal.UpdateClipRect = HeadlessRenderer::UpdateClipRect;
+    Graphics::Internal.UpdateOrtho = HeadlessRenderer::UpdateOrtho;
+    Graphics::Internal.UpdatePerspective = HeadlessRenderer::UpdatePerspective;
+    Graphics::Internal.UpdateProjectionMatrix = HeadlessRenderer::UpdateProjectionMatrix;
+
+    // These guys
+    Graphics::Internal.Clear = HeadlessRenderer::Clear;
+    Graphics::Internal.Present = HeadlessRenderer::Present;
+
+    // Primitive drawing functions
+    Graphics::Internal.StrokeLine = HeadlessRenderer::StrokeLine;
+    Graphics::Internal.StrokeCircle = HeadlessRenderer::StrokeCircle;
+    Graphics::Internal.StrokeEllipse = HeadlessRenderer::StrokeEllipse;
+    Graphics::Internal.StrokeRectangle = HeadlessRenderer::StrokeRectangle;
+    Graphics::Internal.FillCircle = HeadlessRenderer::FillCircle;
+    Graphics::Internal.FillEllipse = HeadlessRenderer::FillEllipse;
+    Graphics::Internal.FillTriangle = HeadlessRenderer::FillTriangle;
+    Graphics::Internal.FillRectangle = HeadlessRenderer::FillRectangle;
+
+    // Texture drawing functions
+    Graphics::Internal.DrawTexture = HeadlessRenderer::DrawTexture;
+    Graphics::Internal.DrawSprite = HeadlessRenderer::DrawSprite;
+    Graphics::Internal.DrawSpritePart = HeadlessRenderer::DrawSpritePart;
+
+    // 3D drawing functions
+    Graphics::Internal.DrawPolygon3D = HeadlessRenderer::DrawPolygon3D;
+    Graphics::Internal.DrawSceneLayer3D = HeadlessRenderer::DrawSceneLayer3D;
+    Graphics::Internal.DrawModel = HeadlessRenderer::DrawModel;
+    Graphics::Internal.DrawModelSkinned = HeadlessRenderer::DrawModelSkinned;
+    Graphics::Internal.DrawVertexBuffer = HeadlessRenderer::DrawVertexBuffer;
+    Graphics::Internal.DrawScene3D = HeadlessRenderer::DrawScene3D;
+}
+PUBLIC STATIC void     HeadlessRenderer::Dispose() {
+    if (!Backbuffer)
+        return;
+
+    Backbuffer->Dispose();
+    Memory::Free(Backbuffer);
+    Backbuffer = NULL;
+}
+
+// Texture management functions
+PUBLIC STATIC Texture* HeadlessRenderer::CreateTexture(Uint32 format, Uint32 access, Uint32 width, Uint32 height) {
+    return Texture::New(format, access, width, height);
+}
+PUBLIC STATIC int      HeadlessRenderer::LockTexture(Texture* texture, void** pixels, int* pitch) {
+    return 1;
+}
+PUBLIC STATIC int      HeadlessRenderer::UpdateTexture(Texture* texture, SDL_Rect* src, void* pixels, int pitch) {
+    // The texture's own pixels are the only copy there is, so draws
+    // recorded against them go out before they change.
+    SoftwareRenderer::FlushCommands();
+    return 1;
+}
+
+// Viewport and view-related functions
+PUBLIC STATIC void     HeadlessRenderer::ReadFramebuffer(void* pixels, int width, int height) {
+    SoftwareRenderer::FlushCommands();
+    if (!Backbuffer)
+        return;
+
+    int copyW = std::min(width, (int)Backbuffer->Width);
+    int copyH = std::min(height, (int)Backbuffer->Height);
+    Uint32* src = (Uint32*)Backbuffer->Pixels;
+    Uint32* dst = (Uint32*)pixels;
+    for (int y = 0; y < copyH; y++)
+        memcpy(&dst[y * width], &src[y * Backbuffer->Width], copyW * sizeof(Uint32));
+}
+PUBLIC STATIC void     HeadlessRenderer::UpdateWindowSize(int width, int height) {
+    CreateBackbuffer(width, height);
+}
+PUBLIC STATIC void     HeadlessRenderer::UpdateViewport() {
+
+}
+PUBLIC STATIC void     HeadlessRenderer::UpdateClipRect() {
+
+}
+PUBLIC STATIC void     HeadlessRenderer::UpdateOrtho(float left, float top, float right, float bottom) {
+
+}
+PUBLIC STATIC void     HeadlessRenderer::UpdatePerspective(float fovy, float aspect, float nearv, float farv) {
+
+}
+PUBLIC STATIC void     HeadlessRenderer::UpdateProjectionMatrix() {
+
+}
+
+// These guys
+PUBLIC STATIC void     HeadlessRenderer::Clear() {
+    BACKBUFFER_DRAW_START();
+    SoftwareRenderer::Clear();
+    BACKBUFFER_DRAW_END();
+}
+PUBLIC STATIC void     HeadlessRenderer::Present() {
+    SoftwareRenderer::FlushCommands();
+}
+
+// Primitive drawing functions
+PUBLIC STATIC void     HeadlessRenderer::StrokeLine(float x1, float y1, float x2, float y2) {
+    BACKBUFFER_DRAW_START();
+    SoftwareRenderer::StrokeLine(x1, y1, x2, y2);
+    BACKBUFFER_DRAW_END();
+}
+PUBLIC STATIC void     HeadlessRenderer::StrokeCircle(float x, float y, float rad, float thickness) {
+    BACKBUFFER_DRAW_START();
+    SoftwareRenderer::StrokeCircle(x, y, rad, thickness);
+    BACKBUFFER_DRAW_END();
+}
+PUBLIC STATIC void     HeadlessRenderer::StrokeEllipse(float x, float y, float w, float h) {
+    BACKBUFFER_DRAW_START();
+    SoftwareRenderer::StrokeEllipse(x, y, w, h);
+    BACKBUFFER_DRAW_END();
+}
+PUBLIC STATIC void     HeadlessRenderer::StrokeRectangle(float x, float y, float w, float h) {
+    BACKBUFFER_DRAW_START();
+    SoftwareRenderer::StrokeRectangle(x, y, w, h);
+    BACKBUFFER_DRAW_END();
+}
+PUBLIC STATIC void     HeadlessRenderer::FillCircle(float x, float y, float rad) {
+    BACKBUFFER_DRAW_START();
+    SoftwareRenderer::FillCircle(x, y, rad);
+    BACKBUFFER_DRAW_END();
+}
+PUBLIC STATIC void     HeadlessRenderer::FillEllipse(float x, float y, float w, float h) {
+    BACKBUFFER_DRAW_START();
+    SoftwareRenderer::FillEllipse(x, y, w, h);
+    BACKBUFFER_DRAW_END();
+}
+PUBLIC STATIC void     HeadlessRenderer::FillTriangle(float x1, float y1, float x2, float y2, float x3, float y3) {
+    BACKBUFFER_DRAW_START();
+    SoftwareRenderer::FillTriangle(x1, y1, x2, y2, x3, y3);
+    BACKBUFFER_DRAW_END();
+}
+PUBLIC STATIC void     HeadlessRenderer::FillRectangle(float x, float y, float w, float h) {
+    BACKBUFFER_DRAW_START();
+    SoftwareRenderer::FillRectangle(x, y, w, h);
+    BACKBUFFER_DRAW_END();
+}
+
+// Texture drawing functions
+PUBLIC STATIC void     HeadlessRenderer::DrawTexture(Texture* texture, float sx, float sy, float sw, float sh, float x, float y, float w, float h) {
+    if (Graphics::CurrentRenderTarget) {
+        SoftwareRenderer::DrawTexture(texture, sx, sy, sw, sh, x, y, w, h);
+        return;
+    }
+
+    // Drawing a texture straight to the screen is how views get
+    // presented, which is a scaled copy in screen space rather than
+    // a sprite draw relative to the current view.
+    SoftwareRenderer::FlushCommands();
+    if (!Backbuffer || sw <= 0.0f || sh <= 0.0f || w <= 0.0f || h <= 0.0f)
+        return;
+
+    Matrix4x4* out = Graphics::ModelViewMatrix;
+    int dst_x1 = (int)(x + out->Values[12]);
+    int dst_y1 = (int)(y + out->Values[13]);
+    int dst_x2 = dst_x1 + (int)w;
+    int dst_y2 = dst_y1 + (int)h;
+    int step_x = (int)(sw * 0x10000 / w);
+    int step_y = (int)(sh * 0x10000 / h);
+
+    int clip_x1 = std::max(dst_x1, 0);
+    int clip_y1 = std::max(dst_y1, 0);
+    int clip_x2 = std::min(dst_x2, (int)Backbuffer->Width);
+    int clip_y2 = std::min(dst_y2, (int)Backbuffer->Height);
+
+    Uint32* srcPx = (Uint32*)texture->Pixels;
+    Uint32* dstPx = (Uint32*)Backbuffer->Pixels;
+    int srcMaxX = (int)texture->Width - 1;
+    int srcMaxY = (int)texture->Height - 1;
+    for (int dst_y = clip_y1; dst_y < clip_y2; dst_y++) {
+        int src_y = (int)sy + (((dst_y - dst_y1) * step_y) >> 16);
+        if (src_y > srcMaxY)
+            break;
+
+        Uint32* srcLine = &srcPx[src_y * texture->Width];
+        Uint32* dstLine = &dstPx[dst_y * Backbuffer->Width];
+        for (int dst_x = clip_x1; dst_x < clip_x2; dst_x++) {
+            int src_x = (int)sx + (((dst_x - dst_x1) * step_x) >> 16);
+            if (src_x > srcMaxX)
+                break;
+            dstLine[dst_x] = srcLine[src_x];
+        }
+    }
+}
+PUBLIC STATIC void     HeadlessRenderer::DrawSprite(ISprite* sprite, int animation, int frame, int x, int y, bool flipX, bool flipY, float scaleW, float scaleH, float rotation, unsigned paletteID) {
+    BACKBUFFER_DRAW_START();
+    SoftwareRenderer::DrawSprite(sprite, animation, frame, x, y, flipX, flipY, scaleW, scaleH, rotation, paletteID);
+    BACKBUFFER_DRAW_END();
+}
+PUBLIC STATIC void     HeadlessRenderer::DrawSpritePart(ISprite* sprite, int animation, int frame, int sx, int sy, int sw, int sh, int x, int y, bool flipX, bool flipY, float scaleW, float scaleH, float rotation, unsigned paletteID) {
+    BACKBUFFER_DRAW_START();
+    SoftwareRenderer::DrawSpritePart(sprite, animation, frame, sx, sy, sw, sh, x, y, flipX, flipY, scaleW, scaleH, rotation, paletteID);
+    BACKBUFFER_DRAW_END();
+}
+
+// 3D drawing functions
+PUBLIC STATIC void     HeadlessRenderer::DrawPolygon3D(void* data, int vertexCount, int vertexFlag, Texture* texture, Matrix4x4* modelMatrix, Matrix4x4* normalMatrix) {
+    BACKBUFFER_DRAW_START();
+    SoftwareRenderer::DrawPolygon3D(data, vertexCount, vertexFlag, texture, modelMatrix, normalMatrix);
+    BACKBUFFER_DRAW_END();
+}
+PUBLIC STATIC void     HeadlessRenderer::DrawSceneLayer3D(void* layer, int sx, int sy, int sw, int sh, Matrix4x4* modelMatrix, Matrix4x4* normalMatrix) {
+    BACKBUFFER_DRAW_START();
+    SoftwareRenderer::DrawSceneLayer3D(layer, sx, sy, sw, sh, modelMatrix, normalMatrix);
+    BACKBUFFER_DRAW_END();
+}
+PUBLIC STATIC void     HeadlessRenderer::DrawModel(void* model, Uint16 animation, Uint32 frame, Matrix4x4* modelMatrix, Matrix4x4* normalMatrix) {
+    BACKBUFFER_DRAW_START();
+    SoftwareRenderer::DrawModel(model, animation, frame, modelMatrix, normalMatrix);
+    BACKBUFFER_DRAW_END();
+}
+PUBLIC STATIC void     HeadlessRenderer::DrawModelSkinned(void* model, Uint16 armature, Matrix4x4* modelMatrix, Matrix4x4* normalMatrix) {
+    BACKBUFFER_DRAW_START();
+    SoftwareRenderer::DrawModelSkinned(model, armature, modelMatrix, normalMatrix);
+    BACKBUFFER_DRAW_END();
+}
+PUBLIC STATIC void     HeadlessRenderer::DrawVertexBuffer(Uint32 vertexBufferIndex, Matrix4x4* modelMatrix, Matrix4x4* normalMatrix) {
+    BACKBUFFER_DRAW_START();
+    SoftwareRenderer::DrawVertexBuffer(vertexBufferIndex, modelMatrix, normalMatrix);
+    BACKBUFFER_DRAW_END();
+}
+PUBLIC STATIC void     HeadlessRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 drawMode) {
+    BACKBUFFER_DRAW_START();
+    SoftwareRenderer::DrawScene3D(sceneIndex, drawMode);
+    BACKBUFFER_DRAW_END();
+}
+
+// Frame hashing
+PUBLIC STATIC Uint32   HeadlessRenderer::GetFrameHash() {
+    SoftwareRenderer::FlushCommands();
+    if (!Backbuffer)
+        return 0;
+
+    size_t size = (size_t)Backbuffer->Width * Backbuffer->Height * sizeof(Uint32);
+    return FNV1A::EncryptData(Backbuffer->Pixels, size);
+}
@@ -23,12 +23,14 @@ public:
     static int               MultTable[0x10000];
     static int               MultTableInv[0x10000];
     static int               MultSubTable[0x10000];
+    static int               ThreadsRequested;
 };
 #endif
 
 #include <Engine/Rendering/Software/SoftwareRenderer.h>
 #include <Engine/Rendering/Software/PolygonRasterizer.h>
 #include <Engine/Rendering/Software/SoftwareEnums.h>
+#include <Engine/Rendering/Software/SpanBlitter.h>
 #include <Engine/Rendering/FaceInfo.h>
 #include <Engine/Rendering/Scene3D.h>
 #include <Engine/Rendering/PolygonRenderer.h>
@@ -50,8 +52,11 @@ Contour           SoftwareRenderer::ContourBuffer[MAX_FRAMEBUFFER_HEIGHT];
 int               SoftwareRenderer::MultTable[0x10000];
 int               SoftwareRenderer::MultTableInv[0x10000];
 int               SoftwareRenderer::MultSubTable[0x10000];
+int               SoftwareRenderer::ThreadsRequested = 1;
 
-BlendState CurrentBlendState;
+// These are set up for every draw, so each thread that draws keeps
+// its own.
+thread_local BlendState CurrentBlendState;
 
 #if 0
 Uint32 ColorAdd(Uint32 color1, Uint32 color2, int percent) {
@@ -81,8 +86,8 @@ Uint8 ColG;
 Uint8 ColB;
 Uint32 ColRGB;
 
-PixelFunction CurrentPixelFunction = NULL;
-TintFunction CurrentTintFunction = NULL;
+thread_local PixelFunction CurrentPixelFunction = NULL;
+thread_local TintFunction CurrentTintFunction = NULL;
 
 bool UseStencil = false;
 
@@ -111,6 +116,286 @@ int FilterCurrent[0x8000];
 int FilterInvert[0x8000];
 int FilterBlackAndWhite[0x8000];
 
+// Threaded rendering functions
+// While threaded rendering is on, sprite and rectangle draws are put
+// into a command list instead of being drawn right away. When the list
+// is flushed, the render target is split into horizontal bands, and
+// each thread replays the whole list into the bands it claims, with the
+// clip rect narrowed down to that band. A draw only ever writes to its
+// own rows of the target, so this comes out the same as drawing the
+// list in order on a single thread.
+#define SOFTWARE_MAX_THREADS 16
+#define SOFTWARE_BANDS_PER_THREAD 4
+#define SOFTWARE_MIN_BAND_HEIGHT 16
+
+enum {
+    SoftwareCommand_SPRITE,
+    SoftwareCommand_SPRITE_TRANSFORMED,
+    SoftwareCommand_RECTANGLE,
+    SoftwareCommand_SCENE_LAYER
+};
+
+struct SoftwareCommand {
+    int         Type;
+    int         MinY;
+    int         MaxY;
+    ClipArea    Clip;
+    BlendState  CurrentBlend;
+    BlendState  Blend;
+
+    Texture*    TexturePtr;
+    int         X, Y, OffX, OffY, W, H;
+    int         SX, SY, SW, SH;
+    int         FlipFlag;
+    int         Rotation;
+    unsigned    PaletteID;
+
+    float       RectX, RectY, RectW, RectH;
+    Uint32      Color;
+
+    SceneLayer* Layer;
+    View*       LayerView;
+};
+
+// Global state that the draw functions read directly. Commands are
+// only kept in the same list while this stays the same, and it's put
+// back for as long as they're being replayed.
+struct SoftwareCommandState {
+    Texture* RenderTarget;
+    bool     TextureBlend;
+    bool     UsePalettes;
+    bool     UsePaletteIndexLines;
+    Uint32   CompareColor;
+};
+
+struct SoftwareBand {
+    ClipArea Clip;
+    int      Y1;
+    int      Y2;
+};
+
+static SDL_Thread*             Workers[SOFTWARE_MAX_THREADS - 1];
+static int                     WorkerCount = 0;
+static SDL_sem*                WorkReady = NULL;
+static SDL_sem*                WorkDone = NULL;
+static SDL_atomic_t            NextBand;
+static int                     BandCount = 0;
+static int                     BandHeight = 0;
+static bool                    WorkersStarted = false;
+static bool                    WorkersQuitting = false;
+
+static vector<SoftwareCommand> Commands;
+static SoftwareCommandState    CommandState;
+
+static thread_local SoftwareBand* CurrentBand = NULL;
+
+void DrawSpriteImage(Texture* texture, int x, int y, int w, int h, int sx, int sy, int flipFlag, unsigned paletteID, BlendState blendState);
+void DrawSpriteImageTransformed(Texture* texture, int x, int y, int offx, int offy, int w, int h, int sx, int sy, int sw, int sh, int flipFlag, int rotation, unsigned paletteID, BlendState blendState);
+void DrawRectangleImage(float x, float y, float w, float h, Uint32 col, BlendState blendState);
+
+static void ReplayCommand(SoftwareCommand* command) {
+    CurrentBand->Clip = command->Clip;
+    CurrentBlendState = command->CurrentBlend;
+
+    switch (command->Type) {
+        case SoftwareCommand_SPRITE:
+            DrawSpriteImage(command->TexturePtr,
+                command->X, command->Y, command->W, command->H,
+                command->SX, command->SY,
+                command->FlipFlag, command->PaletteID, command->Blend);
+            break;
+        case SoftwareCommand_SPRITE_TRANSFORMED:
+            DrawSpriteImageTransformed(command->TexturePtr,
+                command->X, command->Y, command->OffX, command->OffY, command->W, command->H,
+                command->SX, command->SY, command->SW, command->SH,
+                command->FlipFlag, command->Rotation, command->PaletteID, command->Blend);
+            break;
+        case SoftwareCommand_RECTANGLE:
+            DrawRectangleImage(command->RectX, command->RectY, command->RectW, command->RectH, command->Color, command->Blend);
+            break;
+        case SoftwareCommand_SCENE_LAYER:
+            if (command->Layer->DrawBehavior == DrawBehavior_CustomTileScanLines)
+                SoftwareRenderer::DrawSceneLayer_CustomTileScanLines(command->Layer, command->LayerView);
+            else
+                SoftwareRenderer::DrawSceneLayer_HorizontalParallax(command->Layer, command->LayerView);
+            break;
+    }
+}
+static void ReplayBands() {
+    SoftwareBand band;
+    CurrentBand = &band;
+
+    for (;;) {
+        int bandIndex = SDL_AtomicAdd(&NextBand, 1);
+        if (bandIndex >= BandCount)
+            break;
+
+        band.Y1 = bandIndex * BandHeight;
+        band.Y2 = band.Y1 + BandHeight;
+
+        for (size_t i = 0; i < Commands.size(); i++) {
+            SoftwareCommand* command = &Commands[i];
+            if (command->MaxY <= band.Y1 || command->MinY >= band.Y2)
+                continue;
+
+            ReplayCommand(command);
+        }
+    }
+
+    CurrentBand = NULL;
+}
+static int WorkerMain(void* data) {
+    for (;;) {
+        SDL_SemWait(WorkReady);
+        if (WorkersQuitting)
+            break;
+
+        ReplayBands();
+        SDL_SemPost(WorkDone);
+    }
+    return 0;
+}
+static void DestroyWorkers() {
+    WorkersQuitting = true;
+    for (int i = 0; i < WorkerCount; i++)
+        SDL_SemPost(WorkReady);
+    for (int i = 0; i < WorkerCount; i++)
+        SDL_WaitThread(Workers[i], NULL);
+
+    if (WorkReady)
+        SDL_DestroySemaphore(WorkReady);
+    if (WorkDone)
+        SDL_DestroySemaphore(WorkDone);
+
+    WorkReady = NULL;
+    WorkDone = NULL;
+    WorkerCount = 0;
+}
+static void StartWorkers() {
+    WorkersStarted = true;
+
+    // 0 picks one thread per core, 1 turns threaded rendering off.
+    int threads = SoftwareRenderer::ThreadsRequested > 0 ? SoftwareRenderer::ThreadsRequested : SDL_GetCPUCount();
+    if (threads > SOFTWARE_MAX_THREADS)
+        threads = SOFTWARE_MAX_THREADS;
+    if (threads <= 1)
+        return;
+
+    WorkReady = SDL_CreateSemaphore(0);
+    WorkDone = SDL_CreateSemaphore(0);
+    if (!WorkReady || !WorkDone) {
+        Log::Print(Log::LOG_ERROR, "Could not create software renderer semaphores: %s", SDL_GetError());
+        DestroyWorkers();
+        return;
+    }
+
+    WorkersQuitting = false;
+    for (int i = 0; i < threads - 1; i++) {
+        Workers[WorkerCount] = SDL_CreateThread(WorkerMain, "SoftwareRenderer", NULL);
+        if (!Workers[WorkerCount]) {
+            Log::Print(Log::LOG_ERROR, "Could not create software renderer thread: %s", SDL_GetError());
+            break;
+        }
+        WorkerCount++;
+    }
+
+    if (WorkerCount == 0) {
+        DestroyWorkers();
+        return;
+    }
+
+    Log::Print(Log::LOG_VERBOSE, "Software renderer using %d threads.", WorkerCount + 1);
+}
+static void GetCommandState(SoftwareCommandState* state) {
+    state->RenderTarget = Graphics::CurrentRenderTarget;
+    state->TextureBlend = Graphics::TextureBlend;
+    state->UsePalettes = Graphics::UsePalettes;
+    state->UsePaletteIndexLines = Graphics::UsePaletteIndexLines;
+    state->CompareColor = SoftwareRenderer::CompareColor;
+}
+static void SetCommandState(SoftwareCommandState* state) {
+    Graphics::CurrentRenderTarget = state->RenderTarget;
+    Graphics::TextureBlend = state->TextureBlend;
+    Graphics::UsePalettes = state->UsePalettes;
+    Graphics::UsePaletteIndexLines = state->UsePaletteIndexLines;
+    SoftwareRenderer::CompareColor = state->CompareColor;
+}
+// Returns a new command to fill in, or NULL if the draw can't be put
+// off and has to be done right now.
+static SoftwareCommand* AddCommand(int type, int minY, int maxY) {
+    // Replaying, so draw it.
+    if (CurrentBand)
+        return NULL;
+
+    if (!WorkersStarted)
+        StartWorkers();
+
+    // These read state that can change without the renderer knowing
+    // about it, so they're drawn in order with everything else.
+    if (!WorkerCount || SoftwareRenderer::UseSpriteDeform || UseStencil || DotMaskH || DotMaskV || !Graphics::CurrentRenderTarget) {
+        SoftwareRenderer::FlushCommands();
+        return NULL;
+    }
+
+    SoftwareCommandState state;
+    GetCommandState(&state);
+    if (Commands.size() && memcmp(&state, &CommandState, sizeof(state)) != 0)
+        SoftwareRenderer::FlushCommands();
+    if (!Commands.size())
+        CommandState = state;
+
+    Commands.emplace_back();
+
+    SoftwareCommand* command = &Commands.back();
+    command->Type = type;
+    command->MinY = minY;
+    command->MaxY = maxY;
+    command->Clip = Graphics::CurrentClip;
+    command->CurrentBlend = CurrentBlendState;
+    return command;
+}
+
+// Draws everything in the command list. This has to happen before
+// anything that the recorded draws read from (palettes, textures, the
+// render target, or the filter table) gets changed.
+PUBLIC STATIC void     SoftwareRenderer::FlushCommands() {
+    if (!Commands.size() || CurrentBand)
+        return;
+
+    Texture* target = CommandState.RenderTarget;
+    int height = (int)target->Height;
+    int bands = (WorkerCount + 1) * SOFTWARE_BANDS_PER_THREAD;
+
+    BandHeight = (height + bands - 1) / bands;
+    if (BandHeight < SOFTWARE_MIN_BAND_HEIGHT)
+        BandHeight = SOFTWARE_MIN_BAND_HEIGHT;
+    BandCount = (height + BandHeight - 1) / BandHeight;
+
+    SoftwareCommandState state;
+    GetCommandState(&state);
+    SetCommandState(&CommandState);
+
+    BlendState blendState = CurrentBlendState;
+    PixelFunction pixelFunction = CurrentPixelFunction;
+    TintFunction tintFunction = CurrentTintFunction;
+
+    SDL_AtomicSet(&NextBand, 0);
+    for (int i = 0; i < WorkerCount; i++)
+        SDL_SemPost(WorkReady);
+
+    ReplayBands();
+
+    for (int i = 0; i < WorkerCount; i++)
+        SDL_SemWait(WorkDone);
+
+    CurrentBlendState = blendState;
+    CurrentPixelFunction = pixelFunction;
+    CurrentTintFunction = tintFunction;
+
+    SetCommandState(&state);
+    Commands.clear();
+}
+
 // Initialization and disposal functions
 PUBLIC STATIC void     SoftwareRenderer::Init() {
     SoftwareRenderer::BackendFunctions.Init();
@@ -150,6 +435,8 @@ PUBLIC STATIC void     SoftwareRenderer::SetGraphicsFunctions() {
         FilterInvert[a] = (hex ^ 0xFFFFFF) | 0xFF000000U;
     }
 
+    SpanBlitter::Init();
+
     CurrentBlendState.Mode = BlendMode_NORMAL;
     CurrentBlendState.Opacity = 0xFF;
     CurrentBlendState.FilterTable = nullptr;
@@ -232,7 +519,9 @@ PUBLIC STATIC void     SoftwareRenderer::SetGraphicsFunctions() {
     SoftwareRenderer::BackendFunctions.MakeFrameBufferID = SoftwareRenderer::MakeFrameBufferID;
 }
 PUBLIC STATIC void     SoftwareRenderer::Dispose() {
-
+    SoftwareRenderer::FlushCommands();
+    DestroyWorkers();
+    WorkersStarted = false;
 }
 
 PUBLIC STATIC void     SoftwareRenderer::RenderStart() {
@@ -240,7 +529,7 @@ PUBLIC STATIC void     SoftwareRenderer::RenderStart() {
         Graphics::PaletteColors[i][0] &= 0xFFFFFF;
 }
 PUBLIC STATIC void     SoftwareRenderer::RenderEnd() {
-
+    FlushCommands();
 }
 
 // Texture management functions
@@ -253,13 +542,14 @@ PUBLIC STATIC int      SoftwareRenderer::LockTexture(Texture* texture, void** pi
     return 0;
 }
 PUBLIC STATIC int      SoftwareRenderer::UpdateTexture(Texture* texture, SDL_Rect* src, void* pixels, int pitch) {
+    FlushCommands();
     return 0;
 }
 PUBLIC STATIC void     SoftwareRenderer::UnlockTexture(Texture* texture) {
 
 }
 PUBLIC STATIC void     SoftwareRenderer::DisposeTexture(Texture* texture) {
-
+    FlushCommands();
 }
 
 // Viewport and view-related functions
@@ -267,6 +557,7 @@ PUBLIC STATIC void     SoftwareRenderer::SetRenderTarget(Texture* texture) {
 
 }
 PUBLIC STATIC void     SoftwareRenderer::ReadFramebuffer(void* pixels, int width, int height) {
+    FlushCommands();
     if (Graphics::Internal.ReadFramebuffer)
         Graphics::Internal.ReadFramebuffer(pixels, width, height);
 }
@@ -314,11 +605,12 @@ PUBLIC STATIC void     SoftwareRenderer::MakePerspectiveMatrix(Matrix4x4* out, f
 }
 
 void GetClipRegion(int& clip_x1, int& clip_y1, int& clip_x2, int& clip_y2) {
-    if (Graphics::CurrentClip.Enabled) {
-        clip_x1 = Graphics::CurrentClip.X;
-        clip_y1 = Graphics::CurrentClip.Y;
-        clip_x2 = Graphics::CurrentClip.X + Graphics::CurrentClip.Width;
-        clip_y2 = Graphics::CurrentClip.Y + Graphics::CurrentClip.Height;
+    ClipArea* clip = CurrentBand ? &CurrentBand->Clip : &Graphics::CurrentClip;
+    if (clip->Enabled) {
+        clip_x1 = clip->X;
+        clip_y1 = clip->Y;
+        clip_x2 = clip->X + clip->Width;
+        clip_y2 = clip->Y + clip->Height;
 
         if (clip_x1 < 0)
             clip_x1 = 0;
@@ -335,6 +627,14 @@ void GetClipRegion(int& clip_x1, int& clip_y1, int& clip_x2, int& clip_y2) {
         clip_x2 = (int)Graphics::CurrentRenderTarget->Width;
         clip_y2 = (int)Graphics::CurrentRenderTarget->Height;
     }
+
+    // Threads only ever draw into the band they're replaying.
+    if (CurrentBand) {
+        if (clip_y1 < CurrentBand->Y1)
+            clip_y1 = CurrentBand->Y1;
+        if (clip_y2 > CurrentBand->Y2)
+            clip_y2 = CurrentBand->Y2;
+    }
 }
 bool CheckClipRegion(int clip_x1, int clip_y1, int clip_x2, int clip_y2) {
     if (clip_x2 < 0 || clip_y2 < 0 || clip_x1 >= clip_x2 || clip_y1 >= clip_y2)
@@ -344,6 +644,7 @@ bool CheckClipRegion(int clip_x1, int clip_y1, int clip_x2, int clip_y2) {
 
 // Shader-related functions
 PUBLIC STATIC void     SoftwareRenderer::UseShader(void* shader) {
+    FlushCommands();
     if (!shader) {
         CurrentBlendState.FilterTable = nullptr;
         return;
@@ -393,6 +694,7 @@ PUBLIC STATIC void     SoftwareRenderer::SetFilter(int filter) {
 
 // These guys
 PUBLIC STATIC void     SoftwareRenderer::Clear() {
+    FlushCommands();
     Uint32* dstPx = (Uint32*)Graphics::CurrentRenderTarget->Pixels;
     Uint32  dstStride = Graphics::CurrentRenderTarget->Width;
     memset(dstPx, 0, dstStride * Graphics::CurrentRenderTarget->Height * 4);
@@ -728,6 +1030,7 @@ StencilOpFunction StencilFuncPass = StencilOpKeep;
 StencilOpFunction StencilFuncFail = StencilOpKeep;
 
 PUBLIC STATIC void     SoftwareRenderer::SetStencilEnabled(bool enabled) {
+    FlushCommands();
     if (Scene::ViewCurrent >= 0) {
         UseStencil = enabled;
         Scene::Views[Scene::ViewCurrent].SetStencilEnabled(enabled);
@@ -766,6 +1069,7 @@ PUBLIC STATIC void     SoftwareRenderer::SetStencilMask(int mask) {
     StencilMask = mask;
 }
 PUBLIC STATIC void     SoftwareRenderer::ClearStencil() {
+    FlushCommands();
     if (UseStencil && Graphics::CurrentView)
         Graphics::CurrentView->ClearStencil();
 }
@@ -788,6 +1092,7 @@ PUBLIC STATIC void SoftwareRenderer::SetDotMask(int mask) {
     SetDotMaskV(mask);
 }
 PUBLIC STATIC void SoftwareRenderer::SetDotMaskH(int mask) {
+    FlushCommands();
     if (mask < 0)
         mask = 0;
     else if (mask > 255)
@@ -796,6 +1101,7 @@ PUBLIC STATIC void SoftwareRenderer::SetDotMaskH(int mask) {
     DotMaskH = mask;
 }
 PUBLIC STATIC void SoftwareRenderer::SetDotMaskV(int mask) {
+    FlushCommands();
     if (mask < 0)
         mask = 0;
     else if (mask > 255)
@@ -804,9 +1110,11 @@ PUBLIC STATIC void SoftwareRenderer::SetDotMaskV(int mask) {
     DotMaskV = mask;
 }
 PUBLIC STATIC void SoftwareRenderer::SetDotMaskOffsetH(int offset) {
+    FlushCommands();
     DotMaskOffsetH = offset;
 }
 PUBLIC STATIC void SoftwareRenderer::SetDotMaskOffsetV(int offset) {
+    FlushCommands();
     DotMaskOffsetV = offset;
 }
 
@@ -933,6 +1241,7 @@ PUBLIC STATIC void     SoftwareRenderer::BindScene3D(Uint32 sceneIndex) {
         polygonRenderer.ClipPolygonsByFrustum = false;
 }
 PUBLIC STATIC void     SoftwareRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 drawMode) {
+    FlushCommands();
     if (sceneIndex < 0 || sceneIndex >= MAX_3D_SCENES)
         return;
 
@@ -1388,22 +1697,27 @@ PRIVATE STATIC bool     SoftwareRenderer::SetupPolygonRenderer(Matrix4x4* modelM
 }
 
 PUBLIC STATIC void     SoftwareRenderer::DrawPolygon3D(void* data, int vertexCount, int vertexFlag, Texture* texture, Matrix4x4* modelMatrix, Matrix4x4* normalMatrix) {
+    FlushCommands();
     if (SetupPolygonRenderer(modelMatrix, normalMatrix))
         polygonRenderer.DrawPolygon3D((VertexAttribute*)data, vertexCount, vertexFlag, texture);
 }
 PUBLIC STATIC void     SoftwareRenderer::DrawSceneLayer3D(void* layer, int sx, int sy, int sw, int sh, Matrix4x4* modelMatrix, Matrix4x4* normalMatrix) {
+    FlushCommands();
     if (SetupPolygonRenderer(modelMatrix, normalMatrix))
         polygonRenderer.DrawSceneLayer3D((SceneLayer*)layer, sx, sy, sw, sh);
 }
 PUBLIC STATIC void     SoftwareRenderer::DrawModel(void* model, Uint16 animation, Uint32 frame, Matrix4x4* modelMatrix, Matrix4x4* normalMatrix) {
+    FlushCommands();
     if (SetupPolygonRenderer(modelMatrix, normalMatrix))
         polygonRenderer.DrawModel((IModel*)model, animation, frame);
 }
 PUBLIC STATIC void     SoftwareRenderer::DrawModelSkinned(void* model, Uint16 armature, Matrix4x4* modelMatrix, Matrix4x4* normalMatrix) {
+    FlushCommands();
     if (SetupPolygonRenderer(modelMatrix, normalMatrix))
         polygonRenderer.DrawModelSkinned((IModel*)model, armature);
 }
 PUBLIC STATIC void     SoftwareRenderer::DrawVertexBuffer(Uint32 vertexBufferIndex, Matrix4x4* modelMatrix, Matrix4x4* normalMatrix) {
+    FlushCommands();
     if (Graphics::CurrentScene3D < 0 || vertexBufferIndex < 0 || vertexBufferIndex >= MAX_VERTEX_BUFFERS)
         return;
 
@@ -1448,6 +1762,20 @@ PUBLIC STATIC PixelFunction SoftwareRenderer::GetPixelFunction(int blendFlag) {
 
     return CurrentPixelFunction;
 }
+// Returns a function that blends a whole row at once, or NULL if the
+// pixels have to go through GetPixelFunction one at a time.
+PUBLIC STATIC SpanFunction SoftwareRenderer::GetSpanFunction(int blendFlag) {
+    if (DotMaskH || DotMaskV || UseStencil)
+        return NULL;
+    if (blendFlag & (BlendFlag_TINT_BIT | BlendFlag_FILTER_BIT))
+        return NULL;
+
+    int mode = blendFlag & BlendFlag_MODE_MASK;
+    if (mode > BlendFlag_SUBTRACT)
+        return NULL;
+
+    return SpanBlitter::Functions[mode];
+}
 
 static void DoLineStroke(int dst_x1, int dst_y1, int dst_x2, int dst_y2, PixelFunction pixelFunction, Uint32 col, BlendState& blendState, int* multTableAt, int* multSubTableAt, Uint32* dstPx, Uint32 dstStride) {
     int dx = Math::Abs(dst_x2 - dst_x1), sx = dst_x1 < dst_x2 ? 1 : -1;
@@ -1499,6 +1827,7 @@ PUBLIC STATIC void     SoftwareRenderer::SetLineWidth(float n) {
 
 }
 PUBLIC STATIC void     SoftwareRenderer::StrokeLine(float x1, float y1, float x2, float y2) {
+    FlushCommands();
     int x = 0, y = 0;
     Uint32* dstPx = (Uint32*)Graphics::CurrentRenderTarget->Pixels;
     Uint32  dstStride = Graphics::CurrentRenderTarget->Width;
@@ -1544,6 +1873,7 @@ PUBLIC STATIC void     SoftwareRenderer::StrokeLine(float x1, float y1, float x2
     DoLineStrokeBounded(dst_x1, dst_y1, dst_x2, dst_y2, minX, maxX, minY, maxY, pixelFunction, ColRGB, blendState, multTableAt, multSubTableAt, dstPx, dstStride);
 }
 PUBLIC STATIC void     SoftwareRenderer::StrokeCircle(float x, float y, float rad, float thickness) {
+    FlushCommands();
     Uint32* dstPx = (Uint32*)Graphics::CurrentRenderTarget->Pixels;
     Uint32  dstStride = Graphics::CurrentRenderTarget->Width;
 
@@ -1829,9 +2159,10 @@ PRIVATE STATIC void     SoftwareRenderer::StrokeThickCircle(float x, float y, fl
     }
 }
 PUBLIC STATIC void     SoftwareRenderer::StrokeEllipse(float x, float y, float w, float h) {
-
+    FlushCommands();
 }
 PUBLIC STATIC void     SoftwareRenderer::StrokeRectangle(float x, float y, float w, float h) {
+    FlushCommands();
     Uint32* dstPx = (Uint32*)Graphics::CurrentRenderTarget->Pixels;
     Uint32  dstStride = Graphics::CurrentRenderTarget->Width;
 
@@ -1900,6 +2231,7 @@ PUBLIC STATIC void     SoftwareRenderer::StrokeRectangle(float x, float y, float
 }
 
 PUBLIC STATIC void     SoftwareRenderer::FillCircle(float x, float y, float rad) {
+    FlushCommands();
     // just checks to see if the pixel is within a radius range, uses a bounding box constructed by the diameter
 
     Uint32* dstPx = (Uint32*)Graphics::CurrentRenderTarget->Pixels;
@@ -2003,25 +2335,23 @@ PUBLIC STATIC void     SoftwareRenderer::FillCircle(float x, float y, float rad)
 #undef SEEK_MAX
 }
 PUBLIC STATIC void     SoftwareRenderer::FillEllipse(float x, float y, float w, float h) {
+    FlushCommands();
+}
+void DrawRectangleImage(float x, float y, float w, float h, Uint32 col, BlendState blendState) {
+    SoftwareCommand* command = AddCommand(SoftwareCommand_RECTANGLE, (int)y, (int)(y + h));
+    if (command) {
+        command->RectX = x;
+        command->RectY = y;
+        command->RectW = w;
+        command->RectH = h;
+        command->Color = col;
+        command->Blend = blendState;
+        return;
+    }
 
-}
-PUBLIC STATIC void     SoftwareRenderer::FillRectangle(float x, float y, float w, float h) {
     Uint32* dstPx = (Uint32*)Graphics::CurrentRenderTarget->Pixels;
     Uint32  dstStride = Graphics::CurrentRenderTarget->Width;
 
-    View* currentView = Graphics::CurrentView;
-    if (!currentView)
-        return;
-
-    int cx = (int)std::floor(currentView->X);
-    int cy = (int)std::floor(currentView->Y);
-
-    Matrix4x4* out = Graphics::ModelViewMatrix;
-    x += out->Values[12];
-    y += out->Values[13];
-    x -= cx;
-    y -= cy;
-
     int dst_x1 = x;
     int dst_y1 = y;
     int dst_x2 = x + w;
@@ -2044,19 +2374,17 @@ PUBLIC STATIC void     SoftwareRenderer::FillRectangle(float x, float y, float w
     if (dst_x2 < 0 || dst_y2 < 0 || dst_x1 >= dst_x2 || dst_y1 >= dst_y2)
         return;
 
-    BlendState blendState = GetBlendState();
-    if (!AlterBlendState(blendState))
+    if (!SoftwareRenderer::AlterBlendState(blendState))
         return;
 
-    Uint32 col = ColRGB;
     int blendFlag = blendState.Mode;
     int opacity = blendState.Opacity;
 
     if (blendFlag & (BlendFlag_TINT_BIT | BlendFlag_FILTER_BIT))
-        SetTintFunction(blendFlag);
+        SoftwareRenderer::SetTintFunction(blendFlag);
 
-    int* multTableAt = &MultTable[opacity << 8];
-    int* multSubTableAt = &MultSubTable[opacity << 8];
+    int* multTableAt = &SoftwareRenderer::MultTable[opacity << 8];
+    int* multSubTableAt = &SoftwareRenderer::MultSubTable[opacity << 8];
     int dst_strideY = dst_y1 * dstStride;
 
     if (!UseStencil && ((blendFlag & (BlendFlag_MODE_MASK | BlendFlag_TINT_BIT)) == BlendFlag_OPAQUE)) {
@@ -2066,7 +2394,7 @@ PUBLIC STATIC void     SoftwareRenderer::FillRectangle(float x, float y, float w
         }
     }
     else {
-        PixelFunction pixelFunction = GetPixelFunction(blendFlag);
+        PixelFunction pixelFunction = SoftwareRenderer::GetPixelFunction(blendFlag);
 
         for (int dst_y = dst_y1; dst_y < dst_y2; dst_y++) {
             for (int dst_x = dst_x1; dst_x < dst_x2; dst_x++) {
@@ -2076,7 +2404,24 @@ PUBLIC STATIC void     SoftwareRenderer::FillRectangle(float x, float y, float w
         }
     }
 }
+PUBLIC STATIC void     SoftwareRenderer::FillRectangle(float x, float y, float w, float h) {
+    View* currentView = Graphics::CurrentView;
+    if (!currentView)
+        return;
+
+    int cx = (int)std::floor(currentView->X);
+    int cy = (int)std::floor(currentView->Y);
+
+    Matrix4x4* out = Graphics::ModelViewMatrix;
+    x += out->Values[12];
+    y += out->Values[13];
+    x -= cx;
+    y -= cy;
+
+    DrawRectangleImage(x, y, w, h, ColRGB, GetBlendState());
+}
 PUBLIC STATIC void     SoftwareRenderer::FillTriangle(float x1, float y1, float x2, float y2, float x3, float y3) {
+    FlushCommands();
     View* currentView = Graphics::CurrentView;
     if (!currentView)
         return;
@@ -2099,6 +2444,7 @@ PUBLIC STATIC void     SoftwareRenderer::FillTriangle(float x1, float y1, float
     PolygonRasterizer::DrawBasic(vectors, ColRGB, 3, GetBlendState());
 }
 PUBLIC STATIC void     SoftwareRenderer::FillTriangleBlend(float x1, float y1, float x2, float y2, float x3, float y3, int c1, int c2, int c3) {
+    FlushCommands();
     View* currentView = Graphics::CurrentView;
     if (!currentView)
         return;
@@ -2122,6 +2468,7 @@ PUBLIC STATIC void     SoftwareRenderer::FillTriangleBlend(float x1, float y1, f
     PolygonRasterizer::DrawBasicBlend(vectors, colors, 3, GetBlendState());
 }
 PUBLIC STATIC void     SoftwareRenderer::FillQuad(float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4) {
+    FlushCommands();
     View* currentView = Graphics::CurrentView;
     if (!currentView)
         return;
@@ -2145,6 +2492,7 @@ PUBLIC STATIC void     SoftwareRenderer::FillQuad(float x1, float y1, float x2,
     PolygonRasterizer::DrawBasic(vectors, ColRGB, 4, GetBlendState());
 }
 PUBLIC STATIC void     SoftwareRenderer::FillQuadBlend(float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4, int c1, int c2, int c3, int c4) {
+    FlushCommands();
     View* currentView = Graphics::CurrentView;
     if (!currentView)
         return;
@@ -2203,6 +2551,7 @@ PRIVATE STATIC void    SoftwareRenderer::DrawShapeTextured(Texture* texturePtr,
     PolygonRasterizer::DrawBlendPerspective(texturePtr, vectors, uv, colors, numPoints, GetBlendState());
 }
 PUBLIC STATIC void     SoftwareRenderer::DrawTriangleTextured(Texture* texturePtr, float x1, float y1, float x2, float y2, float x3, float y3, int c1, int c2, int c3, float u1, float v1, float u2, float v2, float u3, float v3) {
+    FlushCommands();
     float px[3];
     float py[3];
     float pu[3];
@@ -2230,6 +2579,7 @@ PUBLIC STATIC void     SoftwareRenderer::DrawTriangleTextured(Texture* texturePt
     DrawShapeTextured(texturePtr, 3, px, py, pc, pu, pv);
 }
 PUBLIC STATIC void     SoftwareRenderer::DrawQuadTextured(Texture* texturePtr, float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4, int c1, int c2, int c3, int c4, float u1, float v1, float u2, float v2, float u3, float v3, float u4, float v4) {
+    FlushCommands();
     float px[4];
     float py[4];
     float pu[4];
@@ -2264,6 +2614,21 @@ PUBLIC STATIC void     SoftwareRenderer::DrawQuadTextured(Texture* texturePtr, f
 }
 
 void DrawSpriteImage(Texture* texture, int x, int y, int w, int h, int sx, int sy, int flipFlag, unsigned paletteID, BlendState blendState) {
+    SoftwareCommand* command = AddCommand(SoftwareCommand_SPRITE, y, y + h);
+    if (command) {
+        command->TexturePtr = texture;
+        command->X = x;
+        command->Y = y;
+        command->W = w;
+        command->H = h;
+        command->SX = sx;
+        command->SY = sy;
+        command->FlipFlag = flipFlag;
+        command->PaletteID = paletteID;
+        command->Blend = blendState;
+        return;
+    }
+
     Uint32* srcPx = (Uint32*)texture->Pixels;
     Uint32  srcStride = texture->Width;
     Uint32* srcPxLine;
@@ -2422,7 +2787,31 @@ void DrawSpriteImage(Texture* texture, int x, int y, int w, int h, int sx, int s
     int* multSubTableAt = &SoftwareRenderer::MultSubTable[opacity << 8];
     Sint32* deformValues = &SoftwareRenderer::SpriteDeformBuffer[dst_y1];
 
-    if (Graphics::UsePalettes && texture->Paletted) {
+    SpanFunction spanFunction = NULL;
+    if (!SoftwareRenderer::UseSpriteDeform)
+        spanFunction = SoftwareRenderer::GetSpanFunction(blendFlag);
+
+    if (spanFunction) {
+        bool paletted = Graphics::UsePalettes && texture->Paletted;
+        if (paletted && !Graphics::UsePaletteIndexLines)
+            index = &Graphics::PaletteColors[paletteID][0];
+
+        int srcStep = (flipFlag & 1) ? -1 : 1;
+        int srcStepY = (flipFlag & 2) ? -(int)srcStride : (int)srcStride;
+        dst_strideY = dst_y1 * dstStride;
+        src_strideY = ((flipFlag & 2) ? src_y2 : src_y1) * srcStride + ((flipFlag & 1) ? src_x2 : src_x1);
+        for (int dst_y = dst_y1; dst_y < dst_y2; dst_y++) {
+            if (paletted && Graphics::UsePaletteIndexLines)
+                index = &Graphics::PaletteColors[Graphics::PaletteIndexLines[dst_y]][0];
+
+            SpanBlitter::DrawSpan(spanFunction, srcPx + src_strideY, srcStep, paletted ? index : NULL,
+                dstPx + dst_strideY + dst_x1, dst_x2 - dst_x1, blendState, multTableAt, multSubTableAt);
+
+            dst_strideY += dstStride;
+            src_strideY += srcStepY;
+        }
+    }
+    else if (Graphics::UsePalettes && texture->Paletted) {
         if (!Graphics::UsePaletteIndexLines)
             index = &Graphics::PaletteColors[paletteID][0];
 
@@ -2482,6 +2871,29 @@ void DrawSpriteImage(Texture* texture, int x, int y, int w, int h, int sx, int s
     #undef DRAW_FLIPXY
 }
 void DrawSpriteImageTransformed(Texture* texture, int x, int y, int offx, int offy, int w, int h, int sx, int sy, int sw, int sh, int flipFlag, int rotation, unsigned paletteID, BlendState blendState) {
+    // However it's rotated, the sprite stays within this many
+    // pixels of its origin.
+    int reach = std::max(std::abs(offx), std::abs(offx + w)) + std::max(std::abs(offy), std::abs(offy + h));
+    SoftwareCommand* command = AddCommand(SoftwareCommand_SPRITE_TRANSFORMED, y - reach - 1, y + reach + 2);
+    if (command) {
+        command->TexturePtr = texture;
+        command->X = x;
+        command->Y = y;
+        command->OffX = offx;
+        command->OffY = offy;
+        command->W = w;
+        command->H = h;
+        command->SX = sx;
+        command->SY = sy;
+        command->SW = sw;
+        command->SH = sh;
+        command->FlipFlag = flipFlag;
+        command->Rotation = rotation;
+        command->PaletteID = paletteID;
+        command->Blend = blendState;
+        return;
+    }
+
     Uint32* srcPx = (Uint32*)texture->Pixels;
     Uint32  srcStride = texture->Width;
 
@@ -3180,6 +3592,7 @@ PUBLIC STATIC void     SoftwareRenderer::DrawSceneLayer_HorizontalParallax(Scene
     bool usePaletteIndexLines = Graphics::UsePaletteIndexLines && layer->UsePaletteIndexLines;
 
     PixelFunction pixelFunction = GetPixelFunction(blendFlag);
+    SpanFunction spanFunction = GetSpanFunction(blendFlag);
 
     int j;
     TileScanLine* tScanLine = &TileScanLineBuffer[dst_y1];
@@ -3341,8 +3754,16 @@ PUBLIC STATIC void     SoftwareRenderer::DrawSceneLayer_HorizontalParallax(Scene
                 // If y-flipped
                 if ((*tile & TILE_FLIPY_MASK))
                     srcTYb ^= 15;
+                if (spanFunction) {
+                    color = &tileSources[tileID][srcTYb * srcStrides[tileID]];
+                    Uint32* spanIndex = isPalettedSources[tileID] ? index : NULL;
+                    if ((*tile & TILE_FLIPX_MASK))
+                        SpanBlitter::DrawSpan(spanFunction, color + 15, -1, spanIndex, &dstPxLine[dst_x], 16, blendState, multTableAt, multSubTableAt);
+                    else
+                        SpanBlitter::DrawSpan(spanFunction, color, 1, spanIndex, &dstPxLine[dst_x], 16, blendState, multTableAt, multSubTableAt);
+                }
                 // If x-flipped
-                if ((*tile & TILE_FLIPX_MASK)) {
+                else if ((*tile & TILE_FLIPX_MASK)) {
                     color = &tileSources[tileID][srcTYb * srcStrides[tileID]];
                     if (isPalettedSources[tileID]) {
                         #define UNLOOPED(n, k) if (color[n] && (index[color[n]] & 0xFF000000U)) { pixelFunction(&index[color[n]], &dstPxLine[dst_x + k], blendState, multTableAt, multSubTableAt); }
@@ -3729,6 +4150,20 @@ PUBLIC STATIC void     SoftwareRenderer::DrawSceneLayer(SceneLayer* layer, View*
         SoftwareRenderer::DrawSceneLayer_InitTileScanLines(layer, currentView);
     }
 
+    // The scan lines are only good until the next layer sets them up,
+    // so the layer is drawn right away, just split up between threads.
+    if (layer->DrawBehavior == DrawBehavior_PGZ1_BG
+        || layer->DrawBehavior == DrawBehavior_HorizontalParallax
+        || layer->DrawBehavior == DrawBehavior_CustomTileScanLines) {
+        SoftwareCommand* command = AddCommand(SoftwareCommand_SCENE_LAYER, 0, MAX_FRAMEBUFFER_HEIGHT);
+        if (command) {
+            command->Layer = layer;
+            command->LayerView = currentView;
+            FlushCommands();
+            return;
+        }
+    }
+
     switch (layer->DrawBehavior) {
         case DrawBehavior_PGZ1_BG:
 		case DrawBehavior_HorizontalParallax:
@@ -0,0 +1,357 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Rendering/Enums.h>
+
+class SpanBlitter {
+public:
+    static bool         UseSIMD;
+    static const char*  Level;
+    static SpanFunction Functions[4];
+};
+#endif
+
+#include <Engine/Rendering/Software/SpanBlitter.h>
+
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Includes/StandardSDL2.h>
+#include <Engine/Rendering/Software/SoftwareEnums.h>
+#include <Engine/Rendering/Software/SoftwareRenderer.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define SPAN_X86
+    #include <immintrin.h>
+    // Lets the AVX2 kernels be built without compiling the whole
+    // engine for AVX2. They're only called if the CPU has it.
+    #if defined(__GNUC__) || defined(__clang__)
+        #define SPAN_TARGET(features) __attribute__((target(features)))
+    #else
+        #define SPAN_TARGET(features)
+    #endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+    #define SPAN_NEON
+    #include <arm_neon.h>
+#endif
+
+// Rows that need their pixels flipped or looked up in a palette first
+// are done in pieces of this many pixels.
+#define SPAN_CHUNK 64
+
+typedef void (*PaletteResolveFunction)(Uint32* src, Uint32* index, Uint32* dst, int count);
+
+bool         SpanBlitter::UseSIMD = true;
+const char*  SpanBlitter::Level = "None";
+SpanFunction SpanBlitter::Functions[4];
+
+static PaletteResolveFunction ResolvePalette = NULL;
+
+// Scalar versions
+// These go through the same pixel functions as everything else does,
+// so they always match them exactly.
+#define SCALAR_SPAN(name, pixelFunction) \
+static void name(Uint32* src, Uint32* dst, int count, BlendState& state, int* multTableAt, int* multSubTableAt) { \
+    for (int i = 0; i < count; i++) { \
+        if (src[i] & 0xFF000000U) \
+            pixelFunction(&src[i], &dst[i], state, multTableAt, multSubTableAt); \
+    } \
+}
+SCALAR_SPAN(SpanScalarOpaque, SoftwareRenderer::PixelNoFiltSetOpaque)
+SCALAR_SPAN(SpanScalarTransparent, SoftwareRenderer::PixelNoFiltSetTransparent)
+SCALAR_SPAN(SpanScalarAdditive, SoftwareRenderer::PixelNoFiltSetAdditive)
+SCALAR_SPAN(SpanScalarSubtract, SoftwareRenderer::PixelNoFiltSetSubtract)
+#undef SCALAR_SPAN
+
+static void ResolvePaletteScalar(Uint32* src, Uint32* index, Uint32* dst, int count) {
+    for (int i = 0; i < count; i++)
+        dst[i] = src[i] ? index[src[i]] : 0;
+}
+
+// The blend tables are (opacity * color) >> 8 for transparent and
+// additive blending, and the subtract table rounds the other way:
+// (opacity * -(color ^ 0xFF)) >> 8 floors towards negative infinity,
+// which is the same as taking away (opacity * (color ^ 0xFF) + 0xFF) >> 8.
+// Both fit in 16 bits, so the SIMD versions do them 8 or 16 channels at
+// a time and come out the same as the tables.
+
+#ifdef SPAN_X86
+// SSE2 versions (4 pixels at a time)
+SPAN_TARGET("sse2") static inline __m128i MultiplySSE2(__m128i color, __m128i amount) {
+    return _mm_srli_epi16(_mm_mullo_epi16(color, amount), 8);
+}
+SPAN_TARGET("sse2") static inline __m128i MultiplyRoundUpSSE2(__m128i color, __m128i amount) {
+    return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(color, amount), _mm_set1_epi16(0xFF)), 8);
+}
+
+#define SSE2_SPAN_BEGIN() \
+    const __m128i alphaMask = _mm_set1_epi32((int)0xFF000000U); \
+    const __m128i zero = _mm_setzero_si128(); \
+    int i = 0; \
+    for (; i + 4 <= count; i += 4) { \
+        __m128i s = _mm_loadu_si128((__m128i*)&src[i]); \
+        __m128i skip = _mm_cmpeq_epi32(_mm_and_si128(s, alphaMask), zero); \
+        if (_mm_movemask_epi8(skip) == 0xFFFF) \
+            continue; \
+        __m128i d = _mm_loadu_si128((__m128i*)&dst[i]); \
+        __m128i result;
+#define SSE2_SPAN_END(scalarFunction) \
+        result = _mm_or_si128(_mm_and_si128(skip, d), _mm_andnot_si128(skip, result)); \
+        _mm_storeu_si128((__m128i*)&dst[i], result); \
+    } \
+    scalarFunction(src + i, dst + i, count - i, state, multTableAt, multSubTableAt);
+
+SPAN_TARGET("sse2") static void SpanSSE2Opaque(Uint32* src, Uint32* dst, int count, BlendState& state, int* multTableAt, int* multSubTableAt) {
+    SSE2_SPAN_BEGIN();
+    result = s;
+    SSE2_SPAN_END(SpanScalarOpaque);
+}
+SPAN_TARGET("sse2") static void SpanSSE2Transparent(Uint32* src, Uint32* dst, int count, BlendState& state, int* multTableAt, int* multSubTableAt) {
+    const __m128i opacity = _mm_set1_epi16((short)state.Opacity);
+    const __m128i opacityInv = _mm_set1_epi16((short)(state.Opacity ^ 0xFF));
+    SSE2_SPAN_BEGIN();
+    __m128i lo = _mm_add_epi16(
+        MultiplySSE2(_mm_unpacklo_epi8(s, zero), opacity),
+        MultiplySSE2(_mm_unpacklo_epi8(d, zero), opacityInv));
+    __m128i hi = _mm_add_epi16(
+        MultiplySSE2(_mm_unpackhi_epi8(s, zero), opacity),
+        MultiplySSE2(_mm_unpackhi_epi8(d, zero), opacityInv));
+    result = _mm_or_si128(_mm_packus_epi16(lo, hi), alphaMask);
+    SSE2_SPAN_END(SpanScalarTransparent);
+}
+SPAN_TARGET("sse2") static void SpanSSE2Additive(Uint32* src, Uint32* dst, int count, BlendState& state, int* multTableAt, int* multSubTableAt) {
+    const __m128i opacity = _mm_set1_epi16((short)state.Opacity);
+    SSE2_SPAN_BEGIN();
+    __m128i lo = MultiplySSE2(_mm_unpacklo_epi8(s, zero), opacity);
+    __m128i hi = MultiplySSE2(_mm_unpackhi_epi8(s, zero), opacity);
+    result = _mm_or_si128(_mm_adds_epu8(d, _mm_packus_epi16(lo, hi)), alphaMask);
+    SSE2_SPAN_END(SpanScalarAdditive);
+}
+SPAN_TARGET("sse2") static void SpanSSE2Subtract(Uint32* src, Uint32* dst, int count, BlendState& state, int* multTableAt, int* multSubTableAt) {
+    const __m128i opacity = _mm_set1_epi16((short)state.Opacity);
+    SSE2_SPAN_BEGIN();
+    __m128i inv = _mm_xor_si128(s, _mm_set1_epi8((char)0xFF));
+    __m128i lo = MultiplyRoundUpSSE2(_mm_unpacklo_epi8(inv, zero), opacity);
+    __m128i hi = MultiplyRoundUpSSE2(_mm_unpackhi_epi8(inv, zero), opacity);
+    result = _mm_or_si128(_mm_subs_epu8(d, _mm_packus_epi16(lo, hi)), alphaMask);
+    SSE2_SPAN_END(SpanScalarSubtract);
+}
+
+#undef SSE2_SPAN_BEGIN
+#undef SSE2_SPAN_END
+
+// AVX2 versions (8 pixels at a time)
+SPAN_TARGET("avx2") static inline __m256i MultiplyAVX2(__m256i color, __m256i amount) {
+    return _mm256_srli_epi16(_mm256_mullo_epi16(color, amount), 8);
+}
+SPAN_TARGET("avx2") static inline __m256i MultiplyRoundUpAVX2(__m256i color, __m256i amount) {
+    return _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(color, amount), _mm256_set1_epi16(0xFF)), 8);
+}
+
+// Unpacking and packing both work within each 128-bit lane, so doing
+// one after the other puts the pixels back in the order they were in.
+// The upper halves are cleared before going back to SSE2 code, which
+// is very slow to switch to otherwise.
+#define AVX2_SPAN_BEGIN() \
+    const __m256i alphaMask = _mm256_set1_epi32((int)0xFF000000U); \
+    const __m256i zero = _mm256_setzero_si256(); \
+    int i = 0; \
+    for (; i + 8 <= count; i += 8) { \
+        __m256i s = _mm256_loadu_si256((__m256i*)&src[i]); \
+        __m256i skip = _mm256_cmpeq_epi32(_mm256_and_si256(s, alphaMask), zero); \
+        if (_mm256_movemask_epi8(skip) == -1) \
+            continue; \
+        __m256i d = _mm256_loadu_si256((__m256i*)&dst[i]); \
+        __m256i result;
+#define AVX2_SPAN_END(sse2Function) \
+        result = _mm256_blendv_epi8(result, d, skip); \
+        _mm256_storeu_si256((__m256i*)&dst[i], result); \
+    } \
+    _mm256_zeroupper(); \
+    sse2Function(src + i, dst + i, count - i, state, multTableAt, multSubTableAt);
+
+SPAN_TARGET("avx2") static void SpanAVX2Opaque(Uint32* src, Uint32* dst, int count, BlendState& state, int* multTableAt, int* multSubTableAt) {
+    AVX2_SPAN_BEGIN();
+    result = s;
+    AVX2_SPAN_END(SpanSSE2Opaque);
+}
+SPAN_TARGET("avx2") static void SpanAVX2Transparent(Uint32* src, Uint32* dst, int count, BlendState& state, int* multTableAt, int* multSubTableAt) {
+    const __m256i opacity = _mm256_set1_epi16((short)state.Opacity);
+    const __m256i opacityInv = _mm256_set1_epi16((short)(state.Opacity ^ 0xFF));
+    AVX2_SPAN_BEGIN();
+    __m256i lo = _mm256_add_epi16(
+        MultiplyAVX2(_mm256_unpacklo_epi8(s, zero), opacity),
+        MultiplyAVX2(_mm256_unpacklo_epi8(d, zero), opacityInv));
+    __m256i hi = _mm256_add_epi16(
+        MultiplyAVX2(_mm256_unpackhi_epi8(s, zero), opacity),
+        MultiplyAVX2(_mm256_unpackhi_epi8(d, zero), opacityInv));
+    result = _mm256_or_si256(_mm256_packus_epi16(lo, hi), alphaMask);
+    AVX2_SPAN_END(SpanSSE2Transparent);
+}
+SPAN_TARGET("avx2") static void SpanAVX2Additive(Uint32* src, Uint32* dst, int count, BlendState& state, int* multTableAt, int* multSubTableAt) {
+    const __m256i opacity = _mm256_set1_epi16((short)state.Opacity);
+    AVX2_SPAN_BEGIN();
+    __m256i lo = MultiplyAVX2(_mm256_unpacklo_epi8(s, zero), opacity);
+    __m256i hi = MultiplyAVX2(_mm256_unpackhi_epi8(s, zero), opacity);
+    result = _mm256_or_si256(_mm256_adds_epu8(d, _mm256_packus_epi16(lo, hi)), alphaMask);
+    AVX2_SPAN_END(SpanSSE2Additive);
+}
+SPAN_TARGET("avx2") static void SpanAVX2Subtract(Uint32* src, Uint32* dst, int count, BlendState& state, int* multTableAt, int* multSubTableAt) {
+    const __m256i opacity = _mm256_set1_epi16((short)state.Opacity);
+    AVX2_SPAN_BEGIN();
+    __m256i inv = _mm256_xor_si256(s, _mm256_set1_epi8((char)0xFF));
+    __m256i lo = MultiplyRoundUpAVX2(_mm256_unpacklo_epi8(inv, zero), opacity);
+    __m256i hi = MultiplyRoundUpAVX2(_mm256_unpackhi_epi8(inv, zero), opacity);
+    result = _mm256_or_si256(_mm256_subs_epu8(d, _mm256_packus_epi16(lo, hi)), alphaMask);
+    AVX2_SPAN_END(SpanSSE2Subtract);
+}
+
+#undef AVX2_SPAN_BEGIN
+#undef AVX2_SPAN_END
+
+SPAN_TARGET("avx2") static void ResolvePaletteAVX2(Uint32* src, Uint32* index, Uint32* dst, int count) {
+    const __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i s = _mm256_loadu_si256((__m256i*)&src[i]);
+        __m256i used = _mm256_xor_si256(_mm256_cmpeq_epi32(s, zero), _mm256_set1_epi32(-1));
+        __m256i color = _mm256_mask_i32gather_epi32(zero, (const int*)index, s, used, 4);
+        _mm256_storeu_si256((__m256i*)&dst[i], color);
+    }
+    _mm256_zeroupper();
+    ResolvePaletteScalar(src + i, index, dst + i, count - i);
+}
+#endif
+
+#ifdef SPAN_NEON
+// NEON versions (4 pixels at a time)
+static inline uint8x16_t MultiplyNEON(uint8x16_t color, uint8x8_t amount) {
+    return vcombine_u8(
+        vshrn_n_u16(vmull_u8(vget_low_u8(color), amount), 8),
+        vshrn_n_u16(vmull_u8(vget_high_u8(color), amount), 8));
+}
+static inline uint8x16_t MultiplyRoundUpNEON(uint8x16_t color, uint8x8_t amount) {
+    const uint16x8_t roundUp = vdupq_n_u16(0xFF);
+    return vcombine_u8(
+        vshrn_n_u16(vaddq_u16(vmull_u8(vget_low_u8(color), amount), roundUp), 8),
+        vshrn_n_u16(vaddq_u16(vmull_u8(vget_high_u8(color), amount), roundUp), 8));
+}
+
+#define NEON_SPAN_BEGIN() \
+    const uint32x4_t alphaMask = vdupq_n_u32(0xFF000000U); \
+    int i = 0; \
+    for (; i + 4 <= count; i += 4) { \
+        uint32x4_t s = vld1q_u32(&src[i]); \
+        uint32x4_t skip = vceqq_u32(vandq_u32(s, alphaMask), vdupq_n_u32(0)); \
+        uint32x4_t d = vld1q_u32(&dst[i]); \
+        uint32x4_t result;
+#define NEON_SPAN_END(scalarFunction) \
+        vst1q_u32(&dst[i], vbslq_u32(skip, d, result)); \
+    } \
+    scalarFunction(src + i, dst + i, count - i, state, multTableAt, multSubTableAt);
+
+static void SpanNEONOpaque(Uint32* src, Uint32* dst, int count, BlendState& state, int* multTableAt, int* multSubTableAt) {
+    NEON_SPAN_BEGIN();
+    result = s;
+    NEON_SPAN_END(SpanScalarOpaque);
+}
+static void SpanNEONTransparent(Uint32* src, Uint32* dst, int count, BlendState& state, int* multTableAt, int* multSubTableAt) {
+    const uint8x8_t opacity = vdup_n_u8((Uint8)state.Opacity);
+    const uint8x8_t opacityInv = vdup_n_u8((Uint8)(state.Opacity ^ 0xFF));
+    NEON_SPAN_BEGIN();
+    uint8x16_t color = vaddq_u8(
+        MultiplyNEON(vreinterpretq_u8_u32(s), opacity),
+        MultiplyNEON(vreinterpretq_u8_u32(d), opacityInv));
+    result = vorrq_u32(vreinterpretq_u32_u8(color), alphaMask);
+    NEON_SPAN_END(SpanScalarTransparent);
+}
+static void SpanNEONAdditive(Uint32* src, Uint32* dst, int count, BlendState& state, int* multTableAt, int* multSubTableAt) {
+    const uint8x8_t opacity = vdup_n_u8((Uint8)state.Opacity);
+    NEON_SPAN_BEGIN();
+    uint8x16_t color = vqaddq_u8(vreinterpretq_u8_u32(d), MultiplyNEON(vreinterpretq_u8_u32(s), opacity));
+    result = vorrq_u32(vreinterpretq_u32_u8(color), alphaMask);
+    NEON_SPAN_END(SpanScalarAdditive);
+}
+static void SpanNEONSubtract(Uint32* src, Uint32* dst, int count, BlendState& state, int* multTableAt, int* multSubTableAt) {
+    const uint8x8_t opacity = vdup_n_u8((Uint8)state.Opacity);
+    NEON_SPAN_BEGIN();
+    uint8x16_t inv = vmvnq_u8(vreinterpretq_u8_u32(s));
+    uint8x16_t color = vqsubq_u8(vreinterpretq_u8_u32(d), MultiplyRoundUpNEON(inv, opacity));
+    result = vorrq_u32(vreinterpretq_u32_u8(color), alphaMask);
+    NEON_SPAN_END(SpanScalarSubtract);
+}
+
+#undef NEON_SPAN_BEGIN
+#undef NEON_SPAN_END
+#endif
+
+PUBLIC STATIC void SpanBlitter::Init() {
+    SpanBlitter::Functions[BlendFlag_OPAQUE] = SpanScalarOpaque;
+    SpanBlitter::Functions[BlendFlag_TRANSPARENT] = SpanScalarTransparent;
+    SpanBlitter::Functions[BlendFlag_ADDITIVE] = SpanScalarAdditive;
+    SpanBlitter::Functions[BlendFlag_SUBTRACT] = SpanScalarSubtract;
+    ResolvePalette = ResolvePaletteScalar;
+    SpanBlitter::Level = "None";
+
+    if (!SpanBlitter::UseSIMD) {
+        Log::Print(Log::LOG_VERBOSE, "Software renderer not using SIMD span blitters.");
+        return;
+    }
+
+#ifdef SPAN_X86
+    if (SDL_HasAVX2()) {
+        SpanBlitter::Functions[BlendFlag_OPAQUE] = SpanAVX2Opaque;
+        SpanBlitter::Functions[BlendFlag_TRANSPARENT] = SpanAVX2Transparent;
+        SpanBlitter::Functions[BlendFlag_ADDITIVE] = SpanAVX2Additive;
+        SpanBlitter::Functions[BlendFlag_SUBTRACT] = SpanAVX2Subtract;
+        ResolvePalette = ResolvePaletteAVX2;
+        SpanBlitter::Level = "AVX2";
+    }
+    else if (SDL_HasSSE2()) {
+        SpanBlitter::Functions[BlendFlag_OPAQUE] = SpanSSE2Opaque;
+        SpanBlitter::Functions[BlendFlag_TRANSPARENT] = SpanSSE2Transparent;
+        SpanBlitter::Functions[BlendFlag_ADDITIVE] = SpanSSE2Additive;
+        SpanBlitter::Functions[BlendFlag_SUBTRACT] = SpanSSE2Subtract;
+        SpanBlitter::Level = "SSE2";
+    }
+#endif
+#ifdef SPAN_NEON
+    if (SDL_HasNEON()) {
+        SpanBlitter::Functions[BlendFlag_OPAQUE] = SpanNEONOpaque;
+        SpanBlitter::Functions[BlendFlag_TRANSPARENT] = SpanNEONTransparent;
+        SpanBlitter::Functions[BlendFlag_ADDITIVE] = SpanNEONAdditive;
+        SpanBlitter::Functions[BlendFlag_SUBTRACT] = SpanNEONSubtract;
+        SpanBlitter::Level = "NEON";
+    }
+#endif
+
+    Log::Print(Log::LOG_VERBOSE, "Software renderer span blitters using %s.", SpanBlitter::Level);
+}
+
+// Draws a row of pixels. The source is read backwards if srcStep is
+// negative, and looked up in the palette if index isn't NULL. Pixels
+// with no alpha (or index 0) are skipped, like they are when drawing
+// them one at a time.
+PUBLIC STATIC void SpanBlitter::DrawSpan(SpanFunction spanFunction, Uint32* src, int srcStep, Uint32* index, Uint32* dst, int count, BlendState& state, int* multTableAt, int* multSubTableAt) {
+    if (srcStep > 0 && !index) {
+        spanFunction(src, dst, count, state, multTableAt, multSubTableAt);
+        return;
+    }
+
+    Uint32 buffer[SPAN_CHUNK];
+    while (count > 0) {
+        int length = count < SPAN_CHUNK ? count : SPAN_CHUNK;
+        if (srcStep > 0) {
+            ResolvePalette(src, index, buffer, length);
+        }
+        else {
+            for (int i = 0; i < length; i++)
+                buffer[i] = src[-i];
+            if (index)
+                ResolvePalette(buffer, index, buffer, length);
+        }
+
+        spanFunction(buffer, dst, length, state, multTableAt, multSubTableAt);
+
+        src += srcStep * length;
+        dst += length;
+        count -= length;
+    }
+}
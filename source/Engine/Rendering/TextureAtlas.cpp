@@ -0,0 +1,660 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Rendering/Texture.h>
+
+class TextureAtlas {
+public:
+    static bool Enabled;
+    static int  PageSize;
+};
+#endif
+
+#include <Engine/Rendering/TextureAtlas.h>
+
+#include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Filesystem/Directory.h>
+#include <Engine/Graphics.h>
+#include <Engine/Hashing/CRC32.h>
+#include <Engine/Includes/HashMap.h>
+#include <Engine/IO/MemoryStream.h>
+#include <Engine/IO/ResourceStream.h>
+#include <Engine/ResourceTypes/Image.h>
+#include <Engine/ResourceTypes/ResourceLoader.h>
+#include <Engine/ResourceTypes/ResourceManager.h>
+#include <Engine/Utilities/StringUtils.h>
+
+// Packs sprite sheets and font glyph pages into shared pages, so that
+// sprites drawn one after another can come from the same texture. Each
+// sheet is copied into a page as it's loaded, and the sprite's frames
+// are moved to where the sheet landed.
+//
+// A layout can be baked into the data file ahead of time, which packs
+// every sheet in the Sprites folder together, largest first. Sheets
+// still only get copied into their page once something loads them.
+//
+// Entries count the sprites using them. Once the last one is disposed,
+// the entry's space goes back to its page, or stays reserved for it if
+// it's part of a baked layout.
+
+#define ATLAS_LAYOUT_FILENAME "TextureAtlas/Layout.bin"
+#define ATLAS_LAYOUT_MAGIC    0x534C5441 // ATLS
+// Empty pixels around each sheet, so filtering doesn't pull in its
+// neighbours.
+#define ATLAS_PADDING         2
+
+struct AtlasSkylineNode {
+    int X;
+    int Y;
+    int Width;
+};
+struct AtlasPage {
+    Texture*                 TexturePtr = NULL;
+    int                      Size = 0;
+    // Pages from a baked layout don't take anything that isn't in it
+    bool                     Baked = false;
+    vector<AtlasSkylineNode> Skyline;
+};
+struct AtlasEntry {
+    int    Page;
+    int    X;
+    int    Y;
+    int    Width;
+    int    Height;
+    // Has a spot on a baked page waiting for it
+    bool   Reserved;
+    bool   Loaded;
+    int    References;
+    // Sprite sheets are found again by filename; pixels aren't
+    bool   Keyed;
+    Uint32 Key;
+};
+
+bool TextureAtlas::Enabled = false;
+int  TextureAtlas::PageSize = 2048;
+
+static bool                  Initialized = false;
+static bool                  LayoutLoaded = false;
+static vector<AtlasPage*>    Pages;
+static vector<AtlasEntry*>   AllEntries;
+static HashMap<AtlasEntry*>* Entries = NULL;
+static Uint64                UsedArea = 0;
+
+static AtlasPage* NewPage(int size) {
+    AtlasPage* page = new AtlasPage;
+    page->Size = size;
+    page->Skyline.push_back(AtlasSkylineNode { 0, 0, size });
+    Pages.push_back(page);
+    return page;
+}
+// Finds how low a box can sit if its left edge is at the given node.
+static bool SkylineFit(AtlasPage* page, size_t index, int width, int height, int* y) {
+    int x = page->Skyline[index].X;
+    if (x + width > page->Size)
+        return false;
+
+    int top = 0;
+    for (int left = width; left > 0; index++) {
+        AtlasSkylineNode& node = page->Skyline[index];
+        if (node.Y > top)
+            top = node.Y;
+        if (top + height > page->Size)
+            return false;
+        left -= node.Width;
+    }
+    *y = top;
+    return true;
+}
+// Joins neighbouring nodes at the same height.
+static void SkylineMerge(AtlasPage* page) {
+    for (size_t i = 0; i + 1 < page->Skyline.size(); ) {
+        if (page->Skyline[i].Y == page->Skyline[i + 1].Y) {
+            page->Skyline[i].Width += page->Skyline[i + 1].Width;
+            page->Skyline.erase(page->Skyline.begin() + i + 1);
+        }
+        else {
+            i++;
+        }
+    }
+}
+// Makes sure a node starts at the given X.
+static void SkylineSplit(AtlasPage* page, int x) {
+    for (size_t i = 0; i < page->Skyline.size(); i++) {
+        AtlasSkylineNode node = page->Skyline[i];
+        if (node.X < x && node.X + node.Width > x) {
+            page->Skyline[i].Width = x - node.X;
+            page->Skyline.insert(page->Skyline.begin() + i + 1, AtlasSkylineNode { x, node.Y, node.X + node.Width - x });
+            return;
+        }
+    }
+}
+// Places a box as low (then as far left) as it can go.
+static bool SkylineInsert(AtlasPage* page, int width, int height, int* outX, int* outY) {
+    int bestIndex = -1, bestX = 0, bestY = page->Size;
+    for (size_t i = 0; i < page->Skyline.size(); i++) {
+        int y;
+        if (SkylineFit(page, i, width, height, &y) && y < bestY) {
+            bestIndex = (int)i;
+            bestX = page->Skyline[i].X;
+            bestY = y;
+        }
+    }
+    if (bestIndex < 0)
+        return false;
+
+    page->Skyline.insert(page->Skyline.begin() + bestIndex, AtlasSkylineNode { bestX, bestY + height, width });
+
+    // Cut back whatever the new node now covers
+    for (size_t i = bestIndex + 1; i < page->Skyline.size(); ) {
+        AtlasSkylineNode& prev = page->Skyline[i - 1];
+        AtlasSkylineNode& node = page->Skyline[i];
+        int covered = prev.X + prev.Width - node.X;
+        if (covered <= 0)
+            break;
+
+        node.X += covered;
+        node.Width -= covered;
+        if (node.Width > 0)
+            break;
+        page->Skyline.erase(page->Skyline.begin() + i);
+    }
+    SkylineMerge(page);
+
+    *outX = bestX;
+    *outY = bestY;
+    return true;
+}
+// Takes a box back out, which only works if nothing was put on top of
+// it. Otherwise its space comes back once its page is empty.
+static bool SkylineRemove(AtlasPage* page, int x, int y, int width, int height) {
+    for (size_t i = 0; i < page->Skyline.size(); i++) {
+        AtlasSkylineNode& node = page->Skyline[i];
+        if (node.X < x + width && node.X + node.Width > x && node.Y != y + height)
+            return false;
+    }
+
+    SkylineSplit(page, x);
+    SkylineSplit(page, x + width);
+    for (size_t i = 0; i < page->Skyline.size(); i++) {
+        AtlasSkylineNode& node = page->Skyline[i];
+        if (node.X >= x && node.X < x + width)
+            node.Y = y;
+    }
+    SkylineMerge(page);
+    return true;
+}
+static Texture* GetPageTexture(AtlasPage* page) {
+    if (!page->TexturePtr) {
+        page->TexturePtr = Graphics::CreateTexture(SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, page->Size, page->Size);
+        // Clears the padding, which the renderer might not have done
+        if (page->TexturePtr)
+            Graphics::UpdateTexture(page->TexturePtr, NULL, page->TexturePtr->Pixels, page->Size * 4);
+    }
+    return page->TexturePtr;
+}
+static int GetMaxPageSize() {
+    int size = TextureAtlas::PageSize;
+    if (Graphics::MaxTextureWidth > 1 && size > (int)Graphics::MaxTextureWidth)
+        size = (int)Graphics::MaxTextureWidth;
+    if (Graphics::MaxTextureHeight > 1 && size > (int)Graphics::MaxTextureHeight)
+        size = (int)Graphics::MaxTextureHeight;
+    return size;
+}
+
+// Copies pixels into a page, either at the spot the entry reserved or
+// wherever there's room. Returns the page, or NULL if it didn't fit.
+static Texture* Place(AtlasEntry* entry, Uint32* pixels, int width, int height) {
+    int maxSize = GetMaxPageSize();
+    if (width + ATLAS_PADDING > maxSize / 2 || height + ATLAS_PADDING > maxSize / 2)
+        return NULL;
+
+    if (!entry->Reserved) {
+        // Somewhere of its own
+        AtlasPage* page = NULL;
+        int x = 0, y = 0;
+        for (size_t i = 0; i < Pages.size() && !page; i++) {
+            if (!Pages[i]->Baked && SkylineInsert(Pages[i], width + ATLAS_PADDING, height + ATLAS_PADDING, &x, &y)) {
+                page = Pages[i];
+                entry->Page = (int)i;
+            }
+        }
+        if (!page) {
+            page = NewPage(maxSize);
+            entry->Page = (int)Pages.size() - 1;
+            if (!SkylineInsert(page, width + ATLAS_PADDING, height + ATLAS_PADDING, &x, &y))
+                return NULL;
+        }
+        entry->X = x;
+        entry->Y = y;
+        entry->Width = width;
+        entry->Height = height;
+    }
+
+    Texture* texture = GetPageTexture(Pages[entry->Page]);
+    if (!texture)
+        return NULL;
+
+    SDL_Rect rect = { entry->X, entry->Y, width, height };
+    Graphics::UpdateTexture(texture, &rect, pixels, width * 4);
+
+    entry->Loaded = true;
+    entry->References = 1;
+    UsedArea += (Uint64)width * height;
+    return texture;
+}
+static AtlasEntry* FindEntry(Texture* page, int offsetX, int offsetY) {
+    for (size_t i = 0; i < AllEntries.size(); i++) {
+        AtlasEntry* entry = AllEntries[i];
+        if (entry->Loaded && Pages[entry->Page]->TexturePtr == page && entry->X == offsetX && entry->Y == offsetY)
+            return entry;
+    }
+    return NULL;
+}
+
+PRIVATE STATIC void     TextureAtlas::Init() {
+    Initialized = true;
+    Entries = new HashMap<AtlasEntry*>(NULL, 64);
+
+    if (!ResourceManager::ResourceExists(ATLAS_LAYOUT_FILENAME))
+        return;
+
+    Stream* stream = ResourceStream::New(ATLAS_LAYOUT_FILENAME);
+    if (!stream)
+        return;
+
+    if (stream->ReadUInt32() != ATLAS_LAYOUT_MAGIC) {
+        Log::Print(Log::LOG_WARN, "Invalid texture atlas layout!");
+        stream->Close();
+        return;
+    }
+
+    int pageSize = (int)stream->ReadUInt32();
+    int pageCount = (int)stream->ReadUInt32();
+    int entryCount = (int)stream->ReadUInt32();
+    if (pageSize > GetMaxPageSize()) {
+        Log::Print(Log::LOG_WARN, "Texture atlas layout pages (%d x %d) are too large, ignoring it.", pageSize, pageSize);
+        stream->Close();
+        return;
+    }
+
+    for (int i = 0; i < pageCount; i++)
+        NewPage(pageSize)->Baked = true;
+
+    for (int i = 0; i < entryCount; i++) {
+        Uint32 key = stream->ReadUInt32();
+        AtlasEntry* entry = new AtlasEntry;
+        entry->Page = stream->ReadUInt16();
+        entry->X = stream->ReadUInt16();
+        entry->Y = stream->ReadUInt16();
+        entry->Width = stream->ReadUInt16();
+        entry->Height = stream->ReadUInt16();
+        entry->Reserved = true;
+        entry->Loaded = false;
+        entry->References = 0;
+        entry->Keyed = true;
+        entry->Key = key;
+        if (entry->Page >= pageCount) {
+            delete entry;
+            continue;
+        }
+        Entries->Put(key, entry);
+        AllEntries.push_back(entry);
+    }
+    stream->Close();
+
+    LayoutLoaded = true;
+    Log::Print(Log::LOG_VERBOSE, "Loaded texture atlas layout (%d sheets on %d pages)", entryCount, pageCount);
+}
+
+// Whether sprite sheets should go into the atlas: either it was turned
+// on in the settings, or a layout was baked into the data file.
+PUBLIC STATIC bool      TextureAtlas::IsEnabled() {
+    if (!Initialized)
+        TextureAtlas::Init();
+    return TextureAtlas::Enabled || LayoutLoaded;
+}
+PUBLIC STATIC bool      TextureAtlas::IsPage(Texture* texture) {
+    if (!texture)
+        return false;
+    for (size_t i = 0; i < Pages.size(); i++) {
+        if (Pages[i]->TexturePtr == texture)
+            return true;
+    }
+    return false;
+}
+
+// Loads a sprite sheet into the atlas, and returns the page it's on along
+// with where on the page it is. Sheets that can't share a page (paletted
+// ones, or ones that are too big) get a texture of their own, same as
+// ISprite::AddSpriteSheet would give them.
+PUBLIC STATIC Texture*  TextureAtlas::AddSpriteSheet(const char* filename, int* offsetX, int* offsetY) {
+    *offsetX = 0;
+    *offsetY = 0;
+    if (!TextureAtlas::IsEnabled())
+        return NULL;
+
+    Uint32 key = CRC32::EncryptString(filename);
+    AtlasEntry* entry = NULL;
+    if (Entries->GetIfExists(key, &entry) && entry->Loaded) {
+        entry->References++;
+        *offsetX = entry->X;
+        *offsetY = entry->Y;
+        return Pages[entry->Page]->TexturePtr;
+    }
+
+    Uint32* pixels;
+    int width, height;
+    bool paletted;
+    DecodedImage image;
+    Texture* preloaded = NULL;
+    if (ResourceLoader::TakeTexture(filename, &preloaded)) {
+        pixels = (Uint32*)preloaded->Pixels;
+        width = (int)preloaded->Width;
+        height = (int)preloaded->Height;
+        paletted = preloaded->Paletted;
+    }
+    else if (Image::Prepare(filename, &image)) {
+        pixels = image.Data;
+        width = (int)image.Width;
+        height = (int)image.Height;
+        paletted = image.NumPaletteColors > 0;
+    }
+    else {
+        Log::Print(Log::LOG_ERROR, "Could not load sprite sheet \"%s\"!", filename);
+        return NULL;
+    }
+
+    if (entry && (entry->Width != width || entry->Height != height)) {
+        Log::Print(Log::LOG_WARN, "Sprite sheet \"%s\" doesn't match the baked texture atlas layout!", filename);
+        entry = NULL;
+    }
+
+    Texture* texture = NULL;
+    if (!paletted) {
+        bool added = !entry;
+        if (added) {
+            entry = new AtlasEntry;
+            entry->Reserved = false;
+            entry->Loaded = false;
+            entry->Keyed = true;
+            entry->Key = key;
+        }
+
+        texture = Place(entry, pixels, width, height);
+        if (texture) {
+            *offsetX = entry->X;
+            *offsetY = entry->Y;
+            if (added) {
+                Entries->Put(key, entry);
+                AllEntries.push_back(entry);
+            }
+        }
+        else if (added) {
+            delete entry;
+        }
+    }
+
+    if (texture) {
+        if (preloaded)
+            Graphics::DisposeTexture(preloaded);
+        Memory::Free(image.Palette);
+        Memory::Free(image.Buffer);
+        return texture;
+    }
+
+    texture = preloaded ? preloaded : Image::Upload(filename, &image);
+    if (texture)
+        Graphics::SpriteSheetTextureMap->Put(filename, texture);
+    return texture;
+}
+// Packs a page's worth of pixels that don't come from a file, like a
+// font's glyphs. Returns NULL if they don't fit.
+PUBLIC STATIC Texture*  TextureAtlas::AddPixels(Uint32* pixels, int width, int height, int* offsetX, int* offsetY) {
+    *offsetX = 0;
+    *offsetY = 0;
+    if (!TextureAtlas::IsEnabled())
+        return NULL;
+
+    AtlasEntry* entry = new AtlasEntry;
+    entry->Reserved = false;
+    entry->Loaded = false;
+    entry->Keyed = false;
+    entry->Key = 0;
+
+    Texture* texture = Place(entry, pixels, width, height);
+    if (!texture) {
+        delete entry;
+        return NULL;
+    }
+
+    *offsetX = entry->X;
+    *offsetY = entry->Y;
+    AllEntries.push_back(entry);
+    return texture;
+}
+// Copies a sheet back out of its page into a texture of its own, for
+// things that change the whole texture, like palette conversion.
+// The sheet's spot stays taken until it's released.
+PUBLIC STATIC Texture*  TextureAtlas::Detach(Texture* page, int offsetX, int offsetY) {
+    AtlasEntry* entry = FindEntry(page, offsetX, offsetY);
+    if (!entry)
+        return NULL;
+
+    Uint32* pixels = (Uint32*)Memory::Malloc(entry->Width * entry->Height * sizeof(Uint32));
+    if (!pixels)
+        return NULL;
+
+    Uint32* source = (Uint32*)page->Pixels + entry->Y * page->Width + entry->X;
+    for (int y = 0; y < entry->Height; y++)
+        memcpy(pixels + y * entry->Width, source + y * page->Width, entry->Width * sizeof(Uint32));
+
+    Texture* texture = Graphics::CreateTextureFromPixels(entry->Width, entry->Height, pixels, entry->Width * sizeof(Uint32));
+    Memory::Free(pixels);
+    return texture;
+}
+// Lets go of a sheet or a page of pixels a sprite was using. Once nothing
+// uses it, its spot is cleared and given back.
+PUBLIC STATIC void      TextureAtlas::Release(Texture* page, int offsetX, int offsetY) {
+    AtlasEntry* entry = FindEntry(page, offsetX, offsetY);
+    if (!entry || --entry->References > 0)
+        return;
+
+    entry->Loaded = false;
+    UsedArea -= (Uint64)entry->Width * entry->Height;
+
+    // Free space has to be empty, since it becomes something else's padding
+    int width = entry->Width + ATLAS_PADDING;
+    int height = entry->Height + ATLAS_PADDING;
+    Uint32* blank = (Uint32*)Memory::Calloc(width * height, sizeof(Uint32));
+    if (blank) {
+        SDL_Rect rect = { entry->X, entry->Y, width, height };
+        Graphics::UpdateTexture(page, &rect, blank, width * 4);
+        Memory::Free(blank);
+    }
+
+    // Baked spots stay reserved for whenever the sheet gets loaded again
+    if (entry->Reserved)
+        return;
+
+    AtlasPage* atlasPage = Pages[entry->Page];
+    SkylineRemove(atlasPage, entry->X, entry->Y, width, height);
+
+    if (entry->Keyed)
+        Entries->Remove(entry->Key);
+    for (size_t i = 0; i < AllEntries.size(); i++) {
+        if (AllEntries[i] == entry) {
+            AllEntries.erase(AllEntries.begin() + i);
+            break;
+        }
+    }
+
+    bool empty = true;
+    for (size_t i = 0; i < AllEntries.size() && empty; i++) {
+        if (AllEntries[i]->Page == entry->Page)
+            empty = false;
+    }
+    if (empty) {
+        atlasPage->Skyline.clear();
+        atlasPage->Skyline.push_back(AtlasSkylineNode { 0, 0, atlasPage->Size });
+    }
+
+    delete entry;
+}
+
+PUBLIC STATIC void      TextureAtlas::GetStats(int* pageCount, int* sheetCount, double* usage) {
+    int used = 0, loaded = 0;
+    Uint64 area = 0;
+    for (size_t i = 0; i < Pages.size(); i++) {
+        if (Pages[i]->TexturePtr) {
+            area += (Uint64)Pages[i]->Size * Pages[i]->Size;
+            used++;
+        }
+    }
+    for (size_t i = 0; i < AllEntries.size(); i++) {
+        if (AllEntries[i]->Loaded)
+            loaded++;
+    }
+
+    *pageCount = used;
+    *sheetCount = loaded;
+    *usage = area ? (double)UsedArea / area : 0.0;
+}
+
+// Packs every sheet in the Sprites folder and writes where each one goes
+// into the data file.
+PUBLIC STATIC bool      TextureAtlas::Bake(const char* dataFilename) {
+    struct BakeItem {
+        Uint32 Key;
+        int    Width;
+        int    Height;
+        int    Page;
+        int    X;
+        int    Y;
+    };
+
+    if (!dataFilename)
+        dataFilename = "Data.hatch";
+
+    vector<char*> files;
+    Directory::GetFiles(&files, "Resources/Sprites", "*", true);
+
+    int maxSize = GetMaxPageSize();
+    vector<BakeItem> items;
+    Clock::Start();
+    for (size_t i = 0; i < files.size(); i++) {
+        const char* filename = files[i] + strlen("Resources/");
+        if (!StringUtils::StrCaseStr(filename, ".png")
+            && !StringUtils::StrCaseStr(filename, ".gif")
+            && !StringUtils::StrCaseStr(filename, ".jpg")
+            && !StringUtils::StrCaseStr(filename, ".jpeg"))
+            continue;
+
+        DecodedImage image;
+        if (!Image::Decode(filename, &image)) {
+            Log::Print(Log::LOG_WARN, "Could not decode \"%s\", skipping.", filename);
+            continue;
+        }
+
+        BakeItem item;
+        item.Key = CRC32::EncryptString(filename);
+        item.Width = (int)image.Width;
+        item.Height = (int)image.Height;
+        bool fits = item.Width + ATLAS_PADDING <= maxSize / 2 && item.Height + ATLAS_PADDING <= maxSize / 2;
+        if (!image.NumPaletteColors && fits)
+            items.push_back(item);
+
+        Memory::Free(image.Palette);
+        Memory::Free(image.Buffer);
+    }
+    for (size_t i = 0; i < files.size(); i++)
+        free(files[i]);
+
+    // Tallest first packs the tightest
+    std::sort(items.begin(), items.end(), [](const BakeItem& a, const BakeItem& b) -> bool {
+        if (a.Height != b.Height)
+            return a.Height > b.Height;
+        return a.Width > b.Width;
+    });
+
+    vector<AtlasPage> pages;
+    for (size_t i = 0; i < items.size(); i++) {
+        BakeItem& item = items[i];
+        item.Page = -1;
+        for (size_t p = 0; p < pages.size() && item.Page < 0; p++) {
+            if (SkylineInsert(&pages[p], item.Width + ATLAS_PADDING, item.Height + ATLAS_PADDING, &item.X, &item.Y))
+                item.Page = (int)p;
+        }
+        if (item.Page < 0) {
+            AtlasPage page;
+            page.Size = maxSize;
+            page.Skyline.push_back(AtlasSkylineNode { 0, 0, maxSize });
+            pages.push_back(page);
+            item.Page = (int)pages.size() - 1;
+            SkylineInsert(&pages.back(), item.Width + ATLAS_PADDING, item.Height + ATLAS_PADDING, &item.X, &item.Y);
+        }
+    }
+
+    size_t layoutSize = 16 + items.size() * 14;
+    Uint8* layout = (Uint8*)Memory::Malloc(layoutSize);
+    MemoryStream* stream = MemoryStream::New(layout, layoutSize);
+    if (!stream) {
+        Memory::Free(layout);
+        return false;
+    }
+    stream->WriteUInt32(ATLAS_LAYOUT_MAGIC);
+    stream->WriteUInt32((Uint32)maxSize);
+    stream->WriteUInt32((Uint32)pages.size());
+    stream->WriteUInt32((Uint32)items.size());
+    for (size_t i = 0; i < items.size(); i++) {
+        stream->WriteUInt32(items[i].Key);
+        stream->WriteUInt16((Uint16)items[i].Page);
+        stream->WriteUInt16((Uint16)items[i].X);
+        stream->WriteUInt16((Uint16)items[i].Y);
+        stream->WriteUInt16((Uint16)items[i].Width);
+        stream->WriteUInt16((Uint16)items[i].Height);
+    }
+    stream->Close();
+
+    Log::Print(Log::LOG_INFO, "Packed %d sprite sheets onto %d pages of %d x %d in %.3f ms",
+        (int)items.size(), (int)pages.size(), maxSize, maxSize, Clock::End());
+
+    // Let go of the data file before it gets replaced
+    ResourceManager::Dispose();
+
+    vector<ResourceFileEntry> entries;
+    ResourceFileEntry entry;
+    entry.Filename = ATLAS_LAYOUT_FILENAME;
+    entry.Data = layout;
+    entry.Size = layoutSize;
+    entries.push_back(entry);
+
+    bool success = ResourceManager::AddToDataFile(dataFilename, entries);
+    if (success)
+        Log::Print(Log::LOG_INFO, "Baked texture atlas layout into \"%s\".", dataFilename);
+    else
+        Log::Print(Log::LOG_ERROR, "Could not bake texture atlas layout into \"%s\"!", dataFilename);
+
+    Memory::Free(layout);
+    return success;
+}
+
+PUBLIC STATIC void      TextureAtlas::Dispose() {
+    for (size_t i = 0; i < Pages.size(); i++) {
+        if (Pages[i]->TexturePtr)
+            Graphics::DisposeTexture(Pages[i]->TexturePtr);
+        delete Pages[i];
+    }
+    Pages.clear();
+
+    for (size_t i = 0; i < AllEntries.size(); i++)
+        delete AllEntries[i];
+    AllEntries.clear();
+
+    delete Entries;
+    Entries = NULL;
+
+    UsedArea = 0;
+    LayoutLoaded = false;
+    Initialized = false;
+}
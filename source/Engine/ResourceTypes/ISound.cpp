@@ -91,11 +91,31 @@ PUBLIC AudioPlayback* ISound::CreatePlayer() {
     int requiredSamples = AudioManager::DeviceFormat.samples * AUDIO_FIRST_LOAD_SAMPLE_BOOST;
 
     AudioPlayback* playback = new AudioPlayback(Format, requiredSamples, BytesPerSample, AudioManager::BytesPerSample);
-    playback->SoundData = SoundData;
-    playback->OwnsSoundData = false;
+
+    // The audio thread streams music from sound data of its own, since
+    // this sound's might get loaded in full to be played as a sound
+    // effect at the same time.
+    SoundFormat* soundData = NULL;
+    if (SoundData->Samples.size() < (size_t)SoundData->TotalPossibleSamples)
+        soundData = ISound::OpenSoundData();
+    if (!soundData) {
+        soundData = new SoundFormat;
+        SoundData->CopySamples(soundData);
+    }
+
+    playback->SoundData = soundData;
+    playback->OwnsSoundData = true;
 
     return playback;
 }
+// Opens another stream of this sound's file.
+PRIVATE SoundFormat* ISound::OpenSoundData() {
+    if (StringUtils::StrCaseStr(Filename, ".ogg"))
+        return OGG::Load(Filename);
+    if (StringUtils::StrCaseStr(Filename, ".wav"))
+        return WAV::Load(Filename);
+    return NULL;
+}
 
 PUBLIC void ISound::Dispose() {
 
@@ -11,6 +11,9 @@ public:
 
     Texture*          Spritesheets[32];
     bool              SpritesheetsBorrowed[32];
+    // Where each sheet is on its texture, if it's on an atlas page
+    int               SpritesheetsOffsetX[32];
+    int               SpritesheetsOffsetY[32];
     char              SpritesheetsFilenames[128][32];
     int               SpritesheetCount = 0;
     int               CollisionBoxCount = 0;
@@ -26,9 +29,8 @@ public:
 #include <Engine/Application.h>
 #include <Engine/Graphics.h>
 
-#include <Engine/ResourceTypes/ImageFormats/GIF.h>
-#include <Engine/ResourceTypes/ImageFormats/JPEG.h>
-#include <Engine/ResourceTypes/ImageFormats/PNG.h>
+#include <Engine/Rendering/TextureAtlas.h>
+#include <Engine/ResourceTypes/Image.h>
 
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Clock.h>
@@ -42,12 +44,16 @@ public:
 PUBLIC ISprite::ISprite() {
     memset(Spritesheets, 0, sizeof(Spritesheets));
     memset(SpritesheetsBorrowed, 0, sizeof(SpritesheetsBorrowed));
+    memset(SpritesheetsOffsetX, 0, sizeof(SpritesheetsOffsetX));
+    memset(SpritesheetsOffsetY, 0, sizeof(SpritesheetsOffsetY));
     memset(Filename, 0, 256);
     LoadFailed = true;
 }
 PUBLIC ISprite::ISprite(const char* filename) {
     memset(Spritesheets, 0, sizeof(Spritesheets));
     memset(SpritesheetsBorrowed, 0, sizeof(SpritesheetsBorrowed));
+    memset(SpritesheetsOffsetX, 0, sizeof(SpritesheetsOffsetX));
+    memset(SpritesheetsOffsetY, 0, sizeof(SpritesheetsOffsetY));
     memset(Filename, 0, 256);
 
     strncpy(Filename, filename, 255);
@@ -56,11 +62,6 @@ PUBLIC ISprite::ISprite(const char* filename) {
 
 PUBLIC STATIC Texture* ISprite::AddSpriteSheet(const char* filename) {
     Texture* texture = NULL;
-    Uint32*  data = NULL;
-    Uint32   width = 0;
-    Uint32   height = 0;
-    Uint32*  paletteColors = NULL;
-    unsigned numPaletteColors = 0;
 
     const char* altered = filename;
 
@@ -69,94 +70,11 @@ PUBLIC STATIC Texture* ISprite::AddSpriteSheet(const char* filename) {
         return texture;
     }
 
-    float loadDelta = 0.0f;
-    if (StringUtils::StrCaseStr(altered, ".png")) {
-        Clock::Start();
-        PNG* png = PNG::Load(altered);
-        loadDelta = Clock::End();
-
-        if (png && png->Data) {
-            Log::Print(Log::LOG_VERBOSE, "PNG load took %.3f ms (%s)", loadDelta, altered);
-            width = png->Width;
-            height = png->Height;
-
-            data = png->Data;
-            Memory::Track(data, "Texture::Data");
-
-            if (png->Paletted) {
-                paletteColors = png->GetPalette();
-                numPaletteColors = png->NumPaletteColors;
-            }
-
-            delete png;
-        }
-        else {
-            Log::Print(Log::LOG_ERROR, "PNG could not be loaded!");
-            return NULL;
-        }
-    }
-    else if (StringUtils::StrCaseStr(altered, ".jpg") || StringUtils::StrCaseStr(altered, ".jpeg")) {
-        Clock::Start();
-        JPEG* jpeg = JPEG::Load(altered);
-        loadDelta = Clock::End();
-
-        if (jpeg && jpeg->Data) {
-            Log::Print(Log::LOG_VERBOSE, "JPEG load took %.3f ms (%s)", loadDelta, altered);
-            width = jpeg->Width;
-            height = jpeg->Height;
-
-            data = jpeg->Data;
-            Memory::Track(data, "Texture::Data");
-
-            delete jpeg;
-        }
-        else {
-            Log::Print(Log::LOG_ERROR, "JPEG could not be loaded!");
-            return NULL;
-        }
+    texture = Image::LoadTextureFromResource(altered);
+    if (!texture) {
+        Log::Print(Log::LOG_ERROR, "Could not load sprite sheet \"%s\"!", altered);
+        return NULL;
     }
-    else if (StringUtils::StrCaseStr(altered, ".gif")) {
-        Clock::Start();
-        GIF* gif = GIF::Load(altered);
-        loadDelta = Clock::End();
-
-        if (gif && gif->Data) {
-            Log::Print(Log::LOG_VERBOSE, "GIF load took %.3f ms (%s)", loadDelta, altered);
-            width = gif->Width;
-            height = gif->Height;
-
-            data = gif->Data;
-            Memory::Track(data, "Texture::Data");
-
-            if (gif->Paletted) {
-                paletteColors = gif->GetPalette();
-                numPaletteColors = gif->NumPaletteColors;
-            }
-
-            delete gif;
-        }
-        else {
-            Log::Print(Log::LOG_ERROR, "GIF could not be loaded!");
-            return NULL;
-        }
-    }
-    else {
-        Log::Print(Log::LOG_ERROR, "Unsupported image format for sprite!");
-        return texture;
-    }
-
-    bool forceSoftwareTextures = false;
-    Application::Settings->GetBool("display", "forceSoftwareTextures", &forceSoftwareTextures);
-    if (forceSoftwareTextures)
-        Graphics::NoInternalTextures = true;
-
-    texture = Graphics::CreateTextureFromPixels(width, height, data, width * sizeof(Uint32));
-
-    Graphics::SetTexturePalette(texture, paletteColors, numPaletteColors);
-
-    Graphics::NoInternalTextures = false;
-
-    Memory::Free(data);
 
     Graphics::SpriteSheetTextureMap->Put(altered, texture);
 
@@ -192,8 +110,8 @@ PUBLIC void ISprite::AddFrame(int animID, int duration, int left, int top, int w
     AnimFrame anfrm;
     anfrm.Advance = id;
     anfrm.Duration = duration;
-    anfrm.X = left;
-    anfrm.Y = top;
+    anfrm.X = left + SpritesheetsOffsetX[0];
+    anfrm.Y = top + SpritesheetsOffsetY[0];
     anfrm.Width = width;
     anfrm.Height = height;
     anfrm.OffsetX = pivotX;
@@ -220,10 +138,39 @@ PUBLIC void ISprite::ConvertToRGBA() {
 }
 PUBLIC void ISprite::ConvertToPalette(unsigned paletteNumber) {
     for (int a = 0; a < SpritesheetCount; a++) {
+        // Converting a whole atlas page would convert other sprites too
+        DetachSpriteSheet(a);
         if (Spritesheets[a])
             Graphics::ConvertTextureToPalette(Spritesheets[a], paletteNumber);
     }
 }
+// Moves a sheet off of its atlas page and onto a texture of its own.
+PRIVATE void ISprite::DetachSpriteSheet(int index) {
+    if (!TextureAtlas::IsPage(Spritesheets[index]))
+        return;
+
+    Texture* texture = TextureAtlas::Detach(Spritesheets[index], SpritesheetsOffsetX[index], SpritesheetsOffsetY[index]);
+    if (!texture)
+        return;
+
+    TextureAtlas::Release(Spritesheets[index], SpritesheetsOffsetX[index], SpritesheetsOffsetY[index]);
+    Spritesheets[index] = texture;
+    SpritesheetsBorrowed[index] = false;
+    for (size_t a = 0; a < Animations.size(); a++) {
+        for (size_t i = 0; i < Animations[a].Frames.size(); i++) {
+            AnimFrame* anfrm = &Animations[a].Frames[i];
+            if (anfrm->SheetNumber != index)
+                continue;
+
+            anfrm->X -= SpritesheetsOffsetX[index];
+            anfrm->Y -= SpritesheetsOffsetY[index];
+            Graphics::DeleteFrameBufferID(anfrm);
+            Graphics::MakeFrameBufferID(this, anfrm);
+        }
+    }
+    SpritesheetsOffsetX[index] = 0;
+    SpritesheetsOffsetY[index] = 0;
+}
 
 PUBLIC bool ISprite::LoadAnimation(const char* filename) {
     char* str, altered[4096];
@@ -272,10 +219,20 @@ PUBLIC bool ISprite::LoadAnimation(const char* filename) {
         snprintf(altered, sizeof altered, "Sprites/%s", str);
         Memory::Free(str);
 
-        if (Graphics::SpriteSheetTextureMap->Exists(altered))
+        SpritesheetsOffsetX[i] = 0;
+        SpritesheetsOffsetY[i] = 0;
+        if (Graphics::SpriteSheetTextureMap->Exists(altered)) {
             SpritesheetsBorrowed[i] = true;
-
-        Spritesheets[i] = AddSpriteSheet(altered);
+            Spritesheets[i] = AddSpriteSheet(altered);
+        }
+        else if (TextureAtlas::IsEnabled()) {
+            // Pages are shared, same as sheets in the texture map are
+            SpritesheetsBorrowed[i] = true;
+            Spritesheets[i] = TextureAtlas::AddSpriteSheet(altered, &SpritesheetsOffsetX[i], &SpritesheetsOffsetY[i]);
+        }
+        else {
+            Spritesheets[i] = AddSpriteSheet(altered);
+        }
         // Spritesheets[i] = Image::LoadTextureFromResource(altered);
     }
 
@@ -326,6 +283,10 @@ PUBLIC bool ISprite::LoadAnimation(const char* filename) {
             anfrm.Advance = reader->ReadUInt16();
             anfrm.X = reader->ReadUInt16();
             anfrm.Y = reader->ReadUInt16();
+            if (anfrm.SheetNumber < SpritesheetCount) {
+                anfrm.X += SpritesheetsOffsetX[anfrm.SheetNumber];
+                anfrm.Y += SpritesheetsOffsetY[anfrm.SheetNumber];
+            }
             anfrm.Width = reader->ReadUInt16();
             anfrm.Height = reader->ReadUInt16();
             anfrm.OffsetX = reader->ReadInt16();
@@ -427,8 +388,14 @@ PUBLIC bool ISprite::SaveAnimation(const char* filename) {
             stream->WriteByte(anfrm.SheetNumber);
             stream->WriteUInt16(anfrm.Duration);
             stream->WriteUInt16(anfrm.Advance);
-            stream->WriteUInt16(anfrm.X);
-            stream->WriteUInt16(anfrm.Y);
+            // Frames on an atlas page are saved relative to their sheet
+            int sheetX = 0, sheetY = 0;
+            if (anfrm.SheetNumber >= 0 && anfrm.SheetNumber < SpritesheetCount) {
+                sheetX = SpritesheetsOffsetX[anfrm.SheetNumber];
+                sheetY = SpritesheetsOffsetY[anfrm.SheetNumber];
+            }
+            stream->WriteUInt16(anfrm.X - sheetX);
+            stream->WriteUInt16(anfrm.Y - sheetY);
             stream->WriteUInt16(anfrm.Width);
             stream->WriteUInt16(anfrm.Height);
             stream->WriteInt16(anfrm.OffsetX);
@@ -474,7 +441,12 @@ PUBLIC void ISprite::Dispose() {
         if (Spritesheets[a]) {
             // if (!SpritesheetsBorrowed[a])
             //     Graphics::DisposeTexture(Spritesheets[a]);
+            if (SpritesheetsBorrowed[a] && TextureAtlas::IsPage(Spritesheets[a]))
+                TextureAtlas::Release(Spritesheets[a], SpritesheetsOffsetX[a], SpritesheetsOffsetY[a]);
+            SpritesheetsBorrowed[a] = false;
             Spritesheets[a] = NULL;
+            SpritesheetsOffsetX[a] = 0;
+            SpritesheetsOffsetY[a] = 0;
         }
     }
 }
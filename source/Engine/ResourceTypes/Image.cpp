@@ -1,6 +1,7 @@
 #if INTERFACE
 #include <Engine/Includes/Standard.h>
 #include <Engine/Rendering/Texture.h>
+#include <Engine/ResourceTypes/ImageTypes.h>
 
 class Image {
 public:
@@ -17,6 +18,8 @@ public:
 #include <Engine/ResourceTypes/ImageFormats/GIF.h>
 #include <Engine/ResourceTypes/ImageFormats/JPEG.h>
 #include <Engine/ResourceTypes/ImageFormats/PNG.h>
+#include <Engine/ResourceTypes/ResourceLoader.h>
+#include <Engine/ResourceTypes/TextureCache.h>
 
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Clock.h>
@@ -25,6 +28,11 @@ public:
 #include <Engine/IO/ResourceStream.h>
 #include <Engine/Utilities/StringUtils.h>
 
+// Whether the image being prepared on this thread keeps its palette,
+// or -1 to go by Graphics::UsePalettes. The main thread can change that
+// during a scene load while a loader thread is decoding.
+static thread_local int PreparePalettes = -1;
+
 PUBLIC Image::Image(const char* filename) {
     strncpy(Filename, filename, 255);
     TexturePtr = Image::LoadTextureFromResource(Filename);
@@ -41,12 +49,11 @@ PUBLIC Image::~Image() {
     Dispose();
 }
 
-PUBLIC STATIC Texture* Image::LoadTextureFromResource(const char* filename) {
-    Texture* texture = NULL;
-    Uint32*  data = NULL;
-    Uint32   width = 0;
-    Uint32   height = 0;
-    Uint32*  paletteColors = NULL;
+PUBLIC STATIC bool Image::Decode(const char* filename, DecodedImage* image) {
+    Uint32* data = NULL;
+    Uint32  width = 0;
+    Uint32  height = 0;
+    Uint32* paletteColors = NULL;
     unsigned numPaletteColors = 0;
 
     const char* altered = filename;
@@ -56,21 +63,21 @@ PUBLIC STATIC Texture* Image::LoadTextureFromResource(const char* filename) {
     if (strncmp(altered, "file://", 7) == 0)
         stream = FileStream::New(altered + 7, FileStream::READ_ACCESS);
     else
-        stream = ResourceStream::New(altered);
+        stream = ResourceStream::Open(altered);
     if (stream) {
         magic = stream->ReadUInt32();
         stream->Close();
     }
     else {
         // Log::Print(Log::LOG_ERROR, "Image \"%s\" does not exist!", filename);
-        return NULL;
+        return false;
     }
 
     // 0x474E5089U PNG
     if (magic == 0x474E5089U) {
         Clock::Start();
         PNG* png = PNG::Load(altered);
-        if (png) {
+        if (png && png->Data) {
             Log::Print(Log::LOG_VERBOSE, "PNG load took %.3f ms (%s)", Clock::End(), altered);
             width = (Uint32)png->Width;
             height = (Uint32)png->Height;
@@ -87,14 +94,14 @@ PUBLIC STATIC Texture* Image::LoadTextureFromResource(const char* filename) {
         }
         else {
             Log::Print(Log::LOG_ERROR, "PNG could not be loaded!");
-            return NULL;
+            return false;
         }
     }
     // 0xE0FFD8FFU JPEG
     else if ((magic & 0xFFFF) == 0xD8FFU) {
         Clock::Start();
         JPEG* jpeg = JPEG::Load(altered);
-        if (jpeg) {
+        if (jpeg && jpeg->Data) {
             Log::Print(Log::LOG_VERBOSE, "JPEG load took %.3f ms (%s)", Clock::End(), altered);
             width = (Uint32)jpeg->Width;
             height = (Uint32)jpeg->Height;
@@ -106,13 +113,13 @@ PUBLIC STATIC Texture* Image::LoadTextureFromResource(const char* filename) {
         }
         else {
             Log::Print(Log::LOG_ERROR, "JPEG could not be loaded!");
-            return NULL;
+            return false;
         }
     }
     else if (StringUtils::StrCaseStr(altered, ".gif")) {
         Clock::Start();
         GIF* gif = GIF::Load(altered);
-        if (gif) {
+        if (gif && gif->Data) {
             Log::Print(Log::LOG_VERBOSE, "GIF load took %.3f ms (%s)", Clock::End(), altered);
             width = (Uint32)gif->Width;
             height = (Uint32)gif->Height;
@@ -122,38 +129,96 @@ PUBLIC STATIC Texture* Image::LoadTextureFromResource(const char* filename) {
 
             if (gif->Paletted) {
                 paletteColors = gif->GetPalette();
-                numPaletteColors = 256;
+                numPaletteColors = gif->NumPaletteColors;
             }
 
             delete gif;
         }
         else {
             Log::Print(Log::LOG_ERROR, "GIF could not be loaded!");
-            return NULL;
+            return false;
         }
     }
     else {
         Log::Print(Log::LOG_ERROR, "Unsupported image format! %s", filename);
-        return NULL;
+        return false;
+    }
+
+    image->Data = data;
+    image->Width = width;
+    image->Height = height;
+    image->Palette = paletteColors;
+    image->NumPaletteColors = numPaletteColors;
+    image->Buffer = data;
+    return true;
+}
+
+// Decodes with the given palette mode, whatever Graphics::UsePalettes is.
+PUBLIC STATIC bool Image::Decode(const char* filename, DecodedImage* image, bool usePalettes) {
+    int lastPalettes = PreparePalettes;
+    PreparePalettes = usePalettes;
+    bool decoded = Image::Decode(filename, image);
+    PreparePalettes = lastPalettes;
+    return decoded;
+}
+// What decoders should check instead of Graphics::UsePalettes.
+PUBLIC STATIC bool Image::UsePalettes() {
+    if (PreparePalettes < 0)
+        return Graphics::UsePalettes;
+    return PreparePalettes != 0;
+}
+// Gets the pixels for an image ready to upload, from the texture cache
+// if possible. Doesn't touch the renderer, so it can run on any thread.
+PUBLIC STATIC bool Image::Prepare(const char* filename, DecodedImage* image, bool usePalettes) {
+    PreparePalettes = usePalettes;
+
+    bool prepared = TextureCache::Find(filename, image);
+    if (!prepared && Image::Decode(filename, image)) {
+        TextureCache::Store(filename, image);
+        prepared = true;
     }
 
+    PreparePalettes = -1;
+    return prepared;
+}
+PUBLIC STATIC bool Image::Prepare(const char* filename, DecodedImage* image) {
+    return Image::Prepare(filename, image, Graphics::UsePalettes);
+}
+// Creates a texture from prepared pixels, then frees them.
+PUBLIC STATIC Texture* Image::Upload(const char* filename, DecodedImage* image) {
+    Texture* texture = NULL;
+
     bool forceSoftwareTextures = false;
     Application::Settings->GetBool("display", "forceSoftwareTextures", &forceSoftwareTextures);
     if (forceSoftwareTextures)
         Graphics::NoInternalTextures = true;
 
-    if (!forceSoftwareTextures && (width > Graphics::MaxTextureWidth || height > Graphics::MaxTextureHeight)) {
-		Log::Print(Log::LOG_WARN, "Image file \"%s\" of size %d x %d is larger than maximum size of %d x %d!", altered, width, height, Graphics::MaxTextureWidth, Graphics::MaxTextureHeight);
+    if (!forceSoftwareTextures && (image->Width > Graphics::MaxTextureWidth || image->Height > Graphics::MaxTextureHeight)) {
+		Log::Print(Log::LOG_WARN, "Image file \"%s\" of size %d x %d is larger than maximum size of %d x %d!", filename, image->Width, image->Height, Graphics::MaxTextureWidth, Graphics::MaxTextureHeight);
 		// return NULL;
 	}
 
-    texture = Graphics::CreateTextureFromPixels(width, height, data, width * sizeof(Uint32));
+    texture = Graphics::CreateTextureFromPixels(image->Width, image->Height, image->Data, image->Width * sizeof(Uint32));
 
-    Graphics::SetTexturePalette(texture, paletteColors, numPaletteColors);
+    Graphics::SetTexturePalette(texture, image->Palette, image->NumPaletteColors);
 
     Graphics::NoInternalTextures = false;
 
-    Memory::Free(data);
+    Memory::Free(image->Buffer);
+    image->Buffer = NULL;
 
     return texture;
 }
+
+PUBLIC STATIC Texture* Image::LoadTextureFromResource(const char* filename) {
+    Texture* texture = NULL;
+    DecodedImage image;
+
+    if (ResourceLoader::TakeTexture(filename, &texture))
+        return texture;
+
+    if (!Image::Prepare(filename, &image))
+        return NULL;
+
+    return Image::Upload(filename, &image);
+}
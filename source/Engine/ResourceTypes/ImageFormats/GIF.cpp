@@ -20,6 +20,7 @@ public:
 #include <Engine/IO/ResourceStream.h>
 
 #include <Engine/Graphics.h>
+#include <Engine/ResourceTypes/Image.h>
 
 #include <Libraries/stb_image.h>
 
@@ -173,7 +174,7 @@ Clock::Start(); \
 }
 
 PUBLIC STATIC  GIF*   GIF::Load(const char* filename) {
-    bool loadPalette = Graphics::UsePalettes;
+    bool loadPalette = Image::UsePalettes();
     Entry* codeTable = (Entry*)Memory::Malloc(0x1000 * sizeof(Entry));
 
     GIF* gif = new GIF;
@@ -187,7 +188,7 @@ PUBLIC STATIC  GIF*   GIF::Load(const char* filename) {
     if (strncmp(filename, "file://", 7) == 0)
         stream = FileStream::New(filename + 7, FileStream::READ_ACCESS);
     else
-        stream = ResourceStream::New(filename);
+        stream = ResourceStream::Open(filename);
     if (!stream) {
         Log::Print(Log::LOG_ERROR, "Could not open file '%s'!", filename);
         goto GIF_Load_FAIL;
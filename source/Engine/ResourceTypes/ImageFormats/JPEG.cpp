@@ -127,7 +127,7 @@ PUBLIC STATIC JPEG*   JPEG::Load(const char* filename) {
     if (strncmp(filename, "file://", 7) == 0)
         stream = FileStream::New(filename + 7, FileStream::READ_ACCESS);
     else
-        stream = ResourceStream::New(filename);
+        stream = ResourceStream::Open(filename);
     if (!stream) {
         Log::Print(Log::LOG_ERROR, "Could not open file '%s'!", filename);
         goto JPEG_Load_FAIL;
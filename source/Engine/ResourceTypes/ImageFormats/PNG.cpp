@@ -20,6 +20,7 @@ public:
 #include <Engine/IO/MemoryStream.h>
 #include <Engine/IO/ResourceStream.h>
 #include <Engine/Rendering/Software/SoftwareRenderer.h>
+#include <Engine/ResourceTypes/Image.h>
 
 #ifdef USING_LIBPNG
 #include "png.h"
@@ -67,7 +68,7 @@ PUBLIC STATIC  PNG*   PNG::Load(const char* filename) {
     if (strncmp(filename, "file://", 7) == 0)
         stream = FileStream::New(filename + 7, FileStream::READ_ACCESS);
     else
-        stream = ResourceStream::New(filename);
+        stream = ResourceStream::Open(filename);
     if (!stream) {
         Log::Print(Log::LOG_ERROR, "Could not open file '%s'!", filename);
         goto PNG_Load_FAIL;
@@ -99,7 +100,7 @@ PUBLIC STATIC  PNG*   PNG::Load(const char* filename) {
     if (color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA)
         png_set_gray_to_rgb(png_ptr);
     else if (color_type == PNG_COLOR_TYPE_PALETTE) {
-        if (Graphics::UsePalettes && png_get_PLTE(png_ptr, info_ptr, &palette, &palette_size))
+        if (Image::UsePalettes() && png_get_PLTE(png_ptr, info_ptr, &palette, &palette_size))
             usePalette = true;
 
         if (!usePalette)
@@ -192,7 +193,7 @@ PUBLIC STATIC  PNG*   PNG::Load(const char* filename) {
     if (strncmp(filename, "file://", 7) == 0)
         stream = FileStream::New(filename + 7, FileStream::READ_ACCESS);
     else
-        stream = ResourceStream::New(filename);
+        stream = ResourceStream::Open(filename);
     if (!stream) {
         Log::Print(Log::LOG_ERROR, "Could not open file '%s'!", filename);
         goto PNG_Load_FAIL;
@@ -226,7 +227,7 @@ PUBLIC STATIC  PNG*   PNG::Load(const char* filename) {
 
     color_type = ihdr.color_type;
     isIndexed = color_type == SPNG_COLOR_TYPE_INDEXED;
-    if (isIndexed && Graphics::UsePalettes) {
+    if (isIndexed && Image::UsePalettes()) {
         ret = spng_get_plte(ctx, &plte);
 
         if (ret && ret != SPNG_ECHUNKAVAIL) {
@@ -309,7 +310,7 @@ PNG_Load_Success:
     if (strncmp(filename, "file://", 7) == 0)
         stream = FileStream::New(filename + 7, FileStream::READ_ACCESS);
     else
-        stream = ResourceStream::New(filename);
+        stream = ResourceStream::Open(filename);
     if (!stream) {
         Log::Print(Log::LOG_ERROR, "Could not open file '%s'!", filename);
         goto PNG_Load_FAIL;
@@ -0,0 +1,18 @@
+#ifndef ENGINE_RESOURCETYPES_IMAGETYPES_H
+#define ENGINE_RESOURCETYPES_IMAGETYPES_H
+
+#include <Engine/Includes/Standard.h>
+
+struct DecodedImage {
+    Uint32*  Data = NULL;
+    Uint32   Width = 0;
+    Uint32   Height = 0;
+    Uint32*  Palette = NULL;
+    unsigned NumPaletteColors = 0;
+    // The allocation to free once the pixels are uploaded. Data may
+    // point into it rather than be it, or into a mapped data file, in
+    // which case this is NULL.
+    void*    Buffer = NULL;
+};
+
+#endif /* ENGINE_RESOURCETYPES_IMAGETYPES_H */
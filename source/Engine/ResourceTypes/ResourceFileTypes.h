@@ -0,0 +1,12 @@
+#ifndef ENGINE_RESOURCETYPES_RESOURCEFILETYPES_H
+#define ENGINE_RESOURCETYPES_RESOURCEFILETYPES_H
+
+#include <Engine/Includes/Standard.h>
+
+struct ResourceFileEntry {
+    const char* Filename;
+    Uint8*      Data;
+    size_t      Size;
+};
+
+#endif /* ENGINE_RESOURCETYPES_RESOURCEFILETYPES_H */
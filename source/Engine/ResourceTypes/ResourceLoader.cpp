@@ -0,0 +1,554 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Rendering/Texture.h>
+#include <Engine/ResourceTypes/ISound.h>
+#include <Engine/ResourceTypes/ResourceFileTypes.h>
+
+class ResourceLoader {
+public:
+    static int    ThreadsRequested;
+    static double UploadBudget;
+};
+#endif
+
+#include <Engine/ResourceTypes/ResourceLoader.h>
+
+#include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Graphics.h>
+#include <Engine/Hashing/CRC32.h>
+#include <Engine/ResourceTypes/Image.h>
+#include <Engine/ResourceTypes/ResourceManager.h>
+#include <Engine/Utilities/StringUtils.h>
+
+// Loads resources on worker threads ahead of when they're needed.
+// The workers do everything that doesn't need the renderer (reading,
+// decompressing, decrypting and decoding), and decoded images are
+// uploaded on the main thread in Update, within a per-frame budget.
+// Whatever loads the resource the usual way afterwards picks up the
+// result instead of loading it again.
+
+#define RESOURCE_LOADER_MAX_THREADS 4
+
+enum {
+    LOADJOB_DATA,
+    LOADJOB_IMAGE,
+    LOADJOB_SOUND,
+};
+
+enum {
+    LOADJOB_QUEUED,
+    LOADJOB_LOADING,
+    // Decoded, but waiting for the main thread to upload it
+    LOADJOB_DECODED,
+    LOADJOB_DONE,
+    LOADJOB_FAILED,
+};
+
+struct ResourceLoadJob {
+    char         Filename[256];
+    Uint32       FilenameHash;
+    int          Kind;
+    int          Group;
+    int          State;
+    // Graphics::UsePalettes as of when the job was queued, since it can
+    // change while a worker is decoding.
+    bool         UsePalettes;
+
+    Uint8*       Data = NULL;
+    size_t       Size = 0;
+    DecodedImage Image;
+    Texture*     TexturePtr = NULL;
+    ISound*      Sound = NULL;
+};
+
+struct ResourceLoadGroup {
+    int ID;
+    int Total;
+    int Remaining;
+};
+
+static vector<ResourceLoadJob*>  Jobs;
+static vector<ResourceLoadGroup> Groups;
+static SDL_Thread*               Workers[RESOURCE_LOADER_MAX_THREADS];
+static int                       WorkerCount = 0;
+static SDL_mutex*                Lock = NULL;
+static SDL_cond*                 JobQueued = NULL;
+static SDL_cond*                 JobFinished = NULL;
+static int                       NextGroup = 1;
+static bool                      Quitting = false;
+
+int    ResourceLoader::ThreadsRequested = 0;
+double ResourceLoader::UploadBudget = 2.0;
+
+static int GetJobKind(const char* filename) {
+    if (StringUtils::StrCaseStr(filename, ".png")
+        || StringUtils::StrCaseStr(filename, ".gif")
+        || StringUtils::StrCaseStr(filename, ".jpg")
+        || StringUtils::StrCaseStr(filename, ".jpeg"))
+        return LOADJOB_IMAGE;
+    if (StringUtils::StrCaseStr(filename, ".ogg")
+        || StringUtils::StrCaseStr(filename, ".wav"))
+        return LOADJOB_SOUND;
+    return LOADJOB_DATA;
+}
+static ResourceLoadGroup* FindGroup(int id) {
+    for (size_t i = 0; i < Groups.size(); i++) {
+        if (Groups[i].ID == id)
+            return &Groups[i];
+    }
+    return NULL;
+}
+static ResourceLoadJob* FindJob(const char* filename, int kind) {
+    Uint32 hash = CRC32::EncryptString(filename);
+    for (size_t i = 0; i < Jobs.size(); i++) {
+        ResourceLoadJob* job = Jobs[i];
+        if (job->FilenameHash == hash && job->Kind == kind && !strcmp(job->Filename, filename))
+            return job;
+    }
+    return NULL;
+}
+static ResourceLoadJob* FindJobInState(int state, int group) {
+    for (size_t i = 0; i < Jobs.size(); i++) {
+        if (Jobs[i]->State == state && (!group || Jobs[i]->Group == group))
+            return Jobs[i];
+    }
+    return NULL;
+}
+
+// Must be called with the lock held.
+static void QueueJob(ResourceLoadGroup* group, const char* filename, int kind) {
+    // Already loaded or on the way
+    if (FindJob(filename, kind))
+        return;
+
+    ResourceLoadJob* job = new (std::nothrow) ResourceLoadJob;
+    if (!job)
+        return;
+
+    StringUtils::Copy(job->Filename, filename, sizeof job->Filename);
+    job->FilenameHash = CRC32::EncryptString(job->Filename);
+    job->Kind = kind;
+    job->Group = group->ID;
+    job->State = LOADJOB_QUEUED;
+    job->UsePalettes = Graphics::UsePalettes;
+    Jobs.push_back(job);
+
+    group->Total++;
+    group->Remaining++;
+}
+
+// Everything but the upload. Runs with the lock released.
+static int RunJob(ResourceLoadJob* job) {
+    switch (job->Kind) {
+        case LOADJOB_DATA:
+            if (ResourceManager::LoadResource(job->Filename, &job->Data, &job->Size))
+                return LOADJOB_DONE;
+            break;
+        case LOADJOB_IMAGE:
+            if (Image::Prepare(job->Filename, &job->Image, job->UsePalettes))
+                return LOADJOB_DECODED;
+            break;
+        case LOADJOB_SOUND:
+            job->Sound = new (std::nothrow) ISound(job->Filename);
+            if (job->Sound && !job->Sound->LoadFailed)
+                return LOADJOB_DONE;
+            delete job->Sound;
+            job->Sound = NULL;
+            break;
+    }
+    return LOADJOB_FAILED;
+}
+// Must be called with the lock held.
+static void SetJobState(ResourceLoadJob* job, int state) {
+    bool wasFinished = job->State == LOADJOB_DONE || job->State == LOADJOB_FAILED;
+    job->State = state;
+    if (!wasFinished && (state == LOADJOB_DONE || state == LOADJOB_FAILED)) {
+        ResourceLoadGroup* group = FindGroup(job->Group);
+        if (group)
+            group->Remaining--;
+    }
+    SDL_CondBroadcast(JobFinished);
+}
+// Runs a queued job on the calling thread. Must be called with the
+// lock held; it's released while the job runs.
+static void StealJob(ResourceLoadJob* job) {
+    job->State = LOADJOB_LOADING;
+    SDL_UnlockMutex(Lock);
+    int state = RunJob(job);
+    SDL_LockMutex(Lock);
+    SetJobState(job, state);
+}
+// Main thread only. Must be called with the lock held.
+static void UploadJob(ResourceLoadJob* job) {
+    job->State = LOADJOB_LOADING;
+    SDL_UnlockMutex(Lock);
+    job->TexturePtr = Image::Upload(job->Filename, &job->Image);
+    // The texture owns the palette now
+    job->Image.Palette = NULL;
+    SDL_LockMutex(Lock);
+    SetJobState(job, job->TexturePtr ? LOADJOB_DONE : LOADJOB_FAILED);
+}
+static void FreeJob(ResourceLoadJob* job) {
+    Memory::Free(job->Data);
+    Memory::Free(job->Image.Buffer);
+    Memory::Free(job->Image.Palette);
+    if (job->TexturePtr)
+        Graphics::DisposeTexture(job->TexturePtr);
+    if (job->Sound) {
+        job->Sound->Dispose();
+        delete job->Sound;
+    }
+    delete job;
+}
+// Takes a job out of the list once whoever asked for the resource is
+// done with it. Must be called with the lock held.
+static void RemoveJob(ResourceLoadJob* job) {
+    SetJobState(job, LOADJOB_DONE);
+    for (size_t i = 0; i < Jobs.size(); i++) {
+        if (Jobs[i] == job) {
+            Jobs.erase(Jobs.begin() + i);
+            break;
+        }
+    }
+}
+// Finds the job for a resource that's being loaded the usual way and
+// makes sure the workers are done with it. Must be called with the lock
+// held.
+static ResourceLoadJob* ClaimJob(const char* filename, int kind) {
+    for (;;) {
+        // Look it up again every time the lock has been let go of.
+        ResourceLoadJob* job = FindJob(filename, kind);
+        if (!job)
+            return NULL;
+
+        // It's needed now, so don't wait for a worker to get to it.
+        if (job->State == LOADJOB_QUEUED)
+            StealJob(job);
+        else if (job->State == LOADJOB_LOADING)
+            SDL_CondWait(JobFinished, Lock);
+        else
+            return job;
+    }
+}
+
+static int WorkerMain(void* data) {
+    SDL_LockMutex(Lock);
+    for (;;) {
+        ResourceLoadJob* job = NULL;
+        while (!Quitting && !(job = FindJobInState(LOADJOB_QUEUED, 0)))
+            SDL_CondWait(JobQueued, Lock);
+        if (Quitting)
+            break;
+
+        StealJob(job);
+    }
+    SDL_UnlockMutex(Lock);
+    return 0;
+}
+
+PUBLIC STATIC void ResourceLoader::Init() {
+    if (Lock)
+        return;
+
+    Lock = SDL_CreateMutex();
+    JobQueued = SDL_CreateCond();
+    JobFinished = SDL_CreateCond();
+    if (!Lock || !JobQueued || !JobFinished) {
+        Log::Print(Log::LOG_ERROR, "Could not create resource loader locks: %s", SDL_GetError());
+        ResourceLoader::Dispose();
+        return;
+    }
+
+    // 0 picks a thread count, and anything below that loads on the main
+    // thread from Update instead.
+    int threads = ThreadsRequested;
+    if (threads == 0)
+        threads = SDL_GetCPUCount() - 1;
+    if (threads > RESOURCE_LOADER_MAX_THREADS)
+        threads = RESOURCE_LOADER_MAX_THREADS;
+
+    Quitting = false;
+    WorkerCount = 0;
+    for (int i = 0; i < threads; i++) {
+        Workers[i] = SDL_CreateThread(WorkerMain, "ResourceLoader", NULL);
+        if (!Workers[i]) {
+            Log::Print(Log::LOG_ERROR, "Could not create resource loader thread: %s", SDL_GetError());
+            break;
+        }
+        WorkerCount++;
+    }
+
+    if (WorkerCount)
+        Log::Print(Log::LOG_VERBOSE, "Resource loader using %d threads.", WorkerCount);
+}
+
+// Queues resources to be loaded in the background. Returns a group ID
+// to check on them with.
+PUBLIC STATIC int ResourceLoader::Preload(vector<char*>& filenames) {
+    if (!Lock)
+        ResourceLoader::Init();
+    if (!Lock)
+        return 0;
+
+    SDL_LockMutex(Lock);
+
+    ResourceLoadGroup group = { NextGroup++, 0, 0 };
+    for (size_t i = 0; i < filenames.size(); i++) {
+        int kind = GetJobKind(filenames[i]);
+        if (kind == LOADJOB_IMAGE && Graphics::SpriteSheetTextureMap && Graphics::SpriteSheetTextureMap->Exists(filenames[i]))
+            continue;
+
+        QueueJob(&group, filenames[i], kind);
+    }
+
+    Groups.push_back(group);
+    SDL_CondBroadcast(JobQueued);
+    SDL_UnlockMutex(Lock);
+
+    return group.ID;
+}
+// Reads a list of resources into memory, spread across the loader's
+// threads and this one. Fills in each entry's Data and Size, leaving
+// Data NULL for anything that couldn't be loaded. Returns how many
+// could be.
+PUBLIC STATIC int ResourceLoader::LoadBatch(vector<ResourceFileEntry>& entries) {
+    if (!Lock)
+        ResourceLoader::Init();
+
+    int groupID = 0;
+    if (Lock) {
+        SDL_LockMutex(Lock);
+
+        ResourceLoadGroup group = { NextGroup++, 0, 0 };
+        for (size_t i = 0; i < entries.size(); i++)
+            QueueJob(&group, entries[i].Filename, LOADJOB_DATA);
+
+        Groups.push_back(group);
+        groupID = group.ID;
+        SDL_CondBroadcast(JobQueued);
+        SDL_UnlockMutex(Lock);
+
+        ResourceLoader::Wait(groupID);
+    }
+
+    int loaded = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        ResourceFileEntry* entry = &entries[i];
+        entry->Data = NULL;
+        entry->Size = 0;
+        if (ResourceLoader::TakeData(entry->Filename, &entry->Data, &entry->Size)
+            || ResourceManager::LoadResource(entry->Filename, &entry->Data, &entry->Size))
+            loaded++;
+    }
+
+    if (groupID)
+        ResourceLoader::Release(groupID);
+
+    return loaded;
+}
+
+// Does the main thread's part of the work, for as long as the upload
+// budget allows. Called once a frame.
+PUBLIC STATIC void ResourceLoader::Update() {
+    if (!Lock)
+        return;
+
+    double start = Clock::GetTicks();
+
+    SDL_LockMutex(Lock);
+    while (Clock::GetTicks() - start < UploadBudget) {
+        ResourceLoadJob* job = FindJobInState(LOADJOB_DECODED, 0);
+        if (job) {
+            UploadJob(job);
+            continue;
+        }
+
+        // Without workers, everything happens here.
+        job = WorkerCount ? NULL : FindJobInState(LOADJOB_QUEUED, 0);
+        if (!job)
+            break;
+
+        StealJob(job);
+    }
+    SDL_UnlockMutex(Lock);
+}
+
+PUBLIC STATIC float ResourceLoader::GetProgress(int groupID) {
+    if (!Lock)
+        return 1.0f;
+
+    float progress = 1.0f;
+    SDL_LockMutex(Lock);
+    ResourceLoadGroup* group = FindGroup(groupID);
+    if (group && group->Total)
+        progress = (float)(group->Total - group->Remaining) / group->Total;
+    SDL_UnlockMutex(Lock);
+    return progress;
+}
+PUBLIC STATIC bool ResourceLoader::IsDone(int groupID) {
+    return ResourceLoader::GetProgress(groupID) >= 1.0f;
+}
+// Blocks until everything in a group is loaded and uploaded, helping
+// out with the queued work in the meantime.
+PUBLIC STATIC void ResourceLoader::Wait(int groupID) {
+    if (!Lock)
+        return;
+
+    SDL_LockMutex(Lock);
+    for (;;) {
+        ResourceLoadGroup* group = FindGroup(groupID);
+        if (!group || group->Remaining <= 0)
+            break;
+
+        ResourceLoadJob* job = FindJobInState(LOADJOB_DECODED, groupID);
+        if (job) {
+            UploadJob(job);
+            continue;
+        }
+
+        job = FindJobInState(LOADJOB_QUEUED, groupID);
+        if (job) {
+            StealJob(job);
+            continue;
+        }
+
+        SDL_CondWait(JobFinished, Lock);
+    }
+    SDL_UnlockMutex(Lock);
+}
+// Frees whatever in a group hasn't been picked up.
+PUBLIC STATIC void ResourceLoader::Release(int groupID) {
+    if (!Lock)
+        return;
+
+    SDL_LockMutex(Lock);
+    for (size_t i = 0; i < Jobs.size(); ) {
+        ResourceLoadJob* job = Jobs[i];
+        if (groupID && job->Group != groupID) {
+            i++;
+            continue;
+        }
+
+        while (job->State == LOADJOB_LOADING)
+            SDL_CondWait(JobFinished, Lock);
+
+        Jobs.erase(Jobs.begin() + i);
+        FreeJob(job);
+    }
+
+    for (size_t i = 0; i < Groups.size(); ) {
+        if (!groupID || Groups[i].ID == groupID)
+            Groups.erase(Groups.begin() + i);
+        else
+            i++;
+    }
+    SDL_UnlockMutex(Lock);
+}
+PUBLIC STATIC void ResourceLoader::Clear() {
+    ResourceLoader::Release(0);
+}
+
+// These hand a preloaded resource over to whatever is loading it. They
+// return false when it wasn't preloaded or failed to, so the caller
+// loads it as usual.
+PUBLIC STATIC bool ResourceLoader::TakeData(const char* filename, Uint8** data, size_t* size) {
+    if (!Lock)
+        return false;
+
+    SDL_LockMutex(Lock);
+    ResourceLoadJob* job = ClaimJob(filename, LOADJOB_DATA);
+    bool found = job && job->Data;
+    if (found) {
+        *data = job->Data;
+        *size = job->Size;
+        job->Data = NULL;
+    }
+    if (job) {
+        RemoveJob(job);
+        FreeJob(job);
+    }
+    SDL_UnlockMutex(Lock);
+    return found;
+}
+PUBLIC STATIC bool ResourceLoader::TakeTexture(const char* filename, Texture** texture) {
+    if (!Lock)
+        return false;
+
+    SDL_LockMutex(Lock);
+    ResourceLoadJob* job = FindJob(filename, LOADJOB_IMAGE);
+
+    // If it hasn't been started, it can still be decoded the way it's
+    // wanted now.
+    if (job && job->State == LOADJOB_QUEUED)
+        job->UsePalettes = Graphics::UsePalettes;
+
+    job = ClaimJob(filename, LOADJOB_IMAGE);
+
+    // Otherwise, pixels decoded for the other palette mode are no use.
+    if (job && job->UsePalettes != Graphics::UsePalettes) {
+        RemoveJob(job);
+        FreeJob(job);
+        SDL_UnlockMutex(Lock);
+        return false;
+    }
+
+    if (job && job->State == LOADJOB_DECODED)
+        UploadJob(job);
+
+    bool found = job && job->TexturePtr;
+    if (found) {
+        *texture = job->TexturePtr;
+        job->TexturePtr = NULL;
+    }
+    if (job) {
+        RemoveJob(job);
+        FreeJob(job);
+    }
+    SDL_UnlockMutex(Lock);
+    return found;
+}
+PUBLIC STATIC ISound* ResourceLoader::TakeSound(const char* filename) {
+    if (!Lock)
+        return NULL;
+
+    SDL_LockMutex(Lock);
+    ISound* sound = NULL;
+    ResourceLoadJob* job = ClaimJob(filename, LOADJOB_SOUND);
+    if (job) {
+        sound = job->Sound;
+        job->Sound = NULL;
+        RemoveJob(job);
+        FreeJob(job);
+    }
+    SDL_UnlockMutex(Lock);
+    return sound;
+}
+
+PUBLIC STATIC void ResourceLoader::Dispose() {
+    if (Lock) {
+        SDL_LockMutex(Lock);
+        Quitting = true;
+        if (JobQueued)
+            SDL_CondBroadcast(JobQueued);
+        SDL_UnlockMutex(Lock);
+    }
+    for (int i = 0; i < WorkerCount; i++)
+        SDL_WaitThread(Workers[i], NULL);
+    WorkerCount = 0;
+
+    if (Lock && JobFinished)
+        ResourceLoader::Clear();
+
+    if (JobQueued)
+        SDL_DestroyCond(JobQueued);
+    if (JobFinished)
+        SDL_DestroyCond(JobFinished);
+    if (Lock)
+        SDL_DestroyMutex(Lock);
+
+    JobQueued = NULL;
+    JobFinished = NULL;
+    Lock = NULL;
+}
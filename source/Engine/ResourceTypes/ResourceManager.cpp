@@ -1,6 +1,8 @@
 #if INTERFACE
 #include <Engine/Includes/Standard.h>
 #include <Engine/Includes/HashMap.h>
+#include <Engine/IO/Stream.h>
+#include <Engine/ResourceTypes/ResourceFileTypes.h>
 
 class ResourceManager {
 public:
@@ -11,36 +13,110 @@ public:
 
 #include <Engine/ResourceTypes/ResourceManager.h>
 
+#include <Engine/Diagnostics/Clock.h>
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
 #include <Engine/Filesystem/Directory.h>
 #include <Engine/Filesystem/File.h>
+#include <Engine/Filesystem/MappedFile.h>
 #include <Engine/Hashing/CRC32.h>
 #include <Engine/Includes/StandardSDL2.h>
+#include <Engine/IO/Compression/ChunkedStream.h>
+#include <Engine/IO/Compression/InflateStream.h>
 #include <Engine/IO/Compression/ZLibStream.h>
 #include <Engine/IO/FileStream.h>
 #include <Engine/IO/SDLStream.h>
 #include <Engine/IO/MemoryStream.h>
 #include <Engine/IO/Stream.h>
+#include <Engine/Utilities/StringUtils.h>
 #include <Engine/Application.h>
 
 #define KEEP_DATA_PACKS_IN_MEMORY
 
+// Compressed resources at least this big can be decompressed as they're
+// read
+#define STREAMED_RESOURCE_THRESHOLD 0x40000
+
+// What a data file entry's flag can be. Entries that aren't chunked are
+// compressed with zlib when their compressed size differs from their size.
+#define DATAFLAG_NONE      0
+#define DATAFLAG_ENCRYPTED 2
+#define DATAFLAG_CHUNKED   4
+
 struct      StreamNode {
     Stream*            Table;
+    MappedFile*        Mapping;
+    // Where to open more handles to the data file from, and the ones
+    // that aren't in use right now
+    char*              Path;
+    vector<Stream*>    Handles;
     struct StreamNode* Next;
 };
 StreamNode* StreamNodeHead = NULL;
 
 struct  ResourceRegistryItem {
-    Stream* Table;
+    StreamNode* Pack;
     Uint64  Offset;
     Uint64  Size;
     Uint32  DataFlag;
     Uint64  CompressedSize;
+    Uint32  PackStamp;
+    Uint8*  Mapped;
 };
 HashMap<ResourceRegistryItem>* ResourceRegistry = NULL;
 
+// Reading from a data file means seeking first, so every thread reading
+// from one at the same time gets its own handle. This only guards the
+// list of idle handles, not the reads.
+static SDL_mutex* HandleLock = NULL;
+
+static Stream* AcquireHandle(StreamNode* pack) {
+    Stream* handle = NULL;
+    SDL_LockMutex(HandleLock);
+    if (pack->Handles.size()) {
+        handle = pack->Handles.back();
+        pack->Handles.pop_back();
+    }
+    SDL_UnlockMutex(HandleLock);
+
+    if (!handle)
+        handle = SDLStream::New(pack->Path, SDLStream::READ_ACCESS);
+    return handle;
+}
+static void ReleaseHandle(StreamNode* pack, Stream* handle) {
+    SDL_LockMutex(HandleLock);
+    pack->Handles.push_back(handle);
+    SDL_UnlockMutex(HandleLock);
+}
+// Reads part of a data file. Safe to call from any number of threads.
+static bool ReadFromPack(StreamNode* pack, Uint64 offset, void* data, size_t size) {
+    if (pack->Mapping) {
+        if (offset > pack->Mapping->Size || size > pack->Mapping->Size - offset)
+            return false;
+        memcpy(data, pack->Mapping->Data + offset, size);
+        return true;
+    }
+
+    Stream* handle = AcquireHandle(pack);
+    if (!handle)
+        return false;
+
+    handle->Seek(offset);
+    size_t read = handle->ReadBytes(data, size);
+    ReleaseHandle(pack, handle);
+    return read == size;
+}
+
+static bool GetRegistryItem(const char* filename, ResourceRegistryItem* item) {
+    if (ResourceManager::UsingDataFolder && !ResourceManager::UsingModPack)
+        return false;
+
+    if (!ResourceRegistry)
+        return false;
+
+    return ResourceRegistry->GetIfExists(filename, item);
+}
+
 bool                 ResourceManager::UsingDataFolder = true;
 bool                 ResourceManager::UsingModPack = false;
 
@@ -58,6 +134,8 @@ PUBLIC STATIC void   ResourceManager::PrefixParentPath(char* out, size_t outSize
 PUBLIC STATIC void   ResourceManager::Init(const char* filename) {
     StreamNodeHead = NULL;
     ResourceRegistry = new HashMap<ResourceRegistryItem>(CRC32::EncryptData, 16);
+    if (!HandleLock)
+        HandleLock = SDL_CreateMutex();
 
     if (filename == NULL)
         filename = "Data.hatch";
@@ -91,9 +169,18 @@ PUBLIC STATIC void   ResourceManager::Load(const char* filename) {
     char resourcePath[4096];
     ResourceManager::PrefixParentPath(resourcePath, sizeof resourcePath, filename);
 
-    SDLStream* dataTableStream = SDLStream::New(resourcePath, SDLStream::READ_ACCESS);
+    // Map the whole file if possible, so that resources can be read
+    // straight out of it.
+    Stream* dataTableStream;
+    MappedFile* mapping = MappedFile::Open(resourcePath);
+    if (mapping)
+        dataTableStream = MemoryStream::New(mapping->Data, mapping->Size);
+    else
+        dataTableStream = SDLStream::New(resourcePath, SDLStream::READ_ACCESS);
     if (!dataTableStream) {
         Log::Print(Log::LOG_ERROR, "Could not open MemoryStream!");
+        if (mapping)
+            mapping->Close();
         return;
     }
 
@@ -103,6 +190,8 @@ PUBLIC STATIC void   ResourceManager::Load(const char* filename) {
     if (memcmp(magicHATCH, "HATCH", 5)) {
         Log::Print(Log::LOG_ERROR, "Invalid HATCH data file \"%s\"! (%02X %02X %02X %02X %02X)", filename, magicHATCH[0], magicHATCH[1], magicHATCH[2], magicHATCH[3], magicHATCH[4]);
         dataTableStream->Close();
+        if (mapping)
+            mapping->Close();
         return;
     }
 
@@ -114,11 +203,19 @@ PUBLIC STATIC void   ResourceManager::Load(const char* filename) {
     // Add stream to list for closure on disposal
     StreamNode* streamNode = new StreamNode;
     streamNode->Table = dataTableStream;
+    streamNode->Mapping = mapping;
+    streamNode->Path = StringUtils::Duplicate(resourcePath);
     streamNode->Next = StreamNodeHead;
     StreamNodeHead = streamNode;
 
+    // Identifies this build of the data file, so anything cached from
+    // its entries goes stale when it is repacked.
+    Uint64 packInfo[2] = { 0, 0 };
+    File::GetInfo(resourcePath, &packInfo[0], (Sint64*)&packInfo[1]);
+    Uint32 packStamp = CRC32::EncryptData(packInfo, sizeof packInfo);
+
     fileCount = dataTableStream->ReadUInt16();
-    Log::Print(Log::LOG_VERBOSE, "Loading resource table from \"%s\"...", filename);
+    Log::Print(Log::LOG_VERBOSE, "Loading resource table from \"%s\"%s...", filename, mapping ? " (mapped)" : "");
     for (int i = 0; i < fileCount; i++) {
         Uint32 crc32 = dataTableStream->ReadUInt32();
         Uint64 offset = dataTableStream->ReadUInt64();
@@ -126,50 +223,81 @@ PUBLIC STATIC void   ResourceManager::Load(const char* filename) {
         Uint32 dataFlag = dataTableStream->ReadUInt32();
         Uint64 compressedSize = dataTableStream->ReadUInt64();
 
-        ResourceRegistryItem item { dataTableStream, offset, size, dataFlag, compressedSize };
+        Uint8* mapped = NULL;
+        if (mapping && offset <= mapping->Size && compressedSize <= mapping->Size - offset)
+            mapped = mapping->Data + offset;
+
+        ResourceRegistryItem item { streamNode, offset, size, dataFlag, compressedSize, packStamp, mapped };
         ResourceRegistry->Put(crc32, item);
         // Log::Print(Log::LOG_VERBOSE, "%08X: Offset: %08llX Size: %08llX Comp Size: %08llX Data Flag: %08X", crc32, offset, size, compressedSize, dataFlag);
     }
+
+    // Reuse the table's handle for reading resources
+    if (!mapping)
+        streamNode->Handles.push_back(dataTableStream);
 }
 PUBLIC STATIC bool   ResourceManager::LoadResource(const char* filename, Uint8** out, size_t* size) {
     Uint8* memory;
     char resourcePath[4096];
     ResourceRegistryItem item;
 
-    if (ResourceManager::UsingDataFolder && !ResourceManager::UsingModPack)
-        goto DATA_FOLDER;
-
-    if (!ResourceRegistry)
+    if (!GetRegistryItem(filename, &item))
         goto DATA_FOLDER;
 
-    if (!ResourceRegistry->Exists(filename))
-        goto DATA_FOLDER;
-
-    item = ResourceRegistry->Get(filename);
-
     memory = (Uint8*)Memory::Malloc(item.Size + 1);
     if (!memory)
         goto DATA_FOLDER;
 
     memory[item.Size] = 0;
 
-    item.Table->Seek(item.Offset);
-    if (item.Size != item.CompressedSize) {
-        Uint8* compressedMemory = (Uint8*)Memory::Malloc(item.Size);
+    if (item.DataFlag == DATAFLAG_CHUNKED) {
+        Uint8* payload = item.Mapped;
+        Uint8* payloadMemory = NULL;
+        if (!payload) {
+            payloadMemory = (Uint8*)Memory::Malloc(item.CompressedSize);
+            if (!payloadMemory || !ReadFromPack(item.Pack, item.Offset, payloadMemory, (size_t)item.CompressedSize)) {
+                Memory::Free(payloadMemory);
+                Memory::Free(memory);
+                goto DATA_FOLDER;
+            }
+            payload = payloadMemory;
+        }
+
+        bool decompressed = ChunkedStream::Decompress(payload, (size_t)item.CompressedSize, memory, (size_t)item.Size);
+        Memory::Free(payloadMemory);
+        if (!decompressed) {
+            Log::Print(Log::LOG_ERROR, "Could not decompress \"%s\"!", filename);
+            Memory::Free(memory);
+            goto DATA_FOLDER;
+        }
+    }
+    else if (item.Mapped) {
+        if (item.Size != item.CompressedSize)
+            ZLibStream::Decompress(memory, (size_t)item.Size, item.Mapped, (size_t)item.CompressedSize);
+        else
+            memcpy(memory, item.Mapped, (size_t)item.Size);
+    }
+    else if (item.Size != item.CompressedSize) {
+        Uint8* compressedMemory = (Uint8*)Memory::Malloc(item.CompressedSize);
         if (!compressedMemory) {
             Memory::Free(memory);
             goto DATA_FOLDER;
         }
-        item.Table->ReadBytes(compressedMemory, item.CompressedSize);
+        if (!ReadFromPack(item.Pack, item.Offset, compressedMemory, (size_t)item.CompressedSize)) {
+            Memory::Free(compressedMemory);
+            Memory::Free(memory);
+            goto DATA_FOLDER;
+        }
 
         ZLibStream::Decompress(memory, (size_t)item.Size, compressedMemory, (size_t)item.CompressedSize);
         Memory::Free(compressedMemory);
     }
-    else {
-        item.Table->ReadBytes(memory, item.Size);
+    else if (!ReadFromPack(item.Pack, item.Offset, memory, (size_t)item.Size)) {
+        Memory::Free(memory);
+        goto DATA_FOLDER;
     }
 
-    if (item.DataFlag == 2) {
+    if (item.DataFlag == DATAFLAG_ENCRYPTED) {
         Uint8 keyA[16];
         Uint8 keyB[16];
         Uint32 filenameHash = CRC32::EncryptString(filename);
@@ -262,6 +390,57 @@ PUBLIC STATIC bool   ResourceManager::LoadResource(const char* filename, Uint8**
     *size = rwSize;
     return true;
 }
+// Gets a resource that's stored as is in a mapped data file, without
+// copying it. The memory is read-only.
+PUBLIC STATIC bool   ResourceManager::GetResourceView(const char* filename, Uint8** out, size_t* size) {
+    ResourceRegistryItem item;
+    if (!GetRegistryItem(filename, &item))
+        return false;
+
+    if (!item.Mapped || item.Size != item.CompressedSize || item.DataFlag != DATAFLAG_NONE)
+        return false;
+
+    *out = item.Mapped;
+    *size = (size_t)item.Size;
+    return true;
+}
+// Opens a stream that decompresses a large compressed resource as it's
+// read. Chunked resources can be seeked around in freely; zlib ones are
+// only opened if the reader won't seek backwards. Returns NULL for
+// anything else, which should be loaded in full instead.
+PUBLIC STATIC Stream* ResourceManager::OpenStreamed(const char* filename, bool seekable) {
+    ResourceRegistryItem item;
+    if (!GetRegistryItem(filename, &item))
+        return NULL;
+
+    if (item.Size < STREAMED_RESOURCE_THRESHOLD)
+        return NULL;
+
+    bool chunked = item.DataFlag == DATAFLAG_CHUNKED;
+    if (!chunked && (seekable || item.DataFlag != DATAFLAG_NONE || item.Size == item.CompressedSize))
+        return NULL;
+
+    if (item.Mapped) {
+        if (chunked)
+            return ChunkedStream::New(item.Mapped, (size_t)item.CompressedSize, (size_t)item.Size);
+        return InflateStream::New(item.Mapped, (size_t)item.CompressedSize, (size_t)item.Size);
+    }
+
+    // The stream reads a bit at a time for as long as it's open, so it
+    // gets a handle of its own.
+    Stream* handle = SDLStream::New(item.Pack->Path, SDLStream::READ_ACCESS);
+    if (!handle)
+        return NULL;
+
+    Stream* stream;
+    if (chunked)
+        stream = ChunkedStream::New(handle, (size_t)item.Offset, (size_t)item.CompressedSize, (size_t)item.Size);
+    else
+        stream = InflateStream::New(handle, (size_t)item.Offset, (size_t)item.CompressedSize, (size_t)item.Size);
+    if (!stream)
+        handle->Close();
+    return stream;
+}
 PUBLIC STATIC bool   ResourceManager::ResourceExists(const char* filename) {
     char resourcePath[4096];
     if (ResourceManager::UsingDataFolder && !ResourceManager::UsingModPack)
@@ -285,17 +464,321 @@ PUBLIC STATIC bool   ResourceManager::ResourceExists(const char* filename) {
     SDL_RWclose(rw);
     return true;
 }
+PUBLIC STATIC bool   ResourceManager::GetResourceStamp(const char* filename, Uint64* size, Uint32* stamp) {
+    char resourcePath[4096];
+    Uint64 info[5];
+    ResourceRegistryItem item;
+
+    if (strncmp(filename, "file://", 7) == 0) {
+        StringUtils::Copy(resourcePath, filename + 7, sizeof resourcePath);
+        goto FILE_INFO;
+    }
+
+    if (!GetRegistryItem(filename, &item))
+        goto DATA_FOLDER;
+
+    info[0] = item.PackStamp;
+    info[1] = item.Offset;
+    info[2] = item.Size;
+    info[3] = item.CompressedSize;
+    info[4] = item.DataFlag;
+
+    *size = item.Size;
+    *stamp = CRC32::EncryptData(info, sizeof info);
+    return true;
+
+    DATA_FOLDER:
+    ResourceManager::PrefixResourcePath(resourcePath, sizeof resourcePath, filename);
+
+    FILE_INFO:
+    if (!File::GetInfo(resourcePath, &info[0], (Sint64*)&info[1]))
+        return false;
+
+    *size = info[0];
+    *stamp = CRC32::EncryptData(info, sizeof(Uint64) * 2);
+    return true;
+}
+
+PUBLIC STATIC bool   ResourceManager::AddToDataFile(const char* filename, vector<ResourceFileEntry>& entries) {
+    struct TableEntry {
+        Uint32 CRC;
+        Uint64 Offset;
+        Uint64 Size;
+        Uint32 DataFlag;
+        Uint64 CompressedSize;
+        Uint8* Data;
+    };
+    vector<TableEntry> table;
+    Uint8 version[3] = { 0, 0, 0 };
+
+    // Keep everything already packed, minus whatever is being replaced
+    FileStream* input = FileStream::New(filename, FileStream::READ_ACCESS);
+    if (input) {
+        Uint8 magicHATCH[5];
+        input->ReadBytes(magicHATCH, 5);
+        if (memcmp(magicHATCH, "HATCH", 5)) {
+            Log::Print(Log::LOG_ERROR, "Invalid HATCH data file \"%s\"!", filename);
+            input->Close();
+            return false;
+        }
+        input->ReadBytes(version, 3);
+
+        Uint16 fileCount = input->ReadUInt16();
+        for (int i = 0; i < fileCount; i++) {
+            TableEntry entry;
+            entry.CRC = input->ReadUInt32();
+            entry.Offset = input->ReadUInt64();
+            entry.Size = input->ReadUInt64();
+            entry.DataFlag = input->ReadUInt32();
+            entry.CompressedSize = input->ReadUInt64();
+            entry.Data = NULL;
+
+            bool replaced = false;
+            for (size_t e = 0; e < entries.size() && !replaced; e++)
+                replaced = entry.CRC == CRC32::EncryptString(entries[e].Filename);
+            if (!replaced)
+                table.push_back(entry);
+        }
+    }
+    for (size_t e = 0; e < entries.size(); e++) {
+        TableEntry entry;
+        entry.CRC = CRC32::EncryptString(entries[e].Filename);
+        entry.Offset = 0;
+        entry.Size = entries[e].Size;
+        entry.DataFlag = 0;
+        entry.CompressedSize = entries[e].Size;
+        entry.Data = entries[e].Data;
+        table.push_back(entry);
+    }
+
+    if (table.size() > 0xFFFF) {
+        Log::Print(Log::LOG_ERROR, "Too many files for data file \"%s\"! (%d)", filename, (int)table.size());
+        if (input)
+            input->Close();
+        return false;
+    }
+
+    char tempFilename[4096];
+    snprintf(tempFilename, sizeof tempFilename, "%s.tmp", filename);
+    FileStream* output = FileStream::New(tempFilename, FileStream::WRITE_ACCESS);
+    if (!output) {
+        Log::Print(Log::LOG_ERROR, "Could not open \"%s\" for writing!", tempFilename);
+        if (input)
+            input->Close();
+        return false;
+    }
+
+    output->WriteBytes((void*)"HATCH", 5);
+    output->WriteBytes(version, 3);
+    output->WriteUInt16((Uint16)table.size());
+
+    // Every entry starts 16-byte aligned, so that mapped entries can be
+    // used in place.
+    Uint64 offset = 5 + 3 + 2 + table.size() * 32;
+    for (size_t i = 0; i < table.size(); i++) {
+        offset = (offset + 15) & ~(Uint64)15;
+        output->WriteUInt32(table[i].CRC);
+        output->WriteUInt64(offset);
+        output->WriteUInt64(table[i].Size);
+        output->WriteUInt32(table[i].DataFlag);
+        output->WriteUInt64(table[i].CompressedSize);
+        offset += table[i].CompressedSize;
+    }
+
+    Uint8 buffer[0x10000];
+    Uint64 written = 5 + 3 + 2 + table.size() * 32;
+    memset(buffer, 0, 16);
+    for (size_t i = 0; i < table.size(); i++) {
+        output->WriteBytes(buffer, (size_t)(((written + 15) & ~(Uint64)15) - written));
+        written = ((written + 15) & ~(Uint64)15) + table[i].CompressedSize;
+
+        if (table[i].Data) {
+            output->WriteBytes(table[i].Data, table[i].CompressedSize);
+            continue;
+        }
+
+        input->Seek(table[i].Offset);
+        for (Uint64 left = table[i].CompressedSize; left; ) {
+            size_t chunk = left < sizeof buffer ? (size_t)left : sizeof buffer;
+            input->ReadBytes(buffer, chunk);
+            output->WriteBytes(buffer, chunk);
+            left -= chunk;
+        }
+    }
+
+    output->Close();
+    if (input)
+        input->Close();
+
+    remove(filename);
+    if (rename(tempFilename, filename) != 0) {
+        Log::Print(Log::LOG_ERROR, "Could not replace \"%s\"!", filename);
+        return false;
+    }
+    return true;
+}
+
+// Packs everything in the Resources folder into a new data file, with
+// each file chunked and LZ4 compressed when that makes it smaller. Only
+// one file is held in memory at a time. Baked textures can be added to
+// the result afterwards.
+PUBLIC STATIC bool   ResourceManager::PackDataFile(const char* filename) {
+    struct TableEntry {
+        Uint32 CRC;
+        Uint64 Offset;
+        Uint64 Size;
+        Uint32 DataFlag;
+        Uint64 CompressedSize;
+    };
+
+    if (!filename)
+        filename = "Data.hatch";
+
+    vector<char*> files;
+    Directory::GetFiles(&files, "Resources", "*", true);
+
+    vector<TableEntry> table;
+    FileStream* output = NULL;
+    bool success = false;
+    bool timing = false;
+    Uint64 totalSize = 0;
+    Uint64 totalPacked = 0;
+    Uint64 offset;
+    Uint8 padding[16];
+    char tempFilename[4096];
+
+    if (files.size() > 0xFFFF) {
+        Log::Print(Log::LOG_ERROR, "Too many files for data file \"%s\"! (%d)", filename, (int)files.size());
+        goto FINISH;
+    }
+
+    // Let go of the data file before it gets replaced
+    ResourceManager::Dispose();
+
+    snprintf(tempFilename, sizeof tempFilename, "%s.tmp", filename);
+    output = FileStream::New(tempFilename, FileStream::WRITE_ACCESS);
+    if (!output) {
+        Log::Print(Log::LOG_ERROR, "Could not open \"%s\" for writing!", tempFilename);
+        goto FINISH;
+    }
+
+    // The table is written once everything's been compressed
+    output->WriteBytes((void*)"HATCH", 5);
+    output->WriteBytes((void*)"\x00\x00\x00", 3);
+    output->WriteUInt16((Uint16)files.size());
+    offset = 5 + 3 + 2 + files.size() * 32;
+    for (Uint64 i = 10; i < offset; i++)
+        output->WriteByte(0);
+
+    memset(padding, 0, sizeof padding);
+    Clock::Start();
+    timing = true;
+    for (size_t i = 0; i < files.size(); i++) {
+        const char* resourceName = files[i] + strlen("Resources/");
+
+        FileStream* input = FileStream::New(files[i], FileStream::READ_ACCESS);
+        if (!input) {
+            Log::Print(Log::LOG_ERROR, "Could not open \"%s\"!", files[i]);
+            goto FINISH;
+        }
+
+        size_t size = input->Length();
+        Uint8* data = (Uint8*)Memory::Malloc(size + 1);
+        if (!data || input->ReadBytes(data, size) != size) {
+            Log::Print(Log::LOG_ERROR, "Could not read \"%s\"!", files[i]);
+            Memory::Free(data);
+            input->Close();
+            goto FINISH;
+        }
+        input->Close();
+
+        TableEntry entry;
+        entry.CRC = CRC32::EncryptString(resourceName);
+        entry.Size = size;
+        entry.DataFlag = DATAFLAG_NONE;
+        entry.CompressedSize = size;
+
+        size_t payloadSize = 0;
+        Uint8* payload = ChunkedStream::Compress(data, size, &payloadSize);
+        if (payload && payloadSize < size) {
+            entry.DataFlag = DATAFLAG_CHUNKED;
+            entry.CompressedSize = payloadSize;
+        }
+
+        // Every entry starts 16-byte aligned, the same as AddToDataFile
+        output->WriteBytes(padding, (size_t)(((offset + 15) & ~(Uint64)15) - offset));
+        offset = (offset + 15) & ~(Uint64)15;
+        entry.Offset = offset;
+
+        output->WriteBytes(entry.DataFlag == DATAFLAG_CHUNKED ? payload : data, (size_t)entry.CompressedSize);
+        offset += entry.CompressedSize;
+        totalSize += entry.Size;
+        totalPacked += entry.CompressedSize;
+        table.push_back(entry);
+
+        Memory::Free(payload);
+        Memory::Free(data);
+    }
+
+    output->Seek(10);
+    for (size_t i = 0; i < table.size(); i++) {
+        output->WriteUInt32(table[i].CRC);
+        output->WriteUInt64(table[i].Offset);
+        output->WriteUInt64(table[i].Size);
+        output->WriteUInt32(table[i].DataFlag);
+        output->WriteUInt64(table[i].CompressedSize);
+    }
+    output->Close();
+    output = NULL;
+
+    remove(filename);
+    if (rename(tempFilename, filename) != 0) {
+        Log::Print(Log::LOG_ERROR, "Could not replace \"%s\"!", filename);
+        goto FINISH;
+    }
+
+    Log::Print(Log::LOG_INFO, "Packed %d files into \"%s\" in %.3f ms (%.2f MB to %.2f MB)",
+        (int)table.size(), filename, Clock::End(), totalSize / 1048576.0, totalPacked / 1048576.0);
+    timing = false;
+    success = true;
+
+    FINISH:
+    // Clock keeps a stack of start times
+    if (timing)
+        Clock::End();
+    if (output) {
+        output->Close();
+        remove(tempFilename);
+    }
+    for (size_t i = 0; i < files.size(); i++)
+        free(files[i]);
+    return success;
+}
+
 PUBLIC STATIC void   ResourceManager::Dispose() {
     if (StreamNodeHead) {
         for (StreamNode *old, *streamNode = StreamNodeHead; streamNode; ) {
             old = streamNode;
             streamNode = streamNode->Next;
 
+            for (size_t i = 0; i < old->Handles.size(); i++) {
+                if (old->Handles[i] != old->Table)
+                    old->Handles[i]->Close();
+            }
             old->Table->Close();
+            if (old->Mapping)
+                old->Mapping->Close();
+            Memory::Free(old->Path);
             delete old;
         }
+        StreamNodeHead = NULL;
     }
     if (ResourceRegistry) {
         delete ResourceRegistry;
+        ResourceRegistry = NULL;
+    }
+    if (HandleLock) {
+        SDL_DestroyMutex(HandleLock);
+        HandleLock = NULL;
     }
 }
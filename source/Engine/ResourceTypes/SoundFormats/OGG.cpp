@@ -82,7 +82,7 @@ PUBLIC STATIC SoundFormat* OGG::Load(const char* filename) {
     VorbisGroup* vorbis;
 
     OGG* ogg = NULL;
-    class Stream* stream = ResourceStream::New(filename);
+    class Stream* stream = ResourceStream::Open(filename, true);
     if (!stream) {
         Log::Print(Log::LOG_ERROR, "Could not open file '%s'!", filename);
         goto OGG_Load_FAIL;
@@ -50,7 +50,7 @@ struct WAVheader {
 
 PUBLIC STATIC SoundFormat* WAV::Load(const char* filename) {
     WAV* wav = NULL;
-    class Stream* stream = ResourceStream::New(filename);
+    class Stream* stream = ResourceStream::Open(filename, true);
     if (!stream) {
         Log::Print(Log::LOG_ERROR, "Could not open file '%s'!", filename);
         goto WAV_Load_FAIL;
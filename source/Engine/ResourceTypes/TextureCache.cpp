@@ -0,0 +1,393 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/ResourceTypes/Image.h>
+#include <Engine/ResourceTypes/ResourceFileTypes.h>
+
+class TextureCache {
+public:
+    static char CachePath[4096];
+};
+#endif
+
+#include <Engine/ResourceTypes/TextureCache.h>
+
+#include <Engine/Graphics.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Filesystem/Directory.h>
+#include <Engine/Filesystem/File.h>
+#include <Engine/Hashing/CRC32.h>
+#include <Engine/Includes/StandardSDL2.h>
+#include <Engine/ResourceTypes/ResourceManager.h>
+#include <Engine/Utilities/ColorUtils.h>
+#include <Engine/Utilities/StringUtils.h>
+
+// Cache entries hold the decoded pixels exactly as they are handed to
+// Graphics::CreateTextureFromPixels. Nothing is compressed, and the pixel
+// data sits 4-byte aligned right after the header and the palette, so a
+// loaded entry is uploaded straight from the buffer it was read into, or
+// straight out of a mapped data file. Paletted images only keep one byte
+// per index.
+//
+// Baked entries are stamped with the CRC of the source file's contents,
+// since a patch or a mod can replace the source without touching them.
+// Images that decode differently with palettes on get a second entry.
+
+#define TEXTURE_CACHE_VERSION 2
+
+enum {
+    TEXTURE_CACHE_INDEXED      = 1 << 0,
+    TEXTURE_CACHE_USE_PALETTES = 1 << 1,
+    TEXTURE_CACHE_BAKED        = 1 << 2,
+    // Decodes to the same pixels whether palettes are used or not
+    TEXTURE_CACHE_ANY_PALETTES = 1 << 3,
+};
+
+struct TextureCacheHeader {
+    Uint8  Magic[4];
+    Uint16 Version;
+    Uint16 Flags;
+    Uint32 SourceKey;
+    Uint32 SourceStamp;
+    Uint64 SourceSize;
+    Uint32 PixelFormat;
+    Uint32 Width;
+    Uint32 Height;
+    Uint32 NumPaletteColors;
+};
+
+char TextureCache::CachePath[4096];
+
+PRIVATE STATIC void  TextureCache::GetBakedName(char* out, size_t outSize, Uint32 key, bool usePalettes) {
+    snprintf(out, outSize, usePalettes ? "TextureCache/%08X-p.htc" : "TextureCache/%08X.htc", key);
+}
+PRIVATE STATIC void  TextureCache::GetCacheFilename(char* out, size_t outSize, Uint32 key) {
+    snprintf(out, outSize, "%s/%08X.htc", TextureCache::CachePath, key);
+}
+
+PRIVATE STATIC bool  TextureCache::Unpack(Uint8* entry, size_t entrySize, bool ownsEntry, Uint32 key, Uint64 sourceSize, Uint32 sourceStamp, DecodedImage* image) {
+    TextureCacheHeader header;
+    if (entrySize < sizeof header)
+        return false;
+
+    memcpy(&header, entry, sizeof header);
+    if (memcmp(header.Magic, "HTXC", 4) || header.Version != TEXTURE_CACHE_VERSION)
+        return false;
+
+    // For baked entries, the stamp is the source's CRC.
+    if (header.SourceKey != key || header.SourceSize != sourceSize || header.SourceStamp != sourceStamp)
+        return false;
+
+    // Paletted decoding changes what the pixels are, so it has to match
+    if (!(header.Flags & TEXTURE_CACHE_ANY_PALETTES)
+        && !!(header.Flags & TEXTURE_CACHE_USE_PALETTES) != Image::UsePalettes())
+        return false;
+
+    // The only pixel formats in use are ARGB and ABGR, which can be
+    // swapped between in place.
+    bool swapFormat = header.PixelFormat != Graphics::PreferredPixelFormat;
+    if (swapFormat) {
+        if (header.PixelFormat != SDL_PIXELFORMAT_ARGB8888 && header.PixelFormat != SDL_PIXELFORMAT_ABGR8888)
+            return false;
+        if (Graphics::PreferredPixelFormat != SDL_PIXELFORMAT_ARGB8888 && Graphics::PreferredPixelFormat != SDL_PIXELFORMAT_ABGR8888)
+            return false;
+    }
+
+    size_t pixelCount = (size_t)header.Width * header.Height;
+    size_t paletteSize = header.NumPaletteColors * sizeof(Uint32);
+    size_t pixelSize = pixelCount * ((header.Flags & TEXTURE_CACHE_INDEXED) ? 1 : sizeof(Uint32));
+    if (entrySize < sizeof header + paletteSize + pixelSize)
+        return false;
+
+    Uint8* palette = entry + sizeof header;
+    Uint8* pixels = palette + paletteSize;
+
+    image->Width = header.Width;
+    image->Height = header.Height;
+    image->Palette = NULL;
+    image->NumPaletteColors = header.NumPaletteColors;
+    if (header.NumPaletteColors) {
+        image->Palette = (Uint32*)Memory::TrackedMalloc("ImageFormat::Colors", paletteSize);
+        if (!image->Palette)
+            return false;
+        memcpy(image->Palette, palette, paletteSize);
+        if (swapFormat)
+            ColorUtils::ConvertFromARGBtoABGR(image->Palette, header.NumPaletteColors);
+    }
+
+    if (header.Flags & TEXTURE_CACHE_INDEXED) {
+        Uint32* data = (Uint32*)Memory::TrackedMalloc("Texture::Data", pixelCount * sizeof(Uint32));
+        if (!data) {
+            Memory::Free(image->Palette);
+            return false;
+        }
+        for (size_t i = 0; i < pixelCount; i++)
+            data[i] = pixels[i];
+
+        if (ownsEntry)
+            Memory::Free(entry);
+        image->Data = data;
+        image->Buffer = data;
+    }
+    else if (!ownsEntry && (swapFormat || ((uintptr_t)pixels & 3))) {
+        // Read-only or misaligned, so it needs a copy after all
+        Uint32* data = (Uint32*)Memory::TrackedMalloc("Texture::Data", pixelSize);
+        if (!data) {
+            Memory::Free(image->Palette);
+            return false;
+        }
+        memcpy(data, pixels, pixelSize);
+
+        image->Data = data;
+        image->Buffer = data;
+        if (swapFormat)
+            ColorUtils::ConvertFromARGBtoABGR(image->Data, (int)pixelCount);
+    }
+    else {
+        image->Data = (Uint32*)pixels;
+        image->Buffer = ownsEntry ? entry : NULL;
+        if (swapFormat)
+            ColorUtils::ConvertFromARGBtoABGR(image->Data, (int)pixelCount);
+    }
+    return true;
+}
+PRIVATE STATIC Uint8* TextureCache::Pack(DecodedImage* image, Uint32 key, Uint64 sourceSize, Uint32 sourceStamp, Uint16 flags, size_t* entrySize) {
+    size_t pixelCount = (size_t)image->Width * image->Height;
+
+    bool indexed = image->Palette && image->NumPaletteColors && image->NumPaletteColors <= 256;
+    for (size_t i = 0; i < pixelCount && indexed; i++)
+        indexed = image->Data[i] < 256;
+
+    TextureCacheHeader header;
+    memcpy(header.Magic, "HTXC", 4);
+    header.Version = TEXTURE_CACHE_VERSION;
+    header.Flags = flags;
+    if (indexed)
+        header.Flags |= TEXTURE_CACHE_INDEXED;
+    header.SourceKey = key;
+    header.SourceStamp = sourceStamp;
+    header.SourceSize = sourceSize;
+    header.PixelFormat = Graphics::PreferredPixelFormat;
+    header.Width = image->Width;
+    header.Height = image->Height;
+    header.NumPaletteColors = image->Palette ? image->NumPaletteColors : 0;
+
+    size_t paletteSize = header.NumPaletteColors * sizeof(Uint32);
+    size_t pixelSize = pixelCount * (indexed ? 1 : sizeof(Uint32));
+
+    *entrySize = sizeof header + paletteSize + pixelSize;
+    Uint8* entry = (Uint8*)Memory::Malloc(*entrySize);
+    if (!entry)
+        return NULL;
+
+    memcpy(entry, &header, sizeof header);
+    if (paletteSize)
+        memcpy(entry + sizeof header, image->Palette, paletteSize);
+
+    Uint8* pixels = entry + sizeof header + paletteSize;
+    if (indexed) {
+        for (size_t i = 0; i < pixelCount; i++)
+            pixels[i] = (Uint8)image->Data[i];
+    }
+    else {
+        memcpy(pixels, image->Data, pixelSize);
+    }
+    return entry;
+}
+
+// Reading the source again is still much cheaper than decoding it.
+PRIVATE STATIC bool   TextureCache::GetSourceCRC(const char* filename, Uint32* crc, Uint64* sourceSize) {
+    Uint8* data;
+    size_t size;
+    if (ResourceManager::GetResourceView(filename, &data, &size)) {
+        *crc = CRC32::EncryptData(data, size);
+        *sourceSize = size;
+        return true;
+    }
+    if (ResourceManager::LoadResource(filename, &data, &size)) {
+        *crc = CRC32::EncryptData(data, size);
+        *sourceSize = size;
+        Memory::Free(data);
+        return true;
+    }
+    return false;
+}
+
+PUBLIC STATIC bool   TextureCache::Find(const char* filename, DecodedImage* image) {
+    Uint64 sourceSize;
+    Uint32 sourceStamp;
+    if (!ResourceManager::GetResourceStamp(filename, &sourceSize, &sourceStamp))
+        return false;
+
+    Uint32 key = CRC32::EncryptString(filename);
+    char cacheName[4096];
+    Uint8* entry = NULL;
+    size_t entrySize = 0;
+
+    Clock::Start();
+
+    // Baked into the data file. With palettes on, an image that doesn't
+    // decode differently only has the one entry.
+    if (strncmp(filename, "file://", 7) != 0) {
+        bool usePalettes = Image::UsePalettes();
+        TextureCache::GetBakedName(cacheName, sizeof cacheName, key, usePalettes);
+        if (usePalettes && !ResourceManager::ResourceExists(cacheName))
+            TextureCache::GetBakedName(cacheName, sizeof cacheName, key, false);
+
+        Uint32 sourceCRC;
+        Uint64 crcSize;
+        if (ResourceManager::ResourceExists(cacheName) && TextureCache::GetSourceCRC(filename, &sourceCRC, &crcSize)) {
+            if (ResourceManager::GetResourceView(cacheName, &entry, &entrySize)) {
+                if (TextureCache::Unpack(entry, entrySize, false, key, sourceSize, sourceCRC, image)) {
+                    Log::Print(Log::LOG_VERBOSE, "Baked texture load took %.3f ms (%s, mapped)", Clock::End(), filename);
+                    return true;
+                }
+            }
+            else if (ResourceManager::LoadResource(cacheName, &entry, &entrySize)) {
+                if (TextureCache::Unpack(entry, entrySize, true, key, sourceSize, sourceCRC, image)) {
+                    Log::Print(Log::LOG_VERBOSE, "Baked texture load took %.3f ms (%s)", Clock::End(), filename);
+                    return true;
+                }
+                Memory::Free(entry);
+            }
+        }
+    }
+
+    // Cached on disk
+    if (*TextureCache::CachePath) {
+        TextureCache::GetCacheFilename(cacheName, sizeof cacheName, key);
+        entrySize = File::ReadAllBytes(cacheName, (char**)&entry);
+        if (entrySize) {
+            if (TextureCache::Unpack(entry, entrySize, true, key, sourceSize, sourceStamp, image)) {
+                Log::Print(Log::LOG_VERBOSE, "Cached texture load took %.3f ms (%s)", Clock::End(), filename);
+                return true;
+            }
+            Memory::Free(entry);
+        }
+    }
+
+    Clock::End();
+    return false;
+}
+PUBLIC STATIC void   TextureCache::Store(const char* filename, DecodedImage* image) {
+    if (!*TextureCache::CachePath)
+        return;
+
+    Uint64 sourceSize;
+    Uint32 sourceStamp;
+    if (!ResourceManager::GetResourceStamp(filename, &sourceSize, &sourceStamp))
+        return;
+
+    if (!Directory::Exists(TextureCache::CachePath))
+        Directory::Create(TextureCache::CachePath);
+
+    Uint32 key = CRC32::EncryptString(filename);
+    size_t entrySize;
+    Uint8* entry = TextureCache::Pack(image, key, sourceSize, sourceStamp, Image::UsePalettes() ? TEXTURE_CACHE_USE_PALETTES : 0, &entrySize);
+    if (!entry)
+        return;
+
+    char cacheFilename[4096];
+    TextureCache::GetCacheFilename(cacheFilename, sizeof cacheFilename, key);
+    if (!File::WriteAllBytes(cacheFilename, (char*)entry, entrySize))
+        Log::Print(Log::LOG_WARN, "Could not write texture cache file \"%s\"!", cacheFilename);
+
+    Memory::Free(entry);
+}
+
+// Takes the decoded pixels, and frees them.
+PRIVATE STATIC bool   TextureCache::AddBakedEntry(vector<ResourceFileEntry>* entries, DecodedImage* image, Uint32 key, Uint64 sourceSize, Uint32 sourceCRC, Uint16 flags, bool usePalettes) {
+    ResourceFileEntry entry;
+    entry.Data = TextureCache::Pack(image, key, sourceSize, sourceCRC, flags, &entry.Size);
+    Memory::Free(image->Palette);
+    Memory::Free(image->Buffer);
+    if (!entry.Data)
+        return false;
+
+    char* name = (char*)Memory::Malloc(32);
+    if (!name) {
+        Memory::Free(entry.Data);
+        return false;
+    }
+    TextureCache::GetBakedName(name, 32, key, usePalettes);
+    entry.Filename = name;
+    entries->push_back(entry);
+    return true;
+}
+
+PUBLIC STATIC bool   TextureCache::Bake(const char* dataFilename) {
+    if (!dataFilename)
+        dataFilename = "Data.hatch";
+
+    // The source images are the ones in the Resources folder, the same
+    // ones the data file is packed from.
+    vector<char*> files;
+    Directory::GetFiles(&files, "Resources", "*", true);
+
+    vector<ResourceFileEntry> entries;
+    size_t totalSize = 0;
+    double totalTime = 0.0;
+    int imageCount = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        const char* filename = files[i] + strlen("Resources/");
+        if (!StringUtils::StrCaseStr(filename, ".png")
+            && !StringUtils::StrCaseStr(filename, ".gif")
+            && !StringUtils::StrCaseStr(filename, ".jpg")
+            && !StringUtils::StrCaseStr(filename, ".jpeg"))
+            continue;
+
+        Uint32 sourceCRC;
+        Uint64 sourceSize;
+        if (!TextureCache::GetSourceCRC(filename, &sourceCRC, &sourceSize))
+            continue;
+
+        Clock::Start();
+        DecodedImage image;
+        DecodedImage paletteImage;
+        bool decoded = Image::Decode(filename, &image, false);
+        bool paletteDecoded = decoded && Image::Decode(filename, &paletteImage, true);
+        totalTime += Clock::End();
+        if (!decoded) {
+            Log::Print(Log::LOG_WARN, "Could not decode \"%s\", skipping.", filename);
+            continue;
+        }
+
+        // Most images only need the one entry.
+        Uint16 flags = TEXTURE_CACHE_BAKED;
+        if (paletteDecoded && !paletteImage.Palette
+            && paletteImage.Width == image.Width && paletteImage.Height == image.Height
+            && !memcmp(paletteImage.Data, image.Data, (size_t)image.Width * image.Height * sizeof(Uint32))) {
+            flags |= TEXTURE_CACHE_ANY_PALETTES;
+            Memory::Free(paletteImage.Palette);
+            Memory::Free(paletteImage.Buffer);
+            paletteDecoded = false;
+        }
+
+        Uint32 key = CRC32::EncryptString(filename);
+        if (TextureCache::AddBakedEntry(&entries, &image, key, sourceSize, sourceCRC, flags, false))
+            totalSize += entries.back().Size;
+        if (paletteDecoded && TextureCache::AddBakedEntry(&entries, &paletteImage, key, sourceSize, sourceCRC, flags | TEXTURE_CACHE_USE_PALETTES, true))
+            totalSize += entries.back().Size;
+        imageCount++;
+    }
+    for (size_t i = 0; i < files.size(); i++)
+        free(files[i]);
+
+    Log::Print(Log::LOG_INFO, "Decoded %d images in %.3f ms (%d entries, %.2f MB of cached pixels)", imageCount, totalTime, (int)entries.size(), totalSize / 1048576.0);
+
+    // Let go of the data file before it gets replaced
+    ResourceManager::Dispose();
+
+    bool success = ResourceManager::AddToDataFile(dataFilename, entries);
+    if (success)
+        Log::Print(Log::LOG_INFO, "Baked texture cache into \"%s\".", dataFilename);
+    else
+        Log::Print(Log::LOG_ERROR, "Could not bake texture cache into \"%s\"!", dataFilename);
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        Memory::Free((void*)entries[i].Filename);
+        Memory::Free(entries[i].Data);
+    }
+    return success;
+}
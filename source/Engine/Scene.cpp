@@ -162,7 +162,9 @@ public:
 #include <Engine/ResourceTypes/ResourceManager.h>
 #include <Engine/ResourceTypes/SceneFormats/TiledMapReader.h>
 #include <Engine/Rendering/SDL2/SDL2Renderer.h>
+#include <Engine/Scene/ParallelUpdate.h>
 #include <Engine/Scene/SceneInfo.h>
+#include <Engine/Scene/SpatialGrid.h>
 #include <Engine/TextFormats/XML/XMLParser.h>
 #include <Engine/TextFormats/XML/XMLNode.h>
 #include <Engine/Types/EntityTypes.h>
@@ -318,6 +320,8 @@ void UpdateObjectEarly(Entity* ent) {
 
     if (ent->List)
         ent->List->Performance.EarlyUpdate.DoAverage(elapsed);
+
+    SpatialGrid::Refresh(ent);
 }
 void UpdateObjectLate(Entity* ent) {
     if (Scene::Paused && ent->Pauseable && ent->Activity != ACTIVE_PAUSED && ent->Activity != ACTIVE_ALWAYS)
@@ -336,13 +340,7 @@ void UpdateObjectLate(Entity* ent) {
     if (ent->List)
         ent->List->Performance.LateUpdate.DoAverage(elapsed);
 }
-void UpdateObject(Entity* ent) {
-    if (Scene::Paused && ent->Pauseable && ent->Activity != ACTIVE_PAUSED && ent->Activity != ACTIVE_ALWAYS)
-        return;
-
-    if (!ent->Active)
-        return;
-
+bool UpdateObjectInRange(Entity* ent) {
     bool onScreenX = false;
     bool onScreenY = false;
 
@@ -446,25 +444,9 @@ void UpdateObject(Entity* ent) {
         break;
     }
 
-    if (ent->InRange) {
-        double elapsed = Clock::GetTicks();
-
-        ent->OnScreen = true;
-
-        ent->Update();
-
-        elapsed = Clock::GetTicks() - elapsed;
-
-        if (ent->List)
-            ent->List->Performance.Update.DoAverage(elapsed);
-
-        ent->WasOffScreen = false;
-    }
-    else {
-        ent->OnScreen = false;
-        ent->WasOffScreen = true;
-    }
-
+    return ent->InRange;
+}
+void UpdateObjectPriority(Entity* ent) {
     if (!Scene::PriorityLists)
         return;
 
@@ -501,6 +483,85 @@ void UpdateObject(Entity* ent) {
     ent->PriorityOld = ent->Priority;
     ent->OldDepth = ent->Depth;
 }
+void UpdateObject(Entity* ent) {
+    if (Scene::Paused && ent->Pauseable && ent->Activity != ACTIVE_PAUSED && ent->Activity != ACTIVE_ALWAYS)
+        return;
+
+    if (!ent->Active)
+        return;
+
+    if (UpdateObjectInRange(ent)) {
+        double elapsed = Clock::GetTicks();
+
+        ent->OnScreen = true;
+
+        ent->Update();
+
+        elapsed = Clock::GetTicks() - elapsed;
+
+        if (ent->List)
+            ent->List->Performance.Update.DoAverage(elapsed);
+
+        ent->WasOffScreen = false;
+
+        // Whatever queries the grid next should see where this moved to.
+        SpatialGrid::Refresh(ent);
+    }
+    else {
+        ent->OnScreen = false;
+        ent->WasOffScreen = true;
+    }
+
+    UpdateObjectPriority(ent);
+}
+void QueueObjectUpdate(Entity* ent) {
+    if (Scene::Paused && ent->Pauseable && ent->Activity != ACTIVE_PAUSED && ent->Activity != ACTIVE_ALWAYS)
+        return;
+
+    if (!ent->Active)
+        return;
+
+    if (UpdateObjectInRange(ent)) {
+        ent->OnScreen = true;
+
+        ParallelUpdate::Queue(ent);
+    }
+    else {
+        ent->OnScreen = false;
+        ent->WasOffScreen = true;
+
+        UpdateObjectPriority(ent);
+    }
+}
+void FinishQueuedUpdates() {
+    int count = ParallelUpdate::Run();
+
+    // Everything the workers could race on is done back here.
+    for (int i = 0; i < count; i++) {
+        Entity* ent = ParallelUpdate::Entities[i];
+        if (ent->List)
+            ent->List->Performance.Update.DoAverage(ParallelUpdate::Times[i]);
+
+        ent->WasOffScreen = false;
+
+        UpdateObjectPriority(ent);
+        SpatialGrid::Refresh(ent);
+    }
+
+    // What the workers spawned joins the scene now, the same way
+    // Instance.Create would have added it.
+    for (size_t i = 0; i < ParallelUpdate::Spawned.size(); i++) {
+        ScriptEntity* obj = (ScriptEntity*)ParallelUpdate::Spawned[i];
+        Scene::AddDynamic(obj->List, obj);
+
+        obj->Create(ParallelUpdate::SpawnFlags[i]);
+        obj->PostCreate();
+
+        SpatialGrid::Refresh(obj);
+    }
+
+    ParallelUpdate::Clear();
+}
 
 // Double linked-list functions
 PUBLIC STATIC void Scene::Add(Entity** first, Entity** last, int* count, Entity* obj) {
@@ -560,6 +621,8 @@ PUBLIC STATIC void Scene::AddToScene(Entity* obj) {
 
     Scene::ObjectLast = obj;
     Scene::ObjectCount++;
+
+    SpatialGrid::Insert(obj);
 }
 PUBLIC STATIC void Scene::RemoveFromScene(Entity* obj) {
     if (Scene::ObjectFirst == obj)
@@ -575,6 +638,8 @@ PUBLIC STATIC void Scene::RemoveFromScene(Entity* obj) {
     obj->PrevSceneEntity = obj->NextSceneEntity = NULL;
 
     Scene::ObjectCount--;
+
+    SpatialGrid::Remove(obj);
 }
 PRIVATE STATIC void Scene::RemoveObject(Entity* obj) {
     // Remove from proper list
@@ -612,7 +677,14 @@ PUBLIC STATIC void Scene::DeleteRemoved(Entity* obj) {
         return;
 
     obj->Dispose();
-    delete obj;
+
+    EntityStorage* storage = obj->Storage;
+    if (storage) {
+        obj->~Entity();
+        storage->Free(obj);
+    }
+    else
+        delete obj;
 }
 
 PUBLIC STATIC void Scene::OnEvent(Uint32 event) {
@@ -756,27 +828,40 @@ PUBLIC STATIC void Scene::Update() {
     }
 
     // Update objects
+    // Parallel-safe classes are only queued here, and then updated
+    // all at once across the worker threads after everything else.
     for (Entity* ent = Scene::StaticObjectFirst, *next; ent; ent = next) {
         // Store the "next" so that when/if the current is removed,
         // it can still be used to point at the end of the loop.
         next = ent->NextEntity;
 
         // Execute whatever on object
-        UpdateObject(ent);
+        if (ent->List && ent->List->ParallelSafe && ParallelUpdate::IsAvailable())
+            QueueObjectUpdate(ent);
+        else
+            UpdateObject(ent);
     }
     for (Entity* ent = Scene::DynamicObjectFirst, *next; ent; ent = next) {
         next = ent->NextEntity;
-        UpdateObject(ent);
+        if (ent->List && ent->List->ParallelSafe && ParallelUpdate::IsAvailable())
+            QueueObjectUpdate(ent);
+        else
+            UpdateObject(ent);
     }
+    FinishQueuedUpdates();
 
     // Late Update
+    // Entities get filed again in the spatial grid after each update
+    // event, and this is the last one for the frame.
     for (Entity* ent = Scene::StaticObjectFirst, *next; ent; ent = next) {
         next = ent->NextEntity;
         UpdateObjectLate(ent);
+        SpatialGrid::Refresh(ent);
     }
     for (Entity* ent = Scene::DynamicObjectFirst, *next; ent; ent = next) {
         next = ent->NextEntity;
         UpdateObjectLate(ent);
+        SpatialGrid::Refresh(ent);
 
         // Removes the object from the scene, but doesn't delete it yet.
         if (!ent->Active)
@@ -784,24 +869,21 @@ PUBLIC STATIC void Scene::Update() {
     }
 
     #ifdef USING_FFMPEG
-        AudioManager::Lock();
-        Uint8 audio_buffer[0x8000]; // <-- Should be larger than AudioManager::AudioQueueMaxSize
-        int needed = 0x8000; // AudioManager::AudioQueueMaxSize;
+        Uint8 audio_buffer[0x8000];
         for (size_t i = 0, i_sz = Scene::MediaList.size(); i < i_sz; i++) {
             if (!Scene::MediaList[i])
                 continue;
 
             MediaBag* media = Scene::MediaList[i]->AsMedia;
-            int queued = (int)AudioManager::AudioQueueSize;
-            if (queued < needed) {
-                int ready_bytes = media->Player->GetAudioData(audio_buffer, needed - queued);
-                if (ready_bytes > 0) {
-                    memcpy(AudioManager::AudioQueue + AudioManager::AudioQueueSize, audio_buffer, ready_bytes);
-                    AudioManager::AudioQueueSize += ready_bytes;
-                }
+            int needed = (int)AudioManager::AudioQueue->GetFree();
+            if (needed > (int)sizeof(audio_buffer))
+                needed = (int)sizeof(audio_buffer);
+            if (needed > 0) {
+                int ready_bytes = media->Player->GetAudioData(audio_buffer, needed);
+                if (ready_bytes > 0)
+                    AudioManager::AudioQueue->Write(audio_buffer, ready_bytes);
             }
         }
-        AudioManager::Unlock();
     #endif
 
     if (!Scene::Paused) {
@@ -1353,6 +1435,7 @@ PUBLIC STATIC void Scene::Restart() {
         for (int l = 0; l < (int)Layers.size(); l++)
             memcpy(Layers[l].Tiles, Layers[l].TilesBackup, Layers[l].DataSize);
         Scene::AnyLayerTileChange = false;
+        Scene::ResetCollisionMaps();
     }
 
     Scene::ClearPriorityLists();
@@ -1445,6 +1528,9 @@ PUBLIC STATIC void Scene::Restart() {
             // ent->PostCreated gets set when PostCreate() is called.
             ent->PostCreate();
         }
+
+        // The hitbox is usually only set by now.
+        SpatialGrid::Refresh(ent);
     });
 
     // Run "OnSceneLoad" or "OnSceneRestart" on all objects
@@ -2260,6 +2346,8 @@ PRIVATE STATIC void Scene::InitTileCollisions() {
 
     Scene::TileCfg.push_back(tileCfgA);
     Scene::TileCfg.push_back(tileCfgB);
+
+    Scene::ResetCollisionMaps();
 }
 PRIVATE STATIC void Scene::ClearTileCollisions(TileConfig* cfg, size_t numTiles) {
     for (size_t i = 0; i < numTiles; i++) {
@@ -2352,6 +2440,7 @@ PRIVATE STATIC void Scene::SetTileCount(size_t tileCount) {
     }
 
     Scene::TileCount = tileCount;
+    Scene::ResetCollisionMaps();
 }
 PUBLIC STATIC void Scene::LoadTileCollisions(const char* filename, size_t tilesetID) {
     if (!ResourceManager::ResourceExists(filename)) {
@@ -2385,6 +2474,7 @@ PUBLIC STATIC void Scene::UnloadTileCollisions() {
     Scene::TileCfg.clear();
     Scene::TileCfgLoaded = false;
     Scene::TileCount = 0;
+    Scene::ResetCollisionMaps();
 }
 
 // Resource Management
@@ -2463,8 +2553,9 @@ PUBLIC STATIC void Scene::DisposeInScope(Uint32 scope) {
     // Sounds
     AudioManager::ClearMusic();
     AudioManager::ClearSounds();
+    // The audio thread has to let go of them before they're freed
+    AudioManager::Sync();
 
-    AudioManager::Lock();
     for (size_t i = 0, i_sz = Scene::SoundList.size(); i < i_sz; i++) {
         if (!Scene::SoundList[i]) continue;
         if (Scene::SoundList[i]->UnloadPolicy > scope) continue;
@@ -2500,7 +2591,6 @@ PUBLIC STATIC void Scene::DisposeInScope(Uint32 scope) {
         delete Scene::MediaList[i];
         Scene::MediaList[i] = NULL;
     }
-    AudioManager::Unlock();
     // Textures
     for (size_t i = 0, i_sz = Scene::TextureList.size(); i < i_sz; i++) {
         if (!Scene::TextureList[i]) continue;
@@ -2570,6 +2660,8 @@ PUBLIC STATIC void Scene::Dispose() {
     Scene::ObjectFirst = NULL;
     Scene::ObjectLast = NULL;
 
+    SpatialGrid::Clear();
+
     // Free Priority Lists
     Scene::FreePriorityLists();
 
@@ -2634,6 +2726,62 @@ PUBLIC STATIC void Scene::SetTile(int layer, int x, int y, int tileID, int flip_
         *tile |= TILE_FLIPY_MASK;
     *tile |= collA << 28;
     *tile |= collB << 26;
+
+    Scene::UpdateCollisionTile(layer, x, y);
+}
+
+// Collision Maps
+// Each entry holds the tile's collision sides on that plane in the top
+// two bits, and the index of its TileConfig (flip variant included) in
+// the rest. Tiles that are empty or can't be collided with on that
+// plane are 0, so sensors can skip them with one test.
+#define COLLISION_MAP_SIDES_SHIFT 30
+#define COLLISION_MAP_INDEX_MASK  0x3FFFFFFFU
+
+static inline Uint32 PackCollisionTile(Uint32 tile, int plane) {
+    if ((tile & TILE_IDENT_MASK) == Scene::EmptyTile)
+        return 0;
+
+    Uint32 sides = plane ? (tile & TILE_COLLB_MASK) >> 26 : (tile & TILE_COLLA_MASK) >> 28;
+    if (!sides)
+        return 0;
+
+    Uint32 flipOffset = (((!!(tile & TILE_FLIPY_MASK)) << 1) | (!!(tile & TILE_FLIPX_MASK))) * Scene::TileCount;
+    return (sides << COLLISION_MAP_SIDES_SHIFT) | ((tile & TILE_IDENT_MASK) + flipOffset);
+}
+static void BuildCollisionMaps(SceneLayer* layer) {
+    size_t count = layer->DataSize / sizeof(Uint32);
+    for (int plane = 0; plane < 2; plane++) {
+        Uint32* map = (Uint32*)Memory::TrackedMalloc("SceneLayer::CollisionMaps", count * sizeof(Uint32));
+        for (size_t i = 0; i < count; i++)
+            map[i] = PackCollisionTile(layer->Tiles[i], plane);
+        layer->CollisionMaps[plane] = map;
+    }
+}
+static inline Uint32* GetCollisionMap(SceneLayer* layer, int plane) {
+    if (!layer->CollisionMaps[plane])
+        BuildCollisionMaps(layer);
+    return layer->CollisionMaps[plane];
+}
+
+// Throws away every layer's collision maps, for when tiles or tile
+// variants have changed all at once. They get built again on first use.
+PRIVATE STATIC void Scene::ResetCollisionMaps() {
+    for (size_t i = 0; i < Layers.size(); i++) {
+        for (int plane = 0; plane < 2; plane++) {
+            Memory::Free(Layers[i].CollisionMaps[plane]);
+            Layers[i].CollisionMaps[plane] = NULL;
+        }
+    }
+}
+// Call after changing a single tile.
+PUBLIC STATIC void Scene::UpdateCollisionTile(int layer, int x, int y) {
+    SceneLayer* sceneLayer = &Layers[layer];
+    int index = x + (y << sceneLayer->WidthInBits);
+    for (int plane = 0; plane < 2; plane++) {
+        if (sceneLayer->CollisionMaps[plane])
+            sceneLayer->CollisionMaps[plane][index] = PackCollisionTile(sceneLayer->Tiles[index], plane);
+    }
 }
 
 // Tile Collision
@@ -2645,11 +2793,12 @@ PUBLIC STATIC int  Scene::CollisionAt(int x, int y, int collisionField, int coll
     int checkX;
     int probeXOG = x;
     int probeYOG = y;
-    int tileX, tileY, tileID, tileAngle;
-    int collisionA, collisionB, collision;
+    int tileX, tileY, tileAngle;
+    int collision;
 
     bool check;
     TileConfig* tileCfgBase = Scene::TileCfg[collisionField];
+    int plane = collisionField ? 1 : 0;
 
     bool wallAsFloorFlag = collideSide & 0x10;
 
@@ -2672,7 +2821,7 @@ PUBLIC STATIC int  Scene::CollisionAt(int x, int y, int collisionField, int coll
     }
 
     for (size_t l = 0, lSz = Layers.size(); l < lSz; l++) {
-        SceneLayer layer = Layers[l];
+        SceneLayer& layer = Layers[l];
         if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
             continue;
 
@@ -2697,20 +2846,12 @@ PUBLIC STATIC int  Scene::CollisionAt(int x, int y, int collisionField, int coll
         tileX = x >> 4;
         tileY = y >> 4;
 
-        tileID = layer.Tiles[tileX + (tileY << layer.WidthInBits)];
-        if ((tileID & TILE_IDENT_MASK) != EmptyTile) {
-            int tileFlipOffset = (
-                ((!!(tileID & TILE_FLIPY_MASK)) << 1) | (!!(tileID & TILE_FLIPX_MASK))
-                ) * Scene::TileCount;
-
-            collisionA = (tileID & TILE_COLLA_MASK) >> 28;
-            collisionB = (tileID & TILE_COLLB_MASK) >> 26;
-            // collisionC = (tileID & TILE_COLLC_MASK) >> 24;
-            collision = collisionField ? collisionB : collisionA;
-            tileID = tileID & TILE_IDENT_MASK;
+        Uint32 entry = GetCollisionMap(&layer, plane)[tileX + (tileY << layer.WidthInBits)];
+        if (entry) {
+            collision = entry >> COLLISION_MAP_SIDES_SHIFT;
 
             // Check tile config
-            TileConfig* tileCfg = &tileCfgBase[tileID + tileFlipOffset];
+            TileConfig* tileCfg = &tileCfgBase[entry & COLLISION_MAP_INDEX_MASK];
             Uint8* colT = tileCfg->CollisionTop;
             Uint8* colB = tileCfg->CollisionBottom;
 
@@ -2740,21 +2881,18 @@ PUBLIC STATIC int  Scene::CollisionAt(int x, int y, int collisionField, int coll
     return -1;
 }
 
-PUBLIC STATIC int Scene::CollisionInLine(int x, int y, int angleMode, int checkLen, int collisionField, bool compareAngle, Sensor* sensor) {
-    if (checkLen < 0 || collisionField < 0 || collisionField >= Scene::TileCfg.size())
-        return -1;
-
-    int probeXOG = x;
-    int probeYOG = y;
+// Casts a sensor through one layer, keeping the closest hit so far.
+PRIVATE STATIC void Scene::CollisionInLayerLine(SceneLayer* layer, int x, int y, int angleMode, int checkLen, int collisionField, bool compareAngle, Sensor* sensor, int* minLength) {
     int probeDeltaX = 0;
     int probeDeltaY = 1;
-    int tileX, tileY, tileID;
-    int tileFlipOffset, collisionA, collisionB, collision, collisionMask;
+    int tileX, tileY;
+    int collision, collisionMask, sensedLength;
+    Uint32 entry;
+    Uint32* collisionMap;
     TileConfig* tileCfg;
     TileConfig* tileCfgBase = Scene::TileCfg[collisionField];
 
     int maxTileCheck = ((checkLen + 15) >> 4) + 1;
-    int minLength = 0x7FFFFFFF, sensedLength;
 
     collisionMask = 3;
     switch (angleMode) {
@@ -2780,144 +2918,139 @@ PUBLIC STATIC int Scene::CollisionInLine(int x, int y, int angleMode, int checkL
             break;
     }
 
-    switch (collisionField) {
-        case 0: collisionMask <<= 28; break;
-        case 1: collisionMask <<= 26; break;
-        case 2: collisionMask <<= 24; break;
-    }
-
     // probeDeltaX *= 16;
     // probeDeltaY *= 16;
 
-    sensor->Collided = false;
-    for (size_t l = 0, lSz = Layers.size(); l < lSz; l++) {
-        SceneLayer layer = Layers[l];
-        if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
-            continue;
-
-        x = probeXOG;
-        y = probeYOG;
-        x += layer.OffsetX;
-        y += layer.OffsetY;
+    x += layer->OffsetX;
+    y += layer->OffsetY;
 
-        // x = ((x % temp) + temp) % temp;
-        // y = ((y % temp) + temp) % temp;
+    collisionMap = GetCollisionMap(layer, collisionField);
 
-        tileX = x >> 4;
-        tileY = y >> 4;
-        for (int sl = 0; sl < maxTileCheck; sl++) {
-            if (tileX < 0 || tileX >= layer.Width)
-                goto NEXT_TILE;
-            if (tileY < 0 || tileY >= layer.Height)
-                goto NEXT_TILE;
+    // x = ((x % temp) + temp) % temp;
+    // y = ((y % temp) + temp) % temp;
 
-            tileID = layer.Tiles[tileX + (tileY << layer.WidthInBits)];
-            if ((tileID & TILE_IDENT_MASK) != EmptyTile) {
-                tileFlipOffset = (
-                    ( (!!(tileID & TILE_FLIPY_MASK)) << 1 ) | (!!(tileID & TILE_FLIPX_MASK))
-                ) * Scene::TileCount;
+    tileX = x >> 4;
+    tileY = y >> 4;
+    for (int sl = 0; sl < maxTileCheck; sl++) {
+        if (tileX < 0 || tileX >= layer->Width)
+            goto NEXT_TILE;
+        if (tileY < 0 || tileY >= layer->Height)
+            goto NEXT_TILE;
 
-                collisionA = ((tileID & TILE_COLLA_MASK & collisionMask) >> 28);
-                collisionB = ((tileID & TILE_COLLB_MASK & collisionMask) >> 26);
-                tileID = tileID & TILE_IDENT_MASK;
+        entry = collisionMap[tileX + (tileY << layer->WidthInBits)];
+        if (entry) {
+            tileCfg = &tileCfgBase[entry & COLLISION_MAP_INDEX_MASK];
+            if (!((entry >> COLLISION_MAP_SIDES_SHIFT) & collisionMask))
+                goto NEXT_TILE;
 
-                tileCfg = &tileCfgBase[tileID] + tileFlipOffset;
-                if (!(collisionB | collisionA))
-                    goto NEXT_TILE;
+            switch (angleMode) {
+                case 0:
+                    collision = tileCfg->CollisionTop[x & 15];
+                    if (collision >= 0xF0)
+                        break;
 
-                switch (angleMode) {
-                    case 0:
-                        collision = tileCfg->CollisionTop[x & 15];
-                        if (collision >= 0xF0)
-                            break;
-
-                        collision += tileY << 4;
-                        sensedLength = collision - y;
-                        if ((Uint32)sensedLength <= (Uint32)checkLen) {
-                            if (!compareAngle || abs((int)tileCfg->AngleTop - sensor->Angle) <= 0x20) {
-                                if (minLength > sensedLength) {
-                                    minLength = sensedLength;
-                                    sensor->Angle = tileCfg->AngleTop;
-                                    sensor->Collided = true;
-                                    sensor->X = x;
-                                    sensor->Y = collision;
-                                    sensor->X -= layer.OffsetX;
-                                    sensor->Y -= layer.OffsetY;
-                                    sl = maxTileCheck;
-                                }
+                    collision += tileY << 4;
+                    sensedLength = collision - y;
+                    if ((Uint32)sensedLength <= (Uint32)checkLen) {
+                        if (!compareAngle || abs((int)tileCfg->AngleTop - sensor->Angle) <= 0x20) {
+                            if (*minLength > sensedLength) {
+                                *minLength = sensedLength;
+                                sensor->Angle = tileCfg->AngleTop;
+                                sensor->Collided = true;
+                                sensor->X = x;
+                                sensor->Y = collision;
+                                sensor->X -= layer->OffsetX;
+                                sensor->Y -= layer->OffsetY;
+                                sl = maxTileCheck;
                             }
                         }
+                    }
+                    break;
+                case 1:
+                    collision = tileCfg->CollisionLeft[y & 15];
+                    if (collision >= 0xF0)
                         break;
-                    case 1:
-                        collision = tileCfg->CollisionLeft[y & 15];
-                        if (collision >= 0xF0)
-                            break;
-
-                        collision += tileX << 4;
-                        sensedLength = collision - x;
-                        if ((Uint32)sensedLength <= (Uint32)checkLen) {
-                            if (!compareAngle || abs((int)tileCfg->AngleLeft - sensor->Angle) <= 0x20) {
-                                if (minLength > sensedLength) {
-                                    minLength = sensedLength;
-                                    sensor->Angle = tileCfg->AngleLeft;
-                                    sensor->Collided = true;
-                                    sensor->X = collision;
-                                    sensor->Y = y;
-                                    sensor->X -= layer.OffsetX;
-                                    sensor->Y -= layer.OffsetY;
-                                }
+
+                    collision += tileX << 4;
+                    sensedLength = collision - x;
+                    if ((Uint32)sensedLength <= (Uint32)checkLen) {
+                        if (!compareAngle || abs((int)tileCfg->AngleLeft - sensor->Angle) <= 0x20) {
+                            if (*minLength > sensedLength) {
+                                *minLength = sensedLength;
+                                sensor->Angle = tileCfg->AngleLeft;
+                                sensor->Collided = true;
+                                sensor->X = collision;
+                                sensor->Y = y;
+                                sensor->X -= layer->OffsetX;
+                                sensor->Y -= layer->OffsetY;
                             }
                         }
+                    }
+                    break;
+                case 2:
+                    collision = tileCfg->CollisionBottom[x & 15];
+                    if (collision >= 0xF0)
                         break;
-                    case 2:
-                        collision = tileCfg->CollisionBottom[x & 15];
-                        if (collision >= 0xF0)
-                            break;
-
-                        collision += tileY << 4;
-                        sensedLength = y - collision;
-                        if ((Uint32)sensedLength <= (Uint32)checkLen) {
-                            if (!compareAngle || abs((int)tileCfg->AngleBottom - sensor->Angle) <= 0x20) {
-                                if (minLength > sensedLength) {
-                                    minLength = sensedLength;
-                                    sensor->Angle = tileCfg->AngleBottom;
-                                    sensor->Collided = true;
-                                    sensor->X = x;
-                                    sensor->Y = collision;
-                                    sensor->X -= layer.OffsetX;
-                                    sensor->Y -= layer.OffsetY;
-                                }
+
+                    collision += tileY << 4;
+                    sensedLength = y - collision;
+                    if ((Uint32)sensedLength <= (Uint32)checkLen) {
+                        if (!compareAngle || abs((int)tileCfg->AngleBottom - sensor->Angle) <= 0x20) {
+                            if (*minLength > sensedLength) {
+                                *minLength = sensedLength;
+                                sensor->Angle = tileCfg->AngleBottom;
+                                sensor->Collided = true;
+                                sensor->X = x;
+                                sensor->Y = collision;
+                                sensor->X -= layer->OffsetX;
+                                sensor->Y -= layer->OffsetY;
                             }
                         }
+                    }
+                    break;
+                case 3:
+                    collision = tileCfg->CollisionRight[y & 15];
+                    if (collision >= 0xF0)
                         break;
-                    case 3:
-                        collision = tileCfg->CollisionRight[y & 15];
-                        if (collision >= 0xF0)
-                            break;
-
-                        collision += tileX << 4;
-                        sensedLength = x - collision;
-                        if ((Uint32)sensedLength <= (Uint32)checkLen) {
-                            if (!compareAngle || abs((int)tileCfg->AngleRight - sensor->Angle) <= 0x20) {
-                                if (minLength > sensedLength) {
-                                    minLength = sensedLength;
-                                    sensor->Angle = tileCfg->AngleRight;
-                                    sensor->Collided = true;
-                                    sensor->X = collision;
-                                    sensor->Y = y;
-                                    sensor->X -= layer.OffsetX;
-                                    sensor->Y -= layer.OffsetY;
-                                }
+
+                    collision += tileX << 4;
+                    sensedLength = x - collision;
+                    if ((Uint32)sensedLength <= (Uint32)checkLen) {
+                        if (!compareAngle || abs((int)tileCfg->AngleRight - sensor->Angle) <= 0x20) {
+                            if (*minLength > sensedLength) {
+                                *minLength = sensedLength;
+                                sensor->Angle = tileCfg->AngleRight;
+                                sensor->Collided = true;
+                                sensor->X = collision;
+                                sensor->Y = y;
+                                sensor->X -= layer->OffsetX;
+                                sensor->Y -= layer->OffsetY;
                             }
                         }
-                        break;
-                }
+                    }
+                    break;
             }
-
-            NEXT_TILE:
-            tileX += probeDeltaX;
-            tileY += probeDeltaY;
         }
+
+        NEXT_TILE:
+        tileX += probeDeltaX;
+        tileY += probeDeltaY;
+    }
+}
+
+PUBLIC STATIC int Scene::CollisionInLine(int x, int y, int angleMode, int checkLen, int collisionField, bool compareAngle, Sensor* sensor) {
+    if (checkLen < 0 || collisionField < 0 || collisionField >= Scene::TileCfg.size())
+        return -1;
+
+    int minLength = 0x7FFFFFFF;
+
+    sensor->Collided = false;
+    for (size_t l = 0, lSz = Layers.size(); l < lSz; l++) {
+        SceneLayer& layer = Layers[l];
+        if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
+            continue;
+
+        CollisionInLayerLine(&layer, x, y, angleMode, checkLen, collisionField, compareAngle, sensor, &minLength);
     }
 
     if (sensor->Collided)
@@ -2925,6 +3058,53 @@ PUBLIC STATIC int Scene::CollisionInLine(int x, int y, int angleMode, int checkL
 
     return -1;
 }
+// Casts a whole set of sensors at once, each the same as CollisionInLine
+// would. Goes through the layers one at a time, so each layer's tiles
+// stay in cache across all of the probes. Returns how many hit.
+PUBLIC STATIC int Scene::CollisionInLineBatch(SensorProbe* probes, Sensor* sensors, int count) {
+    if (count <= 0)
+        return 0;
+
+    int* minLengths = (int*)Memory::Malloc(count * sizeof(int));
+    if (!minLengths)
+        return 0;
+
+    int tileCfgCount = (int)Scene::TileCfg.size();
+    for (int i = 0; i < count; i++) {
+        sensors[i].X = probes[i].X;
+        sensors[i].Y = probes[i].Y;
+        sensors[i].Collided = false;
+        sensors[i].Angle = probes[i].CompareAngle >= 0 ? probes[i].CompareAngle & 0xFF : 0;
+        minLengths[i] = 0x7FFFFFFF;
+
+        // Bad probes are skipped below.
+        if (probes[i].Length < 0 || probes[i].Plane < 0 || probes[i].Plane >= tileCfgCount)
+            minLengths[i] = -1;
+    }
+
+    for (size_t l = 0, lSz = Layers.size(); l < lSz; l++) {
+        SceneLayer& layer = Layers[l];
+        if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
+            continue;
+
+        for (int i = 0; i < count; i++) {
+            if (minLengths[i] < 0)
+                continue;
+
+            SensorProbe& probe = probes[i];
+            CollisionInLayerLine(&layer, probe.X, probe.Y, probe.Direction, probe.Length, probe.Plane, probe.CompareAngle >= 0, &sensors[i], &minLengths[i]);
+        }
+    }
+
+    Memory::Free(minLengths);
+
+    int hits = 0;
+    for (int i = 0; i < count; i++) {
+        if (sensors[i].Collided)
+            hits++;
+    }
+    return hits;
+}
 
 PUBLIC STATIC void Scene::SetupCollisionConfig(float minDistance, float lowTolerance, float highTolerance, int floorAngleTolerance, int wallAngleTolerance, int roofAngleTolerance) {
     CollisionMinimumDistance    = minDistance;
@@ -3378,7 +3558,7 @@ PUBLIC STATIC bool Scene::ObjectTileCollision(Entity* entity, int cLayers, int c
 
         case CMODE_FLOOR:
             for (size_t l = 0; l < Layers.size(); ++l, layerID <<= 1) {
-                SceneLayer layer = Layers[l];
+                SceneLayer& layer = Layers[l];
 
                 if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
                     continue;
@@ -3425,7 +3605,7 @@ PUBLIC STATIC bool Scene::ObjectTileCollision(Entity* entity, int cLayers, int c
 
         case CMODE_LWALL:
             for (size_t l = 0; l < Layers.size(); ++l, layerID <<= 1) {
-                SceneLayer layer = Layers[l];
+                SceneLayer& layer = Layers[l];
 
                 if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
                     continue;
@@ -3472,7 +3652,7 @@ PUBLIC STATIC bool Scene::ObjectTileCollision(Entity* entity, int cLayers, int c
 
         case CMODE_ROOF:
             for (size_t l = 0; l < Layers.size(); ++l, layerID <<= 1) {
-                SceneLayer layer = Layers[l];
+                SceneLayer& layer = Layers[l];
 
                 if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
                     continue;
@@ -3519,7 +3699,7 @@ PUBLIC STATIC bool Scene::ObjectTileCollision(Entity* entity, int cLayers, int c
 
         case CMODE_RWALL:
             for (size_t l = 0; l < Layers.size(); ++l, layerID <<= 1) {
-                SceneLayer layer = Layers[l];
+                SceneLayer& layer = Layers[l];
 
                 if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
                     continue;
@@ -3584,7 +3764,7 @@ PUBLIC STATIC bool Scene::ObjectTileGrip(Entity* entity, int cLayers, int cMode,
 
         case CMODE_FLOOR:
             for (size_t l = 0; l < Layers.size(); ++l, layerID <<= 1) {
-                SceneLayer layer = Layers[l];
+                SceneLayer& layer = Layers[l];
 
                 if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
                     continue;
@@ -3634,7 +3814,7 @@ PUBLIC STATIC bool Scene::ObjectTileGrip(Entity* entity, int cLayers, int cMode,
 
         case CMODE_LWALL:
             for (size_t l = 0; l < Layers.size(); ++l, layerID <<= 1) {
-                SceneLayer layer = Layers[l];
+                SceneLayer& layer = Layers[l];
 
                 if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
                     continue;
@@ -3684,7 +3864,7 @@ PUBLIC STATIC bool Scene::ObjectTileGrip(Entity* entity, int cLayers, int cMode,
 
         case CMODE_ROOF:
             for (size_t l = 0; l < Layers.size(); ++l, layerID <<= 1) {
-                SceneLayer layer = Layers[l];
+                SceneLayer& layer = Layers[l];
 
                 if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
                     continue;
@@ -3734,7 +3914,7 @@ PUBLIC STATIC bool Scene::ObjectTileGrip(Entity* entity, int cLayers, int cMode,
 
         case CMODE_RWALL:
             for (size_t l = 0; l < Layers.size(); ++l, layerID <<= 1) {
-                SceneLayer layer = Layers[l];
+                SceneLayer& layer = Layers[l];
 
                 if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
                     continue;
@@ -4925,13 +5105,14 @@ PUBLIC STATIC void Scene::FindFloorPosition(CollisionSensor* sensor) {
     int OGX     = sensor->X;
     int OGY     = sensor->Y;
 
-    int tileX, tileY, tileID;
+    int tileX, tileY;
 
     if (CollisionEntity->CollisionPlane < 0 || CollisionEntity->CollisionPlane >= TileCfg.size())
         return;
 
     TileConfig* tileCfg;
     TileConfig* tileCfgBase = TileCfg[CollisionEntity->CollisionPlane];
+    int plane = CollisionEntity->CollisionPlane ? 1 : 0;
 
     int solid = (CollisionEntity->TileCollisions == TILECOLLISION_DOWN) ? 1 : 2;
 
@@ -4939,7 +5120,7 @@ PUBLIC STATIC void Scene::FindFloorPosition(CollisionSensor* sensor) {
 
     int layerID = 1;
     for (size_t l = 0; l < Layers.size(); ++l, layerID <<= 1) {
-        SceneLayer layer = Layers[l];
+        SceneLayer& layer = Layers[l];
         
         if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
             continue;
@@ -4968,18 +5149,12 @@ PUBLIC STATIC void Scene::FindFloorPosition(CollisionSensor* sensor) {
             if (colX >= 0.0 && colX < TileWidth * layer.Width) {
                 for (int i = 0; i < 3; ++i) {
                     if (cy >= 0 && cy < TileHeight * layer.Height) {
-                        tileID = layer.Tiles[((int)colX / TileWidth) + (((int)colY / TileHeight) << layer.WidthInBits)];
+                        Uint32 entry = GetCollisionMap(&layer, plane)[((int)colX / TileWidth) + (((int)colY / TileHeight) << layer.WidthInBits)];
 
-                        if ((tileID & TILE_IDENT_MASK) != EmptyTile) {
-                            int tileFlipOffset = (((!!(tileID & TILE_FLIPY_MASK)) << 1) | (!!(tileID & TILE_FLIPX_MASK))) * TileCount;
-
-                            int collisionA = (tileID & TILE_COLLA_MASK) >> 28;
-                            int collisionB = (tileID & TILE_COLLB_MASK) >> 26;
-                            int collision = CollisionEntity->CollisionPlane ? collisionB : collisionA;
-
-                            tileID &= TILE_IDENT_MASK;
+                        if (entry) {
+                            int collision = entry >> COLLISION_MAP_SIDES_SHIFT;
 
-                            tileCfg = &tileCfgBase[tileID + tileFlipOffset];
+                            tileCfg = &tileCfgBase[entry & COLLISION_MAP_INDEX_MASK];
                             Uint8* colT = tileCfg->CollisionTop;
 
                             if (collision & 1) {
@@ -5034,7 +5209,7 @@ PUBLIC STATIC void Scene::FindLWallPosition(CollisionSensor* sensor) {
 
     int layerID = 1;
     for (size_t l = 0; l < Layers.size(); ++l, layerID <<= 1) {
-        SceneLayer layer = Layers[l];
+        SceneLayer& layer = Layers[l];
 
         if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
             continue;
@@ -5104,7 +5279,7 @@ PUBLIC STATIC void Scene::FindRoofPosition(CollisionSensor* sensor) {
 
     int layerID = 1;
     for (size_t l = 0; l < Layers.size(); ++l, layerID <<= 1) {
-        SceneLayer layer = Layers[l];
+        SceneLayer& layer = Layers[l];
 
         if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
             continue;
@@ -5173,7 +5348,7 @@ PUBLIC STATIC void Scene::FindRWallPosition(CollisionSensor* sensor) {
 
     int layerID = 1;
     for (size_t l = 0; l < Layers.size(); ++l, layerID <<= 1) {
-        SceneLayer layer = Layers[l];
+        SceneLayer& layer = Layers[l];
 
         if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
             continue;
@@ -5244,7 +5419,7 @@ PUBLIC STATIC void Scene::FloorCollision(CollisionSensor* sensor) {
 
     int layerID = 1;
     for (size_t l = 0; l < Layers.size(); ++l, layerID <<= 1) {
-        SceneLayer layer = Layers[l];
+        SceneLayer& layer = Layers[l];
 
         if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
             continue;
@@ -5319,7 +5494,7 @@ PUBLIC STATIC void Scene::LWallCollision(CollisionSensor* sensor) {
 
     int layerID = 1;
     for (size_t l = 0; l < Layers.size(); ++l, layerID <<= 1) {
-        SceneLayer layer = Layers[l];
+        SceneLayer& layer = Layers[l];
 
         if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
             continue;
@@ -5383,7 +5558,7 @@ PUBLIC STATIC void Scene::RoofCollision(CollisionSensor* sensor) {
 
     int layerID = 1;
         for (size_t l = 0; l < Layers.size(); ++l, layerID <<= 1) {
-        SceneLayer layer = Layers[l];
+        SceneLayer& layer = Layers[l];
 
         if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
             continue;
@@ -5455,7 +5630,7 @@ PUBLIC STATIC void Scene::RWallCollision(CollisionSensor* sensor) {
 
     int layerID = 1;
     for (size_t l = 0; l < Layers.size(); ++l, layerID <<= 1) {
-        SceneLayer layer = Layers[l];
+        SceneLayer& layer = Layers[l];
 
         if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
             continue;
@@ -0,0 +1,245 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Bytecode/Types.h>
+#include <Engine/Types/Entity.h>
+
+class ParallelUpdate {
+public:
+    static int             ThreadsRequested;
+    static int             WorkerCount;
+    static Uint32          FirstThreadIndex;
+    static vector<Entity*> Entities;
+    static vector<double>  Times;
+    static vector<Entity*> Spawned;
+    static vector<VMValue> SpawnFlags;
+};
+#endif
+
+#include <Engine/Scene/ParallelUpdate.h>
+
+#include <Engine/Bytecode/ScriptManager.h>
+#include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/Log.h>
+
+// Entities are claimed a few at a time, so that the workers
+// aren't all contending on the shared index for every Update.
+#define PARALLEL_UPDATE_BATCH 8
+
+// Every participant (the main thread included) needs a VMThread
+// of its own. These come from the top of ScriptManager::Threads,
+// so the Thread class still has the bottom half.
+#define PARALLEL_UPDATE_MAX_THREADS 4
+
+struct ParallelUpdateWorker {
+    SDL_Thread* Thread;
+    Uint32      ThreadID;
+};
+struct ParallelUpdateSpawn {
+    int     Index;
+    Entity* Ent;
+    VMValue Flag;
+};
+
+static ParallelUpdateWorker Workers[PARALLEL_UPDATE_MAX_THREADS - 1];
+static SDL_sem*             WorkReady = NULL;
+static SDL_sem*             WorkDone = NULL;
+static SDL_atomic_t         NextEntity;
+static bool                 Started = false;
+static bool                 Quitting = false;
+static bool                 Running = false;
+
+// Each participant only touches its own slot while running.
+static int                         CurrentEntity[PARALLEL_UPDATE_MAX_THREADS];
+static vector<ParallelUpdateSpawn> Spawns[PARALLEL_UPDATE_MAX_THREADS];
+
+int             ParallelUpdate::ThreadsRequested = 0;
+int             ParallelUpdate::WorkerCount = 0;
+Uint32          ParallelUpdate::FirstThreadIndex = sizeof(ScriptManager::Threads) / sizeof(VMThread);
+vector<Entity*> ParallelUpdate::Entities;
+vector<double>  ParallelUpdate::Times;
+vector<Entity*> ParallelUpdate::Spawned;
+vector<VMValue> ParallelUpdate::SpawnFlags;
+
+static void RunEntities(Uint32 threadID) {
+    int participant = (int)(threadID - ParallelUpdate::FirstThreadIndex);
+    int count = (int)ParallelUpdate::Entities.size();
+    for (;;) {
+        int start = SDL_AtomicAdd(&NextEntity, PARALLEL_UPDATE_BATCH);
+        if (start >= count)
+            break;
+
+        int end = start + PARALLEL_UPDATE_BATCH;
+        if (end > count)
+            end = count;
+
+        for (int i = start; i < end; i++) {
+            CurrentEntity[participant] = i;
+
+            double elapsed = Clock::GetTicks();
+            ParallelUpdate::Entities[i]->UpdateOnThread(threadID);
+            ParallelUpdate::Times[i] = Clock::GetTicks() - elapsed;
+        }
+    }
+}
+static int WorkerMain(void* data) {
+    ParallelUpdateWorker* worker = (ParallelUpdateWorker*)data;
+    for (;;) {
+        SDL_SemWait(WorkReady);
+        if (Quitting)
+            break;
+
+        RunEntities(worker->ThreadID);
+        SDL_SemPost(WorkDone);
+    }
+    return 0;
+}
+
+static void DestroyWorkers() {
+    Quitting = true;
+    for (int i = 0; i < ParallelUpdate::WorkerCount; i++)
+        SDL_SemPost(WorkReady);
+    for (int i = 0; i < ParallelUpdate::WorkerCount; i++)
+        SDL_WaitThread(Workers[i].Thread, NULL);
+
+    if (WorkReady)
+        SDL_DestroySemaphore(WorkReady);
+    if (WorkDone)
+        SDL_DestroySemaphore(WorkDone);
+
+    WorkReady = NULL;
+    WorkDone = NULL;
+    ParallelUpdate::WorkerCount = 0;
+    ParallelUpdate::FirstThreadIndex = sizeof(ScriptManager::Threads) / sizeof(VMThread);
+}
+
+PUBLIC STATIC void ParallelUpdate::Init() {
+    if (Started)
+        return;
+
+    Started = true;
+
+    // 0 picks one thread per core, 1 turns parallel updates off.
+    int threads = ThreadsRequested > 0 ? ThreadsRequested : SDL_GetCPUCount();
+    if (threads > PARALLEL_UPDATE_MAX_THREADS)
+        threads = PARALLEL_UPDATE_MAX_THREADS;
+
+    // Don't take VMThreads that a script thread is already using.
+    Uint32 threadMax = sizeof(ScriptManager::Threads) / sizeof(VMThread);
+    while (threads > 1 && threadMax - threads < ScriptManager::ThreadCount)
+        threads--;
+
+    if (threads <= 1) {
+        WorkerCount = 0;
+        return;
+    }
+
+    WorkReady = SDL_CreateSemaphore(0);
+    WorkDone = SDL_CreateSemaphore(0);
+    if (!WorkReady || !WorkDone) {
+        Log::Print(Log::LOG_ERROR, "Could not create parallel update semaphores: %s", SDL_GetError());
+        DestroyWorkers();
+        return;
+    }
+
+    Quitting = false;
+    FirstThreadIndex = threadMax - threads;
+    WorkerCount = 0;
+    for (int i = 0; i < threads - 1; i++) {
+        ParallelUpdateWorker* worker = &Workers[i];
+        worker->ThreadID = FirstThreadIndex + 1 + i;
+        worker->Thread = SDL_CreateThread(WorkerMain, "ParallelUpdate", worker);
+        if (!worker->Thread) {
+            Log::Print(Log::LOG_ERROR, "Could not create parallel update thread: %s", SDL_GetError());
+            break;
+        }
+        WorkerCount++;
+    }
+
+    if (WorkerCount == 0) {
+        DestroyWorkers();
+        return;
+    }
+
+    Log::Print(Log::LOG_VERBOSE, "Parallel update using %d threads.", WorkerCount + 1);
+}
+PUBLIC STATIC bool ParallelUpdate::IsAvailable() {
+    if (!Started)
+        ParallelUpdate::Init();
+    return WorkerCount > 0;
+}
+PUBLIC STATIC void ParallelUpdate::Queue(Entity* ent) {
+    Entities.push_back(ent);
+}
+PUBLIC STATIC bool ParallelUpdate::IsRunning() {
+    return Running;
+}
+// Entities spawned by a participant can't join the scene's lists until
+// everyone's done, so they're kept until then. Returns false if they
+// can be added right away.
+PUBLIC STATIC bool ParallelUpdate::DeferSpawn(Entity* ent, VMValue flag, Uint32 threadID) {
+    if (!Running)
+        return false;
+
+    // Script threads aren't participants, and never were safe to spawn from.
+    Uint32 participant = threadID - FirstThreadIndex;
+    if (participant > (Uint32)WorkerCount)
+        return false;
+
+    ParallelUpdateSpawn spawn;
+    spawn.Index = CurrentEntity[participant];
+    spawn.Ent = ent;
+    spawn.Flag = flag;
+    Spawns[participant].push_back(spawn);
+    return true;
+}
+PUBLIC STATIC int ParallelUpdate::Run() {
+    int count = (int)Entities.size();
+    if (!count)
+        return 0;
+
+    Times.resize(count);
+    SDL_AtomicSet(&NextEntity, 0);
+
+    Running = true;
+
+    for (int i = 0; i < WorkerCount; i++)
+        SDL_SemPost(WorkReady);
+
+    RunEntities(FirstThreadIndex);
+
+    for (int i = 0; i < WorkerCount; i++)
+        SDL_SemWait(WorkDone);
+
+    Running = false;
+
+    // Each participant claimed entities in order, so sorting by the
+    // spawning entity puts them in the order a serial update would have.
+    vector<ParallelUpdateSpawn> spawns;
+    for (int i = 0; i <= WorkerCount; i++) {
+        spawns.insert(spawns.end(), Spawns[i].begin(), Spawns[i].end());
+        Spawns[i].clear();
+    }
+    std::stable_sort(spawns.begin(), spawns.end(), [](const ParallelUpdateSpawn& a, const ParallelUpdateSpawn& b) -> bool {
+        return a.Index < b.Index;
+    });
+    for (size_t i = 0; i < spawns.size(); i++) {
+        Spawned.push_back(spawns[i].Ent);
+        SpawnFlags.push_back(spawns[i].Flag);
+    }
+
+    return count;
+}
+PUBLIC STATIC void ParallelUpdate::Clear() {
+    Entities.clear();
+    Spawned.clear();
+    SpawnFlags.clear();
+}
+PUBLIC STATIC void ParallelUpdate::Dispose() {
+    DestroyWorkers();
+    Started = false;
+
+    Entities.clear();
+    Times.clear();
+    Spawned.clear();
+    SpawnFlags.clear();
+}
@@ -30,6 +30,10 @@ public:
     Uint32*           TilesBackup = NULL;
     Uint16*           TileOffsetY = NULL;
 
+    // What the tile sensors read: Tiles packed for each collision
+    // plane, built by the scene the first time they're needed.
+    Uint32*           CollisionMaps[2] = { NULL, NULL };
+
     int               DeformOffsetA = 0;
     int               DeformOffsetB = 0;
     int               DeformSetA[MAX_DEFORM_LINES];
@@ -129,4 +133,8 @@ PUBLIC void    SceneLayer::Dispose() {
     Memory::Free(Tiles);
     Memory::Free(TilesBackup);
     Memory::Free(ScrollIndexes);
+    Memory::Free(CollisionMaps[0]);
+    Memory::Free(CollisionMaps[1]);
+    CollisionMaps[0] = NULL;
+    CollisionMaps[1] = NULL;
 }
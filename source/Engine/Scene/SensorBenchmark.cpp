@@ -0,0 +1,184 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+
+class SensorBenchmark {
+public:
+    static int DefaultCount;
+};
+#endif
+
+#include <Engine/Scene/SensorBenchmark.h>
+
+#include <Engine/Bytecode/ScriptEntity.h>
+#include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Scene.h>
+#include <Engine/Scene/SceneEnums.h>
+
+int SensorBenchmark::DefaultCount = 2000;
+
+#define BENCH_PASSES 20
+
+struct SensorBenchProbe {
+    int X;
+    int Y;
+};
+
+static Uint32 BenchSeed;
+static Uint32 NextBenchRandom() {
+    BenchSeed = BenchSeed * 1103515245 + 12345;
+    return BenchSeed >> 16;
+}
+// Mixes a result into the checksum, so that runs on different builds
+// can be checked for giving the same answers.
+static inline Uint32 HashResult(Uint32 hash, int value) {
+    return (hash ^ (Uint32)value) * 0x01000193U;
+}
+
+static bool GetCollideableBounds(int* width, int* height, int* layerMask) {
+    *width = 0;
+    *height = 0;
+    *layerMask = 0;
+    for (size_t l = 0; l < Scene::Layers.size() && l < 32; l++) {
+        SceneLayer& layer = Scene::Layers[l];
+        if (!(layer.Flags & SceneLayer::FLAGS_COLLIDEABLE))
+            continue;
+
+        if (*width < layer.Width * Scene::TileWidth)
+            *width = layer.Width * Scene::TileWidth;
+        if (*height < layer.Height * Scene::TileHeight)
+            *height = layer.Height * Scene::TileHeight;
+        *layerMask |= 1 << l;
+    }
+    return *layerMask != 0;
+}
+static void MakeProbes(vector<SensorBenchProbe>* probes, int count, int width, int height) {
+    BenchSeed = 0x5EED;
+    probes->resize(count);
+    for (int i = 0; i < count; i++) {
+        (*probes)[i].X = (int)((NextBenchRandom() << 16 | NextBenchRandom()) % (Uint32)width);
+        (*probes)[i].Y = (int)((NextBenchRandom() << 16 | NextBenchRandom()) % (Uint32)height);
+    }
+}
+
+static double RunPointPass(vector<SensorBenchProbe>& probes, Uint32* hash) {
+    static const int sides[] = { CollideSide::TOP, CollideSide::LEFT, CollideSide::RIGHT, CollideSide::BOTTOM };
+
+    double elapsed = Clock::GetTicks();
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        for (size_t i = 0; i < probes.size(); i++) {
+            int plane = i & 1;
+            int side = sides[(i >> 1) & 3];
+            *hash = HashResult(*hash, Scene::CollisionAt(probes[i].X, probes[i].Y, plane, side, NULL));
+        }
+    }
+    return Clock::GetTicks() - elapsed;
+}
+static double RunLinePass(vector<SensorBenchProbe>& probes, Uint32* hash) {
+    double elapsed = Clock::GetTicks();
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        for (size_t i = 0; i < probes.size(); i++) {
+            Sensor sensor;
+            sensor.X = 0;
+            sensor.Y = 0;
+            sensor.Angle = 0;
+            Scene::CollisionInLine(probes[i].X, probes[i].Y, (i >> 1) & 3, 32, i & 1, false, &sensor);
+            *hash = HashResult(*hash, sensor.Collided ? sensor.X ^ (sensor.Y << 12) ^ (sensor.Angle << 24) : -1);
+        }
+    }
+    return Clock::GetTicks() - elapsed;
+}
+// The same casts as RunLinePass, handed over all at once.
+static double RunLineBatchPass(vector<SensorBenchProbe>& probes, Uint32* hash) {
+    vector<SensorProbe> batch(probes.size());
+    vector<Sensor> sensors(probes.size());
+    for (size_t i = 0; i < probes.size(); i++) {
+        batch[i].X = probes[i].X;
+        batch[i].Y = probes[i].Y;
+        batch[i].Direction = (i >> 1) & 3;
+        batch[i].Length = 32;
+        batch[i].Plane = i & 1;
+        batch[i].CompareAngle = -1;
+    }
+
+    double elapsed = Clock::GetTicks();
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        Scene::CollisionInLineBatch(batch.data(), sensors.data(), (int)batch.size());
+        for (size_t i = 0; i < sensors.size(); i++) {
+            Sensor& sensor = sensors[i];
+            *hash = HashResult(*hash, sensor.Collided ? sensor.X ^ (sensor.Y << 12) ^ (sensor.Angle << 24) : -1);
+        }
+    }
+    return Clock::GetTicks() - elapsed;
+}
+// The floor sensors that path grip casts for objects on the ground.
+static double RunFloorPass(vector<SensorBenchProbe>& probes, int layerMask, Uint32* hash) {
+    ScriptEntity entity;
+    ScriptEntity* ent = &entity;
+    ent->TileCollisions = TILECOLLISION_DOWN;
+    ent->CollisionLayers = layerMask;
+
+    Entity* lastEntity = Scene::CollisionEntity;
+    float lastTolerance = Scene::CollisionTolerance;
+    Scene::CollisionEntity = ent;
+    Scene::CollisionTolerance = Scene::HighCollisionTolerance;
+
+    double elapsed = Clock::GetTicks();
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        for (size_t i = 0; i < probes.size(); i++) {
+            CollisionSensor sensor;
+            sensor.X = probes[i].X;
+            sensor.Y = probes[i].Y;
+            sensor.Angle = 0;
+            sensor.Collided = false;
+            ent->CollisionPlane = i & 1;
+            Scene::FindFloorPosition(&sensor);
+            *hash = HashResult(*hash, sensor.Collided ? (int)sensor.Y ^ (sensor.Angle << 24) : -1);
+        }
+    }
+    elapsed = Clock::GetTicks() - elapsed;
+
+    Scene::CollisionEntity = lastEntity;
+    Scene::CollisionTolerance = lastTolerance;
+    return elapsed;
+}
+static void PrintBenchResult(const char* name, double elapsed, int count, Uint32 hash) {
+    double perProbe = elapsed * 1000000.0 / ((double)count * BENCH_PASSES);
+    Log::Print(Log::LOG_INFO, "%-20s %9.3f ms  %9.2f ns/probe  (results %08X)", name, elapsed, perProbe, hash);
+}
+
+// Casts sensors at random spots across the loaded scene's collideable
+// layers: single points, short lines in all four directions (one at a
+// time and batched), and the floor sensors objects use to stick to the
+// ground.
+PUBLIC STATIC void SensorBenchmark::Run(int count) {
+    if (count <= 0)
+        count = DefaultCount;
+
+    int width, height, layerMask;
+    if (!Scene::TileCfg.size() || !GetCollideableBounds(&width, &height, &layerMask)) {
+        Log::Print(Log::LOG_ERROR, "Sensor benchmark needs a scene with collideable layers and tile collisions!");
+        return;
+    }
+
+    vector<SensorBenchProbe> probes;
+    MakeProbes(&probes, count, width, height);
+
+    Log::Print(Log::LOG_IMPORTANT, "Sensor Benchmark (%d probes over %d x %d, %d passes):", count, width, height, BENCH_PASSES);
+
+    Uint32 hash = 0x811C9DC5U;
+    double elapsed = RunPointPass(probes, &hash);
+    PrintBenchResult("Point checks", elapsed, count, hash);
+
+    hash = 0x811C9DC5U;
+    elapsed = RunLinePass(probes, &hash);
+    PrintBenchResult("Line casts", elapsed, count, hash);
+
+    hash = 0x811C9DC5U;
+    elapsed = RunLineBatchPass(probes, &hash);
+    PrintBenchResult("Line casts (batch)", elapsed, count, hash);
+
+    hash = 0x811C9DC5U;
+    elapsed = RunFloorPass(probes, layerMask, &hash);
+    PrintBenchResult("Floor sensors", elapsed, count, hash);
+}
@@ -0,0 +1,407 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+#include <Engine/Types/Entity.h>
+
+need_t ObjectList;
+
+class SpatialGrid {
+public:
+    static int             CellSize;
+    static int             Margin;
+    static vector<Entity*> Oversized;
+};
+#endif
+
+#include <Engine/Scene/SpatialGrid.h>
+
+#include <Engine/Scene.h>
+#include <Engine/Types/ObjectList.h>
+
+// Entities whose hitbox covers more than this many cells across
+// are kept in a separate list that every query looks through,
+// instead of being filed under every cell they touch.
+#define SPATIAL_GRID_MAX_SPAN 8
+
+// Cell coordinates are clamped to this, so that entities that are
+// very far away (or at a NaN position) still get a valid cell.
+#define SPATIAL_GRID_LIMIT 0x3FFFFFFF
+
+static std::unordered_map<Uint64, vector<Entity*>> Cells;
+static int                                         MinCellX = 0;
+static int                                         MinCellY = 0;
+static int                                         MaxCellX = -1;
+static int                                         MaxCellY = -1;
+
+int             SpatialGrid::CellSize = 64;
+// Entities are filed again after each of their update events, with
+// their box grown by this much plus a frame of their velocity. That
+// way, queries still find entities that another one has nudged or
+// that ApplyMotion has moved since then. Queries check what they find
+// against where it is now, but an entity moved further than that
+// (say, teleported by another entity) is only found once it's filed
+// again.
+int             SpatialGrid::Margin = 16;
+vector<Entity*> SpatialGrid::Oversized;
+
+static inline Uint64 GetCellKey(int cellX, int cellY) {
+    return ((Uint64)(Uint32)cellX << 32) | (Uint32)cellY;
+}
+static inline int GetCell(float value) {
+    float cell = floorf(value / SpatialGrid::CellSize);
+    if (!(cell > -SPATIAL_GRID_LIMIT))
+        return -SPATIAL_GRID_LIMIT;
+    if (cell > SPATIAL_GRID_LIMIT)
+        return SPATIAL_GRID_LIMIT;
+    return (int)cell;
+}
+static void GetEntityBox(Entity* ent, float* left, float* top, float* right, float* bottom) {
+    // Same box that Entity::CollideWithObject uses.
+    float flipX = (ent->FlipFlag & 1) ? -1.0f : 1.0f;
+    float flipY = (ent->FlipFlag & 2) ? -1.0f : 1.0f;
+    float x = std::floor(ent->X + ent->Hitbox.OffsetX * flipX);
+    float y = std::floor(ent->Y + ent->Hitbox.OffsetY * flipY);
+    float halfW = ent->Hitbox.Width * 0.5f;
+    float halfH = ent->Hitbox.Height * 0.5f;
+    *left = x - halfW;
+    *top = y - halfH;
+    *right = x + halfW;
+    *bottom = y + halfH;
+}
+static void GetFilingRange(Entity* ent, int* left, int* top, int* right, int* bottom) {
+    float boxLeft, boxTop, boxRight, boxBottom;
+    GetEntityBox(ent, &boxLeft, &boxTop, &boxRight, &boxBottom);
+
+    // The position is filed too, for nearest-neighbor queries.
+    float marginX = SpatialGrid::Margin + std::fabs(ent->XSpeed);
+    float marginY = SpatialGrid::Margin + std::fabs(ent->YSpeed) + std::fabs(ent->Gravity);
+    boxLeft = std::min(boxLeft, ent->X) - marginX;
+    boxTop = std::min(boxTop, ent->Y) - marginY;
+    boxRight = std::max(boxRight, ent->X) + marginX;
+    boxBottom = std::max(boxBottom, ent->Y) + marginY;
+
+    *left = GetCell(boxLeft);
+    *top = GetCell(boxTop);
+    *right = GetCell(boxRight);
+    *bottom = GetCell(boxBottom);
+}
+static inline bool IsOversized(int left, int top, int right, int bottom) {
+    return right - left >= SPATIAL_GRID_MAX_SPAN || bottom - top >= SPATIAL_GRID_MAX_SPAN;
+}
+static inline bool IsCandidate(Entity* ent, ObjectList* list) {
+    return ent->Active && !ent->Removed && (!list || ent->List == list);
+}
+static inline float GetDistanceSquared(Entity* ent, float x, float y) {
+    float distX = ent->X - x;
+    float distY = ent->Y - y;
+    return distX * distX + distY * distY;
+}
+
+static void FileEntity(Entity* ent) {
+    if (IsOversized(ent->GridLeft, ent->GridTop, ent->GridRight, ent->GridBottom)) {
+        SpatialGrid::Oversized.push_back(ent);
+        return;
+    }
+
+    for (int y = ent->GridTop; y <= ent->GridBottom; y++)
+        for (int x = ent->GridLeft; x <= ent->GridRight; x++)
+            Cells[GetCellKey(x, y)].push_back(ent);
+
+    if (MinCellX > MaxCellX) {
+        MinCellX = ent->GridLeft;
+        MinCellY = ent->GridTop;
+        MaxCellX = ent->GridRight;
+        MaxCellY = ent->GridBottom;
+    }
+    else {
+        MinCellX = std::min(MinCellX, ent->GridLeft);
+        MinCellY = std::min(MinCellY, ent->GridTop);
+        MaxCellX = std::max(MaxCellX, ent->GridRight);
+        MaxCellY = std::max(MaxCellY, ent->GridBottom);
+    }
+}
+static void RemoveFromCellList(vector<Entity*>& list, Entity* ent) {
+    for (size_t i = 0, iSz = list.size(); i < iSz; i++) {
+        if (list[i] == ent) {
+            list[i] = list[iSz - 1];
+            list.pop_back();
+            return;
+        }
+    }
+}
+static void UnfileEntity(Entity* ent) {
+    if (IsOversized(ent->GridLeft, ent->GridTop, ent->GridRight, ent->GridBottom)) {
+        RemoveFromCellList(SpatialGrid::Oversized, ent);
+        return;
+    }
+
+    // Emptied cells are kept around, since whatever left them
+    // is likely to come back.
+    for (int y = ent->GridTop; y <= ent->GridBottom; y++) {
+        for (int x = ent->GridLeft; x <= ent->GridRight; x++) {
+            auto it = Cells.find(GetCellKey(x, y));
+            if (it != Cells.end())
+                RemoveFromCellList(it->second, ent);
+        }
+    }
+}
+
+PUBLIC STATIC void SpatialGrid::Insert(Entity* ent) {
+    if (ent->GridLeft <= ent->GridRight)
+        return;
+
+    GetFilingRange(ent, &ent->GridLeft, &ent->GridTop, &ent->GridRight, &ent->GridBottom);
+    FileEntity(ent);
+}
+PUBLIC STATIC void SpatialGrid::Remove(Entity* ent) {
+    if (ent->GridLeft > ent->GridRight)
+        return;
+
+    UnfileEntity(ent);
+    ent->GridLeft = 0;
+    ent->GridRight = -1;
+}
+// Files the entity again if it has moved to different cells.
+PUBLIC STATIC void SpatialGrid::Refresh(Entity* ent) {
+    if (ent->GridLeft > ent->GridRight)
+        return;
+
+    int left, top, right, bottom;
+    GetFilingRange(ent, &left, &top, &right, &bottom);
+    if (left == ent->GridLeft && top == ent->GridTop && right == ent->GridRight && bottom == ent->GridBottom)
+        return;
+
+    UnfileEntity(ent);
+    ent->GridLeft = left;
+    ent->GridTop = top;
+    ent->GridRight = right;
+    ent->GridBottom = bottom;
+    FileEntity(ent);
+}
+PUBLIC STATIC void SpatialGrid::Clear() {
+    Cells.clear();
+    Oversized.clear();
+    MinCellX = MinCellY = 0;
+    MaxCellX = MaxCellY = -1;
+}
+PUBLIC STATIC void SpatialGrid::SetCellSize(int size) {
+    if (size < 1 || size == CellSize)
+        return;
+
+    Clear();
+    CellSize = size;
+    for (Entity* ent = Scene::ObjectFirst; ent; ent = ent->NextSceneEntity) {
+        GetFilingRange(ent, &ent->GridLeft, &ent->GridTop, &ent->GridRight, &ent->GridBottom);
+        FileEntity(ent);
+    }
+}
+
+// Candidates filed under more than one cell are only looked at in
+// the first cell that both they and the query cover.
+PUBLIC STATIC void SpatialGrid::GetInRegion(float x, float y, float width, float height, ObjectList* list, vector<Entity*>* results) {
+    float right = x + width;
+    float bottom = y + height;
+    int cellLeft = GetCell(x);
+    int cellTop = GetCell(y);
+    int cellRight = GetCell(right);
+    int cellBottom = GetCell(bottom);
+
+    float boxLeft, boxTop, boxRight, boxBottom;
+    if (IsOversized(cellLeft, cellTop, cellRight, cellBottom)) {
+        Entity* first = list ? list->EntityFirst : Scene::ObjectFirst;
+        for (Entity* ent = first; ent; ent = list ? ent->NextEntityInList : ent->NextSceneEntity) {
+            if (!IsCandidate(ent, list))
+                continue;
+
+            GetEntityBox(ent, &boxLeft, &boxTop, &boxRight, &boxBottom);
+            if (boxRight >= x && boxLeft <= right && boxBottom >= y && boxTop <= bottom)
+                results->push_back(ent);
+        }
+        return;
+    }
+
+    cellLeft = std::max(cellLeft, MinCellX);
+    cellTop = std::max(cellTop, MinCellY);
+    cellRight = std::min(cellRight, MaxCellX);
+    cellBottom = std::min(cellBottom, MaxCellY);
+    for (int cy = cellTop; cy <= cellBottom; cy++) {
+        for (int cx = cellLeft; cx <= cellRight; cx++) {
+            auto it = Cells.find(GetCellKey(cx, cy));
+            if (it == Cells.end())
+                continue;
+
+            vector<Entity*>& cell = it->second;
+            for (size_t i = 0; i < cell.size(); i++) {
+                Entity* ent = cell[i];
+                if (std::max(cellLeft, ent->GridLeft) != cx || std::max(cellTop, ent->GridTop) != cy)
+                    continue;
+                if (!IsCandidate(ent, list))
+                    continue;
+
+                GetEntityBox(ent, &boxLeft, &boxTop, &boxRight, &boxBottom);
+                if (boxRight >= x && boxLeft <= right && boxBottom >= y && boxTop <= bottom)
+                    results->push_back(ent);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < Oversized.size(); i++) {
+        Entity* ent = Oversized[i];
+        if (!IsCandidate(ent, list))
+            continue;
+
+        GetEntityBox(ent, &boxLeft, &boxTop, &boxRight, &boxBottom);
+        if (boxRight >= x && boxLeft <= right && boxBottom >= y && boxTop <= bottom)
+            results->push_back(ent);
+    }
+}
+// Looks through the cells in rings around the point, until the next
+// ring is further away than the closest entity found so far.
+// A maxDistance of 0 or less means there is no limit.
+PUBLIC STATIC Entity* SpatialGrid::GetClosest(float x, float y, ObjectList* list, float maxDistance) {
+    Entity* closest = NULL;
+    float closestDistance = maxDistance > 0.0f ? maxDistance * maxDistance : -1.0f;
+
+    for (size_t i = 0; i < Oversized.size(); i++) {
+        Entity* ent = Oversized[i];
+        if (!IsCandidate(ent, list))
+            continue;
+
+        float distance = GetDistanceSquared(ent, x, y);
+        if (closestDistance < 0.0f || distance < closestDistance || (!closest && distance == closestDistance)) {
+            closestDistance = distance;
+            closest = ent;
+        }
+    }
+
+    if (MinCellX > MaxCellX)
+        return closest;
+
+    int cellX = GetCell(x);
+    int cellY = GetCell(y);
+
+    // Skip the rings that can't reach any filed entity.
+    int ring = 0;
+    ring = std::max(ring, MinCellX - cellX);
+    ring = std::max(ring, cellX - MaxCellX);
+    ring = std::max(ring, MinCellY - cellY);
+    ring = std::max(ring, cellY - MaxCellY);
+
+    for (;; ring++) {
+        if (ring > 0 && closestDistance >= 0.0f) {
+            float reach = (float)(ring - 1) * CellSize;
+            if (reach * reach > closestDistance)
+                break;
+        }
+        if (cellX - ring < MinCellX && cellX + ring > MaxCellX
+            && cellY - ring < MinCellY && cellY + ring > MaxCellY)
+            break;
+
+        int left = std::max(cellX - ring, MinCellX);
+        int right = std::min(cellX + ring, MaxCellX);
+        int top = std::max(cellY - ring, MinCellY);
+        int bottom = std::min(cellY + ring, MaxCellY);
+        for (int cy = top; cy <= bottom; cy++) {
+            // Only the edge of the ring; the inside was done already.
+            int step = 1;
+            if (cy != cellY - ring && cy != cellY + ring)
+                step = ring * 2;
+
+            for (int cx = cellX - ring; cx <= cellX + ring; cx += step) {
+                if (cx < left || cx > right)
+                    continue;
+
+                auto it = Cells.find(GetCellKey(cx, cy));
+                if (it == Cells.end())
+                    continue;
+
+                vector<Entity*>& cell = it->second;
+                for (size_t i = 0; i < cell.size(); i++) {
+                    Entity* ent = cell[i];
+                    if (!IsCandidate(ent, list))
+                        continue;
+
+                    float distance = GetDistanceSquared(ent, x, y);
+                    if (closestDistance < 0.0f || distance < closestDistance || (!closest && distance == closestDistance)) {
+                        closestDistance = distance;
+                        closest = ent;
+                    }
+                }
+            }
+        }
+    }
+
+    return closest;
+}
+// Finds every pair of entities, one from each list, whose hitboxes
+// touch the way Entity::CollideWithObject checks it. The results
+// are stored as consecutive pairs. If both lists are the same, each
+// pair is only reported once.
+PUBLIC STATIC void SpatialGrid::GetOverlappingPairs(ObjectList* listA, ObjectList* listB, vector<Entity*>* results) {
+    bool sameList = listA == listB;
+    if (sameList) {
+        int order = 0;
+        for (Entity* ent = listA->EntityFirst; ent; ent = ent->NextEntityInList)
+            ent->GridMark = order++;
+    }
+
+    for (Entity* entA = listA->EntityFirst; entA; entA = entA->NextEntityInList) {
+        if (!IsCandidate(entA, NULL))
+            continue;
+
+        float boxLeft, boxTop, boxRight, boxBottom;
+        GetEntityBox(entA, &boxLeft, &boxTop, &boxRight, &boxBottom);
+
+        int cellLeft = GetCell(boxLeft);
+        int cellTop = GetCell(boxTop);
+        int cellRight = GetCell(boxRight);
+        int cellBottom = GetCell(boxBottom);
+        if (IsOversized(cellLeft, cellTop, cellRight, cellBottom)) {
+            for (Entity* entB = listB->EntityFirst; entB; entB = entB->NextEntityInList) {
+                if (entB == entA || !IsCandidate(entB, NULL))
+                    continue;
+                if (sameList && entB->GridMark < entA->GridMark)
+                    continue;
+                if (entA->CollideWithObject(entB)) {
+                    results->push_back(entA);
+                    results->push_back(entB);
+                }
+            }
+            continue;
+        }
+
+        for (int cy = cellTop; cy <= cellBottom; cy++) {
+            for (int cx = cellLeft; cx <= cellRight; cx++) {
+                auto it = Cells.find(GetCellKey(cx, cy));
+                if (it == Cells.end())
+                    continue;
+
+                vector<Entity*>& cell = it->second;
+                for (size_t i = 0; i < cell.size(); i++) {
+                    Entity* entB = cell[i];
+                    if (entB == entA || !IsCandidate(entB, listB))
+                        continue;
+                    if (std::max(cellLeft, entB->GridLeft) != cx || std::max(cellTop, entB->GridTop) != cy)
+                        continue;
+                    if (sameList && entB->GridMark < entA->GridMark)
+                        continue;
+                    if (entA->CollideWithObject(entB)) {
+                        results->push_back(entA);
+                        results->push_back(entB);
+                    }
+                }
+            }
+        }
+
+        for (size_t i = 0; i < Oversized.size(); i++) {
+            Entity* entB = Oversized[i];
+            if (entB == entA || !IsCandidate(entB, listB))
+                continue;
+            if (sameList && entB->GridMark < entA->GridMark)
+                continue;
+            if (entA->CollideWithObject(entB)) {
+                results->push_back(entA);
+                results->push_back(entB);
+            }
+        }
+    }
+}
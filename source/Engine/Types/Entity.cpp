@@ -11,38 +11,55 @@
 need_t ObjectList;
 need_t ObjectRegistry;
 need_t DrawGroupList;
+need_t EntityStorage;
 
 class Entity {
 public:
-    float        InitialX = 0;
-    float        InitialY = 0;
+    // Everything the scene looks at for every entity, every frame is
+    // kept together here, so walking the entity lists only touches
+    // the first couple of cache lines of each one.
+    Entity*      PrevEntity = NULL;
+    Entity*      NextEntity = NULL;
+    ObjectList*  List = NULL;
+
     int          Active = true;
     int          Pauseable = true;
-    int          Interactable = true;
-    int          Persistence = Persistence_NONE;
     int          Activity = ACTIVE_BOUNDS;
     int          InRange = false;
-    bool         Created = false;
-    bool         PostCreated = false;
+    int          OnScreen = true;
+    int          WasOffScreen = false;
 
     float        X = 0.0f;
     float        Y = 0.0f;
-    float        Z = 0.0f;
-
     float        XSpeed = 0.0f;
     float        YSpeed = 0.0f;
-    float        GroundSpeed = 0.0f;
     float        Gravity = 0.0f;
-    int          Ground = false;
 
-    int          WasOffScreen = false;
-    int          OnScreen = true;
     float        OnScreenHitboxW = 0.0f;
     float        OnScreenHitboxH = 0.0f;
     float        OnScreenRegionTop = 0.0f;
     float        OnScreenRegionLeft = 0.0f;
     float        OnScreenRegionRight = 0.0f;
     float        OnScreenRegionBottom = 0.0f;
+
+    int          Priority = 0;
+    int          PriorityListIndex = -1;
+    int          PriorityOld = -1;
+    float        Depth = 0.0f;
+    float        OldDepth = 0.0f;
+
+    float        InitialX = 0;
+    float        InitialY = 0;
+    int          Interactable = true;
+    int          Persistence = Persistence_NONE;
+    bool         Created = false;
+    bool         PostCreated = false;
+
+    float        Z = 0.0f;
+
+    float        GroundSpeed = 0.0f;
+    int          Ground = false;
+
     int          ViewRenderFlag = 0xFFFFFFFF;
     int          ViewOverrideFlag = 0;
     float        RenderRegionW = 0.0f;
@@ -60,12 +77,6 @@ public:
     float        Alpha = 1.0;
     int          AutoPhysics = false;
 
-    int          Priority = 0;
-    int          PriorityListIndex = -1;
-    int          PriorityOld = -1;
-
-    float        Depth = 0.0f;
-    float        OldDepth = 0.0f;
     float        ZDepth = 0.0;
 
     int          Sprite = -1;
@@ -103,11 +114,16 @@ public:
     int          SlotID = -1;
 
     bool         Removed = false;
+    EntityStorage* Storage = NULL;
 
-    Entity*      PrevEntity = NULL;
-    Entity*      NextEntity = NULL;
+    // Cells this entity is filed under in the spatial grid.
+    // If GridLeft is past GridRight, it isn't in the grid.
+    int          GridLeft = 0;
+    int          GridTop = 0;
+    int          GridRight = -1;
+    int          GridBottom = -1;
+    int          GridMark = 0;
 
-    ObjectList*  List = NULL;
     Entity*      PrevEntityInList = NULL;
     Entity*      NextEntityInList = NULL;
 
@@ -547,6 +563,9 @@ PUBLIC VIRTUAL void Entity::UpdateEarly() {
 }
 PUBLIC VIRTUAL void Entity::Update() {
 }
+PUBLIC VIRTUAL void Entity::UpdateOnThread(Uint32 threadID) {
+    Update();
+}
 PUBLIC VIRTUAL void Entity::UpdateLate() {
 }
 
@@ -0,0 +1,182 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+
+class EntityBenchmark {
+public:
+    static int DefaultCount;
+};
+#endif
+
+#include <Engine/Types/EntityBenchmark.h>
+
+#include <Engine/Bytecode/ScriptEntity.h>
+#include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Types/EntityStorage.h>
+
+int EntityBenchmark::DefaultCount = 50000;
+
+// Every spawn also makes the allocations a script instance would
+// (the instance and its field table), so that separately allocated
+// entities get spread out the way they are in a running game.
+#define BENCH_INSTANCE_SIZE 96
+#define BENCH_FIELDS_SIZE 256
+
+// Rounds of despawning and respawning a quarter of the entities,
+// like bullets or particles would.
+#define BENCH_CHURN_ROUNDS 4
+
+#define BENCH_PASSES 20
+
+struct EntityBenchList {
+    Entity*        First;
+    Entity*        Last;
+    EntityStorage* Storage;
+    vector<void*>  Allocations;
+    Uint32         Seed;
+};
+
+static Uint32 NextBenchRandom(EntityBenchList* list) {
+    list->Seed = list->Seed * 1103515245 + 12345;
+    return list->Seed >> 16;
+}
+static void SpawnBenchEntity(EntityBenchList* list) {
+    ScriptEntity* ent;
+    void* slot = list->Storage ? list->Storage->Allocate() : NULL;
+    if (slot) {
+        ent = new (slot) ScriptEntity;
+        ent->Storage = list->Storage;
+    }
+    else
+        ent = new ScriptEntity;
+
+    list->Allocations.push_back(malloc(BENCH_INSTANCE_SIZE));
+    list->Allocations.push_back(malloc(BENCH_FIELDS_SIZE));
+
+    Uint32 random = NextBenchRandom(list);
+    ent->X = (float)(random % 4096);
+    ent->Y = (float)(random / 4096 % 2048);
+    ent->XSpeed = (float)(random % 7) - 3.0f;
+    ent->YSpeed = (float)(random % 5) - 2.0f;
+    ent->Gravity = 0.25f;
+    ent->OnScreenHitboxW = 32.0f;
+    ent->OnScreenHitboxH = 32.0f;
+
+    ent->PrevEntity = list->Last;
+    ent->NextEntity = NULL;
+    if (list->Last)
+        list->Last->NextEntity = ent;
+    else
+        list->First = ent;
+    list->Last = ent;
+}
+static void DeleteBenchEntity(EntityBenchList* list, Entity* ent) {
+    if (ent->PrevEntity)
+        ent->PrevEntity->NextEntity = ent->NextEntity;
+    else
+        list->First = ent->NextEntity;
+    if (ent->NextEntity)
+        ent->NextEntity->PrevEntity = ent->PrevEntity;
+    else
+        list->Last = ent->PrevEntity;
+
+    // Every bench entity is a ScriptEntity, but neither type has a
+    // virtual destructor, so it's destroyed as one explicitly.
+    EntityStorage* storage = ent->Storage;
+    ((ScriptEntity*)ent)->~ScriptEntity();
+    if (storage)
+        storage->Free(ent);
+    else
+        ::operator delete(ent);
+}
+static void BuildBenchList(EntityBenchList* list, int count, bool useStorage) {
+    list->First = NULL;
+    list->Last = NULL;
+    list->Storage = useStorage ? new EntityStorage(sizeof(ScriptEntity)) : NULL;
+    list->Seed = 0x5EED;
+
+    for (int i = 0; i < count; i++)
+        SpawnBenchEntity(list);
+
+    for (int round = 0; round < BENCH_CHURN_ROUNDS; round++) {
+        int removed = 0;
+        for (Entity* ent = list->First, *next; ent; ent = next) {
+            next = ent->NextEntity;
+            if (NextBenchRandom(list) % 4 == 0) {
+                DeleteBenchEntity(list, ent);
+                removed++;
+            }
+        }
+        for (int i = 0; i < removed; i++)
+            SpawnBenchEntity(list);
+    }
+}
+static void DisposeBenchList(EntityBenchList* list) {
+    for (Entity* ent = list->First, *next; ent; ent = next) {
+        next = ent->NextEntity;
+        DeleteBenchEntity(list, ent);
+    }
+    for (size_t i = 0; i < list->Allocations.size(); i++)
+        free(list->Allocations[i]);
+    list->Allocations.clear();
+
+    if (list->Storage)
+        list->Storage->Release();
+}
+
+static double RunMotionPass(EntityBenchList* list) {
+    double elapsed = Clock::GetTicks();
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        for (Entity* ent = list->First; ent; ent = ent->NextEntity) {
+            if (!ent->Active)
+                continue;
+            ent->YSpeed += ent->Gravity;
+            ent->X += ent->XSpeed;
+            ent->Y += ent->YSpeed;
+        }
+    }
+    return Clock::GetTicks() - elapsed;
+}
+static double RunRangePass(EntityBenchList* list, int* inRange) {
+    double elapsed = Clock::GetTicks();
+    int found = 0;
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        for (Entity* ent = list->First; ent; ent = ent->NextEntity) {
+            if (!ent->Active)
+                continue;
+            float halfW = ent->OnScreenHitboxW * 0.5f;
+            float halfH = ent->OnScreenHitboxH * 0.5f;
+            ent->InRange = ent->X + halfW >= 0.0f && ent->X - halfW < 1920.0f
+                && ent->Y + halfH >= 0.0f && ent->Y - halfH < 1080.0f;
+            found += ent->InRange;
+        }
+    }
+    *inRange = found;
+    return Clock::GetTicks() - elapsed;
+}
+static void PrintBenchResult(const char* name, double elapsed, int count) {
+    double perEntity = elapsed * 1000000.0 / ((double)count * BENCH_PASSES);
+    Log::Print(Log::LOG_INFO, "%-20s %9.3f ms  %9.2f ns/entity", name, elapsed, perEntity);
+}
+
+PUBLIC STATIC void EntityBenchmark::Run(int count) {
+    if (count <= 0)
+        count = DefaultCount;
+
+    Log::Print(Log::LOG_IMPORTANT, "Entity Benchmark (%d entities, %d passes):", count, BENCH_PASSES);
+    Log::Print(Log::LOG_INFO, "Entity size:          %8u bytes", (Uint32)sizeof(ScriptEntity));
+
+    const char* layoutNames[] = { "Separate allocations:", "Entity storage:" };
+    for (int layout = 0; layout < 2; layout++) {
+        EntityBenchList list;
+        BuildBenchList(&list, count, layout == 1);
+
+        int inRange = 0;
+        Log::Print(Log::LOG_IMPORTANT, "%s", layoutNames[layout]);
+        PrintBenchResult("Motion pass", RunMotionPass(&list), count);
+        PrintBenchResult("Range check pass", RunRangePass(&list, &inRange), count);
+        Log::Print(Log::LOG_VERBOSE, "%d entities in range", inRange / BENCH_PASSES);
+
+        DisposeBenchList(&list);
+    }
+}
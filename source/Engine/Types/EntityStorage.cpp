@@ -0,0 +1,91 @@
+#if INTERFACE
+#include <Engine/Includes/Standard.h>
+
+class EntityStorage {
+public:
+    size_t         SlotSize = 0;
+    Uint32         SlotCount = 0;
+    Uint32         LiveCount = 0;
+    bool           Released = false;
+
+    vector<void*>  Blocks;
+    void*          FreeList = NULL;
+    Uint8*         NextSlot = NULL;
+    Uint8*         BlockEnd = NULL;
+};
+#endif
+
+#include <Engine/Types/EntityStorage.h>
+
+#include <Engine/Diagnostics/Memory.h>
+
+// Blocks start small, since most classes only ever have a few
+// entities, and double up to this many slots.
+#define ENTITY_STORAGE_FIRST_BLOCK 8
+#define ENTITY_STORAGE_MAX_BLOCK 256
+
+// Slots start on a cache line, so an entity's hot fields always
+// take up as few lines as they can.
+#define ENTITY_STORAGE_ALIGN 64
+
+PUBLIC EntityStorage::EntityStorage(size_t slotSize) {
+    if (slotSize < sizeof(void*))
+        slotSize = sizeof(void*);
+    SlotSize = (slotSize + ENTITY_STORAGE_ALIGN - 1) & ~(size_t)(ENTITY_STORAGE_ALIGN - 1);
+}
+PUBLIC EntityStorage::~EntityStorage() {
+    for (size_t i = 0; i < Blocks.size(); i++)
+        Memory::Free(Blocks[i]);
+    Blocks.clear();
+}
+
+PRIVATE bool EntityStorage::AddBlock() {
+    Uint32 slots = SlotCount ? SlotCount : ENTITY_STORAGE_FIRST_BLOCK;
+    if (slots > ENTITY_STORAGE_MAX_BLOCK)
+        slots = ENTITY_STORAGE_MAX_BLOCK;
+
+    Uint8* block = (Uint8*)Memory::TrackedMalloc("EntityStorage::Block", SlotSize * slots + ENTITY_STORAGE_ALIGN);
+    if (!block)
+        return false;
+
+    Blocks.push_back(block);
+    SlotCount += slots;
+    NextSlot = (Uint8*)(((uintptr_t)block + ENTITY_STORAGE_ALIGN - 1) & ~(uintptr_t)(ENTITY_STORAGE_ALIGN - 1));
+    BlockEnd = NextSlot + SlotSize * slots;
+    return true;
+}
+
+PUBLIC void* EntityStorage::Allocate() {
+    void* slot;
+    if (FreeList) {
+        slot = FreeList;
+        FreeList = *(void**)slot;
+    }
+    else {
+        if (NextSlot == BlockEnd && !AddBlock())
+            return NULL;
+
+        slot = NextSlot;
+        NextSlot += SlotSize;
+    }
+
+    LiveCount++;
+    return slot;
+}
+PUBLIC void EntityStorage::Free(void* slot) {
+    *(void**)slot = FreeList;
+    FreeList = slot;
+
+    LiveCount--;
+    if (Released && LiveCount == 0)
+        delete this;
+}
+// Called by the owning object list when it goes away. Entities can
+// outlive their list (persistent ones, or ones that changed class),
+// so the storage stays around until the last one is freed.
+PUBLIC void EntityStorage::Release() {
+    if (LiveCount == 0)
+        delete this;
+    else
+        Released = true;
+}
@@ -48,6 +48,15 @@ struct Sensor {
     int Angle;
 };
 
+struct SensorProbe {
+    int X;
+    int Y;
+    int Direction;
+    int Length;
+    int Plane;
+    int CompareAngle; // -1 to not compare
+};
+
 struct CollisionSensor {
     float   X;
     float   Y;
@@ -1,11 +1,13 @@
 #if INTERFACE
 #include <Engine/Includes/Standard.h>
 #include <Engine/Types/Entity.h>
+#include <Engine/Types/EntityStorage.h>
 
 class ObjectList {
 public:
     int     EntityCount = 0;
     int     Activity = ACTIVE_NORMAL;
+    bool    ParallelSafe = false;
     Entity* EntityFirst = nullptr;
     Entity* EntityLast = nullptr;
 
@@ -15,6 +17,8 @@ public:
 
     ObjectListPerformance Performance;
 
+    EntityStorage* Storage = nullptr;
+
     Entity* (*SpawnFunction)(ObjectList*) = nullptr;
 };
 #endif
@@ -36,6 +40,9 @@ PUBLIC         ObjectList::~ObjectList() {
     Memory::Free(ObjectName);
     Memory::Free(LoadFunctionName);
     Memory::Free(GlobalUpdateFunctionName);
+
+    if (Storage)
+        Storage->Release();
 }
 
 // Double linked-list functions